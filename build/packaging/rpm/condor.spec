@@ -1458,6 +1458,7 @@ rm -rf %{buildroot}
 %_bindir/classad_version
 %_libdir/libclassad.so
 %dir %_includedir/classad/
+%_includedir/classad/arena.h
 %_includedir/classad/attrrefs.h
 %_includedir/classad/cclassad.h
 %_includedir/classad/classad_distribution.h
@@ -1469,6 +1470,7 @@ rm -rf %{buildroot}
 %_includedir/classad/collectionBase.h
 %_includedir/classad/collection.h
 %_includedir/classad/common.h
+%_includedir/classad/compiledExpr.h
 %_includedir/classad/debug.h
 %_includedir/classad/exprList.h
 %_includedir/classad/exprTree.h
@@ -1483,6 +1485,7 @@ rm -rf %{buildroot}
 %_includedir/classad/natural_cmp.h
 %_includedir/classad/operators.h
 %_includedir/classad/query.h
+%_includedir/classad/regexCache.h
 %_includedir/classad/sink.h
 %_includedir/classad/source.h
 %_includedir/classad/transaction.h
@@ -0,0 +1,262 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "classad/common.h"
+#include "classad/arena.h"
+#include <atomic>
+#include <stdint.h>
+#include <cstddef>
+
+namespace classad {
+
+// every allocation is rounded up to this so that objects stay aligned
+#define ARENA_ALIGN alignof(std::max_align_t)
+
+static thread_local ClassAdArena *currentArena = NULL;
+
+// Each block starts with a count of the objects in it that have not been
+// freed, so that the arena can carve a block up again once everything in
+// it is gone.  A tool that parses, prints and deletes one ad at a time thus
+// keeps reusing the same few blocks.
+struct ArenaBlockHeader {
+	std::atomic<size_t> live;
+};
+static const size_t ARENA_HEADER_SIZE =
+	(sizeof(ArenaBlockHeader) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+// Blocks are allocated aligned to their size, so the block that owns a
+// pointer can be found by masking off the low bits.  Live blocks are
+// recorded in a fixed size open addressed table that is read without a
+// lock, and each block may only be in the first ARENA_PROBES slots after
+// its hash, so a lookup is a handful of atomic loads.  The table is only
+// consulted when at least one block exists, so a process that never uses
+// an arena pays nothing extra to free ClassAd nodes.
+#define ARENA_TABLE_SIZE (1 << 16)
+#define ARENA_PROBES 16
+static std::atomic<size_t> liveBlocks(0);
+static std::atomic<uintptr_t> blockTable[ARENA_TABLE_SIZE];
+
+static inline uintptr_t
+blockOf( const void *p )
+{
+	return (uintptr_t)p & ~(uintptr_t)(ClassAdArena::ARENA_BLOCK_SIZE - 1);
+}
+
+static inline size_t
+blockSlot( uintptr_t block )
+{
+	return (size_t)(((block / ClassAdArena::ARENA_BLOCK_SIZE) * 0x9E3779B97F4A7C15ull) >> 48) & (ARENA_TABLE_SIZE - 1);
+}
+
+static bool
+registerBlock( uintptr_t block )
+{
+	size_t slot = blockSlot(block);
+	for (int ii = 0; ii < ARENA_PROBES; ++ii) {
+		uintptr_t expected = 0;
+		if (blockTable[(slot + ii) & (ARENA_TABLE_SIZE - 1)].compare_exchange_strong(expected, block)) {
+			liveBlocks++;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void
+unregisterBlock( uintptr_t block )
+{
+	size_t slot = blockSlot(block);
+	for (int ii = 0; ii < ARENA_PROBES; ++ii) {
+		std::atomic<uintptr_t> &entry = blockTable[(slot + ii) & (ARENA_TABLE_SIZE - 1)];
+		if (entry.load(std::memory_order_relaxed) == block) {
+			entry.store(0);
+			liveBlocks--;
+			return;
+		}
+	}
+}
+
+static inline ArenaBlockHeader *
+headerOf( const void *p )
+{
+	uintptr_t block = blockOf(p);
+	if (liveBlocks.load(std::memory_order_acquire) == 0) {
+		return NULL;
+	}
+	size_t slot = blockSlot(block);
+	for (int ii = 0; ii < ARENA_PROBES; ++ii) {
+		if (blockTable[(slot + ii) & (ARENA_TABLE_SIZE - 1)].load(std::memory_order_acquire) == block) {
+			return (ArenaBlockHeader *)block;
+		}
+	}
+	return NULL;
+}
+
+ClassAdArena::
+ClassAdArena() : cur(0), reuse(0), next(NULL), end(NULL), bytes_used(0)
+{
+}
+
+ClassAdArena::
+~ClassAdArena()
+{
+	Reset();
+}
+
+// start carving from the given block
+void ClassAdArena::
+useBlock( size_t index )
+{
+	cur = index;
+	next = blocks[index] + ARENA_HEADER_SIZE;
+	end = blocks[index] + ARENA_BLOCK_SIZE;
+}
+
+bool ClassAdArena::
+newBlock()
+{
+	// look at a few of the blocks we already have for one that is empty
+	// again, rather than at all of them, so that an arena that keeps its
+	// objects does not pay for the search on every block.
+	for (size_t ii = 0; ii < blocks.size() && ii < 4; ++ii) {
+		reuse = (reuse + 1) % blocks.size();
+		if (reuse != cur && ((ArenaBlockHeader *)blocks[reuse])->live.load(std::memory_order_acquire) == 0) {
+			useBlock(reuse);
+			return true;
+		}
+	}
+
+	char *block = (char *)::operator new(ARENA_BLOCK_SIZE, std::align_val_t(ARENA_BLOCK_SIZE));
+	new (block) ArenaBlockHeader();
+	((ArenaBlockHeader *)block)->live = 0;
+	if ( ! registerBlock((uintptr_t)block)) {
+		// the table is full around this address, let the caller use the heap
+		::operator delete(block, std::align_val_t(ARENA_BLOCK_SIZE));
+		return false;
+	}
+	blocks.push_back(block);
+	useBlock(blocks.size() - 1);
+	return true;
+}
+
+void *ClassAdArena::
+Allocate( size_t size )
+{
+	size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+	if (size > ARENA_BLOCK_SIZE - ARENA_HEADER_SIZE) {
+		return NULL;
+	}
+	if ( ! next || (size_t)(end - next) < size) {
+		if (next && ((ArenaBlockHeader *)blocks[cur])->live.load(std::memory_order_acquire) == 0) {
+			// everything in the current block is gone, start it over
+			useBlock(cur);
+		}
+		if ((size_t)(end - next) < size && ! newBlock()) {
+			return NULL;
+		}
+	}
+	((ArenaBlockHeader *)blocks[cur])->live.fetch_add(1, std::memory_order_relaxed);
+	void *p = next;
+	next += size;
+	bytes_used += size;
+	return p;
+}
+
+void ClassAdArena::
+Reset()
+{
+	for (char *block : blocks) {
+		unregisterBlock((uintptr_t)block);
+		((ArenaBlockHeader *)block)->~ArenaBlockHeader();
+		::operator delete(block, std::align_val_t(ARENA_BLOCK_SIZE));
+	}
+	blocks.clear();
+	cur = reuse = 0;
+	next = end = NULL;
+	bytes_used = 0;
+}
+
+ClassAdArena *ClassAdArena::
+Current()
+{
+	return currentArena;
+}
+
+void *ClassAdArena::
+New( size_t size )
+{
+	ClassAdArena *arena = currentArena;
+	if (arena && size <= MAX_OBJECT_SIZE) {
+		void *p = arena->Allocate(size);
+		if (p) {
+			return p;
+		}
+	}
+	return ::operator new(size);
+}
+
+bool ClassAdArena::
+Owns( const void *p )
+{
+	return p && headerOf(p) != NULL;
+}
+
+void ClassAdArena::
+Free( void *p )
+{
+	if ( ! p) {
+		return;
+	}
+	ArenaBlockHeader *header = headerOf(p);
+	if (header) {
+		header->live.fetch_sub(1, std::memory_order_release);
+		return;
+	}
+	::operator delete(p);
+}
+
+ClassAdArenaScope::
+ClassAdArenaScope( ClassAdArena *arena ) : prev(currentArena), active(arena != NULL)
+{
+	if (active) {
+		currentArena = arena;
+	}
+}
+
+ClassAdArenaScope::
+~ClassAdArenaScope()
+{
+	if (active) {
+		currentArena = prev;
+	}
+}
+
+ClassAdHeapScope::
+ClassAdHeapScope() : prev(currentArena)
+{
+	currentArena = NULL;
+}
+
+ClassAdHeapScope::
+~ClassAdHeapScope()
+{
+	currentArena = prev;
+}
+
+} // classad
@@ -34,15 +34,17 @@ AttributeReference()
 	parentScope = NULL;
 	expr = NULL;
 	absolute = false;
+	attributeAtom = NULL;
 }
 
 
 // a private ctor for use in significant expr identification
 AttributeReference::
-AttributeReference( ExprTree *tree, const string &attrname, bool absolut )
+AttributeReference( ExprTree *tree, const string &attrname, bool absolut, const AttrNameAtom *atom )
 {
 	parentScope = NULL;
 	attributeStr = attrname;
+	attributeAtom = atom ? atom : TryInternAttrName(attrname);
 	expr = tree;
 	absolute = absolut;
 }
@@ -50,6 +52,7 @@ AttributeReference( ExprTree *tree, const string &attrname, bool absolut )
 AttributeReference::
 AttributeReference(const AttributeReference &ref)
 {
+	expr = NULL;
     CopyFrom(ref);
     return;
 }
@@ -97,6 +100,7 @@ CopyFrom(const AttributeReference &ref)
 
 	parentScope = ref.parentScope;
 	attributeStr = ref.attributeStr;
+	attributeAtom = ref.attributeAtom;
 	if( ref.expr && ( expr=ref.expr->Copy( ) ) == NULL ) {
         success = false;
 	} else {
@@ -112,7 +116,10 @@ bool AttributeReference::SetComponents( ExprTree *tree, const std::string &attr,
 		if (expr) delete expr;
 		expr = tree;
 	}
-	attributeStr = attr;
+	if (attributeStr != attr || ! attributeAtom) {
+		attributeStr = attr;
+		attributeAtom = TryInternAttrName(attr);
+	}
 	absolute = abs;
 	return true;
 }
@@ -260,7 +267,7 @@ _Evaluate (EvalState &state, Value &val, ExprTree *&sig ) const
 		}
 		default:  CLASSAD_EXCEPT( "ClassAd:  Should not reach here" );
 	}
-	if(!rval || !(sig=new AttributeReference(exprSig,attributeStr,absolute))){
+	if(!rval || !(sig=new AttributeReference(exprSig,attributeStr,absolute,attributeAtom))){
 		if( rval ) {
 			CondorErrno = ERR_MEM_ALLOC_FAILED;
 			CondorErrMsg = "";
@@ -421,9 +428,9 @@ FindExpr(EvalState &state, ExprTree *&tree, ExprTree *&sig, bool wantSig) const
 					return( EVAL_FAIL );
 				} else {
 					AttributeReference *attrRef = NULL;
-					attrRef = MakeAttributeReference( currExpr->Copy( ),
+					attrRef = new AttributeReference( currExpr->Copy( ),
 												  attributeStr,
-												  false );
+												  false, attributeAtom );
 					val.Clear( );
 						// Create new EvalState, within this scope, because
 						// attrRef is only temporary, so we do not want to
@@ -482,9 +489,17 @@ FindExpr(EvalState &state, ExprTree *&tree, ExprTree *&sig, bool wantSig) const
 		 * Expect alternateScope to be removed from a future release.
 		 */
 	if (!current) { return EVAL_UNDEF; }
-	int rc = current->LookupInScope( attributeStr, tree, state );
+	if ( ! attributeAtom) {
+		// a default constructed reference, or the atom table was full
+		int rc = current->LookupInScope( attributeStr, tree, state );
+		if ( !expr && !absolute && rc == EVAL_UNDEF && current->alternateScope ) {
+			rc = current->alternateScope->LookupInScope( attributeStr, tree, state );
+		}
+		return rc;
+	}
+	int rc = current->LookupInScope( *attributeAtom, tree, state );
 	if ( !expr && !absolute && rc == EVAL_UNDEF && current->alternateScope ) {
-		rc = current->alternateScope->LookupInScope( attributeStr, tree, state );
+		rc = current->alternateScope->LookupInScope( *attributeAtom, tree, state );
 	}
 	return rc;
 }
@@ -58,6 +58,19 @@ bool ClassAdGetExpressionCaching()
 	return doExpressionCaching;
 }
 
+// Should cached expressions and match expressions be compiled to
+// bytecode before evaluation. The default is false.
+static bool doExpressionCompiling = false;
+
+void ClassAdSetExpressionCompiling(bool do_compiling) {
+	doExpressionCompiling = do_compiling;
+}
+
+bool ClassAdGetExpressionCompiling()
+{
+	return doExpressionCompiling;
+}
+
 // This is probably not the best place to put these. However, 
 // I am reconsidering how we want to do errors, and this may all
 // change in any case. 
@@ -726,10 +739,89 @@ LookupInScope( const string &name, const ClassAd *&finalScope ) const
 }
 
 
+// Kinds of attribute names that LookupInScope() resolves specially
+// when they are not defined in any enclosing scope.
+enum SpecialAttrKind {
+	SPECIAL_ATTR_NONE,
+	SPECIAL_ATTR_TOPLEVEL,		// toplevel, root
+	SPECIAL_ATTR_SELF,			// self, my
+	SPECIAL_ATTR_PARENT,		// parent
+	SPECIAL_ATTR_CURRENT_TIME	// CurrentTime
+};
+
+static SpecialAttrKind specialAttrKind( const string &name )
+{
+	if ( getSpecialAttrNames().find(name) == getSpecialAttrNames().end() ) {
+		return SPECIAL_ATTR_NONE;
+	}
+	if( strcasecmp(name.c_str( ),ATTR_TOPLEVEL)==0 ||
+		strcasecmp(name.c_str( ),ATTR_ROOT)==0 ) {
+		return SPECIAL_ATTR_TOPLEVEL;
+	}
+	if( strcasecmp( name.c_str( ), ATTR_SELF ) == 0 ||
+		strcasecmp( name.c_str( ), ATTR_MY ) == 0 ) {
+		return SPECIAL_ATTR_SELF;
+	}
+	if( strcasecmp( name.c_str( ), ATTR_PARENT ) == 0 ) {
+		return SPECIAL_ATTR_PARENT;
+	}
+	if( strcasecmp( name.c_str( ), ATTR_CURRENT_TIME ) == 0 ) {
+		return SPECIAL_ATTR_CURRENT_TIME;
+	}
+	return SPECIAL_ATTR_NONE;
+}
+
+// Same as above, but comparing atoms rather than strings
+static SpecialAttrKind specialAttrKind( const AttrNameAtom &atom )
+{
+	static const AttrNameAtom *toplevel = InternAttrName( ATTR_TOPLEVEL );
+	static const AttrNameAtom *root = InternAttrName( ATTR_ROOT );
+	static const AttrNameAtom *self = InternAttrName( ATTR_SELF );
+	static const AttrNameAtom *parent = InternAttrName( ATTR_PARENT );
+	static const AttrNameAtom *my = InternAttrName( ATTR_MY );
+	static const AttrNameAtom *current_time = InternAttrName( ATTR_CURRENT_TIME );
+
+	if ( &atom == toplevel || &atom == root ) {
+		return SPECIAL_ATTR_TOPLEVEL;
+	}
+	if ( &atom == self ) {
+		return SPECIAL_ATTR_SELF;
+	}
+	if ( &atom == parent ) {
+		return SPECIAL_ATTR_PARENT;
+	}
+	// my and CurrentTime are only special for old ClassAd semantics
+	// see SetOldClassAdSemantics()
+	if ( _useOldClassAdSemantics ) {
+		if ( &atom == my ) {
+			return SPECIAL_ATTR_SELF;
+		}
+		if ( &atom == current_time ) {
+			return SPECIAL_ATTR_CURRENT_TIME;
+		}
+	}
+	return SPECIAL_ATTR_NONE;
+}
+
 int ClassAd::
 LookupInScope(const string &name, ExprTree*& expr, EvalState &state) const
+{
+	return _LookupInScope( name, expr, state );
+}
+
+int ClassAd::
+LookupInScope(const AttrNameAtom &name, ExprTree*& expr, EvalState &state) const
+{
+	return _LookupInScope( name, expr, state );
+}
+
+template <typename Name>
+int ClassAd::
+_LookupInScope(const Name &name, ExprTree*& expr, EvalState &state) const
 {
 	const ClassAd *current = this, *superScope;
+	SpecialAttrKind special = SPECIAL_ATTR_NONE;
+	bool special_known = false;
 
 	expr = NULL;
 
@@ -748,30 +840,34 @@ LookupInScope(const string &name, ExprTree*& expr, EvalState &state) const
 		} else {
 			superScope = current->parentScope;
 		}
-		if ( getSpecialAttrNames().find(name) == getSpecialAttrNames().end() ) {
+		if ( ! special_known ) {
+			special = specialAttrKind( name );
+			special_known = true;
+		}
+		switch ( special ) {
+		case SPECIAL_ATTR_NONE:
 			// continue searching from the superScope ...
 			current = superScope;
 			if( current == this ) {		// NAC - simple loop checker
 				return( EVAL_UNDEF );
 			}
-		} else if(strcasecmp(name.c_str( ),ATTR_TOPLEVEL)==0 ||
-				strcasecmp(name.c_str( ),ATTR_ROOT)==0){
+			break;
+		case SPECIAL_ATTR_TOPLEVEL:
 			// if the "toplevel" attribute was requested ...
 			expr = (ClassAd*)state.rootAd;
 			if( expr == NULL ) {	// NAC - circularity so no root
 				return EVAL_FAIL;  	// NAC
 			}						// NAC
 			return( expr ? EVAL_OK : EVAL_UNDEF );
-		} else if( strcasecmp( name.c_str( ), ATTR_SELF ) == 0 ||
-				   strcasecmp( name.c_str( ), ATTR_MY ) == 0 ) {
+		case SPECIAL_ATTR_SELF:
 			// if the "self" ad was requested
 			expr = (ClassAd*)state.curAd;
 			return( expr ? EVAL_OK : EVAL_UNDEF );
-		} else if( strcasecmp( name.c_str( ), ATTR_PARENT ) == 0 ) {
+		case SPECIAL_ATTR_PARENT:
 			// the lexical parent
 			expr = (ClassAd*)superScope;
 			return( expr ? EVAL_OK : EVAL_UNDEF );
-		} else if( strcasecmp( name.c_str( ), ATTR_CURRENT_TIME ) == 0 ) {
+		case SPECIAL_ATTR_CURRENT_TIME:
 			// an alias for time() from old ClassAds
 			expr = getCurrentTimeExpr();
 			return ( expr ? EVAL_OK : EVAL_UNDEF );
@@ -0,0 +1,167 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef __CLASSAD_ARENA_H__
+#define __CLASSAD_ARENA_H__
+
+#include <stddef.h>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace classad {
+
+/** A monotonic allocator for ClassAds that are created and destroyed
+	together, such as the ads returned by a single query.
+
+	While a ClassAdArenaScope for an arena is active on a thread, every
+	ExprTree node (including ClassAds themselves) and every string held
+	by a Value that the thread creates is carved out of large blocks owned
+	by the arena instead of being allocated individually.  Deleting such an
+	object runs its destructor, and once every object in a block has been
+	deleted the arena carves that block up again.  The blocks themselves
+	are returned all at once when the arena is destroyed or Reset().
+
+	Rules of use:
+	- Every object allocated from an arena must be destroyed before the
+	  arena is destroyed or Reset().
+	- An arena is not thread-safe; only one thread at a time may have a
+	  scope active for it.  Objects allocated from it may be read and
+	  destroyed from any thread.
+	- Only the nodes and string payloads come from the arena.  Attribute
+	  tables and long string buffers still use the ordinary heap.
+
+	When no arena exists in the process, allocation and deletion cost the
+	same as plain new and delete.
+*/
+class ClassAdArena
+{
+	public:
+		ClassAdArena();
+		~ClassAdArena();
+
+		/// Allocate size bytes from this arena, returns NULL if no block
+		/// could be had for it
+		void *Allocate( size_t size );
+
+		/// Release all memory held by the arena, keeping the arena usable
+		void Reset();
+
+		/// Number of bytes handed out since the last Reset()
+		size_t BytesAllocated() const { return bytes_used; }
+
+		/// Number of blocks currently owned by the arena
+		size_t BlocksAllocated() const { return blocks.size(); }
+
+		/// The arena that is active on this thread, or NULL
+		static ClassAdArena *Current();
+
+		/** Allocate from the arena active on this thread, or from the heap
+			if there is none.  Memory from here must be freed with Free().
+		*/
+		static void *New( size_t size );
+
+		/// Free memory obtained from New().  Arena memory is reused once
+		/// everything else in its block has been freed too.
+		static void Free( void *p );
+
+		/// Returns true if p was allocated from any arena that still exists
+		static bool Owns( const void *p );
+
+		/// Size of the blocks the arena carves objects from
+		static const size_t ARENA_BLOCK_SIZE = 64 * 1024;
+
+		/// Larger allocations always go to the heap
+		static const size_t MAX_OBJECT_SIZE = ARENA_BLOCK_SIZE / 8;
+
+	private:
+		ClassAdArena(const ClassAdArena &);
+		ClassAdArena &operator=(const ClassAdArena &);
+
+		bool newBlock();
+		void useBlock( size_t index );
+
+		std::vector<char *> blocks;
+		size_t cur;		// the block we are carving from
+		size_t reuse;	// where newBlock() last looked for an empty block
+		char *next;
+		char *end;
+		size_t bytes_used;
+
+		friend class ClassAdArenaScope;
+		friend class ClassAdHeapScope;
+};
+
+/** Makes an arena the target of ClassAd allocations on this thread for
+	the lifetime of the scope, restoring the previous target afterwards.
+	A NULL arena leaves the current target alone.
+*/
+class ClassAdArenaScope
+{
+	public:
+		explicit ClassAdArenaScope( ClassAdArena *arena );
+		~ClassAdArenaScope();
+	private:
+		ClassAdArenaScope(const ClassAdArenaScope &);
+		ClassAdArenaScope &operator=(const ClassAdArenaScope &);
+		ClassAdArena *prev;
+		bool active;
+};
+
+/** Forces ClassAd allocations on this thread back to the heap for the
+	lifetime of the scope.  Used for objects that outlive the ad that
+	caused them to be created, such as entries in the expression cache.
+*/
+class ClassAdHeapScope
+{
+	public:
+		ClassAdHeapScope();
+		~ClassAdHeapScope();
+	private:
+		ClassAdHeapScope(const ClassAdHeapScope &);
+		ClassAdHeapScope &operator=(const ClassAdHeapScope &);
+		ClassAdArena *prev;
+};
+
+/// Construct a T with memory from ClassAdArena::New()
+template <class T, class... Args>
+T *ClassAdArenaNew( Args&&... args )
+{
+	void *mem = ClassAdArena::New(sizeof(T));
+	try {
+		return new (mem) T(std::forward<Args>(args)...);
+	} catch (...) {
+		ClassAdArena::Free(mem);
+		throw;
+	}
+}
+
+/// Destroy an object created with ClassAdArenaNew()
+template <class T>
+void ClassAdArenaDelete( T *p )
+{
+	if (p) {
+		p->~T();
+		ClassAdArena::Free(p);
+	}
+}
+
+} // classad
+
+#endif//__CLASSAD_ARENA_H__
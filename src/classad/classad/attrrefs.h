@@ -96,13 +96,19 @@ class AttributeReference : public ExprTree
 
 		static int Deref(const AttributeReference & ref, EvalState &, ExprTree*&);
 
+		/** Get the interned name of the attribute being referred to.
+			The atom is looked up once when the reference is made, so
+			evaluating the reference does not need to hash the name.
+		*/
+		const AttrNameAtom * GetAtom() const { return attributeAtom; }
+
 	protected:
 		/// Constructor
     	AttributeReference ();
 
   	private:
-		// private ctor for internal use
-		AttributeReference( ExprTree*, const std::string &, bool );
+		// private ctor for internal use, interns the name if atom is NULL
+		AttributeReference( ExprTree*, const std::string &, bool, const AttrNameAtom *atom = NULL );
 		virtual void _SetParentScope( const ClassAd* p );
     	virtual bool _Evaluate( EvalState & , Value & ) const;
     	virtual bool _Evaluate( EvalState & , Value &, ExprTree*& ) const;
@@ -114,6 +120,7 @@ class AttributeReference : public ExprTree
 		ExprTree	*expr;
 		bool		absolute;
     	std::string attributeStr;
+		const AttrNameAtom *attributeAtom;
 };
 
 } // classad
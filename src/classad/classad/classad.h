@@ -49,6 +49,22 @@ void ClassAdLibraryVersion(std::string &version_string);
 void ClassAdSetExpressionCaching(bool do_caching);
 bool ClassAdGetExpressionCaching();
 
+// Should cached expressions and match expressions be compiled to a
+// flat bytecode program the first time they are evaluated.
+// The default is false.
+void ClassAdSetExpressionCompiling(bool do_compiling);
+bool ClassAdGetExpressionCompiling();
+
+// Maximum number of compiled regular expressions kept by the regexp
+// family of functions. Zero disables the cache. The default is 128.
+void ClassAdSetRegexCacheSize(size_t max_entries);
+size_t ClassAdGetRegexCacheSize();
+
+// Should regular expressions be JIT compiled when they are added to
+// the regex cache. The default is false.
+void ClassAdSetRegexJIT(bool do_jit);
+bool ClassAdGetRegexJIT();
+
 // This flag is only meant for use in Condor, which is transitioning
 // from an older version of ClassAds with slightly different evaluation
 // semantics. It will be removed without warning in a future release.
@@ -866,6 +882,9 @@ class ClassAd : public ExprTree
 		virtual bool _Flatten( EvalState&, Value&, ExprTree*&, int* ) const;
 	
 		int LookupInScope( const std::string&, ExprTree*&, EvalState& ) const;
+		int LookupInScope( const AttrNameAtom&, ExprTree*&, EvalState& ) const;
+		template <typename Name>
+		int _LookupInScope( const Name&, ExprTree*&, EvalState& ) const;
 		AttrList	  attrList;
 		DirtyAttrList dirtyAttrList;
 		bool          do_dirty_tracking;
@@ -21,24 +21,31 @@
 
 #include "classad/exprTree.h"
 #include <string>
+#include <atomic>
 
 namespace classad {
 
+class CompiledExpr;
+
 class CacheEntry
 {
 public: 
-	CacheEntry() : pData(NULL) {}
+	CacheEntry() : pData(NULL), pCompiled(NULL), hash(0) {}
 	CacheEntry(const std::string & szNameIn, const std::string & szValueIn, ExprTree * pDataIn)
 		: szName(szNameIn)
 		, szValue(szValueIn)
 		, pData(pDataIn)
+		, pCompiled(NULL)
+		, hash(0)
 	{}
 
 	virtual ~CacheEntry();
 
 	std::string szName;    // string space the names.
 	std::string szValue;   // reference back for cleanup
-	ExprTree * pData;
+	std::atomic<ExprTree*> pData;  // NULL until a lazy entry is first parsed
+	std::atomic<CompiledExpr*> pCompiled; // program compiled from pData, shared by every envelope of this letter
+	std::atomic<size_t> hash;  // StructuralHash() of pData, 0 until computed
 };
 
 typedef classad_weak_ptr< CacheEntry > pCacheEntry;
@@ -85,6 +92,23 @@ public:
 	ExprTree * get() const;
 	const std::string & get_unparsed_str() const;
 
+	/**
+	 * parses every lazily cached expression in the ad that has not been
+	 * parsed yet, so that threads that go on to share the ad only read it.
+	 */
+	static void parse_lazy(const ClassAd & ad);
+
+	/**
+	 * returns the compiled program for the letter, compiling it on first
+	 * use. returns NULL if the expression is not worth compiling.
+	 */
+	const CompiledExpr * get_compiled() const;
+
+	/**
+	 * returns the StructuralHash() of the letter, computing it on first use.
+	 */
+	size_t get_hash() const;
+
 	virtual const ClassAd *GetParentScope( ) const { return( parentScope ); }
 
 protected:
@@ -206,9 +206,56 @@ struct CaseIgnSizeLTStr {
 	}
 };
 
+/** An attribute name interned in the global atom table by InternAttrName().
+	Atoms are never freed, so a pointer to one can be held indefinitely.
+	An atom can be passed to ClassAd::Lookup() in place of a string, in which
+	case the hash is not recomputed and the name is compared case-sensitively
+	before falling back to a case-insensitive compare.
+*/
+struct AttrNameAtom {
+	unsigned int id;	// small integer id, one per case-folded name, starting at 1
+	size_t hash;		// the value ClassadAttrNameHash gives for name
+	std::string name;	// the spelling that was interned first
+};
+
+/** Find or add the atom for an attribute name.  Case is ignored.
+	This takes a lock, so callers should cache the result.  Use this for
+	names the program itself knows, from the code or the configuration.
+*/
+const AttrNameAtom * InternAttrName( const std::string &name );
+
+/** The most atoms TryInternAttrName() adds */
+const size_t MAX_ATTR_NAME_ATOMS = 65536;
+
+/** Like InternAttrName(), but for names that come from ads, which may
+	be sent by anyone.  Once the table holds MAX_ATTR_NAME_ATOMS names,
+	new ones are not added.
+	@return The atom, or NULL if the name has no atom and the table is full.
+*/
+const AttrNameAtom * TryInternAttrName( const std::string &name );
+
+/** Find the atom for an attribute name without adding one.
+	@return The atom, or NULL if the name has never been interned.
+*/
+const AttrNameAtom * FindAttrNameAtom( const std::string &name );
+
+/** @return the atom with the given id, or NULL if there is none */
+const AttrNameAtom * AttrNameAtomById( unsigned int id );
+
+/** @return the number of interned attribute names */
+size_t AttrNameAtomCount();
+
 struct CaseIgnEqStr {
 	typedef void is_transparent; // magic to enable transparent comparators
 
+	bool operator()(const AttrNameAtom &a, const std::string &s) const {
+		return a.name.size() == s.size() &&
+			(a.name == s || strcasecmp(a.name.c_str(), s.c_str()) == 0);
+	}
+	bool operator()(const std::string &s, const AttrNameAtom &a) const {
+		return (*this)(a, s);
+	}
+
 	bool operator()(const std::string &s1, const std::string &s2 ) const {
 		return( strcasecmp(s1.c_str(), s2.c_str()) == 0 );
 	}
@@ -252,6 +299,9 @@ struct ClassadAttrNameHash
 		return h;
 	}
 
+	size_t operator()( const AttrNameAtom &a ) const {
+		return a.hash;
+	}
 };
 extern std::string       CondorErrMsg;
 
@@ -0,0 +1,115 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef __CLASSAD_COMPILED_EXPR_H__
+#define __CLASSAD_COMPILED_EXPR_H__
+
+#include <vector>
+#include "classad/exprTree.h"
+
+namespace classad {
+
+/** A flat, stack-based program lowered from an ExprTree.
+	Operators, short-circuit logic and the ternary operator are turned
+	into a linear instruction stream, subtrees made only of literals and
+	operators are folded into constants, and attribute references are
+	kept in a per-program table so evaluation does not have to dispatch
+	through the virtual _Evaluate of every node.  Anything the compiler
+	does not lower (function calls, lists, nested ads) is evaluated by
+	the ordinary tree walker, so the result of Evaluate() is always
+	identical to that of ExprTree::Evaluate() on the source tree.
+
+	A program holds pointers into the tree it was compiled from, so the
+	tree must outlive the program.
+*/
+class CompiledExpr
+{
+	public:
+		~CompiledExpr() {}
+
+		/** Compile an expression tree.
+			@param tree The tree to compile; it is only inspected.
+			@return A new program owned by the caller, or NULL if the tree
+				is not worth compiling (e.g. a bare literal or attribute
+				reference).
+		*/
+		static CompiledExpr *Compile( const ExprTree *tree );
+
+		/** Evaluate the program, producing the same result as
+			ExprTree::Evaluate() on the tree it was compiled from.
+			@param state The current evaluation state
+			@param val   The result of the evaluation
+			@return true on success, false on failure
+		*/
+		bool Evaluate( EvalState &state, Value &val ) const;
+
+		/// Number of instructions in the program
+		size_t size() const { return code.size(); }
+
+		/// Maximum number of operand stack slots the program uses
+		int stackDepth() const { return max_stack; }
+
+		/** Get counts of compiler activity for this process.
+			@param compiled Number of trees lowered to a program
+			@param skipped  Number of trees not worth compiling
+			@param folded   Number of subtrees folded to a constant
+		*/
+		static void _debug_get_counts( unsigned long &compiled, unsigned long &skipped, unsigned long &folded );
+
+	private:
+		enum OpCode {
+			PUSH_CONST,		// push consts[arg]
+			EVAL_ATTR,		// evaluate the attribute reference attrs[arg] and push
+			EVAL_TREE,		// evaluate node with the tree walker and push
+			OPERATE,		// pop nargs operands, apply op, push the result
+			AND_SC,			// if top is false, leave false and jump to arg
+			OR_SC,			// if top is true, leave true and jump to arg
+			TERNARY_SC,		// short circuit the ternary selector on top
+			TERNARY_FULL,	// finish a non-short-circuited ternary, then jump to arg
+			JUMP			// jump to arg
+		};
+
+		struct Instr {
+			OpCode code;
+			Operation::OpKind op;
+			int nargs;
+			int arg;
+			int arg2;
+			const ExprTree *node;
+		};
+
+		CompiledExpr() : max_stack(0) {}
+		CompiledExpr(const CompiledExpr &);
+		CompiledExpr &operator=(const CompiledExpr &);
+
+		bool compileNode( const ExprTree *tree, int depth );
+		bool evalAttr( const AttributeReference *ref, EvalState &state, Value &val ) const;
+		size_t emit( OpCode code, int arg = 0, const ExprTree *node = NULL );
+
+		static bool isConstant( const ExprTree *tree );
+
+		std::vector<Instr>	code;
+		std::vector<Value>	consts;
+		std::vector<const AttributeReference *> attrs;
+		int max_stack;
+};
+
+} // classad
+
+#endif//__CLASSAD_COMPILED_EXPR_H__
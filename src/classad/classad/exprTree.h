@@ -111,6 +111,16 @@ class ExprTree
 		/// Virtual destructor
 		virtual ~ExprTree () {};
 
+		/** Expression nodes come from the thread's current ClassAdArena
+			if there is one, and from the heap otherwise.
+			@see ClassAdArena
+		*/
+		static void *operator new( size_t size ) { return ClassAdArena::New(size); }
+		static void operator delete( void *p ) { ClassAdArena::Free(p); }
+		// the class operators above hide the global placement form
+		static void *operator new( size_t, void *where ) { return where; }
+		static void operator delete( void *, void * ) { }
+
 		/** Sets the lexical parent scope of the expression, which is used to 
 				determine the lexical scoping structure for resolving attribute
 				references. (However, the semantic parent may be different from 
@@ -181,6 +191,13 @@ class ExprTree
          */
         virtual bool SameAs(const ExprTree *tree) const = 0;
 
+        /** A hash of the structure of the tree, such that trees that are
+         *  SameAs() each other hash the same.  For a cached expression the
+         *  hash is computed once and shared by every envelope of it.
+         *  @return the hash, which is never 0
+         */
+        size_t StructuralHash() const;
+
 		// Pass in a pointer to a function taking a const char *, which will
 		// print it out somewhere useful, when the classad debug() function
 		// is called
@@ -224,6 +241,7 @@ class ExprTree
 		friend class ExprListIterator;
 		friend class ClassAd;
 		friend class CachedExprEnvelope;
+		friend class CompiledExpr;
 
 		/// Copy constructor
         ExprTree(const ExprTree &tree);
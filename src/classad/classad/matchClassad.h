@@ -22,6 +22,7 @@
 #define __CLASSAD_MATCH_CLASSAD_H__
 
 #include "classad/classad.h"
+#include "classad/compiledExpr.h"
 
 namespace classad {
 
@@ -199,6 +200,7 @@ class MatchClassAd : public ClassAd
 		const ClassAd *ladParent, *radParent;
 		ClassAd *lCtx, *rCtx, *lad, *rad;
 		ExprTree *symmetric_match, *right_matches_left, *left_matches_right;
+		CompiledExpr *symmetric_match_prog, *right_matches_left_prog, *left_matches_right_prog;
 		std::string lAlias, rAlias;
 
     private:
@@ -223,9 +225,14 @@ class MatchClassAd : public ClassAd
 		static bool OptimizeAdForMatchmaking( ClassAd *ad, bool is_right, std::string *error_msg, const std::string &left_alias, const std::string &right_alias );
 
 		/**
+		   @param prog The compiled form of match_expr, which is compiled
+		     on first use if expression compiling is enabled.
 		   @return true if the given expression evaluates to true
 		*/
-		bool EvalMatchExpr(ExprTree *match_expr);
+		bool EvalMatchExpr(ExprTree *match_expr, CompiledExpr *&prog);
+
+		/// discard compiled match expressions, which refer to our trees
+		void ClearCompiledExprs();
 };
 
 } // classad
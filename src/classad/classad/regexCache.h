@@ -0,0 +1,77 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef __CLASSAD_REGEX_CACHE_H__
+#define __CLASSAD_REGEX_CACHE_H__
+
+#include <memory>
+#include <stdint.h>
+
+namespace classad {
+
+/// A compiled pattern that stays valid for as long as it is referenced.
+/// What it holds is private to regexCache.cpp, so that users of this header
+/// do not need <pcre2.h>.  RegexCache::Code() gets the compiled code.
+struct CompiledRegex;
+typedef std::shared_ptr<const CompiledRegex> RegexPtr;
+
+/** A bounded, thread-safe LRU cache of compiled regular expressions,
+	shared by every ClassAd function that takes a pattern.  Policy
+	expressions tend to use the same few patterns over and over, so
+	compiling each one once rather than on every evaluation saves a lot.
+
+	Patterns are handed out as shared pointers, so evicting an entry never
+	frees code that another caller is still matching with.  pcre2_match()
+	only reads the compiled code, so it can be shared between threads as
+	long as each caller uses its own match data.
+
+	The size of the cache and whether patterns are JIT compiled are set
+	with ClassAdSetRegexCacheSize() and ClassAdSetRegexJIT().
+*/
+class RegexCache
+{
+	public:
+		/** Get the compiled form of a pattern, compiling it if it is not
+			already in the cache.
+			@param pattern The pattern
+			@param options PCRE2 compile options
+			@return The compiled pattern, or an empty pointer if the
+				pattern is not valid.  Invalid patterns are not cached.
+		*/
+		static RegexPtr Acquire( const char *pattern, uint32_t options );
+
+		/** Get the compiled code of a pattern.
+			@param re A pattern returned by Acquire()
+			@return The const pcre2_code * to pass to pcre2_match(),
+				or NULL if re is empty.
+		*/
+		static const void *Code( const RegexPtr &re );
+
+		/** Get counts of activity in the cache for this process.
+			@param hits      Number of lookups satisfied from the cache
+			@param misses    Number of lookups that compiled the pattern
+			@param evictions Number of entries discarded to bound the cache
+			@param entries   Number of entries currently in the cache
+		*/
+		static void _debug_get_counts( unsigned long &hits, unsigned long &misses, unsigned long &evictions, unsigned long &entries );
+};
+
+} // classad
+
+#endif//__CLASSAD_REGEX_CACHE_H__
@@ -31,6 +31,7 @@ class ClassAd;
 class ExprTree;
 class ExprList;
 class FunctionCall;
+class ClassAdArena;
 
 /// This reads %ClassAd strings from various sources and converts them into a ClassAd.
 /// It can read from C++ strings, C strings, FILEs, and streams.
@@ -46,6 +47,14 @@ class ClassAdParser
 		void SetOldClassAd( bool old_syntax );
 		bool GetOldClassAd() const;
 
+		/** Allocate everything the parser creates from the given arena
+			rather than the heap.  The arena must outlive the results.
+			@param arena The arena, or NULL to use the thread's current
+				arena, if any.
+		*/
+		void SetArena( ClassAdArena *arena );
+		ClassAdArena *GetArena() const { return arena; }
+
 		/** Parse a ClassAd 
 			@param buffer Buffer containing the string representation of the
 				classad.
@@ -127,6 +136,7 @@ class ClassAdParser
 
 		int  depth; // nesting depth of recursive descent parser
 		bool oldClassAd;
+		ClassAdArena *arena;
 
 		// mutually recursive parsing functions
 		bool parseExpression( ExprTree*&, bool=false);
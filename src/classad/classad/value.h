@@ -24,6 +24,7 @@
 #include "classad/common.h"
 #include "classad/util.h"
 #include "classad/classad_containers.h"
+#include "classad/arena.h"
 
 namespace classad {
 
@@ -433,7 +434,7 @@ class Value
 				break;
 
 			case STRING_VALUE:
-				delete strValue;
+				ClassAdArenaDelete(strValue);
 				break;
 
 			case ABSOLUTE_TIME_VALUE:
@@ -18,6 +18,8 @@
 
 #include "classad/common.h"
 #include "classad/classadCache.h"
+#include "classad/classad.h"
+#include "classad/compiledExpr.h"
 #include "classad/sink.h"
 #include "classad/source.h"
 #include <assert.h>
@@ -339,13 +341,20 @@ static classad_shared_ptr<ClassAdCache> _cache;
 //////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
 
+// marks a letter whose expression has been found to be not worth compiling
+static char not_compilable_marker;
+static CompiledExpr * const NOT_COMPILABLE = reinterpret_cast<CompiledExpr*>(&not_compilable_marker);
+
 CacheEntry::~CacheEntry()
 {
 	if (_cache && _cache.use_count()) {
 		_cache->flush(szName, szValue);
 	}
-	delete pData;
-	pData = NULL;
+	CompiledExpr * prog = pCompiled.exchange(NULL);
+	if (prog != NOT_COMPILABLE) {
+		delete prog;
+	}
+	delete pData.exchange(NULL);
 }
 
 
@@ -374,6 +383,10 @@ ExprTree * CachedExprEnvelope::cache (const std::string & pName, ExprTree * pTre
 		break;
 
 	default:
+		// a tree from an arena dies with the arena, so it can't be shared
+		if (ClassAdArena::Owns(pTree)) {
+			break;
+		}
 		if ( ! _cache) { _cache.reset( new ClassAdCache() ); }
 		pNewEnv = new CachedExprEnvelope();
 		pNewEnv->m_pLetter = _cache->cache(pName, szValue, pTree);
@@ -441,18 +454,86 @@ ExprTree * CachedExprEnvelope::get() const
 	
 	if (m_pLetter) {
 		CacheEntry * ptr = m_pLetter.get();
-		expr = ptr->pData;
+		expr = ptr->pData.load(std::memory_order_acquire);
 		if ( ! expr) {
+			// the parsed tree is shared through the cache, so it must not
+			// come from the arena of whichever ad happens to use it first
+			ClassAdHeapScope heap_scope;
 			ClassAdParser parser;
 			parser.SetOldClassAd(true);
 			expr = parser.ParseExpression(ptr->szValue);
-			ptr->pData = expr;
+
+			// threads that evaluate shared ads may parse the same letter at
+			// once, the first to finish wins and the others throw theirs away.
+			ExprTree * expected = NULL;
+			if (expr && ! ptr->pData.compare_exchange_strong(expected, expr, std::memory_order_acq_rel)) {
+				delete expr;
+				expr = expected;
+			}
 		}
 	}
 	
 	return expr;
 }
 
+void CachedExprEnvelope::parse_lazy(const ClassAd & ad)
+{
+	for (auto it = ad.begin(); it != ad.end(); ++it) {
+		if (it->second && it->second->GetKind() == EXPR_ENVELOPE) {
+			((const CachedExprEnvelope *)it->second)->get();
+		}
+	}
+}
+
+const CompiledExpr * CachedExprEnvelope::get_compiled() const
+{
+	if ( ! m_pLetter) {
+		return NULL;
+	}
+
+	CacheEntry * ptr = m_pLetter.get();
+	CompiledExpr * prog = ptr->pCompiled.load(std::memory_order_acquire);
+	if ( ! prog) {
+		ExprTree * expr = get();
+		if ( ! expr) {
+			return NULL;
+		}
+		prog = CompiledExpr::Compile(expr);
+		if ( ! prog) { prog = NOT_COMPILABLE; }
+
+		// another thread may have compiled the same letter while we did,
+		// in which case we use theirs and throw ours away.
+		CompiledExpr * expected = NULL;
+		if ( ! ptr->pCompiled.compare_exchange_strong(expected, prog, std::memory_order_acq_rel)) {
+			if (prog != NOT_COMPILABLE) { delete prog; }
+			prog = expected;
+		}
+	}
+
+	return (prog == NOT_COMPILABLE) ? NULL : prog;
+}
+
+size_t CachedExprEnvelope::get_hash() const
+{
+	if ( ! m_pLetter) {
+		return 0;
+	}
+
+	// threads that race here compute the same value, so there is no need
+	// to do more than make the store atomic.
+	CacheEntry * ptr = m_pLetter.get();
+	size_t hash = ptr->hash.load(std::memory_order_relaxed);
+	if ( ! hash) {
+		ExprTree * expr = get();
+		if ( ! expr) {
+			return 0;
+		}
+		hash = expr->StructuralHash();
+		ptr->hash.store(hash, std::memory_order_relaxed);
+	}
+	return hash;
+}
+
 const std::string & CachedExprEnvelope::get_unparsed_str() const
 {
 	if (m_pLetter) {
@@ -484,8 +565,9 @@ bool CachedExprEnvelope::SameAs(const ExprTree* tree) const
 	}
 
 	if (tree->GetKind() != EXPR_ENVELOPE) {
-		if (m_pLetter && m_pLetter->pData) {
-			return m_pLetter->pData->SameAs(tree);
+		ExprTree * expr = m_pLetter ? m_pLetter->pData.load(std::memory_order_acquire) : NULL;
+		if (expr) {
+			return expr->SameAs(tree);
 		}
 		return false;
 	}
@@ -500,6 +582,13 @@ bool CachedExprEnvelope::SameAs(const ExprTree* tree) const
 
 bool CachedExprEnvelope::_Evaluate( EvalState& st, Value& v ) const
 {
+	// the compiled program gives the same answer as the tree, but the
+	// debug output is per-node, so only the tree walker can produce it.
+	if (ClassAdGetExpressionCompiling() && ! st.debug) {
+		const CompiledExpr * prog = get_compiled();
+		if (prog) { return prog->Evaluate(st,v); }
+	}
+
 	ExprTree * tree = get();
 	if (tree) { return tree->Evaluate(st,v); }
 	return false;
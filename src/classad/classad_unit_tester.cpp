@@ -35,6 +35,8 @@
 #include "classad/classad_distribution.h"
 #include "classad/lexerSource.h"
 #include "classad/xmlSink.h"
+#include "classad/compiledExpr.h"
+#include "classad/regexCache.h"
 #include <fstream>
 #include <iostream>
 #include <ctype.h>
@@ -69,6 +71,7 @@ public:
     bool  check_operator;
     bool  check_collection;
     bool  check_utils;
+    bool  check_compiled;
 	void  ParseCommandLine(int argc, char **argv);
 };
 
@@ -101,6 +104,7 @@ static void test_exprlist(const Parameters &parameters, Results &results);
 static void test_value(const Parameters &parameters, Results &results);
 static void test_collection(const Parameters &parameters, Results &results);
 static void test_utils(const Parameters &parameters, Results &results);
+static void test_compiled(const Parameters &parameters, Results &results);
 static bool check_in_view(ClassAdCollection *collection, string view_name, string classad_name);
 static void print_version(void);
 
@@ -133,6 +137,7 @@ void Parameters::ParseCommandLine(
     check_operator      = false;
     check_collection    = false;
     check_utils         = false;
+    check_compiled      = false;
 
 	// Then we parse to see what the user wants. 
 	for (int arg_index = 1; arg_index < argc; arg_index++) {
@@ -179,6 +184,9 @@ void Parameters::ParseCommandLine(
             selected_test       = true;
 		} else if (!strcasecmp(argv[arg_index], "-utils")){
             check_utils         = true;
+            selected_test       = true;
+		} else if (!strcasecmp(argv[arg_index], "-compiled")){
+            check_compiled      = true;
             selected_test       = true;
 		} else {
             cout << "Unknown argument: " << argv[arg_index] << endl;
@@ -206,6 +214,7 @@ void Parameters::ParseCommandLine(
         cout << "    -operator:   test the Operator class.\n";
         cout << "    -collection: test the Collection class.\n";
         cout << "    -utils:      test little utilities.\n";
+        cout << "    -compiled:   test compiled expressions.\n";
         exit(1);
     }
     if (!selected_test) {
@@ -302,6 +311,9 @@ int main(
     if (parameters.check_all || parameters.check_utils) {
         test_utils(parameters, results);
     }
+    if (parameters.check_all || parameters.check_compiled) {
+        test_compiled(parameters, results);
+    }
 
     /* ----- Report ----- */
     cout << endl;
@@ -548,6 +560,136 @@ static void test_classad(const Parameters &, Results &results)
     TEST("update from chain is merged",(have_attribute==true));
     TEST("update from chain has attribute c==6",(i==6));
 
+    /* ----- Test attribute name atoms ----- */
+    const AttrNameAtom *atom1 = InternAttrName("AtomTestName");
+    const AttrNameAtom *atom2 = InternAttrName("atomtestNAME");
+    TEST("atoms ignore case", (atom1 == atom2));
+    TEST("atom has an id", (atom1->id > 0));
+    TEST("atom found by id", (AttrNameAtomById(atom1->id) == atom1));
+    TEST("atom found by name", (FindAttrNameAtom("ATOMTESTNAME") == atom1));
+    TEST("atom keeps first spelling", (atom1->name == "AtomTestName"));
+    TEST("unknown name has no atom", (FindAttrNameAtom("NeverInternedAtomName") == NULL));
+
+    classad3.InsertAttr("atomTestName", 11);
+    TEST("lookup by atom", (classad3.Lookup(*atom1) == classad3.Lookup("ATOMTESTNAME")));
+    TEST("lookup by atom finds it", (classad3.Lookup(*atom1) != NULL));
+    TEST("lookup by atom misses", (classad3.Lookup(*InternAttrName("NoSuchAttr")) == NULL));
+    TEST("lookup by atom in chain", (classad1.Lookup(*InternAttrName("A")) != NULL));
+
+    ExprTree *ref_tree = parser.ParseExpression("ATOMTESTNAME + 1");
+    classad3.Insert("AtomRef", ref_tree);
+    have_attribute = classad3.EvaluateAttrInt("AtomRef", i);
+    TEST("reference through atom", (have_attribute == true && i == 12));
+
+    // names from ads stop being interned once the table is full, and
+    // references to them are looked up by name instead
+    for (size_t ix = AttrNameAtomCount(); ix <= MAX_ATTR_NAME_ATOMS; ++ix) {
+        TryInternAttrName("AtomFill" + std::to_string(ix));
+    }
+    TEST("full atom table adds no names from ads", (TryInternAttrName("AtomNotAdded") == NULL));
+    TEST("full atom table finds known names", (TryInternAttrName("AtomTestName") == atom1));
+    TEST("full atom table adds names of the program", (InternAttrName("AtomAlwaysAdded") != NULL));
+    classad3.InsertAttr("AtomOverflow", 20);
+    ref_tree = parser.ParseExpression("AtomOverflow + 1");
+    classad3.Insert("AtomOverflowRef", ref_tree);
+    have_attribute = classad3.EvaluateAttrInt("AtomOverflowRef", i);
+    TEST("reference without atom", (have_attribute == true && i == 21));
+
+    /* ----- Test arena allocation ----- */
+    ClassAdArena *arena = new ClassAdArena();
+    ClassAdParser arena_parser;
+    arena_parser.SetArena(arena);
+    ClassAd *arena_ad = arena_parser.ParseClassAd(
+        "[ A = 1; B = A + 2; C = \"a string that is long enough to leave the small buffer\"; "
+        "  D = { 1, 2, [ E = 3 ] }; ]");
+    TEST("arena ad parsed", (arena_ad != NULL));
+    TEST("arena owns the ad", (ClassAdArena::Owns(arena_ad)));
+    TEST("arena owns its expressions", (arena_ad && ClassAdArena::Owns(arena_ad->Lookup("B"))));
+    TEST("arena has been used", (arena->BytesAllocated() > 0 && arena->BlocksAllocated() > 0));
+    TEST("heap ad is not in the arena", (!ClassAdArena::Owns(&classad3)));
+    have_attribute = arena_ad && arena_ad->EvaluateAttrInt("B", i);
+    TEST("arena ad evaluates", (have_attribute == true && i == 3));
+    have_attribute = arena_ad && arena_ad->EvaluateAttrString("C", s);
+    TEST("arena ad holds strings", (have_attribute == true && s.length() > 40));
+    ClassAd *arena_copy = arena_ad ? (ClassAd *)arena_ad->Copy() : NULL;
+    TEST("copy of arena ad is on the heap", (arena_copy && !ClassAdArena::Owns(arena_copy)));
+    {
+        ClassAdArenaScope arena_scope(arena);
+        ClassAd *scoped_ad = new ClassAd();
+        TEST("scope allocates from the arena", (ClassAdArena::Owns(scoped_ad)));
+        {
+            ClassAdHeapScope heap_scope;
+            ExprTree *heap_tree = Literal::MakeLong(1);
+            TEST("heap scope bypasses the arena", (!ClassAdArena::Owns(heap_tree)));
+            delete heap_tree;
+        }
+        bool was_caching = ClassAdGetExpressionCaching();
+        ClassAdSetExpressionCaching(true);
+        string cached_name = "ArenaCached";
+        scoped_ad->InsertViaCache(cached_name, "ArenaCachedValue + 17");
+        ExprTree *cached_tree = scoped_ad->Lookup("ArenaCached");
+        TEST("arena expressions are not cached",
+             (cached_tree && cached_tree->GetKind() != ExprTree::EXPR_ENVELOPE));
+        ClassAdSetExpressionCaching(was_caching);
+        delete scoped_ad;
+    }
+    TEST("scope ends", (ClassAdArena::Current() == NULL));
+    {
+        ClassAdArena reuse_arena;
+        ClassAdArenaScope arena_scope(&reuse_arena);
+        size_t blocks_used = 0;
+        for (int round = 0; round < 4; ++round) {
+            vector<ClassAd *> reuse_ads;
+            for (int ad_num = 0; ad_num < 2000; ++ad_num) {
+                ClassAd *reuse_ad = new ClassAd();
+                reuse_ad->InsertAttr("A", ad_num);
+                reuse_ad->InsertAttr("S", "a string for the arena");
+                reuse_ads.push_back(reuse_ad);
+            }
+            for (ClassAd *reuse_ad : reuse_ads) {
+                delete reuse_ad;
+            }
+            if (round == 1) {
+                blocks_used = reuse_arena.BlocksAllocated();
+            }
+        }
+        TEST("arena reuses emptied blocks", (blocks_used > 1 && reuse_arena.BlocksAllocated() == blocks_used));
+    }
+    delete arena_ad;
+    delete arena;
+    have_attribute = arena_copy && arena_copy->EvaluateAttrInt("B", i);
+    TEST("copy outlives the arena", (have_attribute == true && i == 3));
+    delete arena_copy;
+
+    /* ----- Test structural hashes ----- */
+    ExprTree *hash1 = parser.ParseExpression("(Memory >= 1024) && Arch == \"X86_64\" && [ a = 1; B = { 2.0, -3 } ].a");
+    ExprTree *hash2 = parser.ParseExpression("(Memory >= 1024) && Arch == \"X86_64\" && [ b = { 2.0, -3 }; A = 1 ].a");
+    ExprTree *hash3 = parser.ParseExpression("(Memory >= 1024) && Arch == \"X86_64\" && [ a = 1; B = { 2.0, -4 } ].a");
+    ExprTree *hash4 = parser.ParseExpression("Memory >= 1024 && Arch == \"X86_64\" && [ a = 1; B = { 2.0, -3 } ].a");
+    TEST("same trees hash the same", (hash1 && hash2 && hash1->SameAs(hash2) &&
+        hash1->StructuralHash() == hash2->StructuralHash()));
+    TEST("different literal changes the hash", (hash3 && hash1->StructuralHash() != hash3->StructuralHash()));
+    TEST("parentheses change the hash", (hash4 && hash1->StructuralHash() != hash4->StructuralHash()));
+    ExprTree *hash_copy = hash1 ? hash1->Copy() : NULL;
+    TEST("hash of a copy", (hash_copy && hash_copy->StructuralHash() == hash1->StructuralHash()));
+    delete hash_copy;
+    {
+        bool was_caching = ClassAdGetExpressionCaching();
+        ClassAdSetExpressionCaching(true);
+        ClassAd hash_ad;
+        string hash_name = "HashCached";
+        hash_ad.InsertViaCache(hash_name, "(Memory >= 1024) && Arch == \"X86_64\" && [ a = 1; B = { 2.0, -3 } ].a");
+        ExprTree *cached_tree = hash_ad.Lookup(hash_name);
+        TEST("cached tree hashes like the plain tree", (cached_tree && hash1 &&
+            cached_tree->GetKind() == ExprTree::EXPR_ENVELOPE &&
+            cached_tree->StructuralHash() == hash1->StructuralHash()));
+        ClassAdSetExpressionCaching(was_caching);
+    }
+    delete hash1;
+    delete hash2;
+    delete hash3;
+    delete hash4;
+
     return;
 }
 
@@ -1028,6 +1170,174 @@ static void test_utils(const Parameters &, Results &results)
     TEST("Dec 31, 2005->6, 364", weekday==6 && yearday==364);
     day_numbers(2004, 12, 31, weekday, yearday);
     TEST("Dec 31, 2005->5, 365", weekday==5 && yearday==365);
+
+    // regex functions share a cache of compiled patterns
+    ClassAdParser parser;
+    ClassAd *ad = parser.ParseClassAd(
+        "[ Name = \"slot1@example.org\"; "
+        "  Match = regexp(\"^SLOT[0-9]+@\", Name, \"i\"); "
+        "  Sub = regexps(\"^slot([0-9]+)@.*\", Name, \"\\\\1\"); "
+        "  Member = regexpMember(\"^slot[0-9]+@\", {\"foo\", \"slot2@bar\"}); "
+        "  Bad = regexp(\"(\", Name); ]");
+    unsigned long hits, misses, evictions, entries;
+    unsigned long hits0, misses0;
+    bool b;
+    std::string str;
+    ClassAdSetRegexCacheSize(2);
+    RegexCache::_debug_get_counts(hits0, misses0, evictions, entries);
+    TEST("regex cache bounded", entries <= 2);
+    TEST("regexp case insensitive", ad->EvaluateAttrBool("Match", b) && b);
+    TEST("regexp again", ad->EvaluateAttrBool("Match", b) && b);
+    RegexCache::_debug_get_counts(hits, misses, evictions, entries);
+    TEST("regex cache miss then hit", misses == misses0 + 1 && hits == hits0 + 1);
+    TEST("regexps from cache", ad->EvaluateAttrString("Sub", str) && str == "1");
+    TEST("regexpMember from cache", ad->EvaluateAttrBool("Member", b) && b);
+    RegexCache::_debug_get_counts(hits, misses, evictions, entries);
+    TEST("regex cache evicts", entries == 2 && evictions >= 1);
+    Value val;
+    TEST("bad regex is an error", ad->EvaluateAttr("Bad", val) && val.IsErrorValue());
+    TEST("bad regex is an error again", ad->EvaluateAttr("Bad", val) && val.IsErrorValue());
+    RegexCache::_debug_get_counts(hits0, misses0, evictions, entries);
+    TEST("bad regex not cached", entries == 2 && misses0 == misses + 2);
+    ClassAdSetRegexJIT(true);
+    TEST("regexp with jit", ad->EvaluateAttrBool("Match", b) && b);
+    TEST("regexps with jit", ad->EvaluateAttrString("Sub", str) && str == "1");
+    ClassAdSetRegexJIT(false);
+    ClassAdSetRegexCacheSize(0);
+    TEST("regexp without cache", ad->EvaluateAttrBool("Match", b) && b);
+    RegexCache::_debug_get_counts(hits, misses, evictions, entries);
+    TEST("regex cache disabled", entries == 0);
+    ClassAdSetRegexCacheSize(128);
+    delete ad;
+    return;
+}
+
+/*********************************************************************
+ *
+ * Function: test_compiled
+ * Purpose:  Test that compiled expressions evaluate exactly like the
+ *           tree walker does.
+ *
+ *********************************************************************/
+static bool same_as_tree(const char *expr_str, ClassAd *scope)
+{
+    ClassAdParser   parser;
+    ClassAdUnParser unparser;
+    ExprTree        *tree;
+    Value           tree_val, prog_val;
+    string          tree_str, prog_str;
+    bool            tree_ok, prog_ok;
+
+    tree = parser.ParseExpression(expr_str);
+    if (tree == NULL) {
+        return false;
+    }
+    tree->SetParentScope(scope);
+
+    EvalState tree_state;
+    tree_state.SetScopes(scope);
+    tree_ok = tree->Evaluate(tree_state, tree_val);
+
+    CompiledExpr *prog = CompiledExpr::Compile(tree);
+    if (prog) {
+        EvalState prog_state;
+        prog_state.SetScopes(scope);
+        prog_ok = prog->Evaluate(prog_state, prog_val);
+        delete prog;
+    } else {
+        prog_ok = tree_ok;
+        prog_val.CopyFrom(tree_val);
+    }
+
+    unparser.Unparse(tree_str, tree_val);
+    unparser.Unparse(prog_str, prog_val);
+    delete tree;
+    return tree_ok == prog_ok && tree_str == prog_str;
+}
+
+static void test_compiled(const Parameters &, Results &results)
+{
+    ClassAdParser parser;
+    ExprTree *tree;
+    CompiledExpr *prog;
+
+    cout << "Testing compiled expressions...\n";
+
+    ClassAd *ad = parser.ParseClassAd(
+        "[ A = 3; B = 4.0; C = \"babyzilla\"; D = true; E = {1, 2, 3}; "
+        "  F = [ AA = 3; ]; N = undefined; X = error; R = A + B; "
+        "  Loop = Loop + 1; Memory = 8192; Arch = \"X86_64\"; ]");
+
+    TEST("A + B * 2", same_as_tree("A + B * 2", ad));
+    TEST("constant folding", same_as_tree("(1 + 2) * 3 - 10 / 4", ad));
+    TEST("string compare", same_as_tree("C == \"BABYZILLA\" && C =?= \"babyzilla\"", ad));
+    TEST("undefined propagation", same_as_tree("N + 1", ad));
+    TEST("error propagation", same_as_tree("X * 2 || true", ad));
+    TEST("and short circuit", same_as_tree("false && X", ad));
+    TEST("or short circuit", same_as_tree("D || N", ad));
+    TEST("and of undefined", same_as_tree("N && false", ad));
+    TEST("or of non-boolean", same_as_tree("C || false", ad));
+    TEST("ternary true", same_as_tree("D ? A : B", ad));
+    TEST("ternary false", same_as_tree("!D ? A : B", ad));
+    TEST("ternary undefined", same_as_tree("N ? A : B", ad));
+    TEST("ternary non-boolean", same_as_tree("C ? A : B", ad));
+    TEST("elvis defined", same_as_tree("A ?: B", ad));
+    TEST("elvis undefined", same_as_tree("N ?: B", ad));
+    TEST("elvis false", same_as_tree("(A > 5) ?: B", ad));
+    TEST("nested ternary", same_as_tree("A > 1 ? (B > 5 ? 1 : 2) : (N ? 3 : 4)", ad));
+    TEST("unary ops", same_as_tree("-A + ~A + !D", ad));
+    TEST("subscript", same_as_tree("E[1] + F[\"AA\"]", ad));
+    TEST("subscript out of range", same_as_tree("E[7]", ad));
+    TEST("function call", same_as_tree("strcat(C, \"-\", string(A)) == \"babyzilla-3\"", ad));
+    TEST("nested reference", same_as_tree("R * 2 + F.AA", ad));
+    TEST("recursive reference", same_as_tree("Loop > 0", ad));
+    TEST("is and isnt", same_as_tree("N is undefined && X isnt undefined", ad));
+    TEST("requirements", same_as_tree("Arch == \"X86_64\" && Memory >= 4096 && (A > 1 || N)", ad));
+
+    tree = parser.ParseExpression("1 + 2");
+    prog = CompiledExpr::Compile(tree);
+    TEST("constant compiles", prog != NULL);
+    TEST("constant folds to one instruction", prog && prog->size() == 1);
+    delete prog;
+    delete tree;
+
+    tree = parser.ParseExpression("Memory");
+    prog = CompiledExpr::Compile(tree);
+    TEST("bare reference not compiled", prog == NULL);
+    delete tree;
+
+    /* ----- Cached envelopes and MatchClassAd ----- */
+    bool was_caching = ClassAdGetExpressionCaching();
+    ClassAdSetExpressionCaching(true);
+    ClassAdSetExpressionCompiling(true);
+
+    ClassAd *job = new ClassAd();
+    ClassAd *slot = new ClassAd();
+    string name;
+    name = "Requirements";
+    job->InsertViaCache(name, "TARGET.Memory >= MY.RequestMemory && TARGET.Arch == \"X86_64\"");
+    name = "RequestMemory";
+    job->InsertViaCache(name, "1024");
+    name = "Requirements";
+    slot->InsertViaCache(name, "MY.Memory > 0 || TARGET.RequestMemory =?= undefined");
+    name = "Memory";
+    slot->InsertViaCache(name, "2048");
+    name = "Arch";
+    slot->InsertViaCache(name, "\"X86_64\"");
+
+    MatchClassAd *mad = MatchClassAd::MakeMatchClassAd(job, slot);
+    TEST("compiled symmetric match", mad->symmetricMatch());
+    TEST("compiled left matches right", mad->leftMatchesRight());
+    name = "Memory";
+    slot->InsertViaCache(name, "512");
+    TEST("compiled symmetric mismatch", !mad->symmetricMatch());
+    TEST("compiled right does not match left", !mad->rightMatchesLeft());
+    TEST("compiled left still matches right", mad->leftMatchesRight());
+    delete mad;
+
+    ClassAdSetExpressionCompiling(false);
+    ClassAdSetExpressionCaching(was_caching);
+    delete ad;
     return;
 }
 
@@ -18,6 +18,11 @@
  ***************************************************************/
 
 #include "classad/common.h"
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace classad {
 
@@ -45,4 +50,109 @@ const char * const ATTR_VIEW_INFO			= "ViewInfo";
 const char * const ATTR_VIEW_NAME			= "ViewName";
 const char * const ATTR_XACTION_NAME			= "XactionName";
 
+// The atom table.  Atoms are allocated once and never freed, and the
+// table itself is never destroyed so that atoms held by static objects
+// remain valid during shutdown.  It is split into shards by hash, each
+// with a reader/writer lock, so that parsers on several threads mostly
+// take shared locks on different shards.
+typedef std::unordered_map<std::string, AttrNameAtom*, ClassadAttrNameHash, CaseIgnEqStr> AttrAtomMap;
+
+static const size_t ATOM_SHARDS = 64;
+
+struct AttrAtomShard {
+	std::shared_mutex lock;
+	AttrAtomMap atoms;
+};
+
+static AttrAtomShard & attrAtomShard( size_t hash )
+{
+	static AttrAtomShard * shards = new AttrAtomShard[ATOM_SHARDS];
+	return shards[hash % ATOM_SHARDS];
+}
+
+// the atoms by id, which is only changed when an atom is added
+static std::mutex & attrAtomIdLock()
+{
+	static std::mutex lock;
+	return lock;
+}
+
+static std::vector<const AttrNameAtom*> & attrAtomsById()
+{
+	static std::vector<const AttrNameAtom*> * by_id = new std::vector<const AttrNameAtom*>();
+	return *by_id;
+}
+
+static std::atomic<size_t> attrAtomCount(0);
+
+static const AttrNameAtom * internAttrName( const std::string &name, bool bounded )
+{
+	size_t hash = ClassadAttrNameHash()(name);
+	AttrAtomShard & shard = attrAtomShard(hash);
+	{
+		std::shared_lock<std::shared_mutex> guard(shard.lock);
+		AttrAtomMap::iterator it = shard.atoms.find(name);
+		if (it != shard.atoms.end()) {
+			return it->second;
+		}
+	}
+
+	// the count may go a little past the limit when threads race here
+	if (bounded && attrAtomCount.load(std::memory_order_relaxed) >= MAX_ATTR_NAME_ATOMS) {
+		return NULL;
+	}
+
+	std::unique_lock<std::shared_mutex> guard(shard.lock);
+	AttrAtomMap::iterator it = shard.atoms.find(name);
+	if (it != shard.atoms.end()) {
+		return it->second;
+	}
+
+	AttrNameAtom * atom = new AttrNameAtom;
+	atom->name = name;
+	atom->hash = hash;
+	{
+		std::lock_guard<std::mutex> id_guard(attrAtomIdLock());
+		std::vector<const AttrNameAtom*> & by_id = attrAtomsById();
+		atom->id = (unsigned int)by_id.size() + 1;
+		by_id.push_back(atom);
+	}
+	shard.atoms[name] = atom;
+	attrAtomCount.fetch_add(1, std::memory_order_relaxed);
+	return atom;
+}
+
+const AttrNameAtom * InternAttrName( const std::string &name )
+{
+	return internAttrName(name, false);
+}
+
+const AttrNameAtom * TryInternAttrName( const std::string &name )
+{
+	return internAttrName(name, true);
+}
+
+const AttrNameAtom * FindAttrNameAtom( const std::string &name )
+{
+	AttrAtomShard & shard = attrAtomShard(ClassadAttrNameHash()(name));
+	std::shared_lock<std::shared_mutex> guard(shard.lock);
+	AttrAtomMap::iterator it = shard.atoms.find(name);
+	return (it != shard.atoms.end()) ? it->second : NULL;
+}
+
+const AttrNameAtom * AttrNameAtomById( unsigned int id )
+{
+	std::lock_guard<std::mutex> guard(attrAtomIdLock());
+	std::vector<const AttrNameAtom*> & by_id = attrAtomsById();
+	if (id < 1 || id > by_id.size()) {
+		return NULL;
+	}
+	return by_id[id - 1];
+}
+
+size_t AttrNameAtomCount()
+{
+	return attrAtomCount.load(std::memory_order_relaxed);
+}
+
 } // classad
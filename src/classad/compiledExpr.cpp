@@ -0,0 +1,377 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "classad/common.h"
+#include "classad/compiledExpr.h"
+#include <atomic>
+
+namespace classad {
+
+// programs whose operand stack fits here evaluate without touching the heap
+#define SMALL_STACK 16
+
+static std::atomic<unsigned long> compiledCount(0);
+static std::atomic<unsigned long> skippedCount(0);
+static std::atomic<unsigned long> foldedCount(0);
+
+void CompiledExpr::
+_debug_get_counts( unsigned long &compiled, unsigned long &skipped, unsigned long &folded )
+{
+	compiled = compiledCount;
+	skipped = skippedCount;
+	folded = foldedCount;
+}
+
+CompiledExpr *CompiledExpr::
+Compile( const ExprTree *tree )
+{
+	if ( ! tree) {
+		return NULL;
+	}
+	tree = tree->self();
+
+	// only operators have enough structure to be worth lowering.
+	// a bare literal or attribute reference is as fast in the tree walker.
+	if (tree->GetKind() != ExprTree::OP_NODE) {
+		skippedCount++;
+		return NULL;
+	}
+
+	// programs are shared through the expression cache, keep their
+	// constants off of any arena
+	ClassAdHeapScope heap_scope;
+	CompiledExpr *prog = new CompiledExpr();
+	if ( ! prog->compileNode(tree, 0)) {
+		delete prog;
+		skippedCount++;
+		return NULL;
+	}
+	compiledCount++;
+	return prog;
+}
+
+// a tree is constant if it consists only of literals and operators
+bool CompiledExpr::
+isConstant( const ExprTree *tree )
+{
+	if ( ! tree) {
+		return true;
+	}
+	switch (tree->GetKind()) {
+	case ExprTree::LITERAL_NODE:
+		return true;
+	case ExprTree::OP_NODE: {
+		Operation::OpKind op = Operation::__NO_OP__;
+		ExprTree *t1 = NULL, *t2 = NULL, *t3 = NULL;
+		((const Operation*)tree)->GetComponents(op, t1, t2, t3);
+		return isConstant(t1) && isConstant(t2) && isConstant(t3);
+	}
+	default:
+		return false;
+	}
+}
+
+size_t CompiledExpr::
+emit( OpCode opcode, int arg, const ExprTree *node )
+{
+	Instr ins;
+	ins.code = opcode;
+	ins.op = Operation::__NO_OP__;
+	ins.nargs = 0;
+	ins.arg = arg;
+	ins.arg2 = -1;
+	ins.node = node;
+	code.push_back(ins);
+	return code.size() - 1;
+}
+
+// Emit code that leaves the value of tree in stack slot 'depth'
+bool CompiledExpr::
+compileNode( const ExprTree *tree, int depth )
+{
+	if (depth + 1 > max_stack) {
+		max_stack = depth + 1;
+	}
+
+	switch (tree->GetKind()) {
+	case ExprTree::LITERAL_NODE: {
+		EvalState state;
+		Value val;
+		if ( ! tree->Evaluate(state, val)) {
+			return false;
+		}
+		consts.push_back(val);
+		emit(PUSH_CONST, (int)consts.size() - 1);
+		return true;
+	}
+
+	case ExprTree::ATTRREF_NODE:
+		attrs.push_back((const AttributeReference*)tree);
+		emit(EVAL_ATTR, (int)attrs.size() - 1);
+		return true;
+
+	case ExprTree::OP_NODE:
+		break;
+
+	default:
+		// function calls, lists, nested ads and envelopes are handed
+		// back to the tree walker
+		emit(EVAL_TREE, 0, tree);
+		return true;
+	}
+
+	Operation::OpKind op = Operation::__NO_OP__;
+	ExprTree *t1 = NULL, *t2 = NULL, *t3 = NULL;
+	((const Operation*)tree)->GetComponents(op, t1, t2, t3);
+
+	// fold subtrees made of nothing but literals and operators.
+	// if folding fails, fall through and let the program fail the
+	// same way the tree walker would.
+	if (op != Operation::PARENTHESES_OP && isConstant(tree)) {
+		EvalState state;
+		Value val;
+		if (tree->Evaluate(state, val)) {
+			consts.push_back(val);
+			emit(PUSH_CONST, (int)consts.size() - 1);
+			foldedCount++;
+			return true;
+		}
+	}
+
+	switch (op) {
+	case Operation::PARENTHESES_OP:
+		return compileNode(t1, depth);
+
+	case Operation::LOGICAL_AND_OP:
+	case Operation::LOGICAL_OR_OP: {
+		if ( ! compileNode(t1, depth)) return false;
+		size_t sc = emit(op == Operation::LOGICAL_AND_OP ? AND_SC : OR_SC);
+		if ( ! compileNode(t2, depth + 1)) return false;
+		size_t ix = emit(OPERATE);
+		code[ix].op = op;
+		code[ix].nargs = 2;
+		code[sc].arg = (int)code.size();
+		return true;
+	}
+
+	case Operation::TERNARY_OP: {
+		// layout is
+		//   <c1> TERNARY_SC TERNARY_FULL [<c2> JUMP end] <c3> end:
+		// where the short circuit jumps into <c2> or <c3> with the
+		// selector popped, or over TERNARY_FULL to end for "c1 ?: c3".
+		if ( ! compileNode(t1, depth)) return false;
+		size_t sc = emit(TERNARY_SC, -1, tree);
+		size_t full = emit(TERNARY_FULL, -1, tree);
+		size_t jmp = 0;
+		if (t2) {
+			code[sc].arg = (int)code.size();
+			if ( ! compileNode(t2, depth)) return false;
+			jmp = emit(JUMP);
+		}
+		if (t3) {
+			code[sc].arg2 = (int)code.size();
+			if ( ! compileNode(t3, depth)) return false;
+		}
+		code[full].arg = (int)code.size();
+		if (t2) {
+			code[jmp].arg = (int)code.size();
+		}
+		return true;
+	}
+
+	default:
+		break;
+	}
+
+	if ( ! t1 || t3) {
+		// not a shape Operation::_Evaluate handles other than via the
+		// ternary code above, so let the tree walker deal with it.
+		emit(EVAL_TREE, 0, tree);
+		return true;
+	}
+
+	if ( ! compileNode(t1, depth)) return false;
+	if (t2 && ! compileNode(t2, depth + 1)) return false;
+	size_t ix = emit(OPERATE);
+	code[ix].op = op;
+	code[ix].nargs = t2 ? 2 : 1;
+	return true;
+}
+
+// mirrors AttributeReference::_Evaluate()
+bool CompiledExpr::
+evalAttr( const AttributeReference *ref, EvalState &state, Value &val ) const
+{
+	ExprTree *tree = NULL;
+	const ClassAd *curAd = state.curAd;
+
+	switch (AttributeReference::Deref(*ref, state, tree)) {
+	case ExprTree::EVAL_FAIL:
+		return false;
+
+	case ExprTree::EVAL_ERROR:
+		val.SetErrorValue();
+		state.curAd = curAd;
+		return true;
+
+	case ExprTree::EVAL_UNDEF:
+		val.SetUndefinedValue();
+		state.curAd = curAd;
+		return true;
+
+	case ExprTree::EVAL_OK: {
+		if (state.depth_remaining <= 0) {
+			val.SetErrorValue();
+			state.curAd = curAd;
+			return false;
+		}
+		state.depth_remaining--;
+
+		bool rval = tree->Evaluate(state, val);
+
+		state.depth_remaining++;
+		state.curAd = curAd;
+		return rval;
+	}
+	default: CLASSAD_EXCEPT( "ClassAd:  Should not reach here" );
+	}
+	return false;
+}
+
+bool CompiledExpr::
+Evaluate( EvalState &state, Value &val ) const
+{
+	Value small_stack[SMALL_STACK];
+	std::vector<Value> big_stack;
+	Value *stack = small_stack;
+	if (max_stack > SMALL_STACK) {
+		big_stack.resize(max_stack);
+		stack = &big_stack[0];
+	}
+
+	int sp = 0;
+	size_t pc = 0;
+	const size_t end = code.size();
+	bool failed = false;
+	bool b;
+
+	while (pc < end && ! failed) {
+		const Instr &ins = code[pc++];
+		switch (ins.code) {
+		case PUSH_CONST:
+			stack[sp++].CopyFrom(consts[ins.arg]);
+			break;
+
+		case EVAL_ATTR: {
+			Value &slot = stack[sp++];
+			slot.Clear();
+			if ( ! evalAttr(attrs[ins.arg], state, slot)) {
+				failed = true;
+			}
+			break;
+		}
+
+		case EVAL_TREE: {
+			Value &slot = stack[sp++];
+			slot.Clear();
+			if ( ! ins.node->Evaluate(state, slot)) {
+				failed = true;
+			}
+			break;
+		}
+
+		case OPERATE: {
+			Value result, dummy2, dummy3;
+			Value *args = &stack[sp - ins.nargs];
+			int rval = Operation::_doOperation(ins.op, args[0],
+						ins.nargs > 1 ? args[1] : dummy2, dummy3,
+						true, ins.nargs > 1, false, result, &state);
+			sp -= ins.nargs;
+			stack[sp++].CopyFrom(result);
+			if (rval == Operation::SIG_NONE) {
+				failed = true;
+			}
+			break;
+		}
+
+		case AND_SC:
+			if (stack[sp-1].IsBooleanValueEquiv(b) && ! b) {
+				stack[sp-1].Clear();
+				stack[sp-1].SetBooleanValue(false);
+				pc = ins.arg;
+			}
+			break;
+
+		case OR_SC:
+			if (stack[sp-1].IsBooleanValueEquiv(b) && b) {
+				stack[sp-1].Clear();
+				stack[sp-1].SetBooleanValue(true);
+				pc = ins.arg;
+			}
+			break;
+
+		case TERNARY_SC:
+			// mirrors Operation3::shortCircuit()
+			if (stack[sp-1].IsBooleanValueEquiv(b)) {
+				if (b) {
+					if (ins.arg >= 0) { --sp; pc = ins.arg; }
+				} else if (ins.arg >= 0 && ins.arg2 >= 0) {
+					--sp; pc = ins.arg2;
+				} else if (ins.arg < 0) {
+					// middle is empty, the selector is the result
+					pc = code[pc].arg;
+				}
+			}
+			break;
+
+		case TERNARY_FULL: {
+			// the selector did not short circuit, so evaluate the rest
+			// exactly the way Operation::_Evaluate does
+			Operation::OpKind op = Operation::__NO_OP__;
+			ExprTree *t1 = NULL, *t2 = NULL, *t3 = NULL;
+			((const Operation*)ins.node)->GetComponents(op, t1, t2, t3);
+
+			Value val2, val3, result;
+			if (t2 && ! t2->Evaluate(state, val2)) { failed = true; break; }
+			if (t3 && ! t3->Evaluate(state, val3)) { failed = true; break; }
+			int rval = Operation::_doOperation(Operation::TERNARY_OP, stack[sp-1], val2, val3,
+						true, t2 != NULL, t3 != NULL, result, &state);
+			stack[sp-1].CopyFrom(result);
+			if (rval == Operation::SIG_NONE) {
+				failed = true;
+			}
+			pc = ins.arg;
+			break;
+		}
+
+		case JUMP:
+			pc = ins.arg;
+			break;
+		}
+	}
+
+	if (failed) {
+		val.SetErrorValue();
+		return false;
+	}
+	val.CopyFrom(stack[0]);
+	return true;
+}
+
+} // classad
@@ -20,8 +20,10 @@
 
 #include "classad/common.h"
 #include "classad/exprTree.h"
+#include "classad/classadCache.h"
 #include "classad/sink.h"
 #include <algorithm> // for std::remove
+#include <string_view>
 
 #ifndef WIN32
 #include <sys/time.h>
@@ -271,6 +273,142 @@ const ExprTree* ExprTree::self()
 	return (pRet);
 }
 
+// the boost hash_combine mix, with the 64 bit constant
+static inline size_t
+hashCombine( size_t seed, size_t val )
+{
+	return seed ^ (val + (size_t)0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+// Must agree with Value::SameAs()
+static size_t
+hashValue( const Value &val, Value::NumberFactor factor )
+{
+	size_t hash = hashCombine((size_t)val.GetType(), (size_t)factor);
+	switch (val.GetType()) {
+	case Value::BOOLEAN_VALUE: {
+		bool b = false;
+		val.IsBooleanValue(b);
+		return hashCombine(hash, b ? 1 : 0);
+	}
+	case Value::INTEGER_VALUE: {
+		long long i = 0;
+		val.IsIntegerValue(i);
+		return hashCombine(hash, std::hash<long long>()(i));
+	}
+	case Value::REAL_VALUE: {
+		double d = 0;
+		val.IsRealValue(d);
+		if (d == 0) { d = 0; } // -0.0 == 0.0
+		return hashCombine(hash, std::hash<double>()(d));
+	}
+	case Value::STRING_VALUE: {
+		const char *str = NULL;
+		int len = 0;
+		val.IsStringValue(str);
+		val.IsStringValue(len);
+		return hashCombine(hash, std::hash<std::string_view>()(std::string_view(str, len)));
+	}
+	case Value::ABSOLUTE_TIME_VALUE: {
+		abstime_t t = {0, 0};
+		val.IsAbsoluteTimeValue(t);
+		hash = hashCombine(hash, std::hash<long long>()(t.secs));
+		return hashCombine(hash, (size_t)t.offset);
+	}
+	case Value::RELATIVE_TIME_VALUE: {
+		double secs = 0;
+		val.IsRelativeTimeValue(secs);
+		if (secs == 0) { secs = 0; }
+		return hashCombine(hash, std::hash<double>()(secs));
+	}
+	default:
+		// lists and ads don't appear in literals, the type will do
+		return hash;
+	}
+}
+
+// Must agree with the SameAs() method of each kind of node
+static size_t
+hashTree( const ExprTree *tree )
+{
+	if ( ! tree) {
+		return 0;
+	}
+
+	size_t hash = (size_t)tree->GetKind() + 1;
+	switch (tree->GetKind()) {
+	case ExprTree::LITERAL_NODE: {
+		Value::NumberFactor factor = Value::NO_FACTOR;
+		const Value &val = ((const Literal*)tree)->getValue(factor);
+		return hashCombine(hash, hashValue(val, factor));
+	}
+
+	case ExprTree::ATTRREF_NODE: {
+		ExprTree *expr = NULL;
+		string attr;
+		bool absolute = false;
+		((const AttributeReference*)tree)->GetComponents(expr, attr, absolute);
+		hash = hashCombine(hash, absolute ? 1 : 0);
+		hash = hashCombine(hash, std::hash<string>()(attr));
+		return hashCombine(hash, hashTree(expr));
+	}
+
+	case ExprTree::OP_NODE: {
+		Operation::OpKind op = Operation::__NO_OP__;
+		ExprTree *t1 = NULL, *t2 = NULL, *t3 = NULL;
+		((const Operation*)tree)->GetComponents(op, t1, t2, t3);
+		hash = hashCombine(hash, (size_t)op);
+		hash = hashCombine(hash, hashTree(t1));
+		hash = hashCombine(hash, hashTree(t2));
+		return hashCombine(hash, hashTree(t3));
+	}
+
+	case ExprTree::FN_CALL_NODE: {
+		string name;
+		vector<ExprTree*> args;
+		((const FunctionCall*)tree)->GetComponents(name, args);
+		hash = hashCombine(hash, std::hash<string>()(name));
+		for (const ExprTree *arg : args) {
+			hash = hashCombine(hash, hashTree(arg));
+		}
+		return hash;
+	}
+
+	case ExprTree::CLASSAD_NODE: {
+		// attribute order does not matter to ClassAd::SameAs(), and names
+		// are compared without regard to case, so combine the attributes
+		// with a sum of case-insensitive hashes.
+		const ClassAd *ad = (const ClassAd*)tree;
+		size_t sum = 0;
+		for (auto it = ad->begin(); it != ad->end(); ++it) {
+			sum += hashCombine(ClassadAttrNameHash()(it->first), hashTree(it->second));
+		}
+		return hashCombine(hash, sum);
+	}
+
+	case ExprTree::EXPR_LIST_NODE: {
+		vector<ExprTree*> items;
+		((const ExprList*)tree)->GetComponents(items);
+		for (const ExprTree *item : items) {
+			hash = hashCombine(hash, hashTree(item));
+		}
+		return hash;
+	}
+
+	case ExprTree::EXPR_ENVELOPE:
+		return ((const CachedExprEnvelope*)tree)->get_hash();
+	}
+
+	return hash;
+}
+
+size_t ExprTree::
+StructuralHash() const
+{
+	size_t hash = hashTree(this);
+	return hash ? hash : 1;
+}
+
 void ExprTree::
 Puke( ) const
 {
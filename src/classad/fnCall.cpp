@@ -39,6 +39,7 @@
 
 #define PCRE2_CODE_UNIT_WIDTH 8
 #include <pcre2.h>
+#include "classad/regexCache.h"
 
 #ifdef UNIX
 #include <dlfcn.h>
@@ -2091,7 +2092,7 @@ bool FunctionCall::hasRefs(const char*, const ArgumentList& argList, EvalState&
 
 	// for the 2 arg form, the second argument is a regex pattern to be compared against
 	// each of the unresolved references
-	pcre2_code * re = nullptr;
+	RegexPtr re;
 	if (argList.size() == 2) {
 		const char* pattern = nullptr;
 		if ( !argList[1]->Evaluate(state, arg) || ! arg.IsStringValue(pattern)) {
@@ -2099,10 +2100,7 @@ bool FunctionCall::hasRefs(const char*, const ArgumentList& argList, EvalState&
 			return false;
 		}
 
-		int error_number;
-		PCRE2_SIZE error_offset;
-		PCRE2_SPTR pattern_pcre2str = reinterpret_cast<const unsigned char *>(pattern);
-		re = pcre2_compile(pattern_pcre2str, PCRE2_ZERO_TERMINATED, PCRE2_CASELESS, &error_number, &error_offset, NULL);
+		re = RegexCache::Acquire(pattern, PCRE2_CASELESS);
 		if ( ! re) {
 			// error in pattern
 			result.SetErrorValue();
@@ -2122,9 +2120,10 @@ bool FunctionCall::hasRefs(const char*, const ArgumentList& argList, EvalState&
 					len -= 7;
 				}
 				if (re) {
-					pcre2_match_data * match_data = pcre2_match_data_create_from_pattern(re, NULL);
+					const pcre2_code * re_code = static_cast<const pcre2_code *>(RegexCache::Code(re));
+					pcre2_match_data * match_data = pcre2_match_data_create_from_pattern(re_code, NULL);
 					PCRE2_SPTR attr_pcre2str = reinterpret_cast<const unsigned char *>(attr);
-					if (pcre2_match(re, attr_pcre2str, len, 0, PCRE2_NOTEMPTY, match_data, NULL) > 0) {
+					if (pcre2_match(re_code, attr_pcre2str, len, 0, PCRE2_NOTEMPTY, match_data, NULL) > 0) {
 						result.SetBooleanValue(true); // found a match
 						pcre2_match_data_free(match_data);
 						break;
@@ -2141,8 +2140,6 @@ bool FunctionCall::hasRefs(const char*, const ArgumentList& argList, EvalState&
 
 	if ( ! re) {
 		result.SetStringValue(val);
-	} else {
-		pcre2_code_free(re);
 	}
 	return true;
 }
@@ -3069,10 +3066,8 @@ static bool regexp_helper(
 	bool		full_target = false;
 	bool		find_all = false;
 
-	PCRE2_SIZE error_offset;
-	int error_code;
-	pcre2_code * re = NULL;
-	PCRE2_SPTR pattern_pcre2 = reinterpret_cast<const unsigned char *>(pattern);
+	RegexPtr re_ptr;
+	const pcre2_code * re = NULL;
 	PCRE2_SIZE *ovector = NULL;
 	bool empty_match = false;
 	uint32_t addl_opts = 0;
@@ -3113,7 +3108,8 @@ static bool regexp_helper(
 		}
     }
 
-    re = pcre2_compile(pattern_pcre2, PCRE2_ZERO_TERMINATED, options, &error_code, &error_offset, NULL);
+    re_ptr = RegexCache::Acquire(pattern, options);
+    re = static_cast<const pcre2_code *>(RegexCache::Code(re_ptr));
     if ( re == NULL ){
 			// error in pattern
 		result.SetErrorValue( );
@@ -3200,9 +3196,6 @@ static bool regexp_helper(
 		result.SetStringValue(output);
 	}
  cleanup:
-	if ( re ) {
-		pcre2_code_free(re);
-	}
     return true;
 }
 
@@ -40,6 +40,7 @@ MatchClassAd()
 	symmetric_match = NULL;
 	right_matches_left = NULL;
 	left_matches_right = NULL;
+	symmetric_match_prog = right_matches_left_prog = left_matches_right_prog = NULL;
 	InitMatchClassAd( NULL, NULL );
 }
 
@@ -49,6 +50,7 @@ MatchClassAd( ClassAd *adl, ClassAd *adr ) : ClassAd()
 {
 	lad = rad = lCtx = rCtx = NULL;
 	ladParent = radParent = NULL;
+	symmetric_match_prog = right_matches_left_prog = left_matches_right_prog = NULL;
 	InitMatchClassAd( adl, adr );
 }
 
@@ -56,6 +58,17 @@ MatchClassAd( ClassAd *adl, ClassAd *adr ) : ClassAd()
 MatchClassAd::
 ~MatchClassAd()
 {
+	ClearCompiledExprs();
+}
+
+
+void MatchClassAd::
+ClearCompiledExprs()
+{
+	delete symmetric_match_prog;
+	delete right_matches_left_prog;
+	delete left_matches_right_prog;
+	symmetric_match_prog = right_matches_left_prog = left_matches_right_prog = NULL;
 }
 
 
@@ -74,6 +87,7 @@ InitMatchClassAd( ClassAd *adl, ClassAd *adr )
 	this->DisableDirtyTracking();
 
 		// clear out old info
+	ClearCompiledExprs();
 	Clear( );
 	lad = rad = NULL;
 	lCtx = rCtx = NULL;
@@ -447,14 +461,31 @@ UnoptimizeAdForMatchmaking( ClassAd *ad )
 }
 
 bool MatchClassAd::
-EvalMatchExpr(ExprTree *match_expr)
+EvalMatchExpr(ExprTree *match_expr, CompiledExpr *&prog)
 {
 	Value val;
 	if( !match_expr ) {
 		return false;
 	}
 
-	if( EvaluateExpr( match_expr, val ) ) {
+	bool evaluated;
+	const CompiledExpr *use_prog = NULL;
+	if( ClassAdGetExpressionCompiling() && match_expr->GetKind() == ExprTree::OP_NODE ) {
+		if( !prog ) {
+			prog = CompiledExpr::Compile( match_expr );
+		}
+		use_prog = prog;
+	}
+	if( use_prog ) {
+			// same as EvaluateExpr(), but running the program
+		EvalState state;
+		state.SetScopes( this );
+		evaluated = use_prog->Evaluate( state, val ) && val.SafetyCheck( state, Value::ValueType::SAFE_VALUES );
+	} else {
+		evaluated = EvaluateExpr( match_expr, val );
+	}
+
+	if( evaluated ) {
 		bool result = false;
 		if( val.IsBooleanValueEquiv( result ) ) {
 			return result;
@@ -470,19 +501,19 @@ EvalMatchExpr(ExprTree *match_expr)
 bool MatchClassAd::
 symmetricMatch()
 {
-	return EvalMatchExpr( symmetric_match );
+	return EvalMatchExpr( symmetric_match, symmetric_match_prog );
 }
 
 bool MatchClassAd::
 rightMatchesLeft()
 {
-	return EvalMatchExpr( right_matches_left );
+	return EvalMatchExpr( right_matches_left, right_matches_left_prog );
 }
 
 bool MatchClassAd::
 leftMatchesRight()
 {
-	return EvalMatchExpr( left_matches_right );
+	return EvalMatchExpr( left_matches_right, left_matches_right_prog );
 }
 
 } // classad
@@ -0,0 +1,249 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "classad/common.h"
+#include "classad/classad.h"
+#include "classad/regexCache.h"
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+
+namespace classad {
+
+struct CompiledRegex
+{
+	explicit CompiledRegex( pcre2_code *re ) : code(re) {}
+	~CompiledRegex() { pcre2_code_free(code); }
+
+	pcre2_code *code;
+
+	private:
+		CompiledRegex( const CompiledRegex & );
+		CompiledRegex &operator=( const CompiledRegex & );
+};
+
+namespace {
+
+class RegexLRU
+{
+	public:
+		RegexLRU() : max_entries(128), do_jit(false) {}
+
+		RegexPtr acquire( const char *pattern, uint32_t options );
+		void setMaxEntries( size_t max );
+		void setJIT( bool jit );
+		size_t size();
+
+		std::atomic<size_t> max_entries;
+		std::atomic<bool> do_jit;
+		std::atomic<unsigned long> hits{0};
+		std::atomic<unsigned long> misses{0};
+		std::atomic<unsigned long> evictions{0};
+
+	private:
+		struct Key {
+			uint32_t options;
+			std::string pattern;
+			bool operator==( const Key &rhs ) const {
+				return options == rhs.options && pattern == rhs.pattern;
+			}
+		};
+		struct KeyHash {
+			size_t operator()( const Key &key ) const {
+				return std::hash<std::string>()(key.pattern) ^ ((size_t)key.options * 0x9e3779b9);
+			}
+		};
+		typedef std::list<Key> LruList;
+		struct Entry {
+			RegexPtr re;
+			LruList::iterator pos;
+		};
+
+		static RegexPtr compile( const char *pattern, uint32_t options, bool jit );
+		void trim();
+
+		std::mutex mtx;
+		std::unordered_map<Key, Entry, KeyHash> table;
+		LruList lru;	// most recently used at the front
+		unsigned long generation{0};	// bumped whenever the entries are thrown away
+};
+
+RegexPtr RegexLRU::
+compile( const char *pattern, uint32_t options, bool jit )
+{
+	int error_code;
+	PCRE2_SIZE error_offset;
+	PCRE2_SPTR pattern_pcre2 = reinterpret_cast<const unsigned char *>(pattern);
+	pcre2_code *re = pcre2_compile(pattern_pcre2, PCRE2_ZERO_TERMINATED, options, &error_code, &error_offset, NULL);
+	if ( ! re) {
+		return RegexPtr();
+	}
+	if (jit) {
+		// failure just means pcre2_match() uses the interpreter
+		pcre2_jit_compile(re, PCRE2_JIT_COMPLETE);
+	}
+	return std::make_shared<const CompiledRegex>(re);
+}
+
+RegexPtr RegexLRU::
+acquire( const char *pattern, uint32_t options )
+{
+	if (max_entries == 0) {
+		misses++;
+		return compile(pattern, options, do_jit);
+	}
+
+	Key key{options, pattern};
+	unsigned long gen;
+	bool jit;
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		auto it = table.find(key);
+		if (it != table.end()) {
+			hits++;
+			lru.splice(lru.begin(), lru, it->second.pos);
+			return it->second.re;
+		}
+		gen = generation;
+		jit = do_jit;
+	}
+
+	// compile without the lock, so that a slow pattern does not hold up
+	// the threads that are looking up other patterns
+	misses++;
+	RegexPtr re = compile(pattern, options, jit);
+	if ( ! re) {
+		return re;
+	}
+
+	std::lock_guard<std::mutex> guard(mtx);
+	if (gen != generation || max_entries == 0) {
+		// the cache was reset while we were compiling, don't put
+		// a pattern compiled the old way into it
+		return re;
+	}
+	auto it = table.find(key);
+	if (it != table.end()) {
+		// another thread compiled the same pattern, share its copy
+		lru.splice(lru.begin(), lru, it->second.pos);
+		return it->second.re;
+	}
+	lru.push_front(key);
+	table.emplace(std::move(key), Entry{re, lru.begin()});
+	trim();
+	return re;
+}
+
+// caller must hold the lock
+void RegexLRU::
+trim()
+{
+	while (table.size() > max_entries) {
+		table.erase(lru.back());
+		lru.pop_back();
+		evictions++;
+	}
+}
+
+void RegexLRU::
+setMaxEntries( size_t max )
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	max_entries = max;
+	trim();
+}
+
+void RegexLRU::
+setJIT( bool jit )
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	if (jit != do_jit) {
+		// start over so that every entry is compiled the same way
+		table.clear();
+		lru.clear();
+		generation++;
+	}
+	do_jit = jit;
+}
+
+size_t RegexLRU::
+size()
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	return table.size();
+}
+
+// Constructed on first use and never destroyed, so that it is safe to
+// use from static initializers and destructors.
+RegexLRU &
+theCache()
+{
+	static RegexLRU *cache = new RegexLRU();
+	return *cache;
+}
+
+} // anonymous namespace
+
+RegexPtr RegexCache::
+Acquire( const char *pattern, uint32_t options )
+{
+	return theCache().acquire(pattern, options);
+}
+
+const void *RegexCache::
+Code( const RegexPtr &re )
+{
+	return re ? re->code : NULL;
+}
+
+void RegexCache::
+_debug_get_counts( unsigned long &hits, unsigned long &misses, unsigned long &evictions, unsigned long &entries )
+{
+	RegexLRU &cache = theCache();
+	hits = cache.hits;
+	misses = cache.misses;
+	evictions = cache.evictions;
+	entries = cache.size();
+}
+
+void ClassAdSetRegexCacheSize(size_t max_entries)
+{
+	theCache().setMaxEntries(max_entries);
+}
+
+size_t ClassAdGetRegexCacheSize()
+{
+	return theCache().max_entries;
+}
+
+void ClassAdSetRegexJIT(bool do_jit)
+{
+	theCache().setJIT(do_jit);
+}
+
+bool ClassAdGetRegexJIT()
+{
+	return theCache().do_jit;
+}
+
+} // classad
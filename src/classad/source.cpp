@@ -39,7 +39,7 @@ namespace classad {
 
 ClassAdParser::
 ClassAdParser ()
-	: depth(0), oldClassAd(false)
+	: depth(0), oldClassAd(false), arena(NULL)
 {
 }
 
@@ -63,9 +63,16 @@ GetOldClassAd() const
 	return oldClassAd;
 }
 
+void ClassAdParser::
+SetArena( ClassAdArena *a )
+{
+	arena = a;
+}
+
 bool ClassAdParser::
 ParseExpression( const string &buffer, ExprTree *&tree, bool full )
 {
+	ClassAdArenaScope arena_scope(arena);
 	bool              success;
 	StringLexerSource lexer_source(&buffer);
 
@@ -80,6 +87,7 @@ ParseExpression( const string &buffer, ExprTree *&tree, bool full )
 bool ClassAdParser::
 ParseExpression( const char *buffer, ExprTree *&tree, bool full )
 {
+	ClassAdArenaScope arena_scope(arena);
 	bool              success;
 	CharLexerSource lexer_source(buffer);
 
@@ -94,6 +102,7 @@ ParseExpression( const char *buffer, ExprTree *&tree, bool full )
 bool ClassAdParser::
 ParseExpression( LexerSource *lexer_source, ExprTree *&tree, bool full )
 {
+	ClassAdArenaScope arena_scope(arena);
 	bool              success;
 
 	success      = false;
@@ -108,6 +117,7 @@ ParseExpression( LexerSource *lexer_source, ExprTree *&tree, bool full )
 ExprTree *ClassAdParser::
 ParseExpression( const string &buffer, bool full)
 {
+	ClassAdArenaScope arena_scope(arena);
 	ExprTree          *tree;
 	StringLexerSource lexer_source(&buffer);
 
@@ -127,6 +137,7 @@ ParseExpression( const string &buffer, bool full)
 ExprTree *ClassAdParser::
 ParseExpression( const char *buffer, bool full)
 {
+	ClassAdArenaScope arena_scope(arena);
 	ExprTree          *tree;
 	CharLexerSource lexer_source(buffer);
 
@@ -146,6 +157,7 @@ ParseExpression( const char *buffer, bool full)
 ExprTree *ClassAdParser::
 ParseExpression( LexerSource *lexer_source, bool full )
 {
+	ClassAdArenaScope arena_scope(arena);
 	ExprTree          *tree;
 
 	tree = NULL;
@@ -164,6 +176,7 @@ ParseExpression( LexerSource *lexer_source, bool full )
 ExprTree *ClassAdParser::
 ParseNextExpression(void)
 {
+	ClassAdArenaScope arena_scope(arena);
     ExprTree *tree;
 
     tree = NULL;
@@ -244,6 +257,7 @@ bool ClassAdParser::ParseClassAd(FILE *file, ClassAd &classad, bool full)
 bool ClassAdParser::
 ParseClassAd(LexerSource *lexer_source, ClassAd &classad, bool full)
 {
+	ClassAdArenaScope arena_scope(arena);
 	bool              success;
 
 	success      = false;
@@ -324,6 +338,7 @@ ParseClassAd(FILE *file, bool full)
 ClassAd *ClassAdParser::
 ParseClassAd(LexerSource *lexer_source, bool full)
 {
+	ClassAdArenaScope arena_scope(arena);
 	ClassAd  *ad;
 
 	ad = new ClassAd;
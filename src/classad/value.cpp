@@ -167,7 +167,7 @@ CopyFrom( const Value &val )
 
 	switch (val.valueType) {
 		case STRING_VALUE:
-			strValue = new string( *val.strValue);
+			strValue = ClassAdArenaNew<string>( *val.strValue );
 			return;
 
 		case BOOLEAN_VALUE:
@@ -265,7 +265,7 @@ SetStringValue( const string &s )
 	}
 	_Clear();
 	valueType = STRING_VALUE;
-	strValue = new string( s );
+	strValue = ClassAdArenaNew<string>( s );
 }
 
 void Value::
@@ -278,7 +278,7 @@ SetStringValue( const char *s )
 	}
 	_Clear();
 	valueType = STRING_VALUE;
-	strValue = new string( s );
+	strValue = ClassAdArenaNew<string>( s );
 }
 
 void Value::
@@ -291,7 +291,7 @@ SetStringValue( const char *s, size_t cch )
 	}
 	_Clear();
 	valueType = STRING_VALUE;
-	strValue = new string( s, cch );
+	strValue = ClassAdArenaNew<string>( s, cch );
 }
 
 void Value::
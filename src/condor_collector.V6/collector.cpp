@@ -40,6 +40,8 @@
 #include "authentication.h"
 
 #include "collector.h"
+#include "query_threads.h"
+#include "update_threads.h"
 
 #if defined(UNIX) && !defined(DARWIN)
 #include "CollectorPlugin.h"
@@ -75,7 +77,7 @@ ClassAd* CollectorDaemon::__query__;
 int CollectorDaemon::__numAds__;
 int CollectorDaemon::__resultLimit__;
 int CollectorDaemon::__failed__;
-List<CollectorRecord>* CollectorDaemon::__ClassAdResultList__;
+CollectorDaemon::QueryResultSender* CollectorDaemon::__resultSender__;
 std::string CollectorDaemon::__adType__;
 ExprTree *CollectorDaemon::__filter__;
 
@@ -114,6 +116,11 @@ int CollectorDaemon::max_pending_query_workers = 50;
 int CollectorDaemon::max_query_worktime = 0;
 int CollectorDaemon::active_query_workers = 0;
 int CollectorDaemon::pending_query_workers = 0;
+int CollectorDaemon::max_query_threads = 0;
+QueryThreadPool *CollectorDaemon::query_threads = NULL;
+int CollectorDaemon::max_update_threads = 0;
+UpdateThreadPool *CollectorDaemon::update_threads = NULL;
+int CollectorDaemon::max_update_batch = 10000;
 
 #ifdef TRACK_QUERIES_BY_SUBSYS
 bool CollectorDaemon::want_track_queries_by_subsys = false;
@@ -382,6 +389,8 @@ void CollectorDaemon::Init()
 	// install command handlers for updates
 	daemonCore->Register_CommandWithPayload(UPDATE_STARTD_AD,"UPDATE_STARTD_AD",
 		receive_update,"receive_update",ADVERTISE_STARTD_PERM);
+	daemonCore->Register_CommandWithPayload(UPDATE_STARTD_AD_DELTA,"UPDATE_STARTD_AD_DELTA",
+		receive_update,"receive_update",ADVERTISE_STARTD_PERM);
 	daemonCore->Register_CommandWithPayload(MERGE_STARTD_AD,"MERGE_STARTD_AD",
 		receive_update,"receive_update",NEGOTIATOR);
 	daemonCore->Register_CommandWithPayload(UPDATE_SCHEDD_AD,"UPDATE_SCHEDD_AD",
@@ -420,6 +429,13 @@ void CollectorDaemon::Init()
 		schedd_token_request, "schedd_token_request", DAEMON,
 		true, 0, &allow_perms);
 
+		// The commands in a batch are each checked against the
+		// permission the command would need on its own.
+	std::vector<DCpermission> batch_perms{ADVERTISE_STARTD_PERM, ADVERTISE_SCHEDD_PERM, ADVERTISE_MASTER_PERM};
+	daemonCore->Register_CommandWithPayload(UPDATE_AD_BATCH,"UPDATE_AD_BATCH",
+		receive_update_batch,"receive_update_batch", DAEMON, false,
+		STANDARD_COMMAND_PAYLOAD_TIMEOUT, &batch_perms);
+
     // install command handlers for updates with acknowledgement
 
     daemonCore->Register_CommandWithPayload(
@@ -455,6 +471,10 @@ void CollectorDaemon::Init()
 
     }
 
+	// then the ads we had when we last shut down, so we can answer
+	// queries before the daemons send their next updates
+	collector.loadState();
+
 	// add an exponential moving average counter of updates received.
 	daemonCore->dc_stats.NewProbe("Collector", "UpdatesReceived", AS_COUNT | IS_CLS_SUM_EMA_RATE | IF_BASICPUB);
 
@@ -472,6 +492,7 @@ collector_runtime_probe HandleQueryForked_runtime;
 collector_runtime_probe HandleQueryMissedFork_runtime;
 collector_runtime_probe HandleLocateForked_runtime;
 collector_runtime_probe HandleLocateMissedFork_runtime;
+collector_runtime_probe HandleQueryThreaded_runtime;
 
 
 template <typename T>
@@ -564,6 +585,69 @@ int CollectorDaemon::receive_query_cedar(int command,
 		// dprintf(D_FULLDEBUG,"QueryWorker old sock_deadline = %d, now new_deadline = %d\n",sock_deadline,new_deadline);
 	}
 
+	// If we have query threads, hand the query to one of them, to be answered
+	// from a snapshot of the ads.  Queries for collector ads are still handled
+	// the old way, since our own ad gets fresh statistics put into it.
+	if ( query_threads && whichAds != COLLECTOR_AD && whichAds != (AdTypes) -1 ) {
+		rt.runtime = &HandleQueryThreaded_runtime;
+
+		std::string subsys;
+		const std::string &sess_id = static_cast<Sock *>(sock)->getSessionID();
+		daemonCore->getSecMan()->getSessionStringAttribute(sess_id.c_str(),ATTR_SEC_SUBSYSTEM,subsys);
+		if ( ! subsys.empty()) {
+			clientSubsys = getKnownSubsysNum(subsys.c_str());
+		}
+		// Same priorities as for forked query workers, see below.
+		bool high_prio_query = clientSubsys == SUBSYSTEM_ID_NEGOTIATOR || clientSubsys == SUBSYSTEM_ID_COLLECTOR ||
+			daemonCore->Is_Command_From_SuperUser(sock);
+
+		int num_threads = query_threads->size();
+		int reserved = query_threads->reserved();
+		int active = 0, pending = 0, pending_high_prio = 0;
+		query_threads->getCounts(active, pending, pending_high_prio);
+		if ( ( ! high_prio_query &&
+			   (active + pending >= num_threads + max_pending_query_workers - reserved))
+			 ||
+			 (high_prio_query &&
+			   (active - reserved + pending_high_prio >= num_threads + max_pending_query_workers))
+		   )
+		{
+			dprintf( D_ALWAYS,
+				"QueryThreads: dropping %s priority query request due to max pending queries of %d ( threads %d reserved %d active %d pending %d )\n",
+				high_prio_query ? "high" : "low",
+				max_pending_query_workers, num_threads, reserved, active, pending );
+			collectorStats.global.DroppedQueries += 1;
+			goto END;
+		}
+
+		ThreadedQuery *query = new ThreadedQuery();
+		query->arrived = rt.begin;
+		query->cad = cad;
+		query->sock = sock;
+		query->whichAds = whichAds;
+		query->is_locate = is_locate;
+		query->high_prio = high_prio_query;
+		query->subsys = subsys;
+		query->filter_private_attrs = query_filters_private_attrs(whichAds, cad, sock);
+		query->filter = prepare_query(whichAds, cad, query->adType, query->resultLimit);
+		std::string projection;
+		if (cad->Lookup(ATTR_PROJECTION) && ! cad->LookupString(ATTR_PROJECTION, projection)) {
+			// The projection is evaluated against each ad we send.  Each query
+			// needs its own match ad for that, the shared one is not thread safe.
+			query->projection_mad = new classad::MatchClassAd();
+			query->projection_mad->ReplaceLeftAd(cad);
+		}
+		query->snapshot = collector.getSnapshot(whichAds, query->filter);
+
+		query_threads->enqueue(query);
+		collectorStats.global.ActiveQueryThreads = active;
+		collectorStats.global.PendingQueries = pending + 1;
+
+		cad = NULL; // the query thread pool deletes it along with the query
+		return_status = KEEP_STREAM; // and the socket
+		goto END;
+	}
+
 	// malloc a query_entry struct.  we must use malloc here, not new, since
 	// DaemonCore::Create_Thread requires a buffer created with malloc(), as it 
 	// will insist on calling free().  Sigh.
@@ -571,6 +655,7 @@ int CollectorDaemon::receive_query_cedar(int command,
 	ASSERT(query_entry);
 	query_entry->cad = cad;
 	query_entry->is_locate = is_locate;
+	query_entry->in_proc = false;
 	query_entry->subsys[0] = 0;
 	query_entry->sock = sock;
 	query_entry->whichAds = whichAds;
@@ -594,6 +679,7 @@ int CollectorDaemon::receive_query_cedar(int command,
 		// We want to immediately handle the query inline in this process.
 		// So in this case, we simply directly invoke our worker thread function.
 		dprintf(D_FULLDEBUG,"QueryWorker: about to handle query in-process\n");
+		query_entry->in_proc = true;
 		return_status = receive_query_cedar_worker_thread((void *)query_entry,sock);
 	} else {
 		// Enqueue the query to ultimately run in a forked process created created with
@@ -826,17 +912,10 @@ int CollectorDaemon::QueryReaper(int pid, int /* exit_status */ )
 }
 
 
-int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Stream* sock)
+// Decide whether the private attributes of ads must be left out of the
+// answer to a query.  This must be called on the main thread.
+bool CollectorDaemon::query_filters_private_attrs(AdTypes whichAds, ClassAd *cad, Stream *sock)
 {
-	int return_status = TRUE;
-	double begin = condor_gettimestamp_double();
-	List<CollectorRecord> results;
-
-	// Pull out relavent state from query_entry
-	pending_query_entry_t *query_entry = (pending_query_entry_t *) in_query_entry;
-	ClassAd *cad = query_entry->cad;
-	bool is_locate = query_entry->is_locate;
-	AdTypes whichAds = query_entry->whichAds;
 	bool wants_pvt_attrs = false;
 
 	cad->LookupBool(ATTR_SEND_PRIVATE_ATTRIBUTES, wants_pvt_attrs);
@@ -871,137 +950,411 @@ int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Str
 		filter_private_attrs = false;
 	}
 
-	// Perform the query
 
-	if (whichAds != (AdTypes) -1) {
-		process_query_public (whichAds, cad, &results);
-	}
+	return filter_private_attrs;
+}
 
-	double end_query = condor_gettimestamp_double();
-	double end_write = 0.0;
+// Sends the ads that match a query to the client as the table is walked,
+// so the client gets the first of them without waiting for the rest and
+// a big answer is never held in memory.
+//
+// A forked query worker writes in blocking mode, so a client that reads
+// slowly also slows down the walk.  A query handled in-process must not
+// stall the collector, so it writes without blocking and leaves whatever
+// the client isn't ready for in the socket's buffer.
+struct CollectorDaemon::QueryResultSender
+{
+	QueryResultSender(Stream *sock, ClassAd *query, AdTypes whichAds, bool filter_private_attrs, bool non_blocking);
 
-	// send the results via cedar			
-	sock->timeout(QueryTimeout); // set up a network timeout of a longer duration
-	sock->encode();
-	results.Rewind();
-	CollectorRecord* curr_rec = nullptr;
-	int more = 1;
-	
-		// See if query ad asks for server-side projection
-	string projection = "";
-		// turn projection string into a set of attributes
+		// Returns false if the query should stop.
+	bool send(CollectorRecord *record);
+		// Returns 1 when done, 0 on failure, or 2 if the end of
+		// the response is still waiting to go out to the client.
+	int finish();
+
+	ReliSock *sock;
+	ClassAd *query;
+	AdTypes whichAds;
+	bool filter_private_attrs;
+	bool non_blocking;
+	bool backlog;		// some of the answer has waited in the buffer
+	bool failed;
+	double first_sent;	// when the first ad went out
+	std::string projection;
 	classad::References proj;
-	bool evaluate_projection = false;
-	if (cad->LookupString(ATTR_PROJECTION, projection) && ! projection.empty()) {
+	bool evaluate_projection;
+};
+
+CollectorDaemon::QueryResultSender::QueryResultSender(Stream *sock_, ClassAd *query_, AdTypes whichAds_, bool filter_private_attrs_, bool non_blocking_)
+	: sock(static_cast<ReliSock *>(sock_))
+	, query(query_)
+	, whichAds(whichAds_)
+	, filter_private_attrs(filter_private_attrs_)
+	, non_blocking(non_blocking_)
+	, backlog(false)
+	, failed(false)
+	, first_sent(0.0)
+	, evaluate_projection(false)
+{
+		// See if query ad asks for server-side projection
+	if (query->LookupString(ATTR_PROJECTION, projection) && ! projection.empty()) {
+			// turn projection string into a set of attributes
 		StringTokenIterator list(projection);
 		const std::string * attr;
 		while ((attr = list.next_string())) { proj.insert(*attr); }
-	} else if (cad->Lookup(ATTR_PROJECTION)) {
+	} else if (query->Lookup(ATTR_PROJECTION)) {
 		// if projection is not a simple string, then assume that evaluating it as a string in the context of the ad will work better
 		// (the negotiator sends this sort of projection)
 		evaluate_projection = true;
 	}
 
-	while ( (curr_rec=results.Next()) )
-	{
-		ClassAd* ad_to_send = filter_private_attrs ? curr_rec->m_publicAd : curr_rec->m_pvtAd;
-		// if querying collector ads, and the collectors own ad appears in this list.
-		// then we want to shove in current statistics. we do this by chaining a
-		// temporary stats ad into the ad to be returned, and publishing updated
-		// statistics into the stats ad.  we do this because if the verbosity level
-		// is increased we do NOT want to put the high-verbosity attributes into
-		// our persistent collector ad.
-		ClassAd * stats_ad = NULL;
-		if ((whichAds == COLLECTOR_AD) && collector.isSelfAd(curr_rec)) {
-			dprintf(D_ALWAYS,"Query includes collector's self ad\n");
-			// update stats in the collector ad before we return it.
-			std::string stats_config;
-			cad->LookupString("STATISTICS_TO_PUBLISH",stats_config);
-			if (stats_config != "stored") {
-				dprintf(D_ALWAYS,"Updating collector stats using a chained ad and config=%s\n", stats_config.c_str());
-				stats_ad = new ClassAd();
-				if (!filter_private_attrs) {
-					stats_ad->CopyFrom(*curr_rec->m_pvtAd);
-				}
-				daemonCore->dc_stats.Publish(*stats_ad, stats_config.c_str());
-				daemonCore->monitor_data.ExportData(stats_ad, true);
-				collectorStats.publishGlobal(stats_ad, stats_config.c_str());
-				stats_ad->ChainToAd(curr_rec->m_publicAd);
-				ad_to_send = stats_ad; // send the stats ad instead of the self ad.
+	sock->timeout(QueryTimeout); // set up a network timeout of a longer duration
+	sock->encode();
+}
+
+bool CollectorDaemon::QueryResultSender::send(CollectorRecord *record)
+{
+	ClassAd* ad_to_send = filter_private_attrs ? record->m_publicAd : record->m_pvtAd;
+	// if querying collector ads, and the collectors own ad appears in this list.
+	// then we want to shove in current statistics. we do this by chaining a
+	// temporary stats ad into the ad to be returned, and publishing updated
+	// statistics into the stats ad.  we do this because if the verbosity level
+	// is increased we do NOT want to put the high-verbosity attributes into
+	// our persistent collector ad.
+	ClassAd * stats_ad = NULL;
+	if ((whichAds == COLLECTOR_AD) && collector.isSelfAd(record)) {
+		dprintf(D_ALWAYS,"Query includes collector's self ad\n");
+		// update stats in the collector ad before we return it.
+		std::string stats_config;
+		query->LookupString("STATISTICS_TO_PUBLISH",stats_config);
+		if (stats_config != "stored") {
+			dprintf(D_ALWAYS,"Updating collector stats using a chained ad and config=%s\n", stats_config.c_str());
+			stats_ad = new ClassAd();
+			if (!filter_private_attrs) {
+				stats_ad->CopyFrom(*record->m_pvtAd);
 			}
+			daemonCore->dc_stats.Publish(*stats_ad, stats_config.c_str());
+			daemonCore->monitor_data.ExportData(stats_ad, true);
+			collectorStats.publishGlobal(stats_ad, stats_config.c_str());
+			stats_ad->ChainToAd(record->m_publicAd);
+			ad_to_send = stats_ad; // send the stats ad instead of the self ad.
 		}
+	}
 
-		if (evaluate_projection) {
-			proj.clear();
-			projection.clear();
-			if (EvalString(ATTR_PROJECTION, cad, curr_rec->m_publicAd, projection) && ! projection.empty()) {
-				StringTokenIterator list(projection);
-				const std::string * attr;
-				while ((attr = list.next_string())) { proj.insert(*attr); }
-			}
+	if (evaluate_projection) {
+		proj.clear();
+		projection.clear();
+		if (EvalString(ATTR_PROJECTION, query, record->m_publicAd, projection) && ! projection.empty()) {
+			StringTokenIterator list(projection);
+			const std::string * attr;
+			while ((attr = list.next_string())) { proj.insert(*attr); }
 		}
+	}
 
-		bool send_failed = (!sock->code(more) || !putClassAd(sock, *ad_to_send, 0, proj.empty() ? NULL : &proj));
-        
-		if (stats_ad) {
-			stats_ad->Unchain();
-			delete stats_ad;
+	int more = 1;
+	bool send_failed;
+	{
+		BlockingModeGuard guard(sock, non_blocking);
+		if (proj.empty() && ! stats_ad) {
+			// Most ads are sent many times between updates, so send the
+			// serialized form kept with the record.
+			SerializedClassAd &wire = filter_private_attrs ? record->m_ads->m_publicWire : record->m_ads->m_pvtWire;
+			send_failed = (!sock->code(more) || !putClassAd(sock, wire));
+		} else {
+			send_failed = (!sock->code(more) || !putClassAd(sock, *ad_to_send, 0, proj.empty() ? NULL : &proj));
 		}
+	}
+	if (sock->clear_backlog_flag()) {
+		backlog = true;
+	}
+	if (first_sent == 0.0) {
+		first_sent = condor_gettimestamp_double();
+	}
 
-		if (send_failed)
-        {
-            dprintf (D_ALWAYS,
-                    "Error sending query result to client -- aborting\n");
-            return_status = 0;
-			goto END;
-        }
+	if (stats_ad) {
+		stats_ad->Unchain();
+		delete stats_ad;
+	}
 
-		if (sock->deadline_expired()) {
-			dprintf( D_ALWAYS,
-				"QueryWorker: max_worktime expired while sending query result to client -- aborting\n");
-			return_status = 0;
-			goto END;
-		}
+	if (send_failed)
+	{
+		dprintf (D_ALWAYS,
+				"Error sending query result to client -- aborting\n");
+		failed = true;
+		return false;
+	}
 
-	} // end of while loop for next result ad to send
+	if (sock->deadline_expired()) {
+		dprintf( D_ALWAYS,
+			"QueryWorker: max_worktime expired while sending query result to client -- aborting\n");
+		failed = true;
+		return false;
+	}
 
+	return true;
+}
+
+int CollectorDaemon::QueryResultSender::finish()
+{
 	// end of query response ...
-	more = 0;
-	if (!sock->code(more))
+	int more = 0;
+	bool sent;
+	{
+		BlockingModeGuard guard(sock, non_blocking);
+		sent = sock->code(more);
+	}
+	if ( ! sent)
 	{
 		dprintf (D_ALWAYS, "Error sending EndOfResponse (0) to client\n");
 	}
 
 	// flush the output
-	if (!sock->end_of_message())
+	int retval = non_blocking ? sock->end_of_message_nonblocking() : sock->end_of_message();
+	if (sock->clear_backlog_flag()) {
+		return 2;
+	}
+	if ( ! retval)
 	{
 		dprintf (D_ALWAYS, "Error flushing CEDAR socket\n");
+		return 0;
+	}
+	return 1;
+}
+
+// Socket handler for the end of an in-process query response that the
+// client wasn't ready to read when it was sent.
+int CollectorDaemon::finish_query_response(Stream *sock)
+{
+	ReliSock *rsock = static_cast<ReliSock *>(sock);
+	int retval = rsock->finish_end_of_message();
+	if (rsock->clear_backlog_flag()) {
+		return KEEP_STREAM;
+	}
+	if ( ! retval) {
+		dprintf (D_ALWAYS, "Error flushing CEDAR socket\n");
+	}
+	return TRUE;
+}
+
+int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Stream* sock)
+{
+	int return_status = TRUE;
+	double begin = condor_gettimestamp_double();
+
+	// Pull out relavent state from query_entry
+	pending_query_entry_t *query_entry = (pending_query_entry_t *) in_query_entry;
+	ClassAd *cad = query_entry->cad;
+	bool is_locate = query_entry->is_locate;
+	AdTypes whichAds = query_entry->whichAds;
+	bool filter_private_attrs = query_filters_private_attrs(whichAds, cad, sock);
+
+	// Perform the query, sending the results via cedar as they are found
+
+	QueryResultSender sender(sock, cad, whichAds, filter_private_attrs, query_entry->in_proc);
+	__numAds__ = 0;
+	__failed__ = 0;
+	__filter__ = NULL;
+	__resultLimit__ = INT_MAX;
+	if (whichAds != (AdTypes) -1) {
+		process_query_public (whichAds, cad, &sender);
+	}
+	if (sender.failed) {
+		return 0;
+	}
+
+	double end_query = condor_gettimestamp_double();
+	double end_write = 0.0;
+
+	int finished = sender.finish();
+	if (finished == 2) {
+		// The client is behind; finish the response when it catches up.
+		if (daemonCore->Register_Socket(sock, "Query Response",
+				(SocketHandler)&CollectorDaemon::finish_query_response,
+				"CollectorDaemon::finish_query_response", HANDLE_WRITE) < 0) {
+			dprintf (D_ALWAYS, "Failed to register socket to finish query response\n");
+			return 0;
+		}
+		return_status = KEEP_STREAM;
 	}
 
 	end_write = condor_gettimestamp_double();
 
 	dprintf (D_ALWAYS,
-			 "Query info: matched=%d; skipped=%d; query_time=%f; send_time=%f; type=%s; requirements={%s}; locate=%d; limit=%d; from=%s; peer=%s; projection={%s}; filter_private_attrs=%d\n",
+			 "Query info: matched=%d; skipped=%d; query_time=%f; send_time=%f; first_ad_time=%f; type=%s; requirements={%s}; locate=%d; limit=%d; from=%s; peer=%s; projection={%s}; filter_private_attrs=%d; backlog=%d\n",
 			 __numAds__,
 			 __failed__,
 			 end_query - begin,
 			 end_write - end_query,
+			 sender.first_sent ? sender.first_sent - begin : 0.0,
 			 AdTypeToString(whichAds),
 			 ExprTreeToString(__filter__),
 			 is_locate,
 			 (__resultLimit__ == INT_MAX) ? 0 : __resultLimit__,
 			 query_entry->subsys,
 			 sock->peer_description(),
-			 projection.c_str(),
-			 filter_private_attrs);
-END:
-	
-	// All done.  Deallocate memory allocated in this method.  Note that DaemonCore 
-	// will supposedly free() the query_entry struct itself and also delete sock.
+			 sender.projection.c_str(),
+			 filter_private_attrs,
+			 sender.backlog || finished == 2);
+
+	// All done.  Note that DaemonCore will supposedly free() the query_entry
+	// struct itself and also delete sock.
 
 	return return_status;
 }
 
+// Answer a query on a query thread.  This must not touch daemon core,
+// the collector tables or anything else that isn't thread safe; the
+// query was set up for it in receive_query_cedar().
+void CollectorDaemon::run_threaded_query(ThreadedQuery *query)
+{
+	Stream *sock = query->sock;
+	query->began = condor_gettimestamp_double();
+
+	// The query may have waited for a thread for some time, so drop it if
+	// it is stale, as QueryReaper() does.
+	if ( sock->deadline_expired() || static_cast<Sock *>(sock)->readReady() ) {
+		query->dropped = true;
+		return;
+	}
+
+	// Perform the query, sending the results via cedar as they are found
+	sock->timeout(QueryTimeout);
+	sock->encode();
+	int more = 1;
+
+	classad::References proj;
+	if ( ! query->projection_mad && query->cad->LookupString(ATTR_PROJECTION, query->projection)) {
+		StringTokenIterator list(query->projection);
+		const std::string * attr;
+		while ((attr = list.next_string())) { proj.insert(*attr); }
+	}
+
+	if ( query->snapshot && query->filter ) {
+		classad::Value result;
+		bool val;
+		for (auto & rec : query->snapshot->records) {
+			CollectorRecord *record = &rec;
+			ClassAd *cad = record->m_publicAd;
+			if ( ! query->adType.empty()) {
+				std::string type;
+				cad->LookupString( ATTR_MY_TYPE, type );
+				if ( strcasecmp( type.c_str(), query->adType.c_str() ) != 0 ) {
+					continue;
+				}
+			}
+			if ( ! EvalExprToBool( query->filter, cad, NULL, result ) ||
+				 ! result.IsBooleanValueEquiv(val) || ! val ) {
+				query->failed++;
+				continue;
+			}
+			query->numAds++;
+
+			ClassAd* ad_to_send = query->filter_private_attrs ? record->m_publicAd : record->m_pvtAd;
+
+			if (query->projection_mad) {
+				// The ads may be read by other threads, so the match ad gets a
+				// stand-in chained to the ad rather than the ad itself.
+				ClassAd target;
+				target.ChainToAd(record->m_publicAd);
+				query->projection_mad->ReplaceRightAd(&target);
+				proj.clear();
+				query->projection.clear();
+				if (query->cad->EvaluateAttrString(ATTR_PROJECTION, query->projection) && ! query->projection.empty()) {
+					StringTokenIterator list(query->projection);
+					const std::string * attr;
+					while ((attr = list.next_string())) { proj.insert(*attr); }
+				}
+				query->projection_mad->RemoveRightAd();
+				target.Unchain();
+			}
+
+			bool sent;
+			if (proj.empty()) {
+				SerializedClassAd &wire = query->filter_private_attrs ? record->m_ads->m_publicWire : record->m_ads->m_pvtWire;
+				sent = sock->code(more) && putClassAd(sock, wire);
+			} else {
+				sent = sock->code(more) && putClassAd(sock, *ad_to_send, 0, &proj);
+			}
+			if ( ! sent) {
+				dprintf (D_ALWAYS,
+						"Error sending query result to client -- aborting\n");
+				return;
+			}
+
+			if (sock->deadline_expired()) {
+				dprintf( D_ALWAYS,
+					"QueryThreads: max_worktime expired while sending query result to client -- aborting\n");
+				return;
+			}
+
+			if (query->numAds >= query->resultLimit) {
+				break;
+			}
+		}
+	}
+	query->end_query = condor_gettimestamp_double();
+
+	// end of query response ...
+	more = 0;
+	if (!sock->code(more))
+	{
+		dprintf (D_ALWAYS, "Error sending EndOfResponse (0) to client\n");
+	}
+
+	// flush the output
+	if (!sock->end_of_message())
+	{
+		dprintf (D_ALWAYS, "Error flushing CEDAR socket\n");
+	}
+
+	query->end_write = condor_gettimestamp_double();
+	query->status = TRUE;
+}
+
+// Called on the main thread after a query thread is done with a query,
+// which is then deleted.
+void CollectorDaemon::finish_threaded_query(ThreadedQuery *query)
+{
+	int active = 0, pending = 0, pending_high_prio = 0;
+	query_threads->getCounts(active, pending, pending_high_prio);
+	collectorStats.global.ActiveQueryThreads = active;
+	collectorStats.global.PendingQueries = pending;
+
+	if (query->dropped) {
+		dprintf( D_ALWAYS,
+			"QueryThreads: dropping stale query request because %s ( threads %d active %d pending %d )\n",
+			query->sock->deadline_expired() ? "max worktime expired" : "client gone",
+			query_threads->size(), active, pending );
+		collectorStats.global.DroppedQueries += 1;
+		return;
+	}
+
+	collectorStats.global.QueryThreadLatency += condor_gettimestamp_double() - query->arrived;
+	if (query->snapshot) {
+		collectorStats.global.QuerySnapshotAge += query->began - query->snapshot->taken;
+	}
+
+	if ( ! query->status) {
+		return;
+	}
+
+	dprintf (D_ALWAYS,
+			 "Query info: matched=%d; skipped=%d; query_time=%f; send_time=%f; wait_time=%f; type=%s; requirements={%s}; locate=%d; limit=%d; from=%s; peer=%s; projection={%s}; filter_private_attrs=%d\n",
+			 query->numAds,
+			 query->failed,
+			 query->end_query - query->began,
+			 query->end_write - query->end_query,
+			 query->began - query->arrived,
+			 AdTypeToString(query->whichAds),
+			 ExprTreeToString(query->filter),
+			 query->is_locate,
+			 (query->resultLimit == INT_MAX) ? 0 : query->resultLimit,
+			 query->subsys.c_str(),
+			 query->sock->peer_description(),
+			 query->projection.c_str(),
+			 query->filter_private_attrs);
+}
+
 AdTypes
 CollectorDaemon::receive_query_public( int command )
 {
@@ -1119,6 +1472,9 @@ int CollectorDaemon::receive_invalidation(int command,
     // collecting further information
     sock->timeout(0);
 
+	// the host's queued updates come before its invalidation
+	drain_threaded_updates(((Sock*)sock)->peer_addr());
+
     switch (command)
     {
 	  case INVALIDATE_STARTD_ADS:
@@ -1252,42 +1608,111 @@ int CollectorDaemon::receive_update(int command, Stream* sock)
 #ifdef PROFILE_RECEIVE_UPDATE
 	CollectorEngine_ru_pre_collect_runtime += rt.tick(rt_last);
 #endif
-    // process the given command
-	if (!(record = collector.collect (command,(Sock*)sock,from,insert)))
-	{
-		if (insert == -2)
-		{
-			// this should never happen assuming we never register QUERY
-			// commands with daemon core, but it cannot hurt to check...
-			dprintf (D_ALWAYS,"Got QUERY command (%d); not supported for UDP\n",
-						command);
+		// Checking the owner of a submittor ad needs the socket, so
+		// those are always collected here.
+	if (update_threads && command != UPDATE_OWN_SUBMITTOR_AD) {
+		if ( ! queue_threaded_update(command, (Sock*)sock, from)) {
+			return FALSE;
 		}
+	} else {
+		drain_threaded_updates(from);
 
-		if (insert == -3)
+		// process the given command
+		if (!(record = collector.collect (command,(Sock*)sock,from,insert)))
 		{
-			/* this happens when we get a classad for which a hash key could
-				not been made. This occurs when certain attributes are needed
-				for the particular catagory the ad is destined for, but they
-				are not present in the ad. */
-			dprintf (D_ALWAYS,
-				"Received malformed ad from command (%d). Ignoring.\n",
-				command);
+			report_failed_update(command, insert);
+			return FALSE;
 		}
+#ifdef PROFILE_RECEIVE_UPDATE
+		CollectorEngine_ru_collect_runtime += rt.tick(rt_last);
+#endif
 
-		if (insert == -4)
-		{
-			// Rejected by COLLECTOR_REQUIREMENTS in validateClassad(),
-			// which already does all the necessary logging.
-		}
+		finish_update(command, record);
+#ifdef PROFILE_RECEIVE_UPDATE
+		rt_last = _condor_debug_get_time_double();
+#endif
+	}
 
-		return FALSE;
+	if( sock->type() == Stream::reli_sock ) {
+			// stash this socket for future updates...
+		int rv = stashSocket( (ReliSock *)sock );
+#ifdef PROFILE_RECEIVE_UPDATE
+		CollectorEngine_ru_stash_socket_runtime += rt.tick(rt_last);
+#endif
+		return rv;
+	}
+
+	// let daemon core clean up the socket
+	return TRUE;
+}
 
+void CollectorDaemon::report_failed_update(int command, int insert)
+{
+	if (insert == -2)
+	{
+		// this should never happen assuming we never register QUERY
+		// commands with daemon core, but it cannot hurt to check...
+		dprintf (D_ALWAYS,"Got QUERY command (%d); not supported for UDP\n",
+					command);
+	}
+
+	if (insert == -3)
+	{
+		/* this happens when we get a classad for which a hash key could
+			not been made. This occurs when certain attributes are needed
+			for the particular catagory the ad is destined for, but they
+			are not present in the ad. */
+		dprintf (D_ALWAYS,
+			"Received malformed ad from command (%d). Ignoring.\n",
+			command);
+	}
+
+	if (insert == -4)
+	{
+		// Rejected by COLLECTOR_REQUIREMENTS in validateClassad(),
+		// which already does all the necessary logging.
+	}
+
+	if (insert == -5)
+	{
+		// A delta that doesn't apply to the ad we have.  The engine
+		// has asked the startd for the whole ad.
+	}
+}
+
+// Insert the authenticated user into an ad from a socket, as the engine
+// does for the ads it reads itself.
+static void
+setAuthenticatedIdentity(ClassAd &ad, const char *authn_user, const char *authn_method)
+{
+	if (authn_user) {
+		ad.Assign(ATTR_AUTHENTICATED_IDENTITY, authn_user);
+		ad.Assign(ATTR_AUTHENTICATION_METHOD, authn_method ? authn_method : "");
+	} else {
+		// remove it from the ad if it's not authenticated.
+		ad.Delete(ATTR_AUTHENTICATED_IDENTITY);
+		ad.Delete(ATTR_AUTHENTICATION_METHOD);
 	}
+}
+
+// What is done with an ad once the engine has it: the plugins see it,
+// and it is forwarded to the view collector.
+void CollectorDaemon::finish_update(int command, CollectorRecord *record)
+{
 #ifdef PROFILE_RECEIVE_UPDATE
-	CollectorEngine_ru_collect_runtime += rt.tick(rt_last);
+	_condor_runtime rt;
+	double rt_last = rt.begin;
 #endif
 
+		// Once applied, a delta leaves a whole ad, which is what
+		// everything from here on expects.
+	if (command == UPDATE_STARTD_AD_DELTA) {
+		command = UPDATE_STARTD_AD;
+	}
+
 	/* let the off-line plug-in have at it */
+	record->BeginUpdate();
+	collector.adsChanged();
 	offline_plugin_.update ( command, *record->m_publicAd );
 
 #if defined(UNIX) && !defined(DARWIN)
@@ -1308,18 +1733,230 @@ int CollectorDaemon::receive_update(int command, Stream* sock)
 #ifdef PROFILE_RECEIVE_UPDATE
 	CollectorEngine_ru_forward_runtime += rt.tick(rt_last);
 #endif
+}
 
-	if( sock->type() == Stream::reli_sock ) {
-			// stash this socket for future updates...
-		int rv = stashSocket( (ReliSock *)sock );
-#ifdef PROFILE_RECEIVE_UPDATE
-		CollectorEngine_ru_stash_socket_runtime += rt.tick(rt_last);
-#endif
-		return rv;
+// Read the ads of an update off the socket, and leave the parsing of them
+// to an update thread.  The reading stays here, since the socket and its
+// security session belong to the main thread.
+bool CollectorDaemon::queue_threaded_update(int command, Sock *sock, const condor_sockaddr &from)
+{
+		// Avoid lengthy blocking on communication with our peer.
+		// This command-handler should not get called until data
+		// is ready to read.
+	sock->timeout(1);
+
+	ThreadedUpdate *update = new ThreadedUpdate();
+	update->command = command;
+	update->from = from;
+
+	if ( ! getClassAdUnparsed(sock, update->public_text)) {
+		dprintf (D_ALWAYS,"Command %d on Sock not followed by ClassAd (or timeout occured)\n",
+				command);
+		delete update;
+		sock->end_of_message();
+		return false;
+	}
+	if (command == UPDATE_STARTD_AD || command == UPDATE_STARTD_AD_DELTA) {
+		update->has_private_ad = getClassAdUnparsed(sock, update->private_text);
+		if ( ! update->has_private_ad) {
+			dprintf(D_FULLDEBUG,"\t(Could not get startd's private ad)\n");
+		}
 	}
 
-	// let daemon core clean up the socket
-	return TRUE;
+	const char* authn_user = sock->getFullyQualifiedUser();
+	if (authn_user) {
+		update->authn_user = authn_user;
+		const char *method = sock->getAuthenticationMethodUsed();
+		update->authn_method = method ? method : "";
+	}
+
+	if (!sock->end_of_message())
+	{
+		dprintf(D_FULLDEBUG,"Warning: Command %d; maybe shedding data on eom\n",
+				 command);
+	}
+
+	update_threads->enqueue(update);
+	return true;
+}
+
+// The permission an update in a batch needs, which is the one its command
+// is registered with.  Returns false for a command that can't be batched.
+static bool
+batchUpdatePerm(int command, DCpermission &perm)
+{
+	switch (command) {
+	case UPDATE_STARTD_AD:
+	case UPDATE_STARTD_AD_DELTA:
+		perm = ADVERTISE_STARTD_PERM;
+		return true;
+	case UPDATE_SCHEDD_AD:
+	case UPDATE_SUBMITTOR_AD:
+		perm = ADVERTISE_SCHEDD_PERM;
+		return true;
+	case UPDATE_MASTER_AD:
+		perm = ADVERTISE_MASTER_PERM;
+		return true;
+	case UPDATE_LICENSE_AD:
+	case UPDATE_STORAGE_AD:
+	case UPDATE_HAD_AD:
+	case UPDATE_AD_GENERIC:
+	case UPDATE_GRID_AD:
+		perm = DAEMON;
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Several updates in one message.  Each is handled as receive_update()
+// would, and on TCP, the sender is told which of them were taken.
+int CollectorDaemon::receive_update_batch(int /*command*/, Stream* sock)
+{
+	_condor_auto_accum_runtime<collector_runtime_probe> rt(CollectorEngine_receive_update_runtime);
+
+	Sock *update_sock = (Sock*)sock;
+	condor_sockaddr from = update_sock->peer_addr();
+	const char* authn_user = update_sock->getFullyQualifiedUser();
+	const char* authn_method = update_sock->getAuthenticationMethodUsed();
+
+	int num_updates = 0;
+	sock->decode();
+	if ( ! sock->code(num_updates) || num_updates < 0) {
+		dprintf(D_ALWAYS, "UPDATE_AD_BATCH from %s: failed to get the number of updates\n",
+				update_sock->peer_description());
+		return FALSE;
+	}
+	if (num_updates > max_update_batch) {
+		dprintf(D_ALWAYS, "UPDATE_AD_BATCH from %s: rejecting %d updates, more than COLLECTOR_MAX_UPDATE_BATCH (%d)\n",
+				update_sock->peer_description(), num_updates, max_update_batch);
+		return FALSE;
+	}
+
+	drain_threaded_updates(from);
+
+	std::vector<int> results(num_updates, 0);
+	for (int ix = 0; ix < num_updates; ix++) {
+		int command = 0;
+		int num_ads = 0;
+		if ( ! sock->code(command) || ! sock->code(num_ads) || num_ads < 1 || num_ads > 2) {
+			dprintf(D_ALWAYS, "UPDATE_AD_BATCH from %s: failed to get update %d of %d\n",
+					update_sock->peer_description(), ix, num_updates);
+			return FALSE;
+		}
+
+			// Read the ads even if we won't keep them, to get to the next
+		ClassAd *ad = new ClassAd;
+		ClassAd *pvt_ad = (num_ads > 1) ? new ClassAd : NULL;
+		if ( ! getClassAdEx(sock, *ad, collector.m_get_ad_options) ||
+			 (pvt_ad && ! getClassAdEx(sock, *pvt_ad, collector.m_get_ad_options))) {
+			dprintf(D_ALWAYS, "UPDATE_AD_BATCH from %s: command %d not followed by ClassAd\n",
+					update_sock->peer_description(), command);
+			delete ad;
+			delete pvt_ad;
+			return FALSE;
+		}
+
+		daemonCore->dc_stats.AddToAnyProbe("UpdatesReceived", 1);
+
+		DCpermission perm = ALLOW;
+		if ( ! batchUpdatePerm(command, perm)) {
+			dprintf(D_ALWAYS, "UPDATE_AD_BATCH from %s: command %d can't be batched, ignoring it\n",
+					update_sock->peer_description(), command);
+			delete ad;
+			delete pvt_ad;
+			continue;
+		}
+		if (daemonCore->Verify(getCollectorCommandString(command), perm, *update_sock, D_SECURITY|D_FULLDEBUG) != USER_AUTH_SUCCESS) {
+			dprintf(D_ALWAYS, "UPDATE_AD_BATCH from %s: %s not allowed, ignoring it\n",
+					update_sock->peer_description(), getCollectorCommandString(command));
+			delete ad;
+			delete pvt_ad;
+			continue;
+		}
+
+		setAuthenticatedIdentity(*ad, authn_user, authn_method);
+
+		int insert = -3;
+		CollectorRecord *record = collector.collect(command, ad, from, insert, NULL, pvt_ad);
+		if ( ! record) {
+			report_failed_update(command, insert);
+			delete ad;
+			continue;
+		}
+		finish_update(command, record);
+		results[ix] = 1;
+	}
+
+	if ( ! sock->end_of_message()) {
+		dprintf(D_FULLDEBUG, "Warning: UPDATE_AD_BATCH; maybe shedding data on eom\n");
+	}
+
+	if (sock->type() != Stream::reli_sock) {
+		return TRUE;
+	}
+
+	sock->encode();
+	bool sent = sock->code(num_updates);
+	for (int ix = 0; sent && ix < num_updates; ix++) {
+		sent = sock->code(results[ix]);
+	}
+	if ( ! sent || ! sock->end_of_message()) {
+		dprintf(D_ALWAYS, "UPDATE_AD_BATCH: failed to send results to %s\n",
+				update_sock->peer_description());
+		return FALSE;
+	}
+
+		// stash this socket for future updates...
+	return stashSocket( (ReliSock *)sock );
+}
+
+// Apply the updates from this host still being parsed on update threads,
+// before handling one of its commands on the main thread.
+void CollectorDaemon::drain_threaded_updates(const condor_sockaddr &from)
+{
+	if (update_threads) {
+		update_threads->drain(from);
+	}
+}
+
+// Called on the main thread after an update thread has parsed the ads
+// of an update, which is then deleted.
+void CollectorDaemon::finish_threaded_update(ThreadedUpdate *update)
+{
+	int command = update->command;
+	if ( ! update->parsed) {
+		dprintf (D_ALWAYS,"Command %d on Sock not followed by ClassAd (or timeout occured)\n",
+				command);
+		return;
+	}
+
+	if ( ! (collector.m_get_ad_options & GET_CLASSAD_NO_CACHE)) {
+		update->public_text.cache(*update->ad);
+		if (update->pvt_ad) {
+			update->private_text.cache(*update->pvt_ad);
+		}
+	}
+
+	ClassAd *clientAd = update->ad;
+	setAuthenticatedIdentity(*clientAd,
+		update->authn_user.empty() ? NULL : update->authn_user.c_str(),
+		update->authn_method.c_str());
+
+		// the engine takes the private ad either way
+	ClassAd *pvt_ad = update->pvt_ad;
+	update->pvt_ad = NULL;
+
+	int insert = -3;
+	CollectorRecord *record = collector.collect(command, clientAd, update->from, insert, NULL, pvt_ad);
+	if ( ! record) {
+		report_failed_update(command, insert);
+		return;
+	}
+		// the engine has the ad now
+	update->ad = NULL;
+
+	finish_update(command, record);
 }
 
 int CollectorDaemon::receive_update_expect_ack(int command,
@@ -1359,6 +1996,8 @@ int CollectorDaemon::receive_update_expect_ack(int command,
     /* get peer's IP/port */
 	condor_sockaddr from = socket->peer_addr();
 
+	drain_threaded_updates(from);
+
     /* "collect" the ad */
     CollectorRecord *record = collector.collect ( 
         command,
@@ -1428,6 +2067,8 @@ int CollectorDaemon::receive_update_expect_ack(int command,
     }
 
 	if(record) {
+		record->BeginUpdate();
+		collector.adsChanged();
 		offline_plugin_.update ( command, *record->m_publicAd );
 
 #if defined(UNIX) && !defined(DARWIN)
@@ -1500,8 +2141,9 @@ int CollectorDaemon::query_scanFunc (CollectorRecord *record)
 		 result.IsBooleanValueEquiv(val) && val ) {
 		// Found a match 
         __numAds__++;
-		__ClassAdResultList__->Append(record);
-		if (__numAds__ >= __resultLimit__) {
+		if ( ! __resultSender__->send(record)) {
+			rc = 0; // the client is gone, stop iterating
+		} else if (__numAds__ >= __resultLimit__) {
 			rc = 0; // tell it to stop iterating, we have all the results we want
 		}
     } else {
@@ -1512,35 +2154,33 @@ int CollectorDaemon::query_scanFunc (CollectorRecord *record)
 }
 
 
-void CollectorDaemon::process_query_public (AdTypes whichAds,
+// Get the filter of a query and the MyType and number of ads it wants.
+// Returns NULL if no ad can match.
+ExprTree * CollectorDaemon::prepare_query (AdTypes whichAds,
 											ClassAd *query,
-											List<CollectorRecord>* results)
+											std::string &adType,
+											int &resultLimit)
 {
-	// set up for hashtable scan
-	__query__ = query;
-	__numAds__ = 0;
-	__failed__ = 0;
-	__ClassAdResultList__ = results;
 	// An empty adType means don't check the MyType of the ads.
 	// This means either the command indicates we're only checking one
 	// type of ad, or the query's TargetType is "Any" (match all ad types).
-	__adType__ = "";
+	adType = "";
 	if ( whichAds == GENERIC_AD || whichAds == ANY_AD ) {
-		query->LookupString( ATTR_TARGET_TYPE, __adType__ );
-		if ( strcasecmp( __adType__.c_str(), "any" ) == 0 ) {
-			__adType__ = "";
+		query->LookupString( ATTR_TARGET_TYPE, adType );
+		if ( strcasecmp( adType.c_str(), "any" ) == 0 ) {
+			adType = "";
 		}
 	}
 
-	__filter__ = query->LookupExpr( ATTR_REQUIREMENTS );
-	if ( __filter__ == NULL ) {
+	ExprTree *filter = query->LookupExpr( ATTR_REQUIREMENTS );
+	if ( filter == NULL ) {
 		dprintf (D_ALWAYS, "Query missing %s\n", ATTR_REQUIREMENTS );
-		return;
+		return NULL;
 	}
 
-	__resultLimit__ = INT_MAX; // no limit
-	if ( ! query->LookupInteger(ATTR_LIMIT_RESULTS, __resultLimit__) || __resultLimit__ <= 0) {
-		__resultLimit__ = INT_MAX; // no limit
+	resultLimit = INT_MAX; // no limit
+	if ( ! query->LookupInteger(ATTR_LIMIT_RESULTS, resultLimit) || resultLimit <= 0) {
+		resultLimit = INT_MAX; // no limit
 	}
 
 	// If ABSENT_REQUIREMENTS is defined, rewrite filter to filter-out absent ads 
@@ -1554,24 +2194,51 @@ void CollectorDaemon::process_query_public (AdTypes whichAds,
 		if (!checks_absent) {
 			std::string modified_filter;
 			formatstr(modified_filter, "(%s) && (%s =!= True)",
-				ExprTreeToString(__filter__),ATTR_ABSENT);
+				ExprTreeToString(filter),ATTR_ABSENT);
 			query->AssignExpr(ATTR_REQUIREMENTS,modified_filter.c_str());
-			__filter__ = query->LookupExpr(ATTR_REQUIREMENTS);
-			if ( __filter__ == NULL ) {
+			filter = query->LookupExpr(ATTR_REQUIREMENTS);
+			if ( filter == NULL ) {
 				dprintf (D_ALWAYS, "Failed to parse modified filter: %s\n", 
 					modified_filter.c_str());
-				return;
+				return NULL;
 			}
 			dprintf(D_FULLDEBUG,"Query after modification: *%s*\n",modified_filter.c_str());
 		}
 	}
 
-	if (!collector.walkHashTable (whichAds, query_scanFunc))
+	return filter;
+}
+
+void CollectorDaemon::process_query_public (AdTypes whichAds,
+											ClassAd *query,
+											QueryResultSender* sender)
+{
+	// set up for hashtable scan
+	__query__ = query;
+	__numAds__ = 0;
+	__failed__ = 0;
+	__resultSender__ = sender;
+	__filter__ = prepare_query( whichAds, query, __adType__, __resultLimit__ );
+	if ( __filter__ == NULL ) {
+		return;
+	}
+
+	std::vector<CollectorRecord *> candidates;
+	if (collector.getCandidates (whichAds, __filter__, candidates))
+	{
+		for (auto *record : candidates) {
+			if ( ! query_scanFunc (record)) {
+				break;
+			}
+		}
+	}
+	else if (!collector.walkHashTable (whichAds, query_scanFunc))
 	{
 		dprintf (D_ALWAYS, "Error sending query response\n");
 	}
 
-	dprintf (D_ALWAYS, "(Sending %d ads in response to query)\n", __numAds__);
+	__resultSender__ = NULL;
+	dprintf (D_ALWAYS, "(Sent %d ads in response to query)\n", __numAds__);
 }
 
 //
@@ -1583,16 +2250,18 @@ void CollectorDaemon::process_query_public (AdTypes whichAds,
 //
 int CollectorDaemon::expiration_scanFunc (CollectorRecord *record)
 {
-    return setAttrLastHeardFrom( record->m_publicAd, 1 );
+    return setAttrLastHeardFrom( record, 1 );
 }
 
 int CollectorDaemon::invalidation_scanFunc (CollectorRecord *record)
 {
-    return setAttrLastHeardFrom( record->m_publicAd, 0 );
+    return setAttrLastHeardFrom( record, 0 );
 }
 
-int CollectorDaemon::setAttrLastHeardFrom (ClassAd* cad, unsigned long time)
+int CollectorDaemon::setAttrLastHeardFrom (CollectorRecord* record, unsigned long time)
 {
+	ClassAd* cad = record->m_publicAd;
+
 	if ( !__adType__.empty() ) {
 		std::string type = "";
 		cad->LookupString( ATTR_MY_TYPE, type );
@@ -1606,7 +2275,9 @@ int CollectorDaemon::setAttrLastHeardFrom (ClassAd* cad, unsigned long time)
 	if ( EvalExprToBool( __filter__, cad, NULL, result ) &&
 		 result.IsBooleanValueEquiv(val) && val ) {
 
-		cad->Assign( ATTR_LAST_HEARD_FROM, time );
+		record->BeginUpdate();
+		collector.adsChanged();
+		record->m_publicAd->Assign( ATTR_LAST_HEARD_FROM, time );
         __numAds__++;
     }
 
@@ -1838,6 +2509,14 @@ void CollectorDaemon::Config()
 	if (opts.empty()) { opts = "none "; }
 	dprintf(D_ALWAYS, "COLLECTOR_GETAD_OPTIONS set to %s(0x%x)\n", opts.c_str(), collector.m_get_ad_options);
 
+	std::string indexes;
+	param(indexes, "COLLECTOR_INDEXES");
+	collector.setIndexes(indexes.c_str());
+
+	std::string state_file;
+	param(state_file, "COLLECTOR_STATE_FILE");
+	collector.setStateFile(state_file.c_str(), param_integer("COLLECTOR_STATE_INTERVAL", 300, 0));
+
 	tmp = param(COLLECTOR_REQUIREMENTS);
 	std::string collector_req_err;
 	if( !collector.setCollectorRequirements( tmp, collector_req_err ) ) {
@@ -1958,6 +2637,41 @@ void CollectorDaemon::Config()
 				reserved_for_highprio_query_workers);
 	}
 
+	// Query threads answer queries from snapshots of the ads instead of
+	// forking query workers.  The same number of threads is reserved for
+	// high priority queries as for workers.
+	max_query_threads = param_integer("COLLECTOR_QUERY_THREADS", 0, 0);
+	int reserved_threads = MAX(0, MIN(param_integer("COLLECTOR_QUERY_WORKERS_RESERVE_FOR_HIGH_PRIO",1,0), max_query_threads - 1));
+	if ( query_threads &&
+		 (query_threads->size() != max_query_threads || query_threads->reserved() != reserved_threads) ) {
+		delete query_threads;
+		query_threads = NULL;
+	}
+	if ( ! query_threads && max_query_threads > 0 ) {
+		query_threads = new QueryThreadPool(run_threaded_query, finish_threaded_query);
+		if ( ! query_threads->start(max_query_threads, reserved_threads) ) {
+			delete query_threads;
+			query_threads = NULL;
+		}
+	}
+
+	// Update threads parse the ads in updates, which the main thread
+	// then hands to the engine.
+	max_update_threads = param_integer("COLLECTOR_UPDATE_THREADS", 0, 0);
+	max_update_batch = param_integer("COLLECTOR_MAX_UPDATE_BATCH", 10000, 1);
+	if ( update_threads && update_threads->size() != max_update_threads ) {
+		update_threads->drainAll();
+		delete update_threads;
+		update_threads = NULL;
+	}
+	if ( ! update_threads && max_update_threads > 0 ) {
+		update_threads = new UpdateThreadPool(finish_threaded_update);
+		if ( ! update_threads->start(max_update_threads) ) {
+			delete update_threads;
+			update_threads = NULL;
+		}
+	}
+
 #ifdef TRACK_QUERIES_BY_SUBSYS
 	want_track_queries_by_subsys = param_boolean("COLLECTOR_TRACK_QUERY_BY_SUBSYS",true);
 #endif
@@ -2006,6 +2720,10 @@ void CollectorDaemon::Exit()
 		daemonCore->Cancel_Timer(UpdateTimerId);
 		UpdateTimerId = -1;
 	}
+	delete query_threads;
+	query_threads = NULL;
+	delete update_threads;
+	update_threads = NULL;
 	free( CollectorName );
 	delete ad;
 	delete collectorsToUpdate;
@@ -2015,6 +2733,14 @@ void CollectorDaemon::Exit()
 
 void CollectorDaemon::Shutdown()
 {
+	// Apply the updates still being parsed, then save the ads for the
+	// next collector to start with
+	if (update_threads) {
+		update_threads->drainAll();
+	}
+	collector.writeState();
+
+
 	// Clean up any workers that have exited but haven't been reaped yet.
 	// This can occur if the collector receives a query followed
 	// immediately by a shutdown command.  The worker will exit but
@@ -2028,6 +2754,10 @@ void CollectorDaemon::Shutdown()
 		daemonCore->Cancel_Timer(UpdateTimerId);
 		UpdateTimerId = -1;
 	}
+	delete query_threads;
+	query_threads = NULL;
+	delete update_threads;
+	update_threads = NULL;
 	free( CollectorName );
 	delete ad;
 	delete collectorsToUpdate;
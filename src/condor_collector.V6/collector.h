@@ -33,6 +33,11 @@
 #include "offline_plugin.h"
 #include "ad_transforms.h"
 
+class QueryThreadPool;
+class UpdateThreadPool;
+struct ThreadedUpdate;
+struct ThreadedQuery;
+
 //----------------------------------------------------------------
 // Simple job universe stats
 //----------------------------------------------------------------
@@ -103,8 +108,22 @@ public:
 	static int receive_invalidation(int, Stream*);
 	static int receive_update(int, Stream*);
     static int receive_update_expect_ack(int, Stream*);
-
-	static void process_query_public(AdTypes, ClassAd*, List<CollectorRecord>*);
+	static int receive_update_batch(int, Stream*);
+	static void report_failed_update(int command, int insert);
+	static void finish_update(int command, CollectorRecord *record);
+	static bool queue_threaded_update(int command, Sock *sock, const condor_sockaddr &from);
+	static void finish_threaded_update(ThreadedUpdate *update);
+	static void drain_threaded_updates(const condor_sockaddr &from);
+
+	// sends the ads that match a query as they are found
+	struct QueryResultSender;
+
+	static void process_query_public(AdTypes, ClassAd*, QueryResultSender*);
+	static int finish_query_response(Stream*);
+	static ExprTree * prepare_query(AdTypes, ClassAd*, std::string &adType, int &resultLimit);
+	static bool query_filters_private_attrs(AdTypes, ClassAd*, Stream*);
+	static void run_threaded_query(ThreadedQuery*);
+	static void finish_threaded_query(ThreadedQuery*);
 	static ClassAd * process_global_query( const char *constraint, void *arg );
 	static int select_by_match( ClassAd *cad );
 	static void process_invalidation(AdTypes, ClassAd&, Stream*);
@@ -153,6 +172,7 @@ public:
 		Stream *sock;
 		AdTypes whichAds;
 		bool is_locate;
+		bool in_proc;
 		char subsys[15];
 	} pending_query_entry_t;
 
@@ -166,6 +186,11 @@ public:
 	static int reserved_for_highprio_query_workers; // from config file
 	static int active_query_workers;
 	static int pending_query_workers;
+	static int max_query_threads;  // from config file
+	static QueryThreadPool *query_threads;
+	static int max_update_threads;  // from config file
+	static UpdateThreadPool *update_threads;
+	static int max_update_batch;  // from config file
 
 #ifdef TRACK_QUERIES_BY_SUBSYS
 	static bool want_track_queries_by_subsys;
@@ -185,7 +210,7 @@ protected:
 	static char* CollectorName;
 
 	static ClassAd* __query__;
-	static List<CollectorRecord>* __ClassAdResultList__;
+	static QueryResultSender* __resultSender__;
 	static int __numAds__;
 	static int __resultLimit__;
 	static int __failed__;
@@ -217,7 +242,7 @@ protected:
 
 private:
 
-	static int setAttrLastHeardFrom( ClassAd* cad, unsigned long time );
+	static int setAttrLastHeardFrom( CollectorRecord* record, unsigned long time );
 
 	static AdTransforms m_forward_ad_xfm;
 };
@@ -28,6 +28,8 @@
 #include "condor_attributes.h"
 #include "condor_daemon_core.h"
 #include "classad_merge.h"
+#include "dc_message.h"
+#include "util_lib_proto.h"
 
 //-------------------------------------------------------------
 
@@ -37,6 +39,7 @@
 static void killHashTable (CollectorHashTable &);
 static int killGenericHashTable(CollectorHashTable *);
 static void purgeHashTable (CollectorHashTable &);
+void movePrivateAttrs(ClassAd& dest, ClassAd& src);
 
 int 	engine_clientTimeoutHandler (Service *);
 int 	engine_housekeepingHandler  (Service *);
@@ -63,6 +66,8 @@ CollectorEngine::CollectorEngine (CollectorStats *stats ) :
 	m_forwardInterval = machineUpdateInterval / 3;
 	m_forwardFilteringEnabled = false;
 	housekeeperTimerID = -1;
+	m_state_interval = 0;
+	m_state_timer = -1;
 
 	m_allowOnlyOneNegotiator = param_boolean("COLLECTOR_ALLOW_ONLY_ONE_NEGOTIATOR", false);
 
@@ -75,6 +80,7 @@ CollectorEngine::CollectorEngine (CollectorStats *stats ) :
 CollectorEngine::
 ~CollectorEngine ()
 {
+	m_indexes.clear();
 	killHashTable (StartdAds);
 	killHashTable (StartdPrivateAds);
 	killHashTable (ScheddAds);
@@ -185,6 +191,8 @@ invokeHousekeeper (AdTypes adType)
 		return 0;
 	}
 
+	adsChanged();
+
 	CollectorHashTable *table=0;
 	CollectorEngine::HashFunc func;
 	if (LookupByAdType(adType, table, func)) {
@@ -231,6 +239,7 @@ CollectorEngine::invalidateAds(AdTypes adType, ClassAd &query)
 				dprintf(D_ALWAYS,
 						"\t\t**** Invalidating ad: \"%s\"\n",
 						hkString.c_str());
+				adsChanged();
 				delete record;
 				count++;
 			}
@@ -307,6 +316,127 @@ walkHashTable (AdTypes adType, int (*scanFunction)(CollectorRecord *))
 }
 
 
+// the snapshot being filled in by getSnapshot()
+static std::vector<CollectorRecord> *snapshotRecords = NULL;
+
+static int
+snapshotScanFunc(CollectorRecord *record)
+{
+	snapshotRecords->push_back(*record);
+	return 1;
+}
+
+std::shared_ptr<CollectorSnapshot> CollectorEngine::
+getSnapshot (AdTypes adType, classad::ExprTree *filter)
+{
+	std::vector<CollectorRecord *> candidates;
+	if (filter && getCandidates(adType, filter, candidates)) {
+		auto snapshot = std::make_shared<CollectorSnapshot>();
+		snapshot->taken = condor_gettimestamp_double();
+		snapshot->records.reserve(candidates.size());
+		for (auto *record : candidates) {
+			snapshot->records.push_back(*record);
+		}
+		return snapshot;
+	}
+
+	auto it = m_snapshots.find(adType);
+	if (it != m_snapshots.end()) {
+		return it->second;
+	}
+
+	auto snapshot = std::make_shared<CollectorSnapshot>();
+	snapshot->taken = condor_gettimestamp_double();
+	snapshotRecords = &snapshot->records;
+	int rval = walkHashTable(adType, snapshotScanFunc);
+	snapshotRecords = NULL;
+	if ( ! rval) {
+		return NULL;
+	}
+
+	m_snapshots[adType] = snapshot;
+	return snapshot;
+}
+
+bool CollectorEngine::
+getCandidates (AdTypes adType, classad::ExprTree *filter, std::vector<CollectorRecord *> &records)
+{
+	if (m_indexes.empty()) {
+		return false;
+	}
+	CollectorHashTable *table;
+	CollectorEngine::HashFunc func;
+	if ( ! LookupByAdType(adType, table, func)) {
+		return false;
+	}
+	auto it = m_indexes.find(table);
+	if (it == m_indexes.end()) {
+		return false;
+	}
+	if ( ! it->second->candidates(filter, records)) {
+		return false;
+	}
+	dprintf(D_FULLDEBUG, "Index narrowed query of %d %s ads to %d\n",
+		table->getNumElements(), AdTypeToString(adType), (int)records.size());
+	return true;
+}
+
+void CollectorEngine::
+setIndexes (const char *str)
+{
+	std::string config = str ? str : "";
+	if (config == m_index_config) {
+		return;
+	}
+	m_index_config = config;
+	m_indexes.clear();
+
+	std::map<CollectorHashTable *, std::vector<std::string> > attrs;
+	for (const auto& item : StringTokenIterator(config)) {
+		size_t dot = item.find('.');
+		AdTypes adType = NO_AD;
+		if (dot != std::string::npos && dot + 1 < item.size()) {
+			adType = AdTypeFromString(item.substr(0, dot).c_str());
+		}
+		CollectorHashTable *table;
+		CollectorEngine::HashFunc func;
+		if (adType == NO_AD || ! LookupByAdType(adType, table, func)) {
+			dprintf(D_ALWAYS, "Ignoring %s in COLLECTOR_INDEXES, which isn't <MyType>.<attribute> for a known ad type\n",
+				item.c_str());
+			continue;
+		}
+		attrs[table].push_back(item.substr(dot + 1));
+	}
+
+	for (auto & it : attrs) {
+		CollectorIndex *index = new CollectorIndex(it.second);
+		m_indexes[it.first].reset(index);
+
+		CollectorRecord *record;
+		it.first->startIterations();
+		while (it.first->iterate(record)) {
+			index->add(record);
+		}
+		dprintf(D_ALWAYS, "Indexing %d attribute(s) of %d ads\n",
+			(int)it.second.size(), it.first->getNumElements());
+	}
+}
+
+void CollectorRecord::
+BeginUpdate()
+{
+	if (m_ads.use_count() > 1) {
+		ReplaceAds(new ClassAd(*m_publicAd), new ClassAd(*m_pvtAd));
+	} else {
+		m_ads->m_publicWire.clear();
+		m_ads->m_pvtWire.clear();
+		if (m_index) {
+			m_index->changed(this);
+		}
+	}
+}
+
+
 CollectorHashTable *CollectorEngine::findOrCreateTable(const std::string &type)
 {
 	CollectorHashTable *table=0;
@@ -323,6 +453,188 @@ CollectorHashTable *CollectorEngine::findOrCreateTable(const std::string &type)
 	return table;
 }
 
+// The tables saved in the state file, other than the generic ones
+static const AdTypes stateAdTypes[] = {
+	STARTD_AD, STARTD_PVT_AD, SCHEDD_AD, SUBMITTOR_AD, LICENSE_AD, MASTER_AD,
+	STORAGE_AD, ACCOUNTING_AD, CKPT_SRVR_AD, COLLECTOR_AD, NEGOTIATOR_AD,
+	HAD_AD, GRID_AD,
+};
+
+// Each ad in the state file says which table it is from
+static const char * const STATE_TABLE_ATTR = "CollectorStateTable";
+
+static bool
+writeStateTable(FILE *fp, CollectorHashTable &table, const char *table_name)
+{
+	CollectorRecord *record;
+	table.startIterations();
+	while (table.iterate(record)) {
+			// the private ad is chained to the public one, so this is both
+		if ( ! fPrintAd(fp, *record->m_pvtAd, false) ||
+			 fprintf(fp, "%s = \"%s\"\n\n", STATE_TABLE_ATTR, table_name) < 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void CollectorEngine::
+setStateFile (const char *filename, int interval)
+{
+	m_state_file = filename ? filename : "";
+	if (m_state_timer != -1 && (m_state_file.empty() || interval != m_state_interval)) {
+		daemonCore->Cancel_Timer(m_state_timer);
+		m_state_timer = -1;
+	}
+	m_state_interval = interval;
+	if (m_state_timer == -1 && ! m_state_file.empty() && interval > 0) {
+		m_state_timer = daemonCore->Register_Timer(interval, interval,
+						(TimerHandlercpp)&CollectorEngine::writeState,
+						"CollectorEngine::writeState", this);
+	}
+}
+
+void CollectorEngine::
+writeState ()
+{
+	if (m_state_file.empty()) {
+		return;
+	}
+
+	double begin = condor_gettimestamp_double();
+	std::string tmp_file = m_state_file + ".tmp";
+		// the private ads have claim ids in them
+	int fd = safe_open_wrapper_follow(tmp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	FILE *fp = fd < 0 ? NULL : fdopen(fd, "w");
+	if ( ! fp) {
+		dprintf(D_ALWAYS, "Failed to open collector state file %s: %s\n",
+			tmp_file.c_str(), strerror(errno));
+		if (fd >= 0) { close(fd); }
+		return;
+	}
+
+	bool ok = true;
+	int num_ads = 0;
+	for (AdTypes adType : stateAdTypes) {
+		CollectorHashTable *table;
+		HashFunc func;
+		if ( ! LookupByAdType(adType, table, func)) {
+			continue;
+		}
+		ok = ok && writeStateTable(fp, *table, AdTypeToString(adType));
+		num_ads += table->getNumElements();
+	}
+	CollectorHashTable *cht;
+	GenericAds.startIterations();
+	while (GenericAds.iterate(cht)) {
+		ok = ok && writeStateTable(fp, *cht, AdTypeToString(GENERIC_AD));
+		num_ads += cht->getNumElements();
+	}
+
+	if (fclose(fp) != 0) {
+		ok = false;
+	}
+	if ( ! ok) {
+		dprintf(D_ALWAYS, "Failed to write collector state file %s: %s\n",
+			tmp_file.c_str(), strerror(errno));
+		unlink(tmp_file.c_str());
+		return;
+	}
+	if (rotate_file(tmp_file.c_str(), m_state_file.c_str()) < 0) {
+		dprintf(D_ALWAYS, "Failed to rename %s to %s\n", tmp_file.c_str(), m_state_file.c_str());
+		unlink(tmp_file.c_str());
+		return;
+	}
+	dprintf(D_FULLDEBUG, "Wrote %d ads to collector state file %s in %.3f seconds\n",
+		num_ads, m_state_file.c_str(), condor_gettimestamp_double() - begin);
+}
+
+int CollectorEngine::
+loadState ()
+{
+	if (m_state_file.empty()) {
+		return 0;
+	}
+	FILE *fp = safe_fopen_wrapper_follow(m_state_file.c_str(), "r");
+	if ( ! fp) {
+		if (errno != ENOENT) {
+			dprintf(D_ALWAYS, "Failed to open collector state file %s: %s\n",
+				m_state_file.c_str(), strerror(errno));
+		}
+		return 0;
+	}
+	CondorClassAdFileIterator adIter;
+	if ( ! adIter.begin(fp, true, CondorClassAdFileParseHelper::Parse_long)) {
+		dprintf(D_ALWAYS, "Failed to read collector state file %s\n", m_state_file.c_str());
+		return 0;
+	}
+
+	time_t now = time(NULL);
+	int num_loaded = 0, num_expired = 0;
+	ClassAd *ad;
+	while ((ad = adIter.next(NULL))) {
+		std::string table_name;
+		ad->LookupString(STATE_TABLE_ATTR, table_name);
+		ad->Delete(STATE_TABLE_ATTR);
+
+		CollectorHashTable *table = NULL;
+		HashFunc func = NULL;
+		AdTypes adType = AdTypeFromString(table_name.c_str());
+		if (adType == GENERIC_AD) {
+			const char *type_str = GetMyTypeName(*ad);
+			if (type_str) {
+				table = findOrCreateTable(type_str);
+				func = makeGenericAdHashKey;
+			}
+		} else if (adType == ANY_AD || adType == NO_AD || ! LookupByAdType(adType, table, func)) {
+			table = NULL;
+		}
+
+			// skip the ads the housekeeper would remove
+		int last_heard = 0;
+		int max_lifetime;
+		if ( ! ad->LookupInteger(ATTR_LAST_HEARD_FROM, last_heard)) {
+			last_heard = 0;
+		}
+		if ( ! ad->LookupInteger(ATTR_CLASSAD_LIFETIME, max_lifetime)) {
+			max_lifetime = machineUpdateInterval;
+		}
+		if (last_heard == 0 || difftime(now, last_heard) > (double)max_lifetime) {
+			num_expired++;
+			delete ad;
+			continue;
+		}
+
+		AdNameHashKey hk;
+		CollectorRecord *record = NULL;
+		if ( ! table || ! func(hk, ad) || table->lookup(hk, record) == 0) {
+				// we can't use it, or already have a newer copy
+			delete ad;
+			continue;
+		}
+
+		ad->Assign(ATTR_RESTORED_AD, true);
+		ClassAd *pvt_ad = new ClassAd();
+		movePrivateAttrs(*pvt_ad, *ad);
+		record = new CollectorRecord(ad, pvt_ad);
+		if (table->insert(hk, record) == -1) {
+			EXCEPT("Error inserting ad (out of memory)");
+		}
+		if ( ! m_indexes.empty()) {
+			auto it = m_indexes.find(table);
+			if (it != m_indexes.end()) {
+				it->second->add(record);
+			}
+		}
+		num_loaded++;
+	}
+	adsChanged();
+
+	dprintf(D_ALWAYS, "Restored %d ads from collector state file %s (%d had expired)\n",
+		num_loaded, m_state_file.c_str(), num_expired);
+	return num_loaded;
+}
+
 #ifdef PROFILE_RECEIVE_UPDATE
 collector_runtime_probe CollectorEngine_ruc_runtime;
 collector_runtime_probe CollectorEngine_ruc_getAd_runtime;
@@ -427,6 +739,7 @@ bool CollectorEngine::ValidateClassAd(int command,ClassAd *clientAd,Sock *sock)
 	  case MERGE_STARTD_AD:
 	  case UPDATE_STARTD_AD:
 	  case UPDATE_STARTD_AD_WITH_ACK:
+	  case UPDATE_STARTD_AD_DELTA:
 		  ipattr = ATTR_STARTD_IP_ADDR;
 		  break;
 	  case UPDATE_OWN_SUBMITTOR_AD:
@@ -483,7 +796,7 @@ bool CollectorEngine::ValidateClassAd(int command,ClassAd *clientAd,Sock *sock)
 	}
 		// Verify the owner matches the value in the specified attribute.
 	if (check_owner) {
-		const char *sock_owner = sock->getOwner();
+		const char *sock_owner = sock ? sock->getOwner() : NULL;
 		if (!sock_owner || !*sock_owner || !strcmp(sock_owner, "unmapped")) {
 			return false;
 		}
@@ -533,10 +846,11 @@ bool CollectorEngine::ValidateClassAd(int command,ClassAd *clientAd,Sock *sock)
 bool   last_updateClassAd_was_insert;
 
 CollectorRecord *CollectorEngine::
-collect (int command,ClassAd *clientAd,const condor_sockaddr& from,int &insert,Sock *sock)
+collect (int command,ClassAd *clientAd,const condor_sockaddr& from,int &insert,Sock *sock,ClassAd *pvt_ad)
 {
 	CollectorRecord* retVal;
 	ClassAd		*pvtAd;
+	std::unique_ptr<ClassAd> given_pvt_ad(pvt_ad);
 	int		insPvt;
 	AdNameHashKey		hk;
 	std::string hashString;
@@ -551,7 +865,9 @@ collect (int command,ClassAd *clientAd,const condor_sockaddr& from,int &insert,S
 		repeatStartdAds = param_integer("COLLECTOR_REPEAT_STARTD_ADS",0);
 	}
 
-	if( !ValidateClassAd(command,clientAd,sock) ) {
+		// a delta is checked along with the ad it applies to, in
+		// applyStartdAdDelta()
+	if( command != UPDATE_STARTD_AD_DELTA && !ValidateClassAd(command,clientAd,sock) ) {
 	    insert = -4;
 		return NULL;
 	}
@@ -565,7 +881,8 @@ collect (int command,ClassAd *clientAd,const condor_sockaddr& from,int &insert,S
 	{
 	  case UPDATE_STARTD_AD:
 	  case UPDATE_STARTD_AD_WITH_ACK:
-		if ( repeatStartdAds > 0 ) {
+	  case UPDATE_STARTD_AD_DELTA:
+		if ( repeatStartdAds > 0 && command != UPDATE_STARTD_AD_DELTA ) {
 			clientAdToRepeat = new ClassAd(*clientAd);
 		}
 		if (!makeStartdAdHashKey (hk, clientAd))
@@ -581,8 +898,18 @@ collect (int command,ClassAd *clientAd,const condor_sockaddr& from,int &insert,S
 		CollectorEngine_rucc_makeHashKey_runtime.Add(rt.tick(rt_last));
 #endif
 
-		retVal=updateClassAd (StartdAds, "StartdAd     ", "Start",
-							  clientAd, hk, hashString, insert, from );
+		if (command == UPDATE_STARTD_AD_DELTA) {
+			retVal = applyStartdAdDelta (clientAd, hk, hashString, insert, sock);
+			if ( ! retVal) {
+				break;
+			}
+		} else {
+			if ( ! m_full_update_requests.empty()) {
+				m_full_update_requests.erase(hashString);
+			}
+			retVal=updateClassAd (StartdAds, "StartdAd     ", "Start",
+								  clientAd, hk, hashString, insert, from );
+		}
 
 #ifdef PROFILE_RECEIVE_UPDATE
 		if (last_updateClassAd_was_insert) { CollectorEngine_rucc_insertAd_runtime.Add(rt.tick(rt_last));
@@ -590,18 +917,21 @@ collect (int command,ClassAd *clientAd,const condor_sockaddr& from,int &insert,S
 #endif
 
 		// if we want to store private ads
-		if (!sock)
+		if (!sock && !given_pvt_ad)
 		{
 			dprintf (D_ALWAYS, "Want private ads, but no socket given!\n");
 			break;
 		}
 		else
 		{
-			if (!(pvtAd = new ClassAd))
+			if (given_pvt_ad) {
+				pvtAd = given_pvt_ad.release();
+			}
+			else if (!(pvtAd = new ClassAd))
 			{
 				EXCEPT ("Memory error!");
 			}
-			if( !getClassAdEx(sock, *pvtAd, m_get_ad_options) )
+			else if( !getClassAdEx(sock, *pvtAd, m_get_ad_options) )
 			{
 				dprintf(D_FULLDEBUG,"\t(Could not get startd's private ad)\n");
 				delete pvtAd;
@@ -619,6 +949,7 @@ collect (int command,ClassAd *clientAd,const condor_sockaddr& from,int &insert,S
 				// Negotiator matches up private ad with public ad by
 				// using the following.
 			if( retVal ) {
+				retVal->BeginUpdate();
 				CopyAttribute( ATTR_MY_ADDRESS, *pvtAd, *retVal->m_publicAd );
 				CopyAttribute( ATTR_NAME, *pvtAd, *retVal->m_publicAd );
 			}
@@ -900,7 +1231,7 @@ collect (int command,ClassAd *clientAd,const condor_sockaddr& from,int &insert,S
 	}
 
 #ifdef PROFILE_RECEIVE_UPDATE
-	if (command != UPDATE_STARTD_AD && command != UPDATE_STARTD_AD_WITH_ACK) {
+	if (command != UPDATE_STARTD_AD && command != UPDATE_STARTD_AD_WITH_ACK && command != UPDATE_STARTD_AD_DELTA) {
 		CollectorEngine_rucc_other_runtime.Add(rt.tick(rt_last));
 	}
 #endif
@@ -953,6 +1284,7 @@ int CollectorEngine::remove (AdTypes t_AddType, const ClassAd & c_query, bool *q
 				hk.sprint( hkString );
 				iRet = !table->remove(hk);
 				dprintf (D_ALWAYS,"\t\t**** Removed(%d) ad(s): \"%s\"\n", iRet, hkString.c_str() );
+				adsChanged();
 				delete record;
 			}
 		}
@@ -974,6 +1306,8 @@ int CollectorEngine::expire( AdTypes adType, const ClassAd & query, bool * query
 
             CollectorRecord* record = nullptr;
             if( hTable->lookup( hKey, record ) != -1 ) {
+                adsChanged();
+                record->BeginUpdate();
                 record->m_publicAd->Assign( ATTR_LAST_HEARD_FROM, 1 );
 
                 if( CollectorDaemon::offline_plugin_.expire( * record->m_publicAd ) == true ) {
@@ -1007,6 +1341,7 @@ remove (AdTypes adType, AdNameHashKey &hk)
 	if (!LookupByAdType(adType, table, func)) {
 		return 0;
 	}
+	adsChanged();
 	return !table->remove(hk);
 }
 
@@ -1084,6 +1419,13 @@ updateClassAd (CollectorHashTable &hashTable,
 		{
 			EXCEPT ("Error inserting ad (out of memory)");
 		}
+		if ( ! m_indexes.empty()) {
+			auto it = m_indexes.find(&hashTable);
+			if (it != m_indexes.end()) {
+				it->second->add(record);
+			}
+		}
+		adsChanged();
 
 		insert = 1;
 
@@ -1106,33 +1448,11 @@ updateClassAd (CollectorHashTable &hashTable,
 		}
 
 		if ( m_forwardFilteringEnabled && ( strcmp( label, "Start" ) == 0 || strcmp( label, "StartdPvt" ) == 0 || strcmp( label, "Submittor" ) == 0 ) ) {
-			bool forward = false;
-			int last_forwarded = 0;
-			old_ad->LookupInteger( "LastForwarded", last_forwarded );
-			if ( last_forwarded + m_forwardInterval < time(NULL) ) {
-				forward = true;
-			} else {
-				classad::Value old_val;
-				classad::Value new_val;
-				const char *attr;
-				m_forwardWatchList.rewind();
-				while ( (attr = m_forwardWatchList.next()) ) {
-					// This treats attribute-not-present and
-					// attribute-evaluates-to-UNDEFINED as equivalent.
-					if ( old_ad->EvaluateAttr( attr, old_val ) &&
-						 new_ad->EvaluateAttr( attr, new_val ) &&
-						 !new_val.SameAs( old_val ) )
-					{
-						forward = true;
-						break;
-					}
-				}
-			}
-			new_ad->Assign( ATTR_SHOULD_FORWARD, forward );
-			new_ad->Assign( ATTR_LAST_FORWARDED, forward ? (int)time(NULL) : last_forwarded );
+			setShouldForward( old_ad, new_ad );
 		}
 
 		// Now, finally, store the new ClassAd
+		adsChanged();
 		record->ReplaceAds(new_ad, new_pvt_ad);
 
 		insert = 0;
@@ -1140,6 +1460,145 @@ updateClassAd (CollectorHashTable &hashTable,
 	}
 }
 
+// Decide whether an update to old_ad should be forwarded to the view
+// collector.
+void CollectorEngine::
+setShouldForward (ClassAd *old_ad, ClassAd *new_ad)
+{
+	bool forward = false;
+	int last_forwarded = 0;
+	old_ad->LookupInteger( "LastForwarded", last_forwarded );
+	if ( last_forwarded + m_forwardInterval < time(NULL) ) {
+		forward = true;
+	} else {
+		classad::Value old_val;
+		classad::Value new_val;
+		const char *attr;
+		m_forwardWatchList.rewind();
+		while ( (attr = m_forwardWatchList.next()) ) {
+			// This treats attribute-not-present and
+			// attribute-evaluates-to-UNDEFINED as equivalent.
+			if ( old_ad->EvaluateAttr( attr, old_val ) &&
+				 new_ad->EvaluateAttr( attr, new_val ) &&
+				 !new_val.SameAs( old_val ) )
+			{
+				forward = true;
+				break;
+			}
+		}
+	}
+	new_ad->Assign( ATTR_SHOULD_FORWARD, forward );
+	new_ad->Assign( ATTR_LAST_FORWARDED, forward ? (int)time(NULL) : last_forwarded );
+}
+
+// Apply an UPDATE_STARTD_AD_DELTA to the startd ad it was made against.
+// If we don't have that ad, because we missed an update or were restarted,
+// ask the startd for the whole ad, and set insert to -5.  The delta is
+// deleted on success, like in mergeClassAd().
+CollectorRecord * CollectorEngine::
+applyStartdAdDelta (ClassAd *delta,
+					AdNameHashKey &hk,
+					const std::string &hashString,
+					int &insert,
+					Sock *sock)
+{
+	CollectorRecord* record = nullptr;
+	long long base_generation = -1, have_generation = -1;
+	time_t start_time = 0, have_start_time = 0;
+
+	insert = 0;
+
+		// the generation restarts along with the startd
+	delta->LookupInteger( ATTR_STARTD_DELTA_BASE_GENERATION, base_generation );
+	delta->LookupInteger( ATTR_DAEMON_START_TIME, start_time );
+	if ( StartdAds.lookup( hk, record ) == -1 ||
+		 ! record->m_publicAd->LookupInteger( ATTR_STARTD_DELTA_GENERATION, have_generation ) ||
+		 ! record->m_publicAd->LookupInteger( ATTR_DAEMON_START_TIME, have_start_time ) ||
+		 have_generation != base_generation || have_start_time != start_time )
+	{
+		dprintf( D_FULLDEBUG, "StartdAd     : Can't apply delta %lld to \"%s\", "
+				 "which is at %lld; asking for the whole ad\n",
+				 base_generation, hashString.c_str(), have_generation );
+		requestFullStartdAd( delta, hashString );
+		insert = -5;
+		return NULL;
+	}
+
+		// COLLECTOR_REQUIREMENTS sees the ad as it would be after the update
+	delta->ChainToAd( record->m_publicAd );
+	bool valid = ValidateClassAd( UPDATE_STARTD_AD_DELTA, delta, sock );
+	if ( valid ) {
+		collectorStats->update( "Start", record->m_publicAd, delta );
+		if ( m_forwardFilteringEnabled ) {
+			setShouldForward( record->m_publicAd, delta );
+		}
+	}
+	delta->Unchain();
+	if ( ! valid ) {
+		insert = -4;
+		return NULL;
+	}
+
+	dprintf( D_FULLDEBUG, "StartdAd     : Applying delta to ... \"%s\"\n",
+			 hashString.c_str() );
+
+	std::string removed;
+	delta->LookupString( ATTR_STARTD_DELTA_REMOVED_ATTRS, removed );
+	delta->Delete( ATTR_STARTD_DELTA_REMOVED_ATTRS );
+	delta->Delete( ATTR_STARTD_DELTA_BASE_GENERATION );
+
+	ClassAd delta_pvt;
+	movePrivateAttrs( delta_pvt, *delta );
+
+	adsChanged();
+	record->BeginUpdate();
+	record->m_publicAd->Delete( ATTR_RESTORED_AD );
+	for (const auto& attr : StringTokenIterator(removed)) {
+		record->m_publicAd->Delete( attr );
+		record->m_pvtAd->Delete( attr );
+	}
+		// like a whole ad, the delta says who sent it
+	if ( ! delta->Lookup( ATTR_AUTHENTICATED_IDENTITY ) ) {
+		record->m_publicAd->Delete( ATTR_AUTHENTICATED_IDENTITY );
+		record->m_publicAd->Delete( ATTR_AUTHENTICATION_METHOD );
+	}
+	MergeClassAds( record->m_publicAd, delta, true );
+	MergeClassAds( record->m_pvtAd, &delta_pvt, true );
+	record->m_publicAd->Assign( ATTR_LAST_HEARD_FROM, (int)time(NULL) );
+
+	delete delta;
+	return record;
+}
+
+// Ask a startd to send the whole ad of a slot, because we couldn't apply
+// a delta to it.  Since a startd may send several deltas before it gets
+// the request, only ask once in a while.
+void CollectorEngine::
+requestFullStartdAd (const ClassAd *delta, const std::string &hashString)
+{
+	time_t now = time(NULL);
+	auto it = m_full_update_requests.find( hashString );
+	if ( it != m_full_update_requests.end() && it->second + FULL_UPDATE_REQUEST_INTERVAL > now ) {
+		return;
+	}
+
+	std::string addr;
+	if ( ! delta->LookupString( ATTR_MY_ADDRESS, addr ) ) {
+		dprintf( D_ALWAYS, "StartdAd     : No %s in delta for \"%s\", "
+				 "can't ask for the whole ad\n", ATTR_MY_ADDRESS, hashString.c_str() );
+		return;
+	}
+	m_full_update_requests[hashString] = now;
+
+	ClassAd request;
+	CopyAttribute( ATTR_NAME, request, *delta );
+
+	classy_counted_ptr<Daemon> startd = new Daemon( DT_STARTD, addr.c_str() );
+	classy_counted_ptr<ClassAdMsg> msg = new ClassAdMsg( REQUEST_FULL_STARTD_UPDATE, request );
+	msg->setTimeout( clientTimeout );
+	startd->sendMsg( msg.get() );
+}
+
 CollectorRecord * CollectorEngine::
 mergeClassAd (CollectorHashTable &hashTable,
 			   const char *adType,
@@ -1179,6 +1638,8 @@ mergeClassAd (CollectorHashTable &hashTable,
 		movePrivateAttrs(new_pvt_ad, new_ad_copy);
 
 		// Now, finally, merge the new ClassAd into the old one
+		adsChanged();
+		record->BeginUpdate();
 		MergeClassAds(record->m_publicAd, &new_ad_copy, true);
 		MergeClassAds(record->m_pvtAd, &new_pvt_ad, true);
 	}
@@ -1203,12 +1664,22 @@ housekeeper()
 
 	dprintf (D_ALWAYS, "Housekeeper:  Ready to clean old ads\n");
 
+	adsChanged();
+
 	dprintf (D_ALWAYS, "\tCleaning StartdAds ...\n");
 	cleanHashTable (StartdAds, now, makeStartdAdHashKey);
 
 	dprintf (D_ALWAYS, "\tCleaning StartdPrivateAds ...\n");
 	cleanHashTable (StartdPrivateAds, now, makeStartdAdHashKey);
 
+	for (auto it = m_full_update_requests.begin(); it != m_full_update_requests.end(); ) {
+		if (it->second + FULL_UPDATE_REQUEST_INTERVAL <= now) {
+			it = m_full_update_requests.erase(it);
+		} else {
+			++it;
+		}
+	}
+
 	dprintf (D_ALWAYS, "\tCleaning ScheddAds ...\n");
 	cleanHashTable (ScheddAds, now, makeScheddAdHashKey);
 
@@ -1293,6 +1764,7 @@ cleanHashTable (CollectorHashTable &hashTable, time_t now, HashFunc makeKey) con
 				   potentially mark the ad absent. if expire() returns false, then delete
 				   the ad as planned; if it return true, it was likely marked as absent,
 				   so then this ad should NOT be deleted. */
+				record->BeginUpdate();
 				if ( CollectorDaemon::offline_plugin_.expire( *record->m_publicAd ) == true ) {
 					// plugin say to not delete this ad, so continue
 					continue;
@@ -23,18 +23,71 @@
 #include "condor_classad.h"
 
 #include "collector_stats.h"
+#include "collector_index.h"
 #include "hashkey.h"
 
+#include <map>
+#include <memory>
+#include <vector>
+
+// One version of the ads of a record.  It is shared by the record and by
+// any query snapshot taken while it was current, and deleted with the last
+// of them.  The ads are serialized for queries the first time they are
+// sent, and the serialized forms kept until the ads change.
+struct CollectorAds
+{
+	CollectorAds(ClassAd* public_ad, ClassAd* pvt_ad)
+		: m_publicAd(public_ad), m_pvtAd(pvt_ad), m_publicWire(public_ad), m_pvtWire(pvt_ad)
+		{ m_pvtAd->ChainToAd(m_publicAd); }
+	~CollectorAds() { delete m_publicAd; delete m_pvtAd; }
+
+	ClassAd* m_publicAd;
+	ClassAd* m_pvtAd;
+	SerializedClassAd m_publicWire;
+	SerializedClassAd m_pvtWire;	// includes the public ad
+
+  private:
+	CollectorAds(const CollectorAds &);
+	CollectorAds & operator=(const CollectorAds &);
+};
+
 struct CollectorRecord
 {
-	CollectorRecord(ClassAd* public_ad, ClassAd* pvt_ad)
-		: m_publicAd(public_ad), m_pvtAd(pvt_ad) { m_pvtAd->ChainToAd(m_publicAd); }
-	~CollectorRecord() { delete m_publicAd; delete m_pvtAd; }
+	CollectorRecord(ClassAd* public_ad, ClassAd* pvt_ad) : m_index(NULL) { ReplaceAds(public_ad, pvt_ad); }
+		// A copy, as in a snapshot, shares the ads but isn't indexed
+	CollectorRecord(const CollectorRecord &that)
+		: m_publicAd(that.m_publicAd), m_pvtAd(that.m_pvtAd), m_ads(that.m_ads), m_index(NULL) {}
+	~CollectorRecord() { if (m_index) { m_index->remove(this); } }
 	void ReplaceAds(ClassAd* public_ad, ClassAd* pvt_ad)
-	{ delete m_publicAd; delete m_pvtAd; m_publicAd=public_ad; m_pvtAd=pvt_ad; m_pvtAd->ChainToAd(m_publicAd); }
+	{
+		if (m_index) { m_index->changed(this); }
+		m_ads = std::make_shared<CollectorAds>(public_ad, pvt_ad); m_publicAd=public_ad; m_pvtAd=pvt_ad;
+	}
+
+		// Call this before changing the ads in place.  If a query
+		// snapshot is reading them, the record gets its own copy,
+		// otherwise their serialized forms are thrown away.
+	void BeginUpdate();
 
 	ClassAd* m_publicAd;
 	ClassAd* m_pvtAd;
+	std::shared_ptr<CollectorAds> m_ads;	// owns the two ads above
+	CollectorIndex* m_index;	// of the table the record is in, if any
+
+  private:
+	CollectorRecord & operator=(const CollectorRecord &);
+};
+
+// The records of one ad type at some moment, for answering a query on
+// a query thread while the tables go on changing.  The records share
+// their ads with the tables, so a snapshot is cheap to take.  Releasing
+// one may delete ads, so that must happen on the main thread.
+struct CollectorSnapshot
+{
+	CollectorSnapshot() : taken(0.0) {}
+
+	std::vector<CollectorRecord> records;
+	double taken;		// when the snapshot was taken
 };
 
 // type for the hash tables ...
@@ -57,11 +110,17 @@ class CollectorEngine : public Service
 
 	// perform the collect operation of the given command
 	CollectorRecord *collect (int, Sock *, const condor_sockaddr&, int &);
-	CollectorRecord *collect (int, ClassAd *, const condor_sockaddr&, int &, Sock* = NULL);
+	// The private ad of a startd is read from the socket after the public
+	// one, unless it is given, in which case the engine takes it over.
+	CollectorRecord *collect (int, ClassAd *, const condor_sockaddr&, int &, Sock* = NULL, ClassAd *pvt_ad = NULL);
 
 	// lookup classad in the specified table with the given hashkey
 	CollectorRecord *lookup (AdTypes, AdNameHashKey &);
 
+	// forget the query snapshots, since the ads in them are no longer
+	// current.  Call this whenever an ad in the tables is changed in place.
+	void adsChanged() { m_snapshots.clear(); }
+
 	/**
 	* remove () - attempts to construct a hashkey from a query
     * to remove in O(1) for INVALIDATE* vs. O(n). The query must contain
@@ -113,6 +172,33 @@ class CollectorEngine : public Service
 	}
 
 
+	// Get a snapshot of the ads of the given type.  The snapshot is
+	// shared by the queries that come in until any ad changes.
+	// Returns NULL for an unknown type.
+	//
+	// If a filter is given and the table has an index it can use, the
+	// snapshot is just of the ads the filter might match, and isn't shared.
+	std::shared_ptr<CollectorSnapshot> getSnapshot(AdTypes, classad::ExprTree *filter = NULL);
+
+	// Use the secondary indexes of a table to find the records a query
+	// filter might match.  Returns false if no index applies, in which
+	// case all of them might.
+	bool getCandidates(AdTypes, classad::ExprTree *filter, std::vector<CollectorRecord *> &records);
+
+	// Set up the secondary indexes from COLLECTOR_INDEXES, a list of
+	// <MyType>.<attribute>
+	void setIndexes(const char *str);
+
+	// Keep a copy of all the ads in a file, written every interval
+	// seconds and at shutdown, so a restarted collector can answer
+	// queries before the daemons have sent their updates again.
+	// An empty file name turns this off.
+	void setStateFile(const char *filename, int interval);
+	void writeState();
+	// Load the ads saved in the state file that haven't yet expired.
+	// Each is marked as restored until its daemon updates it.
+	int loadState();
+
 	// register the collector's own ad pointer, and check to see if a given ad is that ad.
 	// this is used to allow us to recognise the collector ad during iteration and automatically
 	// insert fresh stats into it when it is fetched.
@@ -183,11 +269,33 @@ class CollectorEngine : public Service
 							int  &insert,
 							const condor_sockaddr& /*from*/ );
 
+	void setShouldForward(ClassAd *old_ad, ClassAd *new_ad);
+
+	CollectorRecord* applyStartdAdDelta(ClassAd *delta, AdNameHashKey &hk,
+							const std::string &hashString, int &insert,
+							Sock *sock);
+
+	// startd ads we have asked for in full, and when
+	void requestFullStartdAd(const ClassAd *delta, const std::string &hashString);
+	std::map<std::string, time_t> m_full_update_requests;
+	static const int FULL_UPDATE_REQUEST_INTERVAL = 60;
+
 	// support for dynamically created tables
 	CollectorHashTable *findOrCreateTable(const std::string &str);
 
 	bool ValidateClassAd(int command,ClassAd *clientAd,Sock *sock);
 
+	std::map<AdTypes, std::shared_ptr<CollectorSnapshot> > m_snapshots;
+
+	// the state file
+	std::string m_state_file;
+	int m_state_interval;
+	int m_state_timer;
+
+	// secondary indexes, by table
+	std::map<CollectorHashTable *, std::unique_ptr<CollectorIndex> > m_indexes;
+	std::string m_index_config;
+
 	void* __self_ad__; // contains address of last Ad for this collector added to the hashtable, do NOT free from here
 					   // this pointer is only used to recognise this collector's ad during a condor_status query
 					   // so it's harmless if this pointer is out of date.
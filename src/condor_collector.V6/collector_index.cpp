@@ -0,0 +1,297 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "compat_classad_util.h"
+#include "stl_string_utils.h"
+#include "condor_daemon_core.h"
+#include "collector_engine.h"
+#include "collector_index.h"
+
+CollectorIndex::CollectorIndex(const std::vector<std::string> & attrs)
+	: m_attr_names(attrs)
+	, m_attrs(attrs.size())
+{
+}
+
+CollectorIndex::~CollectorIndex()
+{
+	for (auto & it : m_entries) {
+		it.first->m_index = NULL;
+	}
+}
+
+void
+CollectorIndex::add(CollectorRecord *record)
+{
+	record->m_index = this;
+	index(record, m_entries[record]);
+}
+
+void
+CollectorIndex::changed(CollectorRecord *record)
+{
+	m_dirty.insert(record);
+}
+
+void
+CollectorIndex::remove(CollectorRecord *record)
+{
+	auto it = m_entries.find(record);
+	if (it != m_entries.end()) {
+		unindex(record, it->second);
+		m_entries.erase(it);
+	}
+	m_dirty.erase(record);
+	record->m_index = NULL;
+}
+
+// Look again at the records whose ads have changed since we last did.
+void
+CollectorIndex::refresh()
+{
+	for (auto *record : m_dirty) {
+		std::vector<Entry> &entries = m_entries[record];
+		unindex(record, entries);
+		index(record, entries);
+	}
+	m_dirty.clear();
+}
+
+void
+CollectorIndex::index(CollectorRecord *record, std::vector<Entry> &entries)
+{
+	entries.resize(m_attrs.size());
+	for (size_t ix = 0; ix < m_attrs.size(); ix++) {
+		AttrIndex &ai = m_attrs[ix];
+		Entry &entry = entries[ix];
+		entry.kind = Entry::MISSING;
+
+		classad::ExprTree *expr = record->m_publicAd->Lookup(m_attr_names[ix]);
+		if ( ! expr) {
+			continue;
+		}
+		classad::Value val;
+		std::string str;
+		long long ival;
+		double rval;
+		if ( ! ExprTreeIsPlainLiteral(expr, val)) {
+			entry.kind = Entry::OTHER;
+			ai.others.insert(record);
+		} else if (val.IsStringValue(str)) {
+			entry.kind = Entry::STRING;
+			entry.str = str;
+			lower_case(entry.str);
+			ai.strings[entry.str].insert(record);
+		} else if (val.IsBooleanValue(entry.b)) {
+			entry.kind = Entry::BOOLEAN;
+			ai.booleans[entry.b].insert(record);
+		} else if (val.IsIntegerValue(ival)) {
+			entry.kind = Entry::NUMBER;
+			entry.num = (double)ival;
+			ai.numbers.emplace(entry.num, record);
+		} else if (val.IsRealValue(rval)) {
+			entry.kind = Entry::NUMBER;
+			entry.num = rval;
+			ai.numbers.emplace(entry.num, record);
+		} else if (val.IsUndefinedValue() || val.IsErrorValue()) {
+				// compares as undefined or error with anything we index on
+			continue;
+		} else {
+			entry.kind = Entry::OTHER;
+			ai.others.insert(record);
+		}
+	}
+}
+
+void
+CollectorIndex::unindex(CollectorRecord *record, const std::vector<Entry> &entries)
+{
+	for (size_t ix = 0; ix < entries.size(); ix++) {
+		AttrIndex &ai = m_attrs[ix];
+		const Entry &entry = entries[ix];
+		switch (entry.kind) {
+		case Entry::STRING: {
+			auto it = ai.strings.find(entry.str);
+			if (it != ai.strings.end()) {
+				it->second.erase(record);
+				if (it->second.empty()) {
+					ai.strings.erase(it);
+				}
+			}
+			break;
+		}
+		case Entry::NUMBER:
+			ai.numbers.erase(std::make_pair(entry.num, record));
+			break;
+		case Entry::BOOLEAN:
+			ai.booleans[entry.b].erase(record);
+			break;
+		case Entry::OTHER:
+			ai.others.erase(record);
+			break;
+		case Entry::MISSING:
+			break;
+		}
+	}
+}
+
+bool
+CollectorIndex::candidates(classad::ExprTree *filter, std::vector<CollectorRecord *> &records)
+{
+	refresh();
+
+	// Every conjunct of the filter must be true for an ad to match, so
+	// the candidates from any one of them will do.  Use the fewest.
+	std::vector<classad::ExprTree *> pending;
+	pending.push_back(filter);
+	bool found = false;
+	std::vector<CollectorRecord *> these;
+	while ( ! pending.empty()) {
+		classad::ExprTree *tree = SkipExprParens(pending.back());
+		pending.pop_back();
+		if ( ! tree || tree->GetKind() != classad::ExprTree::OP_NODE) {
+			continue;
+		}
+		classad::Operation::OpKind op;
+		classad::ExprTree *t1, *t2, *t3;
+		((classad::Operation *)tree)->GetComponents(op, t1, t2, t3);
+		if (op == classad::Operation::LOGICAL_AND_OP) {
+			pending.push_back(t1);
+			pending.push_back(t2);
+			continue;
+		}
+		these.clear();
+		if ( ! conjunctCandidates(tree, these)) {
+			continue;
+		}
+		if ( ! found || these.size() < records.size()) {
+			records.swap(these);
+			found = true;
+		}
+	}
+	return found;
+}
+
+// Candidates for an ad attribute compared with a literal.  Returns false
+// if the comparison can't use the index.
+bool
+CollectorIndex::conjunctCandidates(classad::ExprTree *tree, std::vector<CollectorRecord *> &records)
+{
+	classad::Operation::OpKind op;
+	classad::ExprTree *t1, *t2, *t3;
+	((classad::Operation *)tree)->GetComponents(op, t1, t2, t3);
+
+	std::string attr;
+	classad::Value val;
+	if (ExprTreeIsMyAttrRef(t1, attr) && ExprTreeIsPlainLiteral(t2, val)) {
+		// attr op literal
+	} else if (ExprTreeIsMyAttrRef(t2, attr) && ExprTreeIsPlainLiteral(t1, val)) {
+			// literal op attr, so turn it around
+		switch (op) {
+		case classad::Operation::LESS_THAN_OP: op = classad::Operation::GREATER_THAN_OP; break;
+		case classad::Operation::LESS_OR_EQUAL_OP: op = classad::Operation::GREATER_OR_EQUAL_OP; break;
+		case classad::Operation::GREATER_THAN_OP: op = classad::Operation::LESS_THAN_OP; break;
+		case classad::Operation::GREATER_OR_EQUAL_OP: op = classad::Operation::LESS_OR_EQUAL_OP; break;
+		default: break;
+		}
+	} else {
+		return false;
+	}
+
+	size_t ix = 0;
+	for ( ; ix < m_attr_names.size(); ix++) {
+		if (strcasecmp(m_attr_names[ix].c_str(), attr.c_str()) == 0) {
+			break;
+		}
+	}
+	if (ix == m_attr_names.size()) {
+		return false;
+	}
+	AttrIndex &ai = m_attrs[ix];
+
+	bool is_equal = (op == classad::Operation::EQUAL_OP || op == classad::Operation::META_EQUAL_OP);
+	std::string str;
+	bool b = false;
+	long long ival;
+	double num = 0;
+	if (val.IsStringValue(str)) {
+		if ( ! is_equal) {
+			return false;
+		}
+		lower_case(str);
+		auto it = ai.strings.find(str);
+		if (it != ai.strings.end()) {
+			records.insert(records.end(), it->second.begin(), it->second.end());
+		}
+	} else if (val.IsBooleanValue(b)) {
+		if ( ! is_equal) {
+			return false;
+		}
+			// a boolean can equal a number
+		records.insert(records.end(), ai.booleans[b].begin(), ai.booleans[b].end());
+		for (auto & it : ai.numbers) {
+			records.push_back(it.second);
+		}
+	} else if (val.IsIntegerValue(ival) || val.IsRealValue(num)) {
+		if (val.IsIntegerValue(ival)) {
+			num = (double)ival;
+		}
+		auto begin = ai.numbers.begin();
+		auto end = ai.numbers.end();
+		auto lower = ai.numbers.lower_bound(std::make_pair(num, (CollectorRecord *)NULL));
+		auto upper = lower;
+		while (upper != end && upper->first == num) {
+			++upper;
+		}
+		switch (op) {
+		case classad::Operation::EQUAL_OP:
+		case classad::Operation::META_EQUAL_OP:
+			begin = lower; end = upper;
+			break;
+		case classad::Operation::LESS_THAN_OP:
+			end = lower;
+			break;
+		case classad::Operation::LESS_OR_EQUAL_OP:
+			end = upper;
+			break;
+		case classad::Operation::GREATER_THAN_OP:
+			begin = upper;
+			break;
+		case classad::Operation::GREATER_OR_EQUAL_OP:
+			begin = lower;
+			break;
+		default:
+			return false;
+		}
+		for (auto it = begin; it != end; ++it) {
+			records.push_back(it->second);
+		}
+			// a boolean compares as a number
+		for (int bix = 0; bix < 2; bix++) {
+			records.insert(records.end(), ai.booleans[bix].begin(), ai.booleans[bix].end());
+		}
+	} else {
+		return false;
+	}
+
+	records.insert(records.end(), ai.others.begin(), ai.others.end());
+	return true;
+}
@@ -0,0 +1,95 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _COLLECTOR_INDEX_H_
+#define _COLLECTOR_INDEX_H_
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "condor_classad.h"
+
+struct CollectorRecord;
+
+// Secondary indexes on some attributes of the ads in one collector table,
+// declared by COLLECTOR_INDEXES.  Ads whose value of an indexed attribute
+// is a string or a boolean literal are indexed by that value, and those
+// whose value is a number by where it falls in order.  Ads where it is
+// an expression are kept aside, since any query might match them.
+//
+// The index is only a way to skip ads that can't match a query, so the
+// candidates it finds must still be checked against the whole query.
+//
+// A record tells its index when its ads are about to change, and the
+// index looks at them again the next time it is used.
+class CollectorIndex
+{
+public:
+	explicit CollectorIndex(const std::vector<std::string> & attrs);
+	~CollectorIndex();	// the records forget the index
+
+	const std::vector<std::string> & attrs() const { return m_attr_names; }
+
+	void add(CollectorRecord *record);		// a new record in the table
+	void changed(CollectorRecord *record);	// its ads are about to change
+	void remove(CollectorRecord *record);	// it is being deleted
+
+		// Finds records that include every one in the table that the
+		// filter could match, from one of the conjuncts of the filter
+		// that compares an indexed attribute with a literal.  Returns
+		// false if there is no such conjunct, in which case the whole
+		// table must be searched.
+	bool candidates(classad::ExprTree *filter, std::vector<CollectorRecord *> &records);
+
+private:
+	CollectorIndex(const CollectorIndex &);
+	CollectorIndex & operator=(const CollectorIndex &);
+
+	// What one attribute of one record was indexed as
+	struct Entry {
+		enum Kind { MISSING, STRING, NUMBER, BOOLEAN, OTHER };
+		Kind kind;
+		std::string str;	// lower case, since == ignores case
+		double num;
+		bool b;
+	};
+
+	struct AttrIndex {
+		std::unordered_map<std::string, std::unordered_set<CollectorRecord *> > strings;
+		std::set<std::pair<double, CollectorRecord *> > numbers;
+		std::unordered_set<CollectorRecord *> booleans[2];
+		std::unordered_set<CollectorRecord *> others;
+	};
+
+	void refresh();
+	void index(CollectorRecord *record, std::vector<Entry> &entries);
+	void unindex(CollectorRecord *record, const std::vector<Entry> &entries);
+	bool conjunctCandidates(classad::ExprTree *tree, std::vector<CollectorRecord *> &records);
+
+	std::vector<std::string> m_attr_names;
+	std::vector<AttrIndex> m_attrs;		// parallel to m_attr_names
+	std::unordered_map<CollectorRecord *, std::vector<Entry> > m_entries;
+	std::unordered_set<CollectorRecord *> m_dirty;
+};
+
+#endif
@@ -376,6 +376,11 @@ void UpdatesStats::Init()
 	STATS_POOL_ADD(Pool, "", PendingQueries, IF_BASICPUB);
 	STATS_POOL_ADD_VAL_PUB_RECENT(Pool, "", DroppedQueries, IF_BASICPUB);
 
+	// stats for query threads.
+	STATS_POOL_ADD(Pool, "", ActiveQueryThreads, IF_BASICPUB);
+	Pool.AddProbe("QueryThreadLatency", &QueryThreadLatency, "QueryThreadLatency", IF_BASICPUB);
+	Pool.AddProbe("QuerySnapshotAge", &QuerySnapshotAge, "QuerySnapshotAge", IF_BASICPUB);
+
 	ADD_EXTERN_RUNTIME(Pool, HandleQuery, IF_VERBOSEPUB);
 	ADD_EXTERN_RUNTIME(Pool, HandleLocate, IF_VERBOSEPUB);
 
@@ -383,6 +388,7 @@ void UpdatesStats::Init()
 	ADD_EXTERN_RUNTIME(Pool, HandleQueryMissedFork, IF_VERBOSEPUB);
 	ADD_EXTERN_RUNTIME(Pool, HandleLocateForked, IF_VERBOSEPUB);
 	ADD_EXTERN_RUNTIME(Pool, HandleLocateMissedFork, IF_VERBOSEPUB);
+	ADD_EXTERN_RUNTIME(Pool, HandleQueryThreaded, IF_VERBOSEPUB);
 
 #ifdef TRACK_QUERIES_BY_SUBSYS
     #define ADD_SUBSYS_PROBES(pool,subsys,as) \
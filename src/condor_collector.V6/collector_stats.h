@@ -172,6 +172,11 @@ struct UpdatesStats {
 	stats_entry_abs<int> PendingQueries;
 	stats_entry_recent<long> DroppedQueries;
 
+	// stats for query threads
+	stats_entry_abs<int> ActiveQueryThreads;
+	stats_entry_probe<double> QueryThreadLatency;	// seconds from receiving a query to answering it
+	stats_entry_probe<double> QuerySnapshotAge;	// age in seconds of the snapshot a query read
+
 #ifdef TRACK_QUERIES_BY_SUBSYS
 	stats_entry_recent<long> InProcQueriesFrom[SUBSYSTEM_ID_COUNT]; // Track subsystems < the AUTO subsys.
 	stats_entry_recent<long> ForkQueriesFrom[SUBSYSTEM_ID_COUNT]; // Track subsystems < the AUTO subsys.
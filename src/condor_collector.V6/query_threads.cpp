@@ -0,0 +1,216 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_daemon_core.h"
+#include "query_threads.h"
+
+ThreadedQuery::ThreadedQuery()
+	: cad(NULL)
+	, sock(NULL)
+	, whichAds(NO_AD)
+	, is_locate(false)
+	, high_prio(false)
+	, filter_private_attrs(true)
+	, filter(NULL)
+	, resultLimit(INT_MAX)
+	, projection_mad(NULL)
+	, arrived(0.0)
+	, dropped(false)
+	, status(FALSE)
+	, numAds(0)
+	, failed(0)
+	, began(0.0)
+	, end_query(0.0)
+	, end_write(0.0)
+{
+}
+
+ThreadedQuery::~ThreadedQuery()
+{
+	if (projection_mad) {
+		projection_mad->RemoveLeftAd();
+		projection_mad->RemoveRightAd();
+		delete projection_mad;
+	}
+	delete cad;
+	delete sock;
+}
+
+
+QueryThreadPool::QueryThreadPool(QueryFunc run, QueryFunc done)
+	: run_fn(run)
+	, done_fn(done)
+	, num_reserved(0)
+	, num_active(0)
+	, num_active_low_prio(0)
+	, shutting_down(false)
+{
+}
+
+QueryThreadPool::~QueryThreadPool()
+{
+	stop();
+}
+
+bool
+QueryThreadPool::start(int num_threads, int reserved_for_high_prio)
+{
+	ASSERT(threads.empty());
+	if (num_threads < 1) {
+		return false;
+	}
+
+#ifdef WIN32
+	dprintf(D_ALWAYS, "QueryThreads: query threads are not supported on this platform\n");
+	return false;
+#else
+	if ( ! wakeup_pipe.open("query thread wakeup pipe", [this] { reapQueries(); })) {
+		return false;
+	}
+
+	num_reserved = MAX(0, MIN(reserved_for_high_prio, num_threads - 1));
+	shutting_down = false;
+		// the queries dprintf, as does CEDAR under them, and dprintf
+		// only takes its lock if told to expect threads
+	dprintf_make_thread_safe();
+	for (int ix = 0; ix < num_threads; ix++) {
+		threads.emplace_back(&QueryThreadPool::threadMain, this);
+	}
+	dprintf(D_ALWAYS, "QueryThreads: started %d query threads, %d reserved for high priority queries\n",
+		num_threads, num_reserved);
+	return true;
+#endif
+}
+
+void
+QueryThreadPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		shutting_down = true;
+	}
+	wake.notify_all();
+		// queries being answered now are allowed to finish
+	for (auto & thr : threads) {
+		thr.join();
+	}
+	threads.clear();
+
+	for (auto *query : high_prio_queue) { delete query; }
+	for (auto *query : low_prio_queue) { delete query; }
+	for (auto *query : finished) { delete query; }
+	high_prio_queue.clear();
+	low_prio_queue.clear();
+	finished.clear();
+	num_active = num_active_low_prio = 0;
+
+	wakeup_pipe.close();
+}
+
+void
+QueryThreadPool::enqueue(ThreadedQuery *query)
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		if (query->high_prio) {
+			high_prio_queue.push_back(query);
+		} else {
+			low_prio_queue.push_back(query);
+		}
+	}
+		// a thread that can't take a low priority query may be the one
+		// woken up, so wake them all.
+	wake.notify_all();
+}
+
+void
+QueryThreadPool::getCounts(int &active, int &pending, int &pending_high_prio)
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	active = num_active;
+	pending = (int)(high_prio_queue.size() + low_prio_queue.size());
+	pending_high_prio = (int)high_prio_queue.size();
+}
+
+// Called with mtx held.  A low priority query is only taken if that
+// leaves enough threads for high priority queries.
+bool
+QueryThreadPool::takeQuery(ThreadedQuery *&query)
+{
+	if ( ! high_prio_queue.empty()) {
+		query = high_prio_queue.front();
+		high_prio_queue.pop_front();
+		return true;
+	}
+	if ( ! low_prio_queue.empty() && num_active_low_prio < (int)threads.size() - num_reserved) {
+		query = low_prio_queue.front();
+		low_prio_queue.pop_front();
+		num_active_low_prio++;
+		return true;
+	}
+	return false;
+}
+
+void
+QueryThreadPool::threadMain()
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true) {
+		ThreadedQuery *query = NULL;
+		wake.wait(lock, [this, &query] { return shutting_down || takeQuery(query); });
+		if ( ! query) {
+			break;
+		}
+		num_active++;
+		lock.unlock();
+
+		run_fn(query);
+
+		lock.lock();
+		num_active--;
+		if ( ! query->high_prio) {
+			num_active_low_prio--;
+				// another thread may be waiting for a low priority slot
+			wake.notify_one();
+		}
+		bool was_empty = finished.empty();
+		finished.push_back(query);
+		if (was_empty) {
+			wakeup_pipe.wake();
+		}
+	}
+}
+
+// Called through the wakeup pipe, to finish answered queries on the main
+// thread.
+void
+QueryThreadPool::reapQueries()
+{
+	std::vector<ThreadedQuery *> done;
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		done.swap(finished);
+	}
+	for (auto *query : done) {
+		done_fn(query);
+		delete query;
+	}
+}
@@ -0,0 +1,128 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _COLLECTOR_QUERY_THREADS_H_
+#define _COLLECTOR_QUERY_THREADS_H_
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "condor_classad.h"
+#include "collector_engine.h"
+#include "thread_wakeup.h"
+
+// A query answered by a query thread.  Everything about it that needs
+// daemon core, the security manager or the live collector tables is
+// worked out on the main thread beforehand, and it is deleted there.
+struct ThreadedQuery
+{
+	ThreadedQuery();
+	~ThreadedQuery();	// deletes cad, sock and projection_mad
+
+	// Set up by the main thread
+	ClassAd *cad;				// the query
+	Stream *sock;
+	AdTypes whichAds;
+	bool is_locate;
+	bool high_prio;
+	bool filter_private_attrs;
+	std::string subsys;
+	std::string adType;			// MyType of the ads to match, or empty for any
+	classad::ExprTree *filter;	// in cad, or NULL if nothing can match
+	int resultLimit;
+		// For evaluating a projection expression against each result,
+		// which can't use the shared match ad.  NULL if the projection
+		// is a plain list of attributes.
+	classad::MatchClassAd *projection_mad;
+	std::shared_ptr<CollectorSnapshot> snapshot;
+	double arrived;				// when the query was received
+
+	// Set by the query thread
+	bool dropped;				// stale, so never answered
+	int status;					// TRUE if the answer was sent
+	int numAds;
+	int failed;
+	std::string projection;
+	double began;
+	double end_query;
+	double end_write;
+};
+
+// A fixed set of threads for answering collector queries, so they needn't
+// fork the collector.  Queries from the high priority queue are always
+// taken first, and some threads may be kept for them alone.
+//
+// When a thread is done with a query, it hands it back to the main thread
+// through a daemon core pipe, and the done function is called there.
+class QueryThreadPool
+{
+public:
+	typedef void (*QueryFunc)(ThreadedQuery *);
+
+		// run is called on a query thread, and done on the main thread
+		// after that.
+	QueryThreadPool(QueryFunc run, QueryFunc done);
+
+		// Waits for the queries being answered.  Queries still in the
+		// queues are deleted without being answered.
+	~QueryThreadPool();
+
+	bool start(int num_threads, int reserved_for_high_prio);
+	int size() const { return (int)threads.size(); }
+	int reserved() const { return num_reserved; }
+
+		// The pool takes ownership of the query
+	void enqueue(ThreadedQuery *query);
+
+	void getCounts(int &active, int &pending, int &pending_high_prio);
+
+private:
+	QueryThreadPool(const QueryThreadPool &);
+	QueryThreadPool & operator=(const QueryThreadPool &);
+
+	void stop();
+	void threadMain();
+	bool takeQuery(ThreadedQuery *&query);
+	void reapQueries();
+
+	QueryFunc run_fn;
+	QueryFunc done_fn;
+
+	std::vector<std::thread> threads;
+	int num_reserved;		// threads that only take high priority queries
+
+	// protected by mtx
+	std::mutex mtx;
+	std::condition_variable wake;
+	std::deque<ThreadedQuery *> high_prio_queue;
+	std::deque<ThreadedQuery *> low_prio_queue;
+	std::vector<ThreadedQuery *> finished;
+	int num_active;
+	int num_active_low_prio;
+	bool shutting_down;
+
+	ThreadWakeupPipe wakeup_pipe;
+};
+
+#endif
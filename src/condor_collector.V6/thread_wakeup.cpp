@@ -0,0 +1,87 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_daemon_core.h"
+#include "thread_wakeup.h"
+
+ThreadWakeupPipe::ThreadWakeupPipe()
+	: write_fd(-1)
+{
+	pipe_ends[0] = pipe_ends[1] = -1;
+}
+
+ThreadWakeupPipe::~ThreadWakeupPipe()
+{
+	close();
+}
+
+bool
+ThreadWakeupPipe::open(const char *name, std::function<void()> reap)
+{
+	ASSERT(pipe_ends[0] == -1);
+	if ( ! daemonCore->Create_Pipe(pipe_ends, true, false, true, true)) {
+		dprintf(D_ALWAYS, "failed to create %s\n", name);
+		return false;
+	}
+	if ( ! daemonCore->Get_Pipe_FD(pipe_ends[1], &write_fd)) {
+		dprintf(D_ALWAYS, "failed to get the fd of %s\n", name);
+		daemonCore->Close_Pipe(pipe_ends[0]);
+		daemonCore->Close_Pipe(pipe_ends[1]);
+		pipe_ends[0] = pipe_ends[1] = -1;
+		return false;
+	}
+	reap_fn = reap;
+	daemonCore->Register_Pipe(pipe_ends[0], name,
+		(PipeHandlercpp)&ThreadWakeupPipe::handler, "ThreadWakeupPipe::handler",
+		this, HANDLE_READ);
+	return true;
+}
+
+void
+ThreadWakeupPipe::close()
+{
+	if (pipe_ends[0] != -1) {
+		daemonCore->Close_Pipe(pipe_ends[0]);
+		daemonCore->Close_Pipe(pipe_ends[1]);
+		pipe_ends[0] = pipe_ends[1] = -1;
+		write_fd = -1;
+	}
+}
+
+void
+ThreadWakeupPipe::wake()
+{
+		// if this fails, the pipe is full, so the main thread
+		// will be reaping soon anyway.
+	char wakeup = 'w';
+	IGNORE_RETURN write(write_fd, &wakeup, 1);
+}
+
+int
+ThreadWakeupPipe::handler(int pipe_end)
+{
+	char buf[64];
+	while (daemonCore->Read_Pipe(pipe_end, buf, sizeof(buf)) > 0) {
+	}
+
+	reap_fn();
+	return TRUE;
+}
@@ -0,0 +1,53 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _COLLECTOR_THREAD_WAKEUP_H_
+#define _COLLECTOR_THREAD_WAKEUP_H_
+
+#include <functional>
+
+#include "condor_daemon_core.h"
+
+// A daemon core pipe that worker threads write to, so that the main thread
+// picks up what they have finished.  The reap function is called on the
+// main thread, after the pipe is emptied.
+class ThreadWakeupPipe : public Service
+{
+public:
+	ThreadWakeupPipe();
+	~ThreadWakeupPipe();
+
+	bool open(const char *name, std::function<void()> reap);
+	void close();
+
+		// Safe to call on any thread
+	void wake();
+
+private:
+	ThreadWakeupPipe(const ThreadWakeupPipe &);
+	ThreadWakeupPipe & operator=(const ThreadWakeupPipe &);
+
+	int handler(int pipe_end);
+
+	std::function<void()> reap_fn;
+	int pipe_ends[2];		// daemon core pipe ends
+	int write_fd;			// the write end's fd
+};
+
+#endif
@@ -0,0 +1,228 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_daemon_core.h"
+#include "update_threads.h"
+
+ThreadedUpdate::ThreadedUpdate()
+	: command(0)
+	, has_private_ad(false)
+	, parsed(false)
+	, ad(NULL)
+	, pvt_ad(NULL)
+{
+}
+
+ThreadedUpdate::~ThreadedUpdate()
+{
+	delete ad;
+	delete pvt_ad;
+}
+
+// Parse the ads of an update; this runs on an update thread.
+static void
+parseUpdate(ThreadedUpdate *update)
+{
+	update->ad = new ClassAd();
+	if ( ! update->public_text.parse(*update->ad)) {
+		return;
+	}
+	if (update->has_private_ad) {
+		update->pvt_ad = new ClassAd();
+		if ( ! update->private_text.parse(*update->pvt_ad)) {
+			delete update->pvt_ad;
+			update->pvt_ad = NULL;
+		}
+	}
+	update->parsed = true;
+}
+
+
+UpdateThreadPool::UpdateThreadPool(UpdateFunc done)
+	: done_fn(done)
+	, num_pending(0)
+	, shutting_down(false)
+{
+}
+
+UpdateThreadPool::~UpdateThreadPool()
+{
+	stop();
+}
+
+bool
+UpdateThreadPool::start(int num_threads)
+{
+	ASSERT(threads.empty());
+	if (num_threads < 1) {
+		return false;
+	}
+
+#ifdef WIN32
+	dprintf(D_ALWAYS, "UpdateThreads: update threads are not supported on this platform\n");
+	return false;
+#else
+	if ( ! wakeup_pipe.open("update thread wakeup pipe", [this] { applyFinished(); })) {
+		return false;
+	}
+
+	PrepareClassAdParsingForThreads();
+
+		// parsing may dprintf, which only takes its lock if told
+		// to expect threads
+	dprintf_make_thread_safe();
+
+	shutting_down = false;
+	wake = std::vector<std::condition_variable>(num_threads);
+	queues.resize(num_threads);
+	busy.assign(num_threads, false);
+	for (int ix = 0; ix < num_threads; ix++) {
+		threads.emplace_back(&UpdateThreadPool::threadMain, this, (size_t)ix);
+	}
+	dprintf(D_ALWAYS, "UpdateThreads: started %d update threads\n", num_threads);
+	return true;
+#endif
+}
+
+void
+UpdateThreadPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		shutting_down = true;
+	}
+	for (auto & cv : wake) {
+		cv.notify_all();
+	}
+	for (auto & thr : threads) {
+		thr.join();
+	}
+	threads.clear();
+
+	for (auto & queue : queues) {
+		for (auto *update : queue) { delete update; }
+	}
+	for (auto *update : finished) { delete update; }
+	queues.clear();
+	busy.clear();
+	finished.clear();
+	num_pending = 0;
+
+	wakeup_pipe.close();
+}
+
+size_t
+UpdateThreadPool::queueFor(const condor_sockaddr &from) const
+{
+		// An ad is always updated by the same daemon, so keeping the
+		// updates from each host in order keeps those to each ad in order.
+	return std::hash<std::string>()(from.to_ip_string()) % queues.size();
+}
+
+void
+UpdateThreadPool::enqueue(ThreadedUpdate *update)
+{
+	size_t ix = queueFor(update->from);
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		queues[ix].push_back(update);
+		num_pending++;
+	}
+	wake[ix].notify_one();
+}
+
+int
+UpdateThreadPool::pending()
+{
+	std::lock_guard<std::mutex> guard(mtx);
+	return num_pending;
+}
+
+void
+UpdateThreadPool::threadMain(size_t ix)
+{
+	std::deque<ThreadedUpdate *> &queue = queues[ix];
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true) {
+		wake[ix].wait(lock, [this, &queue] { return shutting_down || ! queue.empty(); });
+		if (shutting_down) {
+			break;
+		}
+		ThreadedUpdate *update = queue.front();
+		queue.pop_front();
+		busy[ix] = true;
+		lock.unlock();
+
+		parseUpdate(update);
+
+		lock.lock();
+		busy[ix] = false;
+		idle.notify_all();
+		bool was_empty = finished.empty();
+		finished.push_back(update);
+		if (was_empty) {
+			wakeup_pipe.wake();
+		}
+	}
+}
+
+void
+UpdateThreadPool::drain(const condor_sockaddr &from)
+{
+	if (queues.empty()) {
+		return;
+	}
+	size_t ix = queueFor(from);
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		idle.wait(lock, [this, ix] { return queueIdle(ix); });
+	}
+	applyFinished();
+}
+
+void
+UpdateThreadPool::drainAll()
+{
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		for (size_t ix = 0; ix < queues.size(); ix++) {
+			idle.wait(lock, [this, ix] { return queueIdle(ix); });
+		}
+	}
+	applyFinished();
+}
+
+// Hand the parsed updates to the engine, on the main thread.  Those from
+// any one queue are in the order they were queued.
+void
+UpdateThreadPool::applyFinished()
+{
+	std::vector<ThreadedUpdate *> done;
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		done.swap(finished);
+		num_pending -= (int)done.size();
+	}
+	for (auto *update : done) {
+		done_fn(update);
+		delete update;
+	}
+}
@@ -0,0 +1,121 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _COLLECTOR_UPDATE_THREADS_H_
+#define _COLLECTOR_UPDATE_THREADS_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "condor_classad.h"
+#include "classad_oldnew.h"
+#include "condor_sockaddr.h"
+#include "thread_wakeup.h"
+
+// An update whose ads are parsed on an update thread.  The ads are read
+// off the socket on the main thread, along with everything else about
+// the socket the engine needs, and the parsed ads are handed to the
+// engine back on the main thread.
+struct ThreadedUpdate
+{
+	ThreadedUpdate();
+	~ThreadedUpdate();	// deletes the ads
+
+	// Set up by the main thread
+	int command;
+	condor_sockaddr from;
+	std::string authn_user;		// empty if not authenticated
+	std::string authn_method;
+	UnparsedClassAd public_text;
+	UnparsedClassAd private_text;
+	bool has_private_ad;
+
+	// Set by the update thread
+	bool parsed;
+	ClassAd *ad;
+	ClassAd *pvt_ad;
+};
+
+// A fixed set of threads for parsing the ads in collector updates.  Each
+// thread has its own queue, and the updates from any one sender always go
+// to the same queue, so the updates to an ad are handed back to the main
+// thread in the order they came in.
+//
+// When a thread is done with an update, it hands it back to the main
+// thread through a daemon core pipe, and the done function is called there.
+class UpdateThreadPool
+{
+public:
+	typedef void (*UpdateFunc)(ThreadedUpdate *);
+
+	explicit UpdateThreadPool(UpdateFunc done);
+
+		// Waits for the updates being parsed.  Updates still in the
+		// queues are deleted without being applied.
+	~UpdateThreadPool();
+
+	bool start(int num_threads);
+	int size() const { return (int)threads.size(); }
+
+		// The pool takes ownership of the update
+	void enqueue(ThreadedUpdate *update);
+
+		// Wait for the updates queued from this host to be parsed, and
+		// apply them, along with any others that are done.  Call this
+		// before handling anything else from the host on the main thread,
+		// such as an invalidation, so that it isn't overtaken by them.
+	void drain(const condor_sockaddr &from);
+
+		// Wait for every queued update to be parsed, and apply them all
+	void drainAll();
+
+	int pending();
+
+private:
+	UpdateThreadPool(const UpdateThreadPool &);
+	UpdateThreadPool & operator=(const UpdateThreadPool &);
+
+	void stop();
+	void threadMain(size_t ix);
+	size_t queueFor(const condor_sockaddr &from) const;
+	bool queueIdle(size_t ix) const { return queues[ix].empty() && ! busy[ix]; }
+	void applyFinished();
+
+	UpdateFunc done_fn;
+
+	std::vector<std::thread> threads;
+
+	// protected by mtx
+	std::mutex mtx;
+	std::vector<std::condition_variable> wake;		// one per thread
+	std::vector<std::deque<ThreadedUpdate *> > queues;	// one per thread
+	std::vector<bool> busy;		// one per thread, parsing an update
+	std::condition_variable idle;	// a thread has finished an update
+	std::vector<ThreadedUpdate *> finished;
+	int num_pending;
+	bool shutting_down;
+
+	ThreadWakeupPipe wakeup_pipe;
+};
+
+#endif
@@ -333,6 +333,68 @@ CollectorList::sendUpdates (int cmd, ClassAd * ad1, ClassAd* ad2, bool nonblocki
 	return success_count;
 }
 
+int
+CollectorList::sendUpdateBatch (DCCollectorUpdateBatch & batch, bool nonblocking,
+	DCTokenRequester *token_requester, const std::string &identity,
+	const std::string authz_name)
+{
+	int success_count = 0;
+
+	if ( ! adSeq) {
+		adSeq = new DCCollectorAdSequences();
+	}
+
+	// advance the sequence numbers for these ads
+	//
+	time_t now = time(NULL);
+	for (auto & update : batch) {
+		DCCollectorAdSeq * seqgen = adSeq->getAdSeq(*update.ad1);
+		if (seqgen) { seqgen->advance(now); }
+	}
+
+	this->rewind();
+	int num_collectors = this->Number();
+	DCCollector * daemon;
+	while (this->next(daemon)) {
+		if (!daemon->addr()) {
+			dprintf(D_ALWAYS, "Can't resolve collector %s; skipping update\n",
+					daemon->name() ? daemon->name() : "without a name(?)");
+			continue;
+		}
+
+		if ((num_collectors > 1) && daemon->isBlacklisted()) {
+			dprintf(D_ALWAYS, "Skipping update to collector %s which has timed out in the past\n", daemon->addr());
+			continue;
+		}
+		dprintf( D_FULLDEBUG,
+				 "Trying to update collector %s with %d ads\n",
+				 daemon->addr(), (int)batch.size() );
+		void *data = nullptr;
+		if (token_requester && daemon->name()) {
+			data = token_requester->createCallbackData(daemon->name(),
+				identity, authz_name);
+		}
+
+		if( num_collectors > 1 ) {
+			daemon->blacklistMonitorQueryStarted();
+		}
+
+		bool success = daemon->sendUpdateBatch(batch, *adSeq, nonblocking,
+			DCTokenRequester::daemonUpdateCallback, data);
+
+		if( num_collectors > 1 ) {
+			daemon->blacklistMonitorQueryFinished(success);
+		}
+
+		if (success)
+		{
+			success_count++;
+		}
+	}
+
+	return success_count;
+}
+
 QueryResult
 CollectorList::query (CondorQuery & cQuery, bool (*callback)(void*, ClassAd *), void* pv, CondorError * errstack) {
 
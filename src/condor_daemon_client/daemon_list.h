@@ -96,6 +96,7 @@ public:
 };
 
 class DCCollectorAdSequences;
+struct DCCollectorUpdate;
 
 class CollectorList : public DaemonList {
  public:
@@ -115,6 +116,13 @@ class CollectorList : public DaemonList {
 		DCTokenRequester *token_requester = nullptr, const std::string &identity = "",
 		const std::string authz_name = "");
 
+		// Send a batch of updates to all the collectors, in one
+		// message to each that takes batches.
+		// return - number of collectors successfully updated
+	int sendUpdateBatch (std::vector<DCCollectorUpdate> & batch, bool nonblocking,
+		DCTokenRequester *token_requester = nullptr, const std::string &identity = "",
+		const std::string authz_name = "");
+
 		// use this to detach the ad sequence counters before destroying the collector list
 		// we do this when we want to move the sequence counters to a new list
 	DCCollectorAdSequences * detachAdSequences() { DCCollectorAdSequences * p = adSeq; adSeq = NULL; return p; }
@@ -296,6 +296,89 @@ DCCollector::sendUpdate( int cmd, ClassAd* ad1, DCCollectorAdSequences& adSeq, C
 		nonblocking = false;
 	}
 
+	prepareUpdate(ad1, adSeq, ad2);
+
+	if ( ! checkUpdatePort(callback_fn, miscdata)) {
+		return false;
+	}
+
+	//
+	// We don't want the collector to send TCP updates to itself, since
+	// this could cause it to deadlock.  Since the only ad a collector
+	// will ever advertise is its own, only check for *_COLLECTOR_ADS.
+	//
+	if( cmd == UPDATE_COLLECTOR_AD || cmd == INVALIDATE_COLLECTOR_ADS ) {
+		if( daemonCore ) {
+			const char * myOwnSinful = daemonCore->InfoCommandSinfulString();
+			if( myOwnSinful == NULL ) {
+				dprintf( D_ALWAYS, "Unable to determine my own address, will not update or invalidate collector ad to avoid potential deadlock.\n" );
+				if (callback_fn) {
+					(*callback_fn)(false, nullptr, nullptr, "", false, miscdata);
+				}
+				return false;
+			}
+			if( _addr == NULL ) {
+				dprintf( D_ALWAYS, "Failing attempt to update or invalidate collector ad because of missing daemon address (probably an unresolved hostname; daemon name is '%s').\n", _name );
+				if (callback_fn) {
+					(*callback_fn)(false, nullptr, nullptr, "", false, miscdata);
+				}
+				return false;
+			}
+			if( strcmp( myOwnSinful, _addr ) == 0 ) {
+				EXCEPT( "Collector attempted to send itself an update.\n" );
+			}
+		}
+	}
+
+	if( use_tcp ) {
+		return sendTCPUpdate( cmd, ad1, ad2, NULL, nonblocking, callback_fn, miscdata );
+	}
+	return sendUDPUpdate( cmd, ad1, ad2, nonblocking, callback_fn, miscdata );
+}
+
+
+bool
+DCCollector::sendUpdateBatch( DCCollectorUpdateBatch& batch, DCCollectorAdSequences& adSeq, bool nonblocking, StartCommandCallbackType callback_fn, void *miscdata )
+{
+	if( ! _is_configured || batch.empty() ) {
+			// nothing to do, treat it as success...
+		return true;
+	}
+
+	if( ! use_tcp ) {
+			// A batch of ads is too big for a UDP message, so send
+			// them one at a time.  The callback only wants to hear
+			// about the first.
+		bool success = true;
+		for (auto & update : batch) {
+			if ( ! sendUpdate(update.cmd, update.ad1, adSeq, update.ad2, nonblocking, callback_fn, miscdata)) {
+				success = false;
+			}
+			callback_fn = nullptr;
+			miscdata = nullptr;
+		}
+		return success;
+	}
+
+	if(!use_nonblocking_update || !daemonCore) {
+		nonblocking = false;
+	}
+
+	for (auto & update : batch) {
+		prepareUpdate(update.ad1, adSeq, update.ad2);
+	}
+
+	if ( ! checkUpdatePort(callback_fn, miscdata)) {
+		return false;
+	}
+
+	return sendTCPUpdate( UPDATE_AD_BATCH, NULL, NULL, &batch, nonblocking, callback_fn, miscdata );
+}
+
+
+void
+DCCollector::prepareUpdate( ClassAd* ad1, DCCollectorAdSequences& adSeq, ClassAd* ad2 )
+{
 	// Add start time & seq # to the ads before we publish 'em
 	if ( ad1 ) {
 		ad1->Assign(ATTR_DAEMON_START_TIME, startTime);
@@ -320,7 +403,12 @@ DCCollector::sendUpdate( int cmd, ClassAd* ad1, DCCollectorAdSequences& adSeq, C
 	if ( ad1 && ad2 ) {
 		CopyAttribute(ATTR_MY_ADDRESS,*ad2,*ad1);
 	}
+}
 
+
+bool
+DCCollector::checkUpdatePort( StartCommandCallbackType callback_fn, void *miscdata )
+{
 		// We never want to try sending an update to port 0.  If we're
 		// about to try that, and we're trying to talk to a local
 		// collector, we should try re-reading the address file and
@@ -347,45 +435,13 @@ DCCollector::sendUpdate( int cmd, ClassAd* ad1, DCCollectorAdSequences& adSeq, C
 		}
 		return false;
 	}
-
-	//
-	// We don't want the collector to send TCP updates to itself, since
-	// this could cause it to deadlock.  Since the only ad a collector
-	// will ever advertise is its own, only check for *_COLLECTOR_ADS.
-	//
-	if( cmd == UPDATE_COLLECTOR_AD || cmd == INVALIDATE_COLLECTOR_ADS ) {
-		if( daemonCore ) {
-			const char * myOwnSinful = daemonCore->InfoCommandSinfulString();
-			if( myOwnSinful == NULL ) {
-				dprintf( D_ALWAYS, "Unable to determine my own address, will not update or invalidate collector ad to avoid potential deadlock.\n" );
-				if (callback_fn) {
-					(*callback_fn)(false, nullptr, nullptr, "", false, miscdata);
-				}
-				return false;
-			}
-			if( _addr == NULL ) {
-				dprintf( D_ALWAYS, "Failing attempt to update or invalidate collector ad because of missing daemon address (probably an unresolved hostname; daemon name is '%s').\n", _name );
-				if (callback_fn) {
-					(*callback_fn)(false, nullptr, nullptr, "", false, miscdata);
-				}
-				return false;
-			}
-			if( strcmp( myOwnSinful, _addr ) == 0 ) {
-				EXCEPT( "Collector attempted to send itself an update.\n" );
-			}
-		}
-	}
-
-	if( use_tcp ) {
-		return sendTCPUpdate( cmd, ad1, ad2, nonblocking, callback_fn, miscdata );
-	}
-	return sendUDPUpdate( cmd, ad1, ad2, nonblocking, callback_fn, miscdata );
+	return true;
 }
 
 
 
 bool
-DCCollector::finishUpdate( DCCollector *self, Sock* sock, ClassAd* ad1, ClassAd* ad2, StartCommandCallbackType callback_fn, void *miscdata )
+DCCollector::finishUpdate( DCCollector *self, Sock* sock, ClassAd* ad1, ClassAd* ad2, const DCCollectorUpdateBatch* batch, StartCommandCallbackType callback_fn, void *miscdata )
 {
 		// Only send secrets in the case where
 		// the collector has been build since 8.9.3 and understands not
@@ -411,6 +467,12 @@ DCCollector::finishUpdate( DCCollector *self, Sock* sock, ClassAd* ad1, ClassAd*
 	// longevity of the DCCollector instance.
 
 	sock->encode();
+	if( batch && ! putUpdateBatch(self, sock, *batch, options) ) {
+		if (callback_fn) {
+			(*callback_fn)(false, sock, nullptr, sock->getTrustDomain(), sock->shouldTryTokenRequest(), miscdata);
+		}
+		return false;
+	}
 	if( ad1 && ! putClassAd(sock, *ad1, options) ) {
 		if(self) {
 			self->newError( CA_COMMUNICATION_ERROR,
@@ -442,12 +504,94 @@ DCCollector::finishUpdate( DCCollector *self, Sock* sock, ClassAd* ad1, ClassAd*
 		}
 		return false;
 	}
+	if( batch && ! getUpdateBatchResults(self, sock, *batch) ) {
+		if (callback_fn) {
+			(*callback_fn)(false, sock, nullptr, sock->getTrustDomain(), sock->shouldTryTokenRequest(), miscdata);
+		}
+		return false;
+	}
 	if (callback_fn) {
 		(*callback_fn)(true, sock, nullptr, sock->getTrustDomain(), sock->shouldTryTokenRequest(), miscdata);
 	}
 	return true;
 }
 
+// Send the updates of an UPDATE_AD_BATCH: the number of them, then for
+// each its command, the number of ads, and the ads.
+bool
+DCCollector::putUpdateBatch( DCCollector *self, Sock* sock, const DCCollectorUpdateBatch& batch, int options )
+{
+	int num_updates = (int)batch.size();
+	if( ! sock->put(num_updates) ) {
+		if(self) {
+			self->newError( CA_COMMUNICATION_ERROR,
+			                "Failed to send batch size to collector" );
+		}
+		return false;
+	}
+	for (auto & update : batch) {
+		int num_ads = update.ad2 ? 2 : 1;
+		if( ! sock->put(update.cmd) || ! sock->put(num_ads) ||
+			! putClassAd(sock, *update.ad1, options) ||
+			(update.ad2 && ! putClassAd(sock, *update.ad2, 0)) )
+		{
+			if(self) {
+				self->newError( CA_COMMUNICATION_ERROR,
+				                "Failed to send batched ClassAd to collector" );
+			}
+			return false;
+		}
+	}
+	return true;
+}
+
+// Get the collector's answer to an UPDATE_AD_BATCH, and log the updates
+// it didn't take.
+bool
+DCCollector::getUpdateBatchResults( DCCollector *self, Sock* sock, const DCCollectorUpdateBatch& batch )
+{
+	if( sock->type() != Stream::reli_sock ) {
+			// no answer on UDP
+		return true;
+	}
+	int num_updates = (int)batch.size();
+	sock->decode();
+	int num_results = 0;
+	if( ! sock->get(num_results) || num_results != num_updates ) {
+		if(self) {
+			self->newError( CA_COMMUNICATION_ERROR,
+			                "Failed to get batch results from collector" );
+		}
+		return false;
+	}
+	for (int ix = 0; ix < num_results; ix++) {
+		int result = 0;
+		if( ! sock->get(result) ) {
+			if(self) {
+				self->newError( CA_COMMUNICATION_ERROR,
+				                "Failed to get batch results from collector" );
+			}
+			return false;
+		}
+		if( ! result ) {
+			std::string name;
+			batch[ix].ad1->LookupString(ATTR_NAME, name);
+			dprintf( D_ALWAYS, "Collector %s did not take update %d (%s) for %s\n",
+					 sock->get_sinful_peer(), ix, getCollectorCommandString(batch[ix].cmd),
+					 name.c_str() );
+		}
+	}
+	if( ! sock->end_of_message() ) {
+		if(self) {
+			self->newError( CA_COMMUNICATION_ERROR,
+			                "Failed to get EOM of batch results from collector" );
+		}
+		return false;
+	}
+	sock->encode();
+	return true;
+}
+
 class UpdateData {
 
 private:
@@ -456,11 +600,12 @@ private:
 public:
 	ClassAd *ad1;
 	ClassAd *ad2;
+	DCCollectorUpdateBatch batch;	// copies of the ads, for UPDATE_AD_BATCH
 	DCCollector *dc_collector;
 	StartCommandCallbackType *m_callback_fn{nullptr};
 	void *m_miscdata{nullptr};
 
-	UpdateData(int ad_cmd, Stream::stream_type stype, ClassAd *cad1, ClassAd *cad2, DCCollector *dc_collect, StartCommandCallbackType *callback_fn, void *miscdata)
+	UpdateData(int ad_cmd, Stream::stream_type stype, ClassAd *cad1, ClassAd *cad2, const DCCollectorUpdateBatch *cbatch, DCCollector *dc_collect, StartCommandCallbackType *callback_fn, void *miscdata)
 	  : cmd(ad_cmd),
 	    sock_type(stype),
 	    ad1(cad1 ? new ClassAd(*cad1) : NULL),
@@ -469,6 +614,13 @@ public:
 	    m_callback_fn(callback_fn),
 	    m_miscdata(miscdata)
 	{
+		if (cbatch) {
+			for (auto & update : *cbatch) {
+				batch.push_back({update.cmd, new ClassAd(*update.ad1),
+					update.ad2 ? new ClassAd(*update.ad2) : NULL});
+			}
+		}
+
 			// In case the collector object gets destructed before this
 			// update is finished, we need to register ourselves with
 			// the dc_collector object so that it can null out our
@@ -481,6 +633,10 @@ public:
 	~UpdateData() {
 		delete ad1;
 		delete ad2;
+		for (auto & update : batch) {
+			delete update.ad1;
+			delete update.ad2;
+		}
 			// Remove ourselves from the dc_collector's list.
 		if(dc_collector) {
 			std::deque<UpdateData *>::iterator iter = std::find(dc_collector->pending_update_list.begin(), dc_collector->pending_update_list.end(), this);
@@ -491,6 +647,10 @@ public:
 		}
 	}
 
+	const DCCollectorUpdateBatch *getBatch() const {
+		return (cmd == UPDATE_AD_BATCH) ? &batch : NULL;
+	}
+
 	void DCCollectorGoingAway() {
 			// The DCCollector object is being deleted.  We don't
 			// need it in order to finish the update.  We only keep
@@ -530,7 +690,7 @@ public:
 				ud = 0;	
 			}
 		}
-		else if(sock && !DCCollector::finishUpdate(ud->dc_collector,sock,ud->ad1,ud->ad2, ud->m_callback_fn, ud->m_miscdata)) {
+		else if(sock && !DCCollector::finishUpdate(ud->dc_collector,sock,ud->ad1,ud->ad2,ud->getBatch(), ud->m_callback_fn, ud->m_miscdata)) {
 			char const *who = "unknown";
 			if(sock) who = sock->get_sinful_peer();
 			dprintf(D_ALWAYS,"Failed to send non-blocking update to %s.\n",who);
@@ -577,7 +737,7 @@ public:
 					// I don't think mixing TCP/UDP to the same collector is supported, so
 					// I believe this shortcut acceptable.
 				if (!dc_collector->update_rsock->put( ud->cmd ) ||
-					!DCCollector::finishUpdate(ud->dc_collector,dc_collector->update_rsock,ud->ad1,ud->ad2,ud->m_callback_fn,ud->m_miscdata))
+					!DCCollector::finishUpdate(ud->dc_collector,dc_collector->update_rsock,ud->ad1,ud->ad2,ud->getBatch(),ud->m_callback_fn,ud->m_miscdata))
 				{
 					char const *who = "unknown";
 					if(dc_collector->update_rsock) {
@@ -630,7 +790,7 @@ DCCollector::sendUDPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblockin
 	}
 
 	if(nonblocking) {
-		UpdateData *ud = new UpdateData(cmd, Sock::safe_sock, ad1, ad2, this, callback_fn, miscdata);
+		UpdateData *ud = new UpdateData(cmd, Sock::safe_sock, ad1, ad2, NULL, this, callback_fn, miscdata);
 		if (this->pending_update_list.size() == 1)
 		{
 			startCommand_nonblocking(cmd, Sock::safe_sock, 20, NULL, UpdateData::startUpdateCallback, ud, NULL, raw_protocol );
@@ -649,7 +809,7 @@ DCCollector::sendUDPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblockin
 		return false;
 	}
 
-	bool success = finishUpdate( this, ssock, ad1, ad2, callback_fn, miscdata );
+	bool success = finishUpdate( this, ssock, ad1, ad2, NULL, callback_fn, miscdata );
 	delete ssock;
 
 	return success;
@@ -657,7 +817,7 @@ DCCollector::sendUDPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblockin
 
 
 bool
-DCCollector::sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblocking, StartCommandCallbackType callback_fn, void *miscdata )
+DCCollector::sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, const DCCollectorUpdateBatch* batch, bool nonblocking, StartCommandCallbackType callback_fn, void *miscdata )
 {
 	dprintf( D_FULLDEBUG,
 			 "Attempting to send update via TCP to collector %s\n",
@@ -673,7 +833,7 @@ DCCollector::sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblockin
 			// update at the same time.  if the security API changes
 			// in the future, we'll be able to make this code a little
 			// more straight-forward...
-		return initiateTCPUpdate( cmd, ad1, ad2, nonblocking, callback_fn, miscdata );
+		return initiateTCPUpdate( cmd, ad1, ad2, batch, nonblocking, callback_fn, miscdata );
 	}
 
 		// otherwise, we've already got our socket, it's connected,
@@ -692,7 +852,7 @@ DCCollector::sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblockin
 		// finishUpdate to prevent both finishUpdate and initiateUpdate from invoking the
 		// callback function in the case we need to create a new connection.
 	update_rsock->encode();
-	if (update_rsock->put(cmd) && finishUpdate(this, update_rsock, ad1, ad2, nullptr, nullptr)) {
+	if (update_rsock->put(cmd) && finishUpdate(this, update_rsock, ad1, ad2, batch, nullptr, nullptr)) {
 		if (callback_fn) {
 			(*callback_fn)(true, update_rsock, nullptr, update_rsock->getTrustDomain(), update_rsock->shouldTryTokenRequest(), miscdata);
 		}
@@ -703,20 +863,20 @@ DCCollector::sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblockin
 			 "starting new connection\n" );
 	delete update_rsock;
 	update_rsock = NULL;
-	return initiateTCPUpdate( cmd, ad1, ad2, nonblocking, callback_fn, miscdata );
+	return initiateTCPUpdate( cmd, ad1, ad2, batch, nonblocking, callback_fn, miscdata );
 }
 
 
 
 bool
-DCCollector::initiateTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblocking, StartCommandCallbackType *callback_fn, void *miscdata )
+DCCollector::initiateTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, const DCCollectorUpdateBatch* batch, bool nonblocking, StartCommandCallbackType *callback_fn, void *miscdata )
 {
 	if( update_rsock ) {
 		delete update_rsock;
 		update_rsock = NULL;
 	}
 	if(nonblocking) {
-		UpdateData *ud = new UpdateData(cmd, Sock::reli_sock, ad1, ad2, this, callback_fn, miscdata);
+		UpdateData *ud = new UpdateData(cmd, Sock::reli_sock, ad1, ad2, batch, this, callback_fn, miscdata);
 			// Note that UpdateData automatically adds itself to the pending_update_list.
 		if (this->pending_update_list.size() == 1)
 		{
@@ -737,7 +897,7 @@ DCCollector::initiateTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblo
 		return false;
 	}
 	update_rsock = (ReliSock *)sock;
-	return finishUpdate( this, update_rsock, ad1, ad2, callback_fn, miscdata );
+	return finishUpdate( this, update_rsock, ad1, ad2, batch, callback_fn, miscdata );
 }
 
 
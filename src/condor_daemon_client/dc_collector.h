@@ -30,6 +30,7 @@
 
 #include <deque>
 #include <map>
+#include <vector>
 
 // This holds a single update ad sequence number
 //
@@ -58,6 +59,16 @@ private:
 };
 
 
+// One of the updates sent together by DCCollector::sendUpdateBatch().
+// The caller keeps ownership of the ads.
+struct DCCollectorUpdate {
+	int cmd;
+	ClassAd *ad1;
+	ClassAd *ad2;	// the private ad of a startd, or NULL
+};
+typedef std::vector<DCCollectorUpdate> DCCollectorUpdateBatch;
+
+
 /** This is the Collector-specific class derived from Daemon.  It
 	implements some of the collectors's daemonCore command interface.  
 	For now, it handles sending updates to the collector, so that we
@@ -94,6 +105,14 @@ public:
 		*/
 	bool sendUpdate( int cmd, ClassAd* ad1, DCCollectorAdSequences& seq, ClassAd* ad2, bool nonblocking, StartCommandCallbackType=nullptr, void *miscdata=nullptr );
 
+		/** Send a number of updates to this collector in one
+			UPDATE_AD_BATCH message, so the collector handles them all in
+			one command.  The collector sends back whether it took each
+			one, and any it didn't are logged.  Batches are only sent
+			over TCP; with UDP, the updates are sent one at a time.
+		*/
+	bool sendUpdateBatch( DCCollectorUpdateBatch& batch, DCCollectorAdSequences& seq, bool nonblocking, StartCommandCallbackType=nullptr, void *miscdata=nullptr );
+
 	void reconfig( void );
 
 	const char* updateDestination( void );
@@ -129,15 +148,21 @@ private:
 	std::deque<class UpdateData*> pending_update_list;
 	friend class UpdateData;
 
-	bool sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblocking, StartCommandCallbackType callback_fn, void* miscdata );
+	void prepareUpdate( ClassAd* ad1, DCCollectorAdSequences& seq, ClassAd* ad2 );
+	bool checkUpdatePort( StartCommandCallbackType callback_fn, void *miscdata );
+
+		// For UPDATE_AD_BATCH, ad1 and ad2 are NULL and batch has the updates
+	bool sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, const DCCollectorUpdateBatch* batch, bool nonblocking, StartCommandCallbackType callback_fn, void* miscdata );
 	bool sendUDPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblocking, StartCommandCallbackType callback_fn, void *miscdata );
 
-	static bool finishUpdate( DCCollector *self, Sock* sock, ClassAd* ad1, ClassAd* ad2, StartCommandCallbackType callback_fn, void *miscdata );
+	static bool finishUpdate( DCCollector *self, Sock* sock, ClassAd* ad1, ClassAd* ad2, const DCCollectorUpdateBatch* batch, StartCommandCallbackType callback_fn, void *miscdata );
+	static bool putUpdateBatch( DCCollector *self, Sock* sock, const DCCollectorUpdateBatch& batch, int options );
+	static bool getUpdateBatchResults( DCCollector *self, Sock* sock, const DCCollectorUpdateBatch& batch );
 
 	void parseTCPInfo( void );
 	void initDestinationStrings( void );
 
-	bool initiateTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblocking, StartCommandCallbackType callback_fn, void *miscdata );
+	bool initiateTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, const DCCollectorUpdateBatch* batch, bool nonblocking, StartCommandCallbackType callback_fn, void *miscdata );
 
 	char* update_destination;
 
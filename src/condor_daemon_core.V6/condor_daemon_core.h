@@ -75,6 +75,7 @@ class ProcFamilyInterface;
 
 template <class Key, class Value> class HashTable; // forward declaration
 class Probe;
+class EpollSelector;
 
 #define USE_MIRON_PROBE_FOR_DC_RUNTIME_STATS
 
@@ -1631,6 +1632,15 @@ class DaemonCore : public Service
 		DCTokenRequester *requester = nullptr, const std::string &identity = "",
 		const std::string &authz_name = "");
 
+		/**
+		   Like sendUpdates(), but send a number of updates together,
+		   in one message to each collector that takes batches.
+		   @return The number of collectors successfully updated.
+		*/
+	int sendUpdateBatch(std::vector<DCCollectorUpdate> &batch, bool nonblock = false,
+		DCTokenRequester *requester = nullptr, const std::string &identity = "",
+		const std::string &authz_name = "");
+
 	DCCollectorAdSequences & getUpdateAdSeq() { return m_collector_list->getAdSeq(); }
 
 	time_t getStartTime() const {return m_startup_time;}
@@ -2012,6 +2022,10 @@ class DaemonCore : public Service
 	int               nPendingSockets; // number of sockets waiting on timers or any other callbacks
 	std::vector<SockEnt> sockTable; // socket table; grows dynamically if needed
 
+		// The fds we are waiting on, kept between calls to Driver() so
+		// only the changes go to the kernel.  NULL if we use select().
+	EpollSelector	*m_epoll;
+
 		// number of file descriptors in use past which we should start
 		// avoiding the creation of new persistent sockets.  Do not use
 		// this value directly.  Call FileDescriptorSafetyLimit().
@@ -2268,6 +2282,10 @@ class DaemonCore : public Service
 	bool evalExpr( ClassAd* ad, const char* param_name,
 				   const char* attr_name, const char* message );
 
+		// Check DAEMON_SHUTDOWN and DAEMON_SHUTDOWN_FAST against an
+		// ad we are about to send to the collectors.
+	void checkDaemonShutdown( ClassAd* ad );
+
 	CollectorList* m_collector_list;
 
 		/**
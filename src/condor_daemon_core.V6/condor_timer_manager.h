@@ -33,6 +33,9 @@
 #include "dc_service.h"
 #include "condor_timeslice.h"
 
+#include <unordered_map>
+#include <vector>
+
 #ifdef WIN32
 #include <time.h>
 #else
@@ -83,7 +86,8 @@ struct tagTimer {
     /** Not_Yet_Documented */ TimerHandler             handler;
     /** Not_Yet_Documented */ TimerHandlercpp          handlercpp;
     /** Not_Yet_Documented */ class Service*    service; 
-    /** Not_Yet_Documented */ struct tagTimer*  next;
+    /** Index in TimerManager's heap */ size_t   heap_index;
+    /** Orders timers with the same when */ uint64_t sequence;
     /** Not_Yet_Documented */ char*             event_descrip;
     /** Not_Yet_Documented */ void*             data_ptr;
     /** Not_Yet_Documented */ Timeslice *       timeslice;
@@ -249,19 +253,29 @@ class TimerManager
                   unsigned   period          =  0,
 				  const Timeslice *timeslice = NULL);
 
-	void RemoveTimer( Timer *timer, Timer *prev );
+	void RemoveTimer( Timer *timer );
 	void InsertTimer( Timer *new_timer );
 	void DeleteTimer( Timer *timer );
 
 	/*
 	  @param id The id of the timer to find
-	  @param prev If not NULL, this will be set to previous timer in list
 	  @return pointer to timer with specified id or NULL if not found
 	 */
-	Timer *GetTimer( int id, Timer **prev );
+	Timer *GetTimer( int id );
+
+	// The timers that are due by now, soonest first
+	void GetReadyTimers( time_t now, std::vector<Timer*> &ready );
+
+	// Restore the heap order around the timer at index ix
+	void SiftUp( size_t ix );
+	void SiftDown( size_t ix );
 
-    Timer*  timer_list;
-	Timer*  list_tail;
+	// Pending timers, as a binary min-heap on (when, sequence), so
+	// timer_heap[0] is always the next one to run.  Each timer knows
+	// its own index in the heap, so it can be removed without a search.
+	std::vector<Timer*> timer_heap;
+	std::unordered_map<int, Timer*> timer_map;   // by id
+	uint64_t timer_sequence;
     int     timer_ids;
     Timer*  in_timeout;
     bool    did_reset;
@@ -44,6 +44,7 @@ static const int DC_PIPE_BUF_SIZE = 65536;
 
 #include "authentication.h"
 #include "daemon.h"
+#include "dc_collector.h"
 #include "reli_sock.h"
 #include "condor_daemon_core.h"
 #include "condor_io.h"
@@ -79,6 +80,7 @@ CRITICAL_SECTION Big_fat_mutex; // coarse grained mutex for debugging purposes
 
 #include "HashTable.h"
 #include "selector.h"
+#include "epoll_selector.h"
 #include "proc_family_interface.h"
 #include "condor_netdb.h"
 #include "util_lib_proto.h"
@@ -411,6 +413,8 @@ DaemonCore::DaemonCore(int ComSize,int SigSize,
 
 	m_refresh_dns_timer = -1;
 
+	m_epoll = NULL;
+
 	m_ccb_listeners = NULL;
 	m_shared_port_endpoint = NULL;
 	nRegisteredSocks = 0;
@@ -474,6 +478,8 @@ DaemonCore::~DaemonCore()
 		free( sockEnt.handler_descrip );
 		}
 
+	delete m_epoll;
+
 	delete sec_man;
 
 	// Since we created these, we need to clean them up.
@@ -1810,6 +1816,13 @@ int DaemonCore::Cancel_Socket( Stream* insock, void *prev_entry)
 	if ( curr_dataptr == &( sockTable[i].data_ptr) )
 		curr_dataptr = NULL;
 
+	// Stop watching the fd now, since the caller may close it as soon
+	// as we return.  If there was a previous entry for this socket, the
+	// Driver will pick it up again.
+	if ( m_epoll ) {
+		m_epoll->forget_fd( ((Sock *)insock)->get_file_desc() );
+	}
+
 	if (sockTable[i].servicing_tid == 0 ||
 		sockTable[i].servicing_tid == CondorThreads::get_handle()->get_tid() || prev_entry)
 	{
@@ -2209,6 +2222,13 @@ int DaemonCore::Cancel_Pipe( int pipe_end )
 			"Cancel_Pipe: cancelled pipe end %d <%s> (entry=%zu)\n",
 			pipe_end,pipeTable[i].pipe_descrip, i );
 
+#ifndef WIN32
+	// Stop watching the fd, since Close_Pipe() is about to close it
+	if ( m_epoll ) {
+		m_epoll->forget_fd( pipeHandleTable[index] );
+	}
+#endif
+
 	// mark entry unused
 	pipeTable[i].index = -1;
 	free(pipeTable[i].pipe_descrip );
@@ -3355,6 +3375,21 @@ void DaemonCore::Driver()
 		dprintf( D_ALWAYS, "Done with stdout & stderr tests\n" );
 	}
 
+#ifdef CONDOR_HAVE_EPOLL
+		// With epoll, the set of fds we wait on persists from one pass
+		// through the loop to the next, so a wakeup costs nothing for
+		// the fds that aren't ready.  Selector is the fallback.
+	if ( ! m_epoll && param_boolean( "DAEMON_CORE_USE_EPOLL", true ) ) {
+		m_epoll = new EpollSelector;
+		if ( ! m_epoll->init() ) {
+			delete m_epoll;
+			m_epoll = NULL;
+		}
+	}
+#endif
+	dprintf( D_FULLDEBUG, "DaemonCore: waiting for events with %s\n",
+			 m_epoll ? "epoll" : "select" );
+
 	double runtime = _condor_debug_get_time_double();
 	double group_runtime = runtime;
     double pump_cycle_begin_time = runtime;
@@ -3458,103 +3493,132 @@ void DaemonCore::Driver()
 		// Setup what socket descriptors to select on.  We recompute this
 		// every time because 1) some timeout handler may have removed/added
 		// sockets, and 2) it ain't that expensive....
-		selector.reset();
-		min_deadline = 0;
-		for (auto & sockEnt : sockTable) {
-				// NOTE: keep the following logic for building the
-				// fdset in sync with DaemonCore::ServiceCommandSocket()
-
-				// if a valid entry not already being serviced, add to select
-			if ( sockEnt.iosock && 
-				 sockEnt.servicing_tid==0 &&
-				 sockEnt.remove_asap == false ) {	
-					// Setup our fdsets
-				if ( sockEnt.is_reverse_connect_pending ) {
-					// nothing to do; we are just allowing this socket
-					// to be registered so that it behaves like a socket
-					// that is doing a non-blocking connect
-					// CCBClient will eventually ensure that the
-					// socket's registered callback function is called
-					// We want to ignore the socket's deadline (below)
-					// because that is all taken care of by CCBClient.
+		// With epoll, only the fds whose interest changed since the last
+		// time through cost a system call.
+		auto watch_fd = [&]( int fd, int interests, int tag ) {
+			if ( m_epoll ) {
+				m_epoll->set_interest( fd, interests, tag );
+				return;
+			}
+			if ( interests & EpollSelector::WANT_READ ) {
+				selector.add_fd( fd, Selector::IO_READ );
+			}
+			if ( interests & EpollSelector::WANT_WRITE ) {
+				selector.add_fd( fd, Selector::IO_WRITE );
+			}
+			if ( interests & EpollSelector::WANT_EXCEPT ) {
+				selector.add_fd( fd, Selector::IO_EXCEPT );
+			}
+		};
+		auto handler_interests = []( HandlerType handler_type ) {
+			switch( handler_type ) {
+			case HANDLE_READ:
+				return (int)EpollSelector::WANT_READ;
+			case HANDLE_WRITE:
+				return (int)EpollSelector::WANT_WRITE;
+			case HANDLE_READ_WRITE:
+				return EpollSelector::WANT_READ | EpollSelector::WANT_WRITE;
+			default:
+				return 0;
+			}
+		};
+
+		auto watch_all = [&]() {
+			selector.reset();
+			min_deadline = 0;
+			for (size_t si = 0; si < sockTable.size(); si++) {
+				SockEnt & sockEnt = sockTable[si];
+					// NOTE: keep the following logic for building the
+					// fdset in sync with DaemonCore::ServiceCommandSocket()
+
+					// skip empty entries, and cancelled ones, whose socket
+					// may be gone.  Cancel_Socket() stopped watching their fds.
+				if ( ! sockEnt.iosock || sockEnt.remove_asap ) {
 					continue;
 				}
-				else if ( sockEnt.is_connect_pending ) {
-						// we want to be woken when a non-blocking
-						// connect is ready to write.  when connect
-						// is ready, select will set the writefd set
-						// on success, or the exceptfd set on failure.
-					selector.add_fd( sockEnt.iosock->get_file_desc(), Selector::IO_WRITE );
-					selector.add_fd( sockEnt.iosock->get_file_desc(), Selector::IO_EXCEPT );
-				} else {
-					int sockfd = sockEnt.iosock->get_file_desc();
-					switch( sockEnt.handler_type ) {
-					case HANDLE_READ:
-						selector.add_fd( sockfd, Selector::IO_READ );
-						break;
-					case HANDLE_WRITE:
-						selector.add_fd( sockfd, Selector::IO_WRITE );
-						break;
-					case HANDLE_READ_WRITE:
-						selector.add_fd( sockfd, Selector::IO_READ );
-						selector.add_fd( sockfd, Selector::IO_WRITE );
-						break;
+				int sockfd = sockEnt.iosock->get_file_desc();
+				int interests = 0;
+
+					// if a valid entry not already being serviced, add to select
+				if ( sockEnt.servicing_tid==0 ) {
+						// Setup our fdsets
+					if ( sockEnt.is_reverse_connect_pending ) {
+						// nothing to do; we are just allowing this socket
+						// to be registered so that it behaves like a socket
+						// that is doing a non-blocking connect
+						// CCBClient will eventually ensure that the
+						// socket's registered callback function is called
+						// We want to ignore the socket's deadline (below)
+						// because that is all taken care of by CCBClient.
 					}
-				}
+					else {
+						if ( sockEnt.is_connect_pending ) {
+								// we want to be woken when a non-blocking
+								// connect is ready to write.  when connect
+								// is ready, select will set the writefd set
+								// on success, or the exceptfd set on failure.
+							interests = EpollSelector::WANT_WRITE | EpollSelector::WANT_EXCEPT;
+						} else {
+							interests = handler_interests( sockEnt.handler_type );
+						}
 
-					// If this socket times out sooner than
-					// our select timeout, adjust the select timeout.
-				time_t deadline = sockEnt.iosock->get_deadline();
-				if(deadline) { // If non-zero, there is a timeout.
-					if(min_deadline == 0 || min_deadline > deadline) {
-						min_deadline = deadline;
+							// If this socket times out sooner than
+							// our select timeout, adjust the select timeout.
+						time_t deadline = sockEnt.iosock->get_deadline();
+						if(deadline) { // If non-zero, there is a timeout.
+							if(min_deadline == 0 || min_deadline > deadline) {
+								min_deadline = deadline;
+							}
+						}
 					}
 				}
-            }
-		}
+				if ( sockfd != -1 ) {
+					watch_fd( sockfd, interests, (int)si );
+				}
+			}
 
-		if( min_deadline ) {
-			int deadline_timeout = min_deadline - time(NULL) + 1;
-			if(deadline_timeout < timeout) {
-				if(deadline_timeout < 0) deadline_timeout = 0;
-				timeout = deadline_timeout;
+			if( min_deadline ) {
+				int deadline_timeout = min_deadline - time(NULL) + 1;
+				if(deadline_timeout < timeout) {
+					if(deadline_timeout < 0) deadline_timeout = 0;
+					timeout = deadline_timeout;
+				}
 			}
-		}
 
 #if !defined(WIN32)
-		// Add the registered pipe fds into the list of descriptors to
-		// select on.
-		for (i = 0; i < (int)pipeTable.size(); i++) {
-			if ( pipeTable[i].index != -1 ) {	// if a valid entry....
-				int pipefd = pipeHandleTable[pipeTable[i].index];
-				switch( pipeTable[i].handler_type ) {
-				case HANDLE_READ:
-					selector.add_fd( pipefd, Selector::IO_READ );
-					break;
-				case HANDLE_WRITE:
-					selector.add_fd( pipefd, Selector::IO_WRITE );
-					break;
-				case HANDLE_READ_WRITE:
-					selector.add_fd( pipefd, Selector::IO_READ );
-					selector.add_fd( pipefd, Selector::IO_WRITE );
-					break;
+			// Add the registered pipe fds into the list of descriptors to
+			// select on.
+			for (i = 0; i < (int)pipeTable.size(); i++) {
+				if ( pipeTable[i].index != -1 ) {	// if a valid entry....
+					int pipefd = pipeHandleTable[pipeTable[i].index];
+					watch_fd( pipefd, handler_interests( pipeTable[i].handler_type ), -1 );
 				}
 			}
-        }
 #endif
 
 
-		// Add the read side of async_pipe to the list of file descriptors to
-		// select on.  We write to async_pipe if a unix async signal
-		// is delivered after we unblock signals and before we block on select.
+			// Add the read side of async_pipe to the list of file descriptors to
+			// select on.  We write to async_pipe if a unix async signal
+			// is delivered after we unblock signals and before we block on select.
 #ifdef WIN32
-		if ( ! async_pipe[0].is_connected()) {
-			EXCEPT("DaemonCore:: async_pipe has been unexpectedly closed!");
-		} 
-		selector.add_fd( async_pipe[0].get_file_desc() , Selector::IO_READ );
+			if ( ! async_pipe[0].is_connected()) {
+				EXCEPT("DaemonCore:: async_pipe has been unexpectedly closed!");
+			} 
+			selector.add_fd( async_pipe[0].get_file_desc() , Selector::IO_READ );
 #else
-		selector.add_fd( async_pipe[0], Selector::IO_READ );
+			watch_fd( async_pipe[0], EpollSelector::WANT_READ, -1 );
 #endif
+		};
+
+		watch_all();
+		if ( m_epoll && ! m_epoll->usable() ) {
+				// the kernel refused one of our fds, or we are a forked
+				// child.  Either way, start over with a Selector.
+			dprintf( D_ALWAYS, "DaemonCore: epoll is no longer usable, using select instead\n" );
+			delete m_epoll;
+			m_epoll = NULL;
+			watch_all();
+		}
 
 		// Let other threads run while we are waiting on select
 		CondorThreads::enable_parallel(true);
@@ -3574,7 +3638,11 @@ void DaemonCore::Driver()
 		LeaveCriticalSection(&Big_fat_mutex);
 #endif
 
-		selector.set_timeout( timeout );
+		if ( m_epoll ) {
+			m_epoll->set_timeout( timeout );
+		} else {
+			selector.set_timeout( timeout );
+		}
 
 		errno = 0;
 		time_t time_before = time(NULL);
@@ -3587,17 +3655,34 @@ void DaemonCore::Driver()
 			dprintf(D_PERF_TRACE, "PERF: entering select. timeout=%lld\n", (long long)timeout);
 		}
 
-		selector.execute();
+		if ( m_epoll ) {
+			m_epoll->execute();
+		} else {
+			selector.execute();
+		}
 
 		// update statistics on time spent waiting in select.
 		runtime = _condor_debug_get_time_double();
 		dc_stats.SelectWaittime += (runtime - group_runtime);
 		//dc_stats.StatsLifetime = now - dc_stats.InitTime;
 
-		tmpErrno = errno;
+		tmpErrno = m_epoll ? m_epoll->select_errno() : errno;
 
 		CheckForTimeSkip(time_before, okay_delta);
 
+		auto fd_ready = [&]( int fd, Selector::IO_FUNC interest ) {
+			return m_epoll ? m_epoll->fd_ready( fd, interest ) : selector.fd_ready( fd, interest );
+		};
+		auto display_selector = [&]() {
+			if ( m_epoll ) {
+				m_epoll->display();
+			} else {
+				selector.display();
+			}
+		};
+		bool fds_ready = m_epoll ? m_epoll->has_ready() : selector.has_ready();
+		bool fds_timed_out = m_epoll ? m_epoll->timed_out() : selector.timed_out();
+
 #ifndef WIN32
 		// Unix
 
@@ -3610,12 +3695,12 @@ void DaemonCore::Driver()
 		// set it to FALSE after we block the signals again.
 		async_sigs_unblocked = FALSE;
 
-		if ( selector.failed() ) {
+		if ( m_epoll ? m_epoll->failed() : selector.failed() ) {
 			// not just interrupted by a signal...
 				dprintf(D_ALWAYS,"Socket Table:\n");
         		DumpSocketTable( D_ALWAYS );
 				dprintf(D_ALWAYS,"State of selector:\n");
-				selector.display();
+				display_selector();
 				EXCEPT("DaemonCore: select() returned an unexpected error: %d (%s)",tmpErrno,strerror(tmpErrno));
 		}
 #else
@@ -3659,7 +3744,7 @@ void DaemonCore::Driver()
 			// have questions ask matt.
 		if (IsDebugLevel(D_PERF_TRACE)) {
 			dprintf(D_PERF_TRACE, "PERF: leaving select\n");
-			selector.display();
+			display_selector();
 		}
 
 		// For now, do not let other threads run while we are processing
@@ -3668,8 +3753,8 @@ void DaemonCore::Driver()
 
 		runtime = group_runtime = _condor_debug_get_time_double();
 
-		if ( selector.has_ready() ||
-			 ( selector.timed_out() && 
+		if ( fds_ready ||
+			 ( fds_timed_out && 
 			   min_deadline && min_deadline < time(NULL) ) )
 		{
 			// Either socket activity has happened or a socket
@@ -3687,12 +3772,12 @@ void DaemonCore::Driver()
 			// from this one socket for this daemoncore cycle.
 			bool superuser_command_arrived = false;
 			if (super_dc_rsock &&
-				selector.fd_ready(super_dc_rsock->get_file_desc(), Selector::IO_READ))
+				fd_ready(super_dc_rsock->get_file_desc(), Selector::IO_READ))
 			{
 				superuser_command_arrived = true;
 			}
 			if (super_dc_ssock &&
-				selector.fd_ready(super_dc_ssock->get_file_desc(), Selector::IO_READ))
+				fd_ready(super_dc_ssock->get_file_desc(), Selector::IO_READ))
 			{
 				superuser_command_arrived = true;
 			}
@@ -3700,8 +3785,8 @@ void DaemonCore::Driver()
 				dprintf(D_ALWAYS,"Received a superuser command\n");
 			}
 
-			// scan through the socket table to find which ones select() set
-			for(auto & sockEnt : sockTable) {
+			// figure out if we should call the handler for a socket table entry
+			auto check_sock = [&]( SockEnt & sockEnt ) {
 				if ( sockEnt.iosock && 
 					 sockEnt.servicing_tid==0 &&
 					 sockEnt.remove_asap == false ) 
@@ -3726,9 +3811,9 @@ void DaemonCore::Driver()
 					}
 					else if ( sockEnt.is_connect_pending ) {
 
-						if ( selector.fd_ready( sockEnt.iosock->get_file_desc(),
+						if ( fd_ready( sockEnt.iosock->get_file_desc(),
 												Selector::IO_WRITE ) ||
-							 selector.fd_ready( sockEnt.iosock->get_file_desc(),
+							 fd_ready( sockEnt.iosock->get_file_desc(),
 												Selector::IO_EXCEPT ) ||
 							 sock_timed_out )
 						{
@@ -3744,20 +3829,36 @@ void DaemonCore::Driver()
 							}
 						}
 					} else if (sockEnt.handler_type == HANDLE_READ || sockEnt.handler_type == HANDLE_READ_WRITE) {
-						if ( (selector.fd_ready( sockEnt.iosock->get_file_desc(), Selector::IO_READ ) ) ||
+						if ( (fd_ready( sockEnt.iosock->get_file_desc(), Selector::IO_READ ) ) ||
 							 sock_timed_out )
 						{
 							sockEnt.call_handler = true;
 						}
 					} else if (sockEnt.handler_type == HANDLE_WRITE || sockEnt.handler_type == HANDLE_READ_WRITE) {
-						if ( (selector.fd_ready(sockEnt.iosock->get_file_desc(), Selector::IO_WRITE ) ) ||
+						if ( (fd_ready(sockEnt.iosock->get_file_desc(), Selector::IO_WRITE ) ) ||
 							 sock_timed_out )
 						{
 							sockEnt.call_handler = true;
 						}
 					}
 				}	// end of if valid sock entry
-			}	// end of for loop through all sock entries
+			};
+
+			// With epoll, only the sockets that are ready need a look,
+			// unless some socket's deadline has passed.  Otherwise,
+			// scan through the socket table to find which ones select() set.
+			if ( m_epoll && ! ( min_deadline && min_deadline < now ) ) {
+				for ( int ix = 0; ix < m_epoll->num_ready(); ix++ ) {
+					int si = m_epoll->ready_tag( ix );
+					if ( si >= 0 && si < (int)sockTable.size() ) {
+						check_sock( sockTable[si] );
+					}
+				}
+			} else {
+				for(auto & sockEnt : sockTable) {
+					check_sock( sockEnt );
+				}
+			}
 
 			runtime = _condor_debug_get_time_double();
 			dc_stats.SocketRuntime += (runtime - group_runtime);
@@ -3779,11 +3880,11 @@ void DaemonCore::Driver()
 #else
 					// For Unix, check if select set the bit
 					int pipefd = pipeHandleTable[pipeTable[i].index];
-					if ( selector.fd_ready( pipefd, Selector::IO_READ ) )
+					if ( fd_ready( pipefd, Selector::IO_READ ) )
 					{
 						pipeTable[i].call_handler = true;
 					}
-					if ( selector.fd_ready( pipefd, Selector::IO_WRITE ) )
+					if ( fd_ready( pipefd, Selector::IO_WRITE ) )
 					{
 						pipeTable[i].call_handler = true;
 					}
@@ -10919,18 +11020,7 @@ DaemonCore::sendUpdates( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblock,
 	ASSERT(m_collector_list);
 
 		// Now's our chance to evaluate the DAEMON_SHUTDOWN expressions.
-	if (!m_in_daemon_shutdown_fast &&
-		evalExpr(ad1, "DAEMON_SHUTDOWN_FAST", ATTR_DAEMON_SHUTDOWN_FAST,
-				 "starting fast shutdown"))	{
-			// Daemon wants to quickly shut itself down and not restart.
-		beginDaemonShutdown(true);
-	}
-	else if (!m_in_daemon_shutdown &&
-			 evalExpr(ad1, "DAEMON_SHUTDOWN", ATTR_DAEMON_SHUTDOWN,
-					  "starting graceful shutdown")) {
-			// Daemon wants to gracefully shut itself down and not restart.
-		beginDaemonShutdown(false);
-	}
+	checkDaemonShutdown(ad1);
 
 		// Provide the collector with a capability to administer us.
 	std::string capability;
@@ -10945,6 +11035,45 @@ DaemonCore::sendUpdates( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblock,
 }
 
 
+int
+DaemonCore::sendUpdateBatch( DCCollectorUpdateBatch &batch, bool nonblock,
+	DCTokenRequester *token_requester, const std::string &identity, const std::string &authz_name )
+{
+	ASSERT(m_collector_list);
+
+	std::string capability;
+	bool have_capability = ! batch.empty() && SetupAdministratorSession(1800, capability);
+	for (auto & update : batch) {
+		ASSERT(update.ad1);
+		checkDaemonShutdown(update.ad1);
+		if (have_capability) {
+			update.ad1->InsertAttr(ATTR_REMOTE_ADMIN_CAPABILITY, capability);
+		}
+	}
+
+	return m_collector_list->sendUpdateBatch(batch, nonblock, token_requester,
+		identity, authz_name);
+}
+
+
+void
+DaemonCore::checkDaemonShutdown( ClassAd* ad )
+{
+	if (!m_in_daemon_shutdown_fast &&
+		evalExpr(ad, "DAEMON_SHUTDOWN_FAST", ATTR_DAEMON_SHUTDOWN_FAST,
+				 "starting fast shutdown"))	{
+			// Daemon wants to quickly shut itself down and not restart.
+		beginDaemonShutdown(true);
+	}
+	else if (!m_in_daemon_shutdown &&
+			 evalExpr(ad, "DAEMON_SHUTDOWN", ATTR_DAEMON_SHUTDOWN,
+					  "starting graceful shutdown")) {
+			// Daemon wants to gracefully shut itself down and not restart.
+		beginDaemonShutdown(false);
+	}
+}
+
+
 bool
 DaemonCore::wantsRestart() const
 {
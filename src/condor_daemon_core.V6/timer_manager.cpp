@@ -24,7 +24,7 @@
 #include "condor_debug.h"
 #include "condor_daemon_core.h"
 #include "condor_config.h"
-#include <unordered_set>
+#include <algorithm>
 
 static const char* DEFAULT_INDENT = "DaemonCore--> ";
 
@@ -36,6 +36,18 @@ extern void **curr_regdataptr;
 // disable warning about memory leaks due to exception. all memory freed on exit anyway
 MSC_DISABLE_WARNING(6211)
 
+// The order of the timer heap.  Timers due at the same time run in the
+// order they were scheduled, so that timers that constantly reset
+// themselves to zero take turns.
+static inline bool
+TimerBefore( const Timer *a, const Timer *b )
+{
+	if ( a->when != b->when ) {
+		return a->when < b->when;
+	}
+	return a->sequence < b->sequence;
+}
+
 TimerManager &
 TimerManager::GetTimerManager()
 {
@@ -52,8 +64,7 @@ TimerManager::TimerManager()
 	{
 		EXCEPT("TimerManager object exists!");
 	}
-	timer_list = NULL;
-	list_tail = NULL;
+	timer_sequence = 0;
 	timer_ids = 0;
 	in_timeout = NULL;
 	_t = this; 
@@ -185,7 +196,7 @@ bool TimerManager::ResetTimerTimeslice(int id, Timeslice const &new_timeslice)
 
 bool TimerManager::GetTimerTimeslice(int id, Timeslice &timeslice)
 {
-	Timer *timer_ptr = GetTimer( id, NULL );
+	Timer *timer_ptr = GetTimer( id );
 	if( !timer_ptr || !timer_ptr->timeslice ) {
 		return false;
 	}
@@ -195,7 +206,7 @@ bool TimerManager::GetTimerTimeslice(int id, Timeslice &timeslice)
 
 time_t TimerManager::GetNextRuntime(int id)
 {
-	Timer *timer_ptr = GetTimer( id, NULL );
+	Timer *timer_ptr = GetTimer( id );
 	if (!timer_ptr) { return false; }
 
 	return timer_ptr->when;
@@ -205,22 +216,15 @@ int TimerManager::ResetTimer(int id, unsigned when, unsigned period,
 							 Timeslice const *new_timeslice)
 {
 	Timer*			timer_ptr;
-	Timer*			trail_ptr;
 
 	dprintf( D_DAEMONCORE,
 			 "In reset_timer(), id=%d, time=%d, period=%d\n",id,when,period);
-	if (timer_list == NULL) {
+	if (timer_heap.empty()) {
 		dprintf( D_DAEMONCORE, "Reseting Timer from empty list!\n");
 		return -1;
 	}
 
-	timer_ptr = timer_list;
-	trail_ptr = NULL;
-	while ( timer_ptr && timer_ptr->id != id ) {
-		trail_ptr = timer_ptr;
-		timer_ptr = timer_ptr->next;
-	}
-
+	timer_ptr = GetTimer( id );
 	if ( timer_ptr == NULL ) {
 		dprintf( D_ALWAYS, "Timer %d not found\n",id );
 		return -1;
@@ -278,7 +282,7 @@ int TimerManager::ResetTimer(int id, unsigned when, unsigned period,
 	}
 	timer_ptr->period = period;
 
-	RemoveTimer( timer_ptr, trail_ptr );
+	RemoveTimer( timer_ptr );
 	InsertTimer( timer_ptr );
 
 	if ( in_timeout == timer_ptr ) {
@@ -293,27 +297,20 @@ int TimerManager::ResetTimer(int id, unsigned when, unsigned period,
 int TimerManager::CancelTimer(int id)
 {
 	Timer*		timer_ptr;
-	Timer*		trail_ptr;
 
 	dprintf( D_DAEMONCORE, "In cancel_timer(), id=%d\n",id);
-	if (timer_list == NULL) {
+	if (timer_heap.empty()) {
 		dprintf( D_DAEMONCORE, "Removing Timer from empty list!\n");
 		return -1;
 	}
 
-	timer_ptr = timer_list;
-	trail_ptr = NULL;
-	while ( timer_ptr && timer_ptr->id != id ) {
-		trail_ptr = timer_ptr;
-		timer_ptr = timer_ptr->next;
-	}
-
+	timer_ptr = GetTimer( id );
 	if ( timer_ptr == NULL ) {
 		dprintf( D_ALWAYS, "Timer %d not found\n",id );
 		return -1;
 	}
 
-	RemoveTimer( timer_ptr, trail_ptr );
+	RemoveTimer( timer_ptr );
 
 	if ( in_timeout == timer_ptr ) {
 		// We're inside the handler for this timer. Don't delete it,
@@ -329,11 +326,13 @@ int TimerManager::CancelTimer(int id)
 
 void TimerManager::CancelAllTimers()
 {
-	Timer		*timer_ptr;
+	// Take the timers out first, so that nothing done while deleting
+	// them can see a half-dismantled heap.
+	std::vector<Timer*> timers;
+	timers.swap( timer_heap );
+	timer_map.clear();
 
-	while( timer_list != NULL ) {
-		timer_ptr = timer_list;
-		timer_list = timer_list->next;
+	for ( Timer *timer_ptr : timers ) {
 		if( in_timeout == timer_ptr ) {
 				// We get here if somebody calls exit from inside a timer.
 			did_cancel = true;
@@ -342,8 +341,6 @@ void TimerManager::CancelAllTimers()
 			DeleteTimer( timer_ptr );
 		}
 	}
-	timer_list = NULL;
-	list_tail = NULL;
 }
 
 // Timeout() is called when a select() time out.  Returns number of seconds
@@ -361,10 +358,10 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 
 	if ( in_timeout != NULL ) {
 		dprintf(D_DAEMONCORE,"DaemonCore Timeout() called and in_timeout is non-NULL\n");
-		if ( timer_list == NULL ) {
+		if ( timer_heap.empty() ) {
 			result = 0;
 		} else {
-			result = (timer_list->when) - time(NULL);
+			result = (timer_heap[0]->when) - time(NULL);
 		}
 		if ( result < 0 ) {
 			result = 0;
@@ -374,7 +371,7 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 		
 	dprintf( D_DAEMONCORE, "In DaemonCore Timeout()\n");
 
-	if (timer_list == NULL) {
+	if (timer_heap.empty()) {
 		dprintf( D_DAEMONCORE, "Empty timer list, nothing to do\n" );
 	}
 
@@ -383,63 +380,54 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 	DumpTimerList(D_DAEMONCORE | D_FULLDEBUG);
 
     // if we are going to not limit the number of timer handlers we invoke,
-    // make a set now of all timers that are ready to go... below we will
-    // use this set in order to NOT invoke new timers that are inserted by
-    // timer handlers themselves.
-    std::unordered_set<int> readyTimerIds;
-    if (max_timer_events_per_cycle == INT_MAX) {
-        in_timeout = timer_list;
-        while ((in_timeout != NULL) && (in_timeout->when <= now)) {
-            readyTimerIds.insert(in_timeout->id);
-            in_timeout = in_timeout->next;
+    // make a list now of all timers that are ready to go... below we will
+    // only invoke the timers on this list, in order to NOT invoke new timers
+    // that are inserted by timer handlers themselves.  Each timer is
+    // looked up again by id before it is called, since handlers may have
+    // cancelled or reset it in the meantime.
+    bool unlimited = (max_timer_events_per_cycle == INT_MAX);
+    std::vector<int> readyTimerIds;
+    size_t nextReady = 0;
+    if (unlimited) {
+        std::vector<Timer*> ready;
+        GetReadyTimers(now, ready);
+        readyTimerIds.reserve(ready.size());
+        for (Timer *timer_ptr : ready) {
+            readyTimerIds.push_back(timer_ptr->id);
         }
-        in_timeout = NULL;
     }
 
 	// loop until all handlers that should have been called by now or before
 	// are invoked and renewed if periodic.  Remember that NewTimer and CancelTimer
-	// keep the timer_list happily sorted on "when" for us.  We use "now" as a 
+	// keep the timer_heap ordered on "when" for us.  We use "now" as a
 	// variable so that if some of these handler functions run for a long time,
 	// we do not sit in this loop forever.
 	// we make certain we do not call more than "max_fires" handlers in a 
 	// single timeout --- this ensures that timers don't starve out the rest
 	// of daemonCore if a timer handler resets itself to 0.
-	while( (timer_list != NULL) && (timer_list->when <= now ) &&
-		   (num_fires < max_timer_events_per_cycle))
+	while( num_fires < max_timer_events_per_cycle )
 	{
-        in_timeout = timer_list;
-
-        // In this code block, if there is no limit on how many timer handlers we will invoke,
-        // we want to skip over timers that got  added or reset by other timer handlers to make
-        // certain we aren't stuck here forever. So we will only call timer handlers that
-        // were ready to fire when we first entered Timeout().
-        if (max_timer_events_per_cycle == INT_MAX) {
-            std::unordered_set<int>::iterator it;
-            bool call_handler = false;
-            // Skip handlers already invoked or added
-            do {
-                it = readyTimerIds.find(in_timeout->id);
-                if (it == readyTimerIds.end()) {
-                    // this timer was not ready when we first looked, so it must have been
-                    // added or reset by another timer callback.  in this case, skip this timer
-                    // callback (we will deal with it next time through the daemoncore loop).
-                    dprintf(D_DAEMONCORE, "Timer %d not fired (SKIPPED) cause added\n", in_timeout->id);
-                    in_timeout = in_timeout->next;
-                }
-                else {
-                    // this timer was ready to fire when we first looked at the timer list, so
-                    // we are going to go ahead and call its handler.  Erase it from our readyTimerIds
-                    // list, and then break out of loop to go ahead and call the handler.
-                    call_handler = true;
-                    readyTimerIds.erase(it);
-                }
-            } while ((!call_handler) && (in_timeout != NULL) && (in_timeout->when <= now));
+        in_timeout = NULL;
 
-            if (!call_handler) {
-                // no timers left that we want to fire at this time, break out of outer while loop
-                break;
+        if (unlimited) {
+            // Take the next timer that was ready when we first entered
+            // Timeout().  Timers that were added or reset by other timer
+            // handlers will be dealt with next time through the daemoncore loop.
+            while (nextReady < readyTimerIds.size()) {
+                Timer *timer_ptr = GetTimer(readyTimerIds[nextReady++]);
+                if (timer_ptr && timer_ptr->when <= now) {
+                    in_timeout = timer_ptr;
+                    break;
+                }
             }
-        }  // end of block if max_timer_events_per_cycle == INT_MAX
+        } else if (!timer_heap.empty() && timer_heap[0]->when <= now) {
+            in_timeout = timer_heap[0];
+        }
+
+        if (in_timeout == NULL) {
+            // no timers left that we want to fire at this time
+            break;
+        }
 
         num_fires++;
 
@@ -494,7 +482,9 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 		}
 
         // Make sure we didn't leak our priv state
-		daemonCore->CheckPrivState();
+		if ( daemonCore ) {
+			daemonCore->CheckPrivState();
+		}
 
 		// Clear curr_dataptr
 		curr_dataptr = NULL;
@@ -510,12 +500,10 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 			// If a new timer was added at a time in the past
 			// (possible when resetting a timeslice timer), then
 			// it may have landed before the timer we just processed,
-			// meaning that we cannot assume prev==NULL in the call
-			// to RemoveTimer() below.
+			// so it is not necessarily at the top of the heap.
 
-			Timer *prev = NULL;
-			ASSERT( GetTimer(in_timeout->id,&prev) == in_timeout );
-			RemoveTimer( in_timeout, prev );
+			ASSERT( GetTimer(in_timeout->id) == in_timeout );
+			RemoveTimer( in_timeout );
 
 			if ( in_timeout->period > 0 || in_timeout->timeslice ) {
 				in_timeout->period_started = time(NULL);
@@ -541,13 +529,13 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 
 	// set result to number of seconds until next event.  get an update on the
 	// time from time() in case the handlers we called above took significant time.
-	if ( timer_list == NULL ) {
+	if ( timer_heap.empty() ) {
 		// we set result to be -1 so that we do not busy poll.
 		// a -1 return value will tell the DaemonCore:Driver to use select with
 		// no timeout.
 		result = -1;
 	} else {
-		result = (timer_list->when) - time(NULL);
+		result = (timer_heap[0]->when) - time(NULL);
 		if (result < 0)
 			result = 0;
 	}
@@ -563,7 +551,6 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 
 void TimerManager::DumpTimerList(int flag, const char* indent)
 {
-	Timer		*timer_ptr;
 	const char	*ptmp;
 
 	// we want to allow flag to be "D_FULLDEBUG | D_DAEMONCORE",
@@ -580,7 +567,12 @@ void TimerManager::DumpTimerList(int flag, const char* indent)
 	dprintf(flag, "\n");
 	dprintf(flag, "%sTimers\n", indent);
 	dprintf(flag, "%s~~~~~~\n", indent);
-	for(timer_ptr = timer_list; timer_ptr != NULL; timer_ptr = timer_ptr->next)
+
+	// list the timers in the order they will run
+	std::vector<Timer*> timers( timer_heap );
+	std::sort( timers.begin(), timers.end(), TimerBefore );
+
+	for ( Timer *timer_ptr : timers )
 	{
 		if ( timer_ptr->event_descrip )
 			ptmp = timer_ptr->event_descrip;
@@ -648,69 +640,103 @@ void TimerManager::Start()
 	}
 }
 
-void TimerManager::RemoveTimer( Timer *timer, Timer *prev )
+void TimerManager::RemoveTimer( Timer *timer )
 {
-	if ( timer == NULL || ( prev && prev->next != timer ) ||
-		 ( !prev && timer != timer_list ) ) {
+	if ( timer == NULL || timer->heap_index >= timer_heap.size() ||
+		 timer_heap[timer->heap_index] != timer ) {
 		EXCEPT( "Bad call to TimerManager::RemoveTimer()!" );
 	}
 
-	if ( timer == timer_list ) {
-		timer_list = timer_list->next;
-	}
-	if ( timer == list_tail ) {
-		list_tail = prev;
-	}
-	if ( prev ) {
-		prev->next = timer->next;
+	timer_map.erase( timer->id );
+
+	// move the last timer into the hole, and put it where it belongs
+	size_t ix = timer->heap_index;
+	Timer *last = timer_heap.back();
+	timer_heap.pop_back();
+	if ( last != timer ) {
+		timer_heap[ix] = last;
+		last->heap_index = ix;
+		SiftUp( ix );
+		SiftDown( last->heap_index );
 	}
 }
 
 void TimerManager::InsertTimer( Timer *new_timer )
 {
-	if ( timer_list == NULL ) {
-		// list is empty, place ours in front
-		timer_list = new_timer;
-		list_tail = new_timer;
-		new_timer->next = NULL;
+	// Every insert gets a new sequence number, so a timer goes behind
+	// all the others with the same "when".  This makes certain we
+	// "round-robin" across timers that constantly reset themselves to zero.
+	new_timer->sequence = timer_sequence++;
+	new_timer->heap_index = timer_heap.size();
+	timer_heap.push_back( new_timer );
+	timer_map[new_timer->id] = new_timer;
+	SiftUp( new_timer->heap_index );
+
+	if ( new_timer->heap_index == 0 && daemonCore ) {
 			// since we have a new first timer, we must wake up select
 		daemonCore->Wake_up_select();
-	} else {
-		// list is not empty, so keep timer_list ordered from soonest to
-		// farthest (i.e. sorted on "when").
-		// Note: when doing the comparisons, we always use "<" instead
-		// of "<=" -- this makes certain we "round-robin" across 
-		// timers that constantly reset themselves to zero.
-		if ( new_timer->when < timer_list->when ) {
-			// make the this new timer first in line
-			new_timer->next = timer_list;
-			timer_list = new_timer;
-			// since we have a new first timer, we must wake up select
-			daemonCore->Wake_up_select();
-		} else if ( new_timer->when == TIME_T_NEVER ) {
-			// Our new timer goes to the very back of the list.
-			new_timer->next = NULL;
-			list_tail->next = new_timer;
-			list_tail = new_timer;
-		} else {
-			Timer* timer_ptr;
-			Timer* trail_ptr = NULL;
-			for (timer_ptr = timer_list; timer_ptr != NULL; 
-				 timer_ptr = timer_ptr->next ) 
-			{
-				if (new_timer->when < timer_ptr->when) {
-					break;
-				}
-				trail_ptr = timer_ptr;
-			}
-			ASSERT( trail_ptr );
-			new_timer->next = timer_ptr;
-			trail_ptr->next = new_timer;
-			if ( trail_ptr == list_tail ) {
-				list_tail = new_timer;
+	}
+}
+
+void TimerManager::SiftUp( size_t ix )
+{
+	Timer *timer = timer_heap[ix];
+	while ( ix > 0 ) {
+		size_t parent = (ix - 1) / 2;
+		if ( ! TimerBefore( timer, timer_heap[parent] ) ) {
+			break;
+		}
+		timer_heap[ix] = timer_heap[parent];
+		timer_heap[ix]->heap_index = ix;
+		ix = parent;
+	}
+	timer_heap[ix] = timer;
+	timer->heap_index = ix;
+}
+
+void TimerManager::SiftDown( size_t ix )
+{
+	size_t count = timer_heap.size();
+	Timer *timer = timer_heap[ix];
+	for (;;) {
+		size_t child = 2 * ix + 1;
+		if ( child >= count ) {
+			break;
+		}
+		if ( child + 1 < count && TimerBefore( timer_heap[child + 1], timer_heap[child] ) ) {
+			child++;
+		}
+		if ( ! TimerBefore( timer_heap[child], timer ) ) {
+			break;
+		}
+		timer_heap[ix] = timer_heap[child];
+		timer_heap[ix]->heap_index = ix;
+		ix = child;
+	}
+	timer_heap[ix] = timer;
+	timer->heap_index = ix;
+}
+
+void TimerManager::GetReadyTimers( time_t now, std::vector<Timer*> &ready )
+{
+	// Walk the heap from the top, skipping the subtree below any timer
+	// that isn't due, since nothing in it can be due either.
+	ready.clear();
+	if ( timer_heap.empty() || timer_heap[0]->when > now ) {
+		return;
+	}
+	std::vector<size_t> pending( 1, 0 );
+	while ( ! pending.empty() ) {
+		size_t ix = pending.back();
+		pending.pop_back();
+		ready.push_back( timer_heap[ix] );
+		for ( size_t child = 2 * ix + 1; child <= 2 * ix + 2; child++ ) {
+			if ( child < timer_heap.size() && timer_heap[child]->when <= now ) {
+				pending.push_back( child );
 			}
 		}
 	}
+	std::sort( ready.begin(), ready.end(), TimerBefore );
 }
 
 void TimerManager::DeleteTimer( Timer *timer )
@@ -735,18 +761,11 @@ void TimerManager::DeleteTimer( Timer *timer )
 	delete timer;
 }
 
-Timer *TimerManager::GetTimer( int id, Timer **prev )
+Timer *TimerManager::GetTimer( int id )
 {
-	Timer *timer_ptr = timer_list;
-	if( prev ) {
-		*prev = NULL;
+	auto it = timer_map.find( id );
+	if ( it == timer_map.end() ) {
+		return NULL;
 	}
-	while ( timer_ptr && timer_ptr->id != id ) {
-		if( prev ) {
-			*prev = timer_ptr;
-		}
-		timer_ptr = timer_ptr->next;
-	}
-
-	return timer_ptr;
+	return it->second;
 }
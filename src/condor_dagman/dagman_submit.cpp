@@ -698,6 +698,17 @@ direct_condor_submit(const Dagman &dm, Job* node,
 
 		int proc_id = 0, item_index = 0, step = 0;
 
+		// if the schedd can take the ads of the cluster a message at a time,
+		// it creates each proc when it gets the proc ad, rather than on NewProc
+		bool send_ads = false;
+		ClassAd caps;
+		if (GetScheddCapabilites(0, caps)) {
+			caps.LookupBool("SendJobAds", send_ads);
+		}
+		if (send_ads && BeginSendJobAds(cluster_id, SetAttribute_NoAck) < 0) {
+			send_ads = false;
+		}
+
 		SubmitStepFromQArgs ssi(*submitHash);
 		JOB_ID_KEY jid(cluster_id, proc_id);
 		rval = ssi.begin(jid, queue_args);
@@ -711,7 +722,7 @@ direct_condor_submit(const Dagman &dm, Job* node,
 		}
 
 		while ((rval = ssi.next(jid, item_index, step)) > 0) {
-			proc_id = NewProc(cluster_id);
+			proc_id = send_ads ? jid.proc : NewProc(cluster_id);
 			if (proc_id != jid.proc) {
 				formatstr(errmsg, "expected next ProcId to be %d, but Schedd says %d", jid.proc, proc_id);
 				rval = -1;
@@ -741,7 +752,11 @@ direct_condor_submit(const Dagman &dm, Job* node,
 				classad::ClassAd * clusterad = proc_ad->GetChainedParentAd();
 				if (clusterad) {
 					send_jobset_if_allowed(*submitHash, cluster_id);
-					rval = SendJobAttributes(JOB_ID_KEY(cluster_id, -1), *clusterad, SetAttribute_NoAck, submitHash->error_stack(), "Submit");
+					if (send_ads) {
+						rval = SendJobAd(JOB_ID_KEY(cluster_id, -1), *clusterad, submitHash->error_stack(), "Submit");
+					} else {
+						rval = SendJobAttributes(JOB_ID_KEY(cluster_id, -1), *clusterad, SetAttribute_NoAck, submitHash->error_stack(), "Submit");
+					}
 					if (rval < 0) {
 						errmsg = "failed to send cluster classad";
 						goto finis;
@@ -752,12 +767,21 @@ direct_condor_submit(const Dagman &dm, Job* node,
 				condorID._subproc = 0;
 			}
 
-			rval = SendJobAttributes(jid, *proc_ad, SetAttribute_NoAck, submitHash->error_stack(), "Submit");
+			if (send_ads) {
+				rval = SendJobAd(jid, *proc_ad, submitHash->error_stack(), "Submit");
+			} else {
+				rval = SendJobAttributes(jid, *proc_ad, SetAttribute_NoAck, submitHash->error_stack(), "Submit");
+			}
 			if (rval < 0) {
 				errmsg = "failed to send proc ad";
 				goto finis;
 			}
 		}
+		if (send_ads && EndSendJobAds(submitHash->error_stack(), "Submit") < 0) {
+			errmsg = "failed to send job ads";
+			rval = -1;
+			goto finis;
+		}
 		// commit transaction and disconnect queue
 		CondorError errstack;
 		success = DisconnectQ(qmgr, true, &errstack); qmgr = NULL;
@@ -627,6 +627,7 @@
 #define ATTR_RESOURCE_REQUEST_COUNT "_condor_RESOURCE_COUNT"  // used in resource request ad
 #define ATTR_RESOURCE_REQUEST_CLUSTER "_condor_RESOURCE_CLUSTER"
 #define ATTR_RESOURCE_REQUEST_PROC "_condor_RESOURCE_PROC"
+#define ATTR_RESTORED_AD  "RestoredAd"
 #define ATTR_RESTRICT_TO_AUTHENTICATED_IDENTITY "RestrictToAuthenticatedIdentity"
 #define ATTR_SLOT_TYPE  "SlotType"
 #define ATTR_SLOT_TYPE_ID  "SlotTypeID"
@@ -666,6 +667,9 @@
 #define ATTR_START  "Start"
 #define ATTR_START_LOCAL_UNIVERSE  "StartLocalUniverse"
 #define ATTR_START_SCHEDULER_UNIVERSE  "StartSchedulerUniverse"
+#define ATTR_STARTD_DELTA_BASE_GENERATION  "StartdDeltaBaseGeneration"
+#define ATTR_STARTD_DELTA_GENERATION  "StartdDeltaGeneration"
+#define ATTR_STARTD_DELTA_REMOVED_ATTRS  "StartdDeltaRemovedAttrs"
 #define ATTR_STARTD_IP_ADDR  "StartdIpAddr"
 #define ATTR_STARTD_PRINCIPAL  "StartdPrincipal"
 #define ATTR_STARTD_SENDS_ALIVES  "StartdSendsAlives"
@@ -67,7 +67,7 @@ const int REQUEST_CLAIM_SLOT_AD          = 7;
 
 
 constexpr const
-std::array<std::pair<int, const char *>, 199> makeCommandTable() {
+std::array<std::pair<int, const char *>, 200> makeCommandTable() {
 	return {{ // Yes, we need two...
 
 /****
@@ -373,6 +373,8 @@ std::array<std::pair<int, const char *>, 199> makeCommandTable() {
 		{SET_FLOOR, "SET_FLOOR"},
 #define DIRECT_ATTACH (SCHED_VERS+131) // Provide slot ads to the schedd (not from the negotiator)
 		{DIRECT_ATTACH, "DIRECT_ATTACH"},
+#define REQUEST_FULL_STARTD_UPDATE (SCHED_VERS+132) // Collector: resend a slot's whole ad, because a delta update didn't apply
+		{REQUEST_FULL_STARTD_UPDATE, "REQUEST_FULL_STARTD_UPDATE"},
 // command ids from +140 to +149 reserved for Schedd UserRec commands
 #define QUERY_USERREC_ADS (SCHED_VERS+140)
 		{QUERY_USERREC_ADS, "QUERY_USERREC_ADS"},
@@ -712,7 +714,7 @@ static_assert(makeCommandTable().back().first == COMMAND_LAST, "Is the size of t
 *** Command ids used by the collector 
 ************/
 constexpr const
-std::array<std::pair<int, const char *>, 61> makeCollectorCommandTable() {
+std::array<std::pair<int, const char *>, 63> makeCollectorCommandTable() {
 	return {{ 
 #define UPDATE_STARTD_AD		0
 		{UPDATE_STARTD_AD, "UPDATE_STARTD_AD"},
@@ -875,6 +877,16 @@ std::array<std::pair<int, const char *>, 61> makeCollectorCommandTable() {
 #define IMPERSONATION_TOKEN_REQUEST 81
 		{IMPERSONATION_TOKEN_REQUEST, "IMPERSONATION_TOKEN_REQUEST"},
 
+			// Only the attributes of a slot ad that changed since the last
+			// update, see StartdDeltaGeneration
+#define UPDATE_STARTD_AD_DELTA 82
+		{UPDATE_STARTD_AD_DELTA, "UPDATE_STARTD_AD_DELTA"},
+
+			// Several updates in one message, each with its own command,
+			// see DCCollector::sendUpdateBatch
+#define UPDATE_AD_BATCH 83
+		{UPDATE_AD_BATCH, "UPDATE_AD_BATCH"},
+
 #define COLLECTOR_COMMAND_LAST (INT_MAX - 1)			// used by the Win32 credd only
 		{COLLECTOR_COMMAND_LAST, "COLLECTOR_COMMAND_LAST"},
 	}};
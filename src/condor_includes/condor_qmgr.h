@@ -158,6 +158,18 @@ int SendJobAttributes(const JOB_ID_KEY & key, const classad::ClassAd & ad, SetAt
 // send the jobset ad during submission of the given cluster_id.
 int SendJobsetAd(int cluster_id, const classad::ClassAd & ad, unsigned int flags);
 
+// send the cluster ad and the proc ads of a new cluster a message at a time, rather than as a
+// NewProc and a series of SetAttribute calls for each proc. Only for schedds that have the SendJobAds capability.
+// After BeginSendJobAds, call SendJobAd with the cluster ad (key.proc == -1) and then with each proc ad in order,
+// and make no other qmgmt calls until EndSendJobAds (the transaction calls will end it if need be).
+// The schedd creates each proc as NewProc would, so key.proc must be the next proc of the cluster, and, like
+// SendJobAttributes, only the attributes of the given ad are sent, and not those of its chained parent ad.
+// The schedd replies only to a whole message, so a failure may be returned by a later SendJobAd or by EndSendJobAds,
+// the return value is then < 0 (one of the NEWJOB_ERR_* codes if the schedd could not create a proc) with errno set.
+int BeginSendJobAds(int cluster_id, SetAttributeFlags_t saflags);
+int SendJobAd(const JOB_ID_KEY & key, const classad::ClassAd & ad, CondorError *errstack=NULL, const char * who=NULL);
+int EndSendJobAds(CondorError *errstack=NULL, const char * who=NULL);
+
 /** For all jobs in the queue for which constraint evaluates to true, set
 	attr = value.  The value should be a valid ClassAd value (strings
 	should be surrounded by quotes).
@@ -277,6 +289,12 @@ void CommitNonDurableTransactionOrDieTrying();
 void CommitTransactionOrDieTrying();
 int CommitTransactionAndLive( SetAttributeFlags_t flags, CondorError * errstack )
 	WARN_UNUSED_RESULT;
+/** Like CommitTransactionAndLive(), but with JOB_QUEUE_GROUP_COMMIT a durable
+    commit shares its fsync with other commits, so it may not be on disk yet
+    when this returns.  See JobQueueLogSynced() and DeferQmgmtReply().
+*/
+int CommitTransactionGroupSync( SetAttributeFlags_t flags, CondorError * errstack )
+	WARN_UNUSED_RESULT;
 
 
 int AbortTransaction();
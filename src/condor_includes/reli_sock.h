@@ -47,6 +47,7 @@ extern size_t relisock_gsi_put_last_size;
 
 class Authentication;
 class Condor_MD_MAC;
+class ClassAdWireDictionary;
 /** The ReliSock class implements the Sock interface with TCP. */
 
 #define GET_FILE_OPEN_FAILED -2
@@ -287,6 +288,10 @@ public:
 
 	bool is_closed() const {return rcv_msg.m_closed;}
 
+		// Attribute names sent or received in binary encoded ClassAds
+		// during the current message, see classad_wire.h.
+	ClassAdWireDictionary * classad_wire_dict();
+
 	// serialize and deserialize
 	const char * deserialize(const char *);	// restore state from buffer
 	void serialize(std::string& outbuf) const;	// save state into buffer
@@ -401,6 +406,9 @@ protected:
 	bool m_read_would_block;
 	bool m_non_blocking;
 
+	ClassAdWireDictionary *m_wire_dict;
+	void reset_classad_wire_dict();
+
 	// Message digest covering communications prior to enabling encryption
 	// When encryption is enabled, this digest is included in the authenticated
 	// data in order to detect that the two sides didn't see the same handshake.
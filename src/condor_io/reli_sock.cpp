@@ -29,6 +29,7 @@
 #include "ccb_client.h"
 #include "condor_sockfunc.h"
 #include "condor_crypt_aesgcm.h"
+#include "classad_wire.h"
 
 #define NORMAL_HEADER_SIZE 5
 #define MAX_HEADER_SIZE MAC_SIZE + NORMAL_HEADER_SIZE
@@ -49,6 +50,7 @@ ReliSock::init()
 	m_has_backlog = false;
 	m_read_would_block = false;
 	m_non_blocking = false;
+	m_wire_dict = NULL;
 	ignore_next_encode_eom = FALSE;
 	ignore_next_decode_eom = FALSE;
 	_bytes_sent = 0.0;
@@ -111,6 +113,8 @@ ReliSock::~ReliSock()
 		delete m_authob;
 		m_authob = NULL;
 	}
+	delete m_wire_dict;
+	m_wire_dict = NULL;
 	if ( hostAddr ) {
 		free( hostAddr );
 		hostAddr = NULL;
@@ -137,6 +141,7 @@ ReliSock::close()
 	m_final_recv_header = false;
 	m_send_md_ctx.reset();
 	m_recv_md_ctx.reset();
+	reset_classad_wire_dict();
 
 	// then invoke close() in parent class to close fd etc
 	return Sock::close();
@@ -543,6 +548,25 @@ ReliSock::end_of_message()
 	return end_of_message_internal();
 }
 
+ClassAdWireDictionary *
+ReliSock::classad_wire_dict()
+{
+	if ( ! m_wire_dict) {
+		m_wire_dict = new ClassAdWireDictionary();
+	}
+	return m_wire_dict;
+}
+
+void
+ReliSock::reset_classad_wire_dict()
+{
+	// both ends of the connection do this at the same point in the
+	// stream, so their dictionaries stay in step
+	if (m_wire_dict) {
+		m_wire_dict->clear();
+	}
+}
+
 int 
 ReliSock::end_of_message_internal()
 {
@@ -557,6 +581,7 @@ ReliSock::end_of_message_internal()
 				ignore_next_encode_eom = FALSE;
 				return TRUE;
 			}
+			reset_classad_wire_dict();
 			if (!snd_msg.buf.empty()) {
 				int retval = snd_msg.snd_packet(peer_description(), _sock, TRUE, _timeout);
 				if (retval == 2 || retval == 3) {
@@ -575,6 +600,7 @@ ReliSock::end_of_message_internal()
 				ignore_next_decode_eom = FALSE;
 				return TRUE;
 			}
+			reset_classad_wire_dict();
 			if ( rcv_msg.ready ) {
 				if ( rcv_msg.buf.consumed() ) {
 					ret_val = TRUE;
@@ -474,6 +474,7 @@ Matchmaker ()
 	rejForSubmitterLimit = 0;
 	rejForConcurrencyLimit = 0;
 	rejForSubmitterCeiling = 0;
+	rejForRequirements = 0;
 
 	cachedPrio = 0;
 	cachedOnlyForStartdRank = false;
@@ -501,6 +502,8 @@ Matchmaker ()
 											 ResourcesInUseByUsersGroup_classad_func );
 	slotWeightStr = 0;
 	m_staticRanks = false;
+	parallelMatcher = NULL;
+	m_useSlotIndex = true;
 	m_dryrun = false;
 }
 
@@ -517,6 +520,7 @@ Matchmaker::
 	delete PreemptionRank;
 	delete NegotiatorPreJobRank;
 	delete NegotiatorPostJobRank;
+	delete parallelMatcher;
 	delete sockCache;
 	if (MatchList) {
 		delete MatchList;
@@ -900,6 +904,24 @@ reinitialize ()
 	ASSERT( num_negotiation_cycle_stats <= MAX_NEGOTIATION_CYCLE_STATS );
 
 	m_staticRanks = param_boolean("NEGOTIATOR_IGNORE_JOB_RANKS", false);
+	m_useSlotIndex = param_boolean("NEGOTIATOR_USE_SLOT_INDEX", true);
+
+		// the matcher keeps copies of the expressions parsed above
+	delete parallelMatcher;
+	parallelMatcher = NULL;
+	int num_threads = param_integer("NEGOTIATOR_NUM_THREADS", 1, 1);
+	if (num_threads > 1) {
+		ParallelMatcher::Exprs exprs;
+		exprs.rankCondStd = rankCondStd;
+		exprs.rankCondPrioPreempt = rankCondPrioPreempt;
+		exprs.PreemptionReq = PreemptionReq;
+		exprs.PreemptionRank = PreemptionRank;
+		exprs.NegotiatorPreJobRank = NegotiatorPreJobRank;
+		exprs.NegotiatorPostJobRank = NegotiatorPostJobRank;
+		int chunk_size = param_integer("NEGOTIATOR_MATCH_CHUNK_SIZE", 32, 1);
+		parallelMatcher = new ParallelMatcher(num_threads, chunk_size, exprs);
+		dprintf(D_ALWAYS, "Matching with %d threads, %d slots at a time\n", num_threads, chunk_size);
+	}
 
 	if( first_time ) {
 		first_time = false;
@@ -1654,6 +1676,7 @@ negotiationTime ()
 
 	ranksMap.clear();
 	m_slotNameToAdMap.clear();
+	slotIndex.clear();
 
 	/**
 		Check if we just finished a cycle less than NEGOTIATOR_CYCLE_DELAY
@@ -1800,6 +1823,10 @@ negotiationTime ()
 		dprintf(D_FULLDEBUG, "Done sorting machine ads by rank\n");
 	}
 
+	if (m_useSlotIndex) {
+		slotIndex.build(startdAds);
+	}
+
     negotiation_cycle_stats[0]->trimmed_slots = startdAds.MyLength();
     negotiation_cycle_stats[0]->candidate_slots = startdAds.MyLength();
 
@@ -1815,6 +1842,10 @@ negotiationTime ()
 	// available during matchmaking
 	addRemoteUserPrios( startdAds );
 
+	if (parallelMatcher) {
+		ParallelMatcher::prepareOffers(startdAds);
+	}
+
 	SetupMatchSecurity(submitterAds);
 
     if (hgq_groups.size() <= 1) {
@@ -2492,6 +2523,7 @@ negotiateWithGroup ( bool isFloorRound,
 			rejPreemptForRank = 0;
 			rejForSubmitterLimit = 0;
 			rejForSubmitterCeiling = 0;
+			rejForRequirements = 0;
 			rejectedConcurrencyLimits.clear();
 
 			// Optimizations:
@@ -4081,6 +4113,12 @@ negotiate(char const* groupName, char const *submitterName, const ClassAd *submi
 											 pieLeft,
 											 only_consider_startd_rank);
 
+				// whatever happens to the offer now may not be reflected
+				// in the slot index
+			if (offer) {
+				slotIndex.markChanged(offer);
+			}
+
 			if( !offer )
 			{
 				// lookup want_match_diagnostics in request
@@ -4127,8 +4165,8 @@ negotiate(char const* groupName, char const *submitterName, const ClassAd *submi
 					} else {
 						diagnostic_message = "no match found";
 					}
-					dprintf(D_ALWAYS|D_MATCH|D_NOHEADER, "%s\n",
-							diagnostic_message.c_str());
+					dprintf(D_ALWAYS|D_MATCH|D_NOHEADER, "%s (%d slots rejected by requirements)\n",
+							diagnostic_message.c_str(), rejForRequirements);
 				}
 				// add in autocluster and job id info if requested
 				if ( want_match_diagnostics == 2 ) {
@@ -4555,7 +4593,8 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
 				rejPreemptForPolicy,
 				rejPreemptForRank,
 				rejForSubmitterLimit,
-				rejForSubmitterCeiling);
+				rejForSubmitterCeiling,
+				rejForRequirements);
 		}
 		if ( cached_bestSoFar && !candidateDslotClaims.empty() ) {
 			cached_bestSoFar->Assign("PreemptDslotClaims", candidateDslotClaims);
@@ -4593,27 +4632,38 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
 	rejPreemptForPolicy = 0;
 	rejPreemptForRank = 0;
 	rejForSubmitterLimit = 0;
+	rejForRequirements = 0;
 
 	bool allow_pslot_preemption = param_boolean("ALLOW_PSLOT_PREEMPTION", false);
 	double allocatedWeight = 0.0;
-		// Set up for parallel matchmaking, if enabled
-	std::vector<ClassAd *> par_candidates;
-	std::vector<ClassAd *> par_matches;
 
-	int num_threads =  param_integer("NEGOTIATOR_NUM_THREADS", 1);
-	if (num_threads > 1) {
-		startdAds.Open();
-		par_candidates.reserve(startdAds.Length());
-		while ((candidate = startdAds.Next())) {
-			par_candidates.push_back(candidate);
+	int cluster_id=-1,proc_id=-1;
+	if( IsDebugLevel( D_MACHINE ) ) {
+		request.LookupInteger(ATTR_CLUSTER_ID,cluster_id);
+		request.LookupInteger(ATTR_PROC_ID,proc_id);
+	}
+
+		// Look up the simple clauses of the job's Requirements in the
+		// slot index, to rule out slots without evaluating it.  A pslot
+		// that doesn't match may still be used by preempting its dslots,
+		// so don't when that is possible.
+	std::vector<bool> indexed_slots;
+	bool use_index = false;
+	int index_skipped = 0;
+	if (slotIndex.isBuilt()) {
+		bool jobWantsMultiMatch = false;
+		request.LookupBool(ATTR_WANT_PSLOT_PREEMPTION, jobWantsMultiMatch);
+		if ( ! (ConsiderPreemption && allow_pslot_preemption && jobWantsMultiMatch)) {
+			use_index = slotIndex.findCandidates(request, indexed_slots);
 		}
-		startdAds.Close();
-		ParallelIsAMatch(&request, par_candidates, par_matches, num_threads, false);
 	}
 
-	// scan the offer ads
+	// scan the offer ads, setting aside the ones this request can't use
+	std::vector<ClassAd *> candidates;
+	candidates.reserve(startdAds.Length());
 	startdAds.Open ();
 	std::string machineAddr;
+	std::string machine_name;
 	std::string pslot_claimer;
 	bool is_pslot;
 
@@ -4622,6 +4672,13 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
 	getSinfulStringProtocolBools( false, false, scheddAddr, isIPv4, isIPv6 );
 
 	while ((candidate = startdAds.Next ())) {
+		if (use_index && ! slotIndex.isCandidate(indexed_slots, candidate)) {
+				// the index only skips slots whose Requirements can't match
+			++index_skipped;
+			++rejForRequirements;
+			continue;
+		}
+
 		bool v4 = false;
 		bool v6 = false;
 		candidate->LookupString( "MyAddress", machineAddr );
@@ -4648,51 +4705,72 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
 			}
 		}
 
-		int cluster_id=-1,proc_id=-1;
-		std::string machine_name;
-		if( IsDebugLevel( D_MACHINE ) ) {
-			request.LookupInteger(ATTR_CLUSTER_ID,cluster_id);
-			request.LookupInteger(ATTR_PROC_ID,proc_id);
-			candidate->LookupString(ATTR_NAME,machine_name);
-		}
-
 		is_pslot = false;
 		candidate->LookupBool(ATTR_SLOT_PARTITIONABLE, is_pslot);
 		if (is_pslot && candidate->LookupString(ATTR_REMOTE_SCHEDD_NAME, pslot_claimer)) {
 			if (pslot_claimer != scheddName) {
+				if( IsDebugLevel( D_MACHINE ) ) {
+					candidate->LookupString(ATTR_NAME,machine_name);
+				}
 				dprintf(D_MACHINE, "Job %d.%d is not from the schedd that has pslot %s claimed (%s)\n", cluster_id, proc_id, machine_name.c_str(), pslot_claimer.c_str());
 				continue;
 			}
 		}
 
-        consumption_map_t consumption;
-        bool has_cp = cp_supports_policy(*candidate);
-        bool cp_sufficient = true;
-        if (has_cp) {
-            // replace RequestXxx attributes (temporarily) with values derived from
-            // the consumption policy, so that Requirements expressions evaluate in a
-            // manner consistent with the check on CP resources
-            cp_override_requested(request, *candidate, consumption);
-            cp_sufficient = cp_sufficient_assets(*candidate, consumption);
-        }
+		candidates.push_back(candidate);
+	}
+	startdAds.Close ();
+
+	if (use_index) {
+		dprintf(D_FULLDEBUG, "Slot index ruled out %d of %d slots\n", index_skipped, startdAds.MyLength());
+	}
+
+		// Evaluate the request against the candidates on several threads,
+		// if enabled.  The loop below then uses the results in place of
+		// evaluating requirements, preemption predicates and ranks itself.
+	std::vector<ParallelMatcher::Candidate> evaluated;
+	if (parallelMatcher) {
+		parallelMatcher->evaluate(request, submitterName, ConsiderPreemption,
+			only_for_startdrank, candidates, evaluated);
+	}
+
+	for (size_t cand_ix = 0; cand_ix < candidates.size(); ++cand_ix) {
+		candidate = candidates[cand_ix];
+		const ParallelMatcher::Candidate *eval = evaluated.empty() ? NULL : &evaluated[cand_ix];
+
+		if( IsDebugLevel( D_MACHINE ) ) {
+			candidate->LookupString(ATTR_NAME,machine_name);
+		}
 
-		// The candidate offer and request must match.
-        // When candidate supports a consumption policy, then resources
-        // requested via consumption policy must also be available from
-        // the resource
 		bool is_a_match = false;
-		if (num_threads > 1) {
-			is_a_match = cp_sufficient &&
-				(par_matches.end() !=
-					std::find(par_matches.begin(), par_matches.end(), candidate));
+		if (eval && eval->evaluated) {
+			is_a_match = eval->is_match;
 		} else {
+			consumption_map_t consumption;
+			bool has_cp = cp_supports_policy(*candidate);
+			bool cp_sufficient = true;
+			if (has_cp) {
+				// replace RequestXxx attributes (temporarily) with values derived from
+				// the consumption policy, so that Requirements expressions evaluate in a
+				// manner consistent with the check on CP resources
+				cp_override_requested(request, *candidate, consumption);
+				cp_sufficient = cp_sufficient_assets(*candidate, consumption);
+			}
+
+			// The candidate offer and request must match.
+			// When candidate supports a consumption policy, then resources
+			// requested via consumption policy must also be available from
+			// the resource
 			is_a_match = cp_sufficient && IsAMatch(&request, candidate);
+
+			if (has_cp) {
+				// put original values back for RequestXxx attributes
+				cp_restore_requested(request, consumption);
+			}
 		}
 
-        if (has_cp) {
-            // put original values back for RequestXxx attributes
-            cp_restore_requested(request, consumption);
-        }
+			// from here on, use the parallel results only for a match they found
+		const ParallelMatcher::Candidate *pre = (is_a_match && eval && eval->evaluated) ? eval : NULL;
 
 		candidatePreemptState = NO_PREEMPTION;
 
@@ -4716,6 +4794,7 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
 
 		if( !is_a_match ) {
 				// they don't match; continue
+			++rejForRequirements;
 			continue;
 		}
 
@@ -4724,7 +4803,9 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
 			// Otherwise, we need to preempt the user who is running the job.
 
 			// But don't bother with all these lookups if preemption is disabled.
-		if (ConsiderPreemption && (candidatePreemptState == NO_PREEMPTION)) {
+		if (pre) {
+			remoteUser = pre->remoteUser;
+		} else if (ConsiderPreemption && (candidatePreemptState == NO_PREEMPTION)) {
 			if (!candidate->LookupString(ATTR_PREEMPTING_ACCOUNTING_GROUP, remoteUser)) {
 				if (!candidate->LookupString(ATTR_PREEMPTING_USER, remoteUser)) {
 					if (!candidate->LookupString(ATTR_ACCOUNTING_GROUP, remoteUser)) {
@@ -4755,8 +4836,9 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
 						machine_name.c_str(), cluster_id, proc_id);
 				continue;
 			}
-			if ( !(EvalExprToBool(rankCondStd, candidate, &request, result) &&
-				   result.IsBooleanValue(val) && val) ) {
+			if ( !(pre ? pre->rank_preempt :
+				   (EvalExprToBool(rankCondStd, candidate, &request, result) &&
+				    result.IsBooleanValue(val) && val)) ) {
 					// offer does not strictly prefer this request.
 					// try the next offer since only_for_statdrank flag is set
 
@@ -4780,8 +4862,9 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
 			 (candidatePreemptState == NO_PREEMPTION) // have we not already considered preemption?
 		   )
 		{
-			if( EvalExprToBool(rankCondStd, candidate, &request, result) &&
-				result.IsBooleanValue(val) && val ) {
+			if( pre ? pre->rank_preempt :
+				(EvalExprToBool(rankCondStd, candidate, &request, result) &&
+				 result.IsBooleanValue(val) && val) ) {
 					// offer strictly prefers this request to the one
 					// currently being serviced; preempt for rank
 				candidatePreemptState = RANK_PREEMPTION;
@@ -4794,8 +4877,9 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
 					// (1) we need to make sure that PreemptionReq's hold (i.e.,
 					// if the PreemptionReq expression isn't true, dont preempt)
 				if (PreemptionReq &&
-					!(EvalExprToBool(PreemptionReq,candidate,&request,result) &&
-					  result.IsBooleanValue(val) && val) ) {
+					!(pre ? pre->preemption_req :
+					  (EvalExprToBool(PreemptionReq,candidate,&request,result) &&
+					   result.IsBooleanValue(val) && val)) ) {
 					rejPreemptForPolicy++;
 					dprintf(D_MACHINE,
 							"PREEMPTION_REQUIREMENTS prevents job %d.%d from claiming %s.\n",
@@ -4805,8 +4889,9 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
 					// (2) we need to make sure that the machine ranks the job
 					// at least as well as the one it is currently running
 					// (i.e., rankCondPrioPreempt holds)
-				if(!(EvalExprToBool(rankCondPrioPreempt,candidate,&request,result)&&
-					 result.IsBooleanValue(val) && val ) ) {
+				if(!(pre ? pre->prio_preempt :
+					 (EvalExprToBool(rankCondPrioPreempt,candidate,&request,result)&&
+					  result.IsBooleanValue(val) && val) ) ) {
 						// machine doesn't like this job as much -- find another
 					rejPreemptForRank++;
 					dprintf(D_MACHINE,
@@ -4844,7 +4929,7 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
 			}
 		}
 
-		calculateRanks(request, candidate, candidatePreemptState, candidateRankValue, candidatePreJobRankValue, candidatePostJobRankValue, candidatePreemptRankValue);
+		calculateRanks(request, candidate, candidatePreemptState, candidateRankValue, candidatePreJobRankValue, candidatePostJobRankValue, candidatePreemptRankValue, pre);
 
 		if ( MatchList ) {
 			MatchList->add_candidate(
@@ -4917,7 +5002,6 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
 			}
 		}
 	}
-	startdAds.Close ();
 
 	if ( MatchList ) {
 		MatchList->set_diagnostics(
@@ -4928,7 +5012,8 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
 			rejPreemptForPolicy,
 		   	rejPreemptForRank,
 			rejForSubmitterLimit,
-			rejForSubmitterCeiling);
+			rejForSubmitterCeiling,
+			rejForRequirements);
 
 			// only bother sorting if there is more than one entry
 		if ( MatchList->length() > 1 ) {
@@ -4966,7 +5051,8 @@ calculateRanks(ClassAd &request,
                double &candidateRankValue,
                double &candidatePreJobRankValue,
                double &candidatePostJobRankValue,
-               double &candidatePreemptRankValue
+               double &candidatePreemptRankValue,
+               const ParallelMatcher::Candidate *evaluated
               )
 {
 	if (m_staticRanks) {
@@ -4983,26 +5069,37 @@ calculateRanks(ClassAd &request,
 		}
 	}
 
-	candidatePreJobRankValue = EvalNegotiatorMatchRank(
-		"NEGOTIATOR_PRE_JOB_RANK",NegotiatorPreJobRank,
-		request, candidate);
-
-	// calculate the request's rank of the candidate
-	double tmp;
-	if(!EvalFloat(ATTR_RANK, &request, candidate, tmp)) {
-		tmp = 0.0;
-	}
-	candidateRankValue = tmp;
+	if (evaluated) {
+		// already evaluated by the ParallelMatcher
+		candidatePreJobRankValue = evaluated->pre_job_rank;
+		candidateRankValue = evaluated->rank;
+		candidatePostJobRankValue = evaluated->post_job_rank;
+		candidatePreemptRankValue = -(FLT_MAX);
+		if(candidatePreemptState != NO_PREEMPTION) {
+			candidatePreemptRankValue = evaluated->preempt_rank;
+		}
+	} else {
+		candidatePreJobRankValue = EvalNegotiatorMatchRank(
+			"NEGOTIATOR_PRE_JOB_RANK",NegotiatorPreJobRank,
+			request, candidate);
 
-	candidatePostJobRankValue = EvalNegotiatorMatchRank(
-		"NEGOTIATOR_POST_JOB_RANK",NegotiatorPostJobRank,
-		request, candidate);
+		// calculate the request's rank of the candidate
+		double tmp;
+		if(!EvalFloat(ATTR_RANK, &request, candidate, tmp)) {
+			tmp = 0.0;
+		}
+		candidateRankValue = tmp;
 
-	candidatePreemptRankValue = -(FLT_MAX);
-	if(candidatePreemptState != NO_PREEMPTION) {
-		candidatePreemptRankValue = EvalNegotiatorMatchRank(
-			"PREEMPTION_RANK",PreemptionRank,
+		candidatePostJobRankValue = EvalNegotiatorMatchRank(
+			"NEGOTIATOR_POST_JOB_RANK",NegotiatorPostJobRank,
 			request, candidate);
+
+		candidatePreemptRankValue = -(FLT_MAX);
+		if(candidatePreemptState != NO_PREEMPTION) {
+			candidatePreemptRankValue = EvalNegotiatorMatchRank(
+				"PREEMPTION_RANK",PreemptionRank,
+				request, candidate);
+		}
 	}
 
 	if (m_staticRanks) {
@@ -5606,6 +5703,7 @@ MatchListType(int maxlen)
 	m_rejPreemptForRank = 0;
 	m_rejForSubmitterLimit = 0;
 	m_rejForSubmitterCeiling = 0;
+	m_rejForRequirements = 0;
 	m_submitterLimit = 0.0f;
 }
 
@@ -5776,7 +5874,8 @@ get_diagnostics(int & rejForNetwork,
 					int & rejPreemptForPolicy,
 				    int & rejPreemptForRank,
 				    int & rejForSubmitterLimit,
-				    int & rejForSubmitterCeiling) const
+				    int & rejForSubmitterCeiling,
+				    int & rejForRequirements) const
 {
 	rejForNetwork = m_rejForNetwork;
 	rejForNetworkShare = m_rejForNetworkShare;
@@ -5786,6 +5885,7 @@ get_diagnostics(int & rejForNetwork,
 	rejPreemptForRank = m_rejPreemptForRank;
 	rejForSubmitterLimit = m_rejForSubmitterLimit;
 	rejForSubmitterCeiling = m_rejForSubmitterCeiling;
+	rejForRequirements = m_rejForRequirements;
 }
 
 void Matchmaker::MatchListType::
@@ -5796,7 +5896,8 @@ set_diagnostics(int rejForNetwork,
 					int rejPreemptForPolicy,
 				    int rejPreemptForRank,
 				    int rejForSubmitterLimit,
-				    int rejForSubmitterCeiling)
+				    int rejForSubmitterCeiling,
+				    int rejForRequirements)
 {
 	m_rejForNetwork = rejForNetwork;
 	m_rejForNetworkShare = rejForNetworkShare;
@@ -5806,6 +5907,7 @@ set_diagnostics(int rejForNetwork,
 	m_rejPreemptForRank = rejPreemptForRank;
 	m_rejForSubmitterLimit = rejForSubmitterLimit;
 	m_rejForSubmitterCeiling = rejForSubmitterCeiling;
+	m_rejForRequirements = rejForRequirements;
 }
 
 void Matchmaker::MatchListType::
@@ -29,6 +29,8 @@
 #include "dc_collector.h"
 #include "condor_ver_info.h"
 #include "matchmaker_negotiate.h"
+#include "matchmaker_parallel.h"
+#include "matchmaker_slot_index.h"
 #include "GroupEntry.h"
 
 #include <vector>
@@ -95,7 +97,7 @@ class Matchmaker : public Service
 		void forwardAccountingData(std::set<std::string> &names);
 		void forwardGroupAccounting(GroupEntry *ge);
 
-		void calculateRanks(ClassAd &request, ClassAd *offer, PreemptState candidatePreemptState, double &candidateRankValue, double &candidatePreJobRankValue, double &candidatePostJobRankValue, double &candidatePreemptRankValue);
+		void calculateRanks(ClassAd &request, ClassAd *offer, PreemptState candidatePreemptState, double &candidateRankValue, double &candidatePreJobRankValue, double &candidatePostJobRankValue, double &candidatePreemptRankValue, const ParallelMatcher::Candidate *evaluated = NULL);
 
 		void setDryRun(bool d) {m_dryrun = d;}
 		bool getDryRun() const {return m_dryrun;}
@@ -351,6 +353,14 @@ class Matchmaker : public Service
 
 		bool m_staticRanks;
 
+		// evaluates requests against the offers on several threads,
+		// or NULL if NEGOTIATOR_NUM_THREADS is 1
+		ParallelMatcher *parallelMatcher;
+
+		// narrows down the slot ads each request is matched against
+		SlotIndex slotIndex;
+		bool m_useSlotIndex;
+
 		StringList NegotiatorMatchExprNames;
 		StringList NegotiatorMatchExprValues;
 
@@ -395,6 +405,7 @@ class Matchmaker : public Service
 		int rejPreemptForRank;	//   - startd RANKs new job lower?
 		int rejForSubmitterLimit;   //   - not enough group quota?
 		int rejForSubmitterCeiling;   //   - not enough submitter ceiling ?
+		int rejForRequirements;	//   - Requirements don't match (incl. skipped by the slot index)
 	std::set<std::string> rejectedConcurrencyLimits;
 	std::string lastRejectedConcurrencyString;
 		bool m_dryrun;
@@ -477,7 +488,8 @@ class Matchmaker : public Service
 					int & rejPreemptForPolicy,
 					int & rejPreemptForRank,
 					int & rejForSubmitterLimit,
-					int & rejForSubmitterCeiling) const;
+					int & rejForSubmitterCeiling,
+					int & rejForRequirements) const;
 			void set_diagnostics(int rejForNetwork,
 					int rejForNetworkShare,
 					int rejForConcurrencyLimit,
@@ -485,7 +497,8 @@ class Matchmaker : public Service
 					int rejPreemptForPolicy,
 					int rejPreemptForRank,
 					int rejForSubmitterLimit,
-					int rejForSubmitterCeiling);
+					int rejForSubmitterCeiling,
+					int rejForRequirements);
 			void add_candidate(ClassAd* candidate,
 					double candidateRankValue,
 					double candidatePreJobRankValue,
@@ -520,6 +533,7 @@ class Matchmaker : public Service
 			int m_rejPreemptForRank;    //   - startd RANKs new job lower?
 			int m_rejForSubmitterLimit;     //  - not enough group quota?
 			int m_rejForSubmitterCeiling;     //  - not enough submitter ceiling?
+			int m_rejForRequirements;     //  - Requirements don't match
 			float m_submitterLimit;
 			
 			
@@ -0,0 +1,229 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_classad.h"
+#include "condor_attributes.h"
+#include "condor_debug.h"
+#include "consumption_policy.h"
+#include "classad/classadCache.h"
+#include "matchmaker_parallel.h"
+
+static ExprTree * copyExpr(ExprTree * expr)
+{
+	return expr ? expr->Copy() : NULL;
+}
+
+// Evaluate one of the negotiator's expressions with the offer as MY and
+// the request as TARGET.  The offer must be in the worker's match ad.
+static bool evalOfferExpr(ExprTree * expr, ClassAd & offer, classad::Value & result)
+{
+	const classad::ClassAd * old_scope = expr->GetParentScope();
+	expr->SetParentScope(&offer);
+	bool rc = offer.EvaluateExpr(expr, result, classad::Value::ValueType::NUMBER_VALUES);
+	expr->SetParentScope(old_scope);
+	return rc;
+}
+
+static bool evalOfferCond(ExprTree * expr, ClassAd & offer)
+{
+	classad::Value result;
+	bool val = false;
+	return evalOfferExpr(expr, offer, result) && result.IsBooleanValue(val) && val;
+}
+
+// The same as Matchmaker::EvalNegotiatorMatchRank()
+static double evalOfferRank(char const * expr_name, ExprTree * expr, ClassAd & offer)
+{
+	classad::Value result;
+	double rank = -(DBL_MAX);
+
+	if (expr && evalOfferExpr(expr, offer, result)) {
+		double val;
+		if (result.IsNumber(val)) {
+			rank = (float)val;
+		} else {
+			dprintf(D_ALWAYS, "Failed to evaluate %s "
+			                  "expression to a float.\n", expr_name);
+		}
+	} else if (expr) {
+		dprintf(D_ALWAYS, "Failed to evaluate %s "
+		                  "expression.\n", expr_name);
+	}
+	return rank;
+}
+
+ParallelMatcher::ParallelMatcher(int num_threads, int chunk_size, const Exprs & exprs)
+	: pool(num_threads)
+	, chunk_size(chunk_size < 1 ? 1 : chunk_size)
+	, submitter_name(NULL)
+	, consider_preemption(false)
+	, only_for_startdrank(false)
+{
+	for (int ix = 0; ix < pool.size(); ++ix) {
+		Worker * w = new Worker;
+		w->exprs.rankCondStd = copyExpr(exprs.rankCondStd);
+		w->exprs.rankCondPrioPreempt = copyExpr(exprs.rankCondPrioPreempt);
+		w->exprs.PreemptionReq = copyExpr(exprs.PreemptionReq);
+		w->exprs.PreemptionRank = copyExpr(exprs.PreemptionRank);
+		w->exprs.NegotiatorPreJobRank = copyExpr(exprs.NegotiatorPreJobRank);
+		w->exprs.NegotiatorPostJobRank = copyExpr(exprs.NegotiatorPostJobRank);
+		workers.push_back(w);
+	}
+}
+
+ParallelMatcher::~ParallelMatcher()
+{
+	for (auto w : workers) {
+		delete w->exprs.rankCondStd;
+		delete w->exprs.rankCondPrioPreempt;
+		delete w->exprs.PreemptionReq;
+		delete w->exprs.PreemptionRank;
+		delete w->exprs.NegotiatorPreJobRank;
+		delete w->exprs.NegotiatorPostJobRank;
+		delete w;
+	}
+}
+
+void
+ParallelMatcher::evaluate(ClassAd & request, const char * submitterName,
+						  bool consider, bool startdrank_only,
+						  const std::vector<ClassAd *> & offers,
+						  std::vector<Candidate> & results)
+{
+	results.clear();
+	results.resize(offers.size());
+	if (offers.empty()) {
+		return;
+	}
+
+	submitter_name = submitterName;
+	consider_preemption = consider;
+	only_for_startdrank = startdrank_only;
+
+	// The workers only read the request, through their own views of it,
+	// so anything parsed on first use must be parsed now.
+	classad::CachedExprEnvelope::parse_lazy(request);
+
+	// There is no point setting up workers that won't get a chunk.
+	size_t num_chunks = (offers.size() + chunk_size - 1) / chunk_size;
+	size_t num_active = std::min(num_chunks, workers.size());
+	for (size_t ix = 0; ix < num_active; ++ix) {
+		Worker * w = workers[ix];
+		w->request_view.ChainToAd(&request);
+		w->mad.ReplaceLeftAd(&w->request_view);
+	}
+
+	pool.run(offers.size(), chunk_size, [&](size_t begin, size_t end, int worker) {
+		Worker & w = *workers[worker];
+		for (size_t ix = begin; ix < end; ++ix) {
+			evaluateOffer(w, w.request_view, *offers[ix], results[ix]);
+		}
+	});
+
+	for (size_t ix = 0; ix < num_active; ++ix) {
+		workers[ix]->mad.RemoveLeftAd();
+		workers[ix]->request_view.Unchain();
+	}
+}
+
+void
+ParallelMatcher::prepareOffers(ClassAdListDoesNotDeleteAds & offers)
+{
+	ClassAd * offer;
+	offers.Open();
+	while ((offer = offers.Next())) {
+		classad::CachedExprEnvelope::parse_lazy(*offer);
+	}
+	offers.Close();
+}
+
+void
+ParallelMatcher::evaluateOffer(Worker & w, ClassAd & request, ClassAd & offer,
+							   Candidate & result)
+{
+	result.evaluated = false;
+	result.is_match = false;
+	result.remoteUser.clear();
+	result.rank_preempt = false;
+	result.preemption_req = true;
+	result.prio_preempt = false;
+	result.preempt_rank = -(FLT_MAX);
+	result.rank = 0.0;
+	result.pre_job_rank = -(DBL_MAX);
+	result.post_job_rank = -(DBL_MAX);
+
+	// a consumption policy temporarily rewrites the request, and is
+	// evaluated through the shared match ad, so leave those to the caller
+	if (cp_supports_policy(offer)) {
+		return;
+	}
+	result.evaluated = true;
+
+	w.mad.ReplaceRightAd(&offer);
+
+	result.is_match = w.mad.symmetricMatch();
+	if (result.is_match) {
+		if (consider_preemption) {
+			if ( ! offer.LookupString(ATTR_PREEMPTING_ACCOUNTING_GROUP, result.remoteUser)) {
+				if ( ! offer.LookupString(ATTR_PREEMPTING_USER, result.remoteUser)) {
+					if ( ! offer.LookupString(ATTR_ACCOUNTING_GROUP, result.remoteUser)) {
+						offer.LookupString(ATTR_REMOTE_USER, result.remoteUser);
+					}
+				}
+			}
+		}
+
+		// only the predicates the matchmaker will look at
+		if ( ! result.remoteUser.empty()) {
+			Exprs & ex = w.exprs;
+			result.rank_preempt = evalOfferCond(ex.rankCondStd, offer);
+			if ( ! result.rank_preempt && ! only_for_startdrank &&
+				 result.remoteUser != submitter_name)
+			{
+				if (ex.PreemptionReq) {
+					result.preemption_req = evalOfferCond(ex.PreemptionReq, offer);
+				}
+				if (result.preemption_req) {
+					result.prio_preempt = evalOfferCond(ex.rankCondPrioPreempt, offer);
+				}
+			}
+			if (result.rank_preempt || result.prio_preempt) {
+				result.preempt_rank = evalOfferRank("PREEMPTION_RANK", ex.PreemptionRank, offer);
+			}
+		}
+
+		result.pre_job_rank = evalOfferRank("NEGOTIATOR_PRE_JOB_RANK",
+			w.exprs.NegotiatorPreJobRank, offer);
+
+		// like EvalFloat(ATTR_RANK, &request, &offer, rank)
+		double tmp = 0.0;
+		if (request.Lookup(ATTR_RANK)) {
+			if ( ! request.EvaluateAttrNumber(ATTR_RANK, tmp)) { tmp = 0.0; }
+		} else if (offer.Lookup(ATTR_RANK)) {
+			if ( ! offer.EvaluateAttrNumber(ATTR_RANK, tmp)) { tmp = 0.0; }
+		}
+		result.rank = tmp;
+
+		result.post_job_rank = evalOfferRank("NEGOTIATOR_POST_JOB_RANK",
+			w.exprs.NegotiatorPostJobRank, offer);
+	}
+
+	w.mad.RemoveRightAd();
+}
@@ -0,0 +1,116 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _MATCHMAKER_PARALLEL_H
+#define _MATCHMAKER_PARALLEL_H
+
+#include "work_stealing_pool.h"
+
+#include <string>
+#include <vector>
+
+// Evaluates a request against a list of offers on several threads.
+//
+// For each offer this does the expensive, side-effect free part of
+// Matchmaker::matchmakingAlgorithm(): the requirements of both ads, the
+// preemption predicates and the four rank values.  The matchmaker then
+// walks the results in offer order and does everything else (logging,
+// rejection counters, submitter and concurrency limits, picking the best
+// offer) just as it does without threads, so the match it picks does not
+// depend on the number of threads.
+//
+// Each thread keeps its own MatchClassAd and copies of the negotiator's
+// expressions, since evaluating an expression changes its parent scope.
+// The threads share the request through empty ads chained to it, which
+// give each of them its own parent and alternate scope without copying
+// the request.  The request and the offers are only read, so any lazily
+// parsed expressions in them must be parsed before the threads start,
+// see prepareOffers().
+class ParallelMatcher
+{
+ public:
+		// The negotiator expressions to evaluate for each offer.  Any of
+		// them may be NULL.
+	struct Exprs {
+		ExprTree *rankCondStd;
+		ExprTree *rankCondPrioPreempt;
+		ExprTree *PreemptionReq;
+		ExprTree *PreemptionRank;
+		ExprTree *NegotiatorPreJobRank;
+		ExprTree *NegotiatorPostJobRank;
+	};
+
+		// What was learned about one offer.
+	struct Candidate {
+			// false if the offer has a consumption policy, in which case
+			// the matchmaker must evaluate it the usual way.  Nothing
+			// else here is set.
+		bool evaluated;
+		bool is_match;
+			// the rest is set only for offers that match
+		std::string remoteUser;
+			// set only if remoteUser is not empty
+		bool rank_preempt;        // rankCondStd
+		bool preemption_req;      // PREEMPTION_REQUIREMENTS, true if not defined
+		bool prio_preempt;        // rankCondPrioPreempt
+		double preempt_rank;      // PREEMPTION_RANK, if either of the above
+		double rank;
+		double pre_job_rank;
+		double post_job_rank;
+	};
+
+	ParallelMatcher(int num_threads, int chunk_size, const Exprs & exprs);
+	~ParallelMatcher();
+
+	int threads() const { return pool.size(); }
+
+		// Parse the lazily cached expressions of the offers, once for each
+		// negotiation cycle, before they are evaluated on threads.
+	static void prepareOffers(ClassAdListDoesNotDeleteAds & offers);
+
+		// Fill in results[i] for each offers[i].
+	void evaluate(ClassAd & request, const char * submitterName,
+				  bool consider_preemption, bool only_for_startdrank,
+				  const std::vector<ClassAd *> & offers,
+				  std::vector<Candidate> & results);
+
+ private:
+	ParallelMatcher(const ParallelMatcher &);
+	ParallelMatcher & operator=(const ParallelMatcher &);
+
+	struct Worker {
+		classad::MatchClassAd mad;
+		ClassAd request_view;   // empty, chained to the request
+		Exprs exprs;            // this worker's own copies
+	};
+
+	void evaluateOffer(Worker & w, ClassAd & request, ClassAd & offer,
+					   Candidate & result);
+
+	WorkStealingPool pool;
+	std::vector<Worker *> workers;
+	int chunk_size;
+
+		// the arguments to the current evaluate()
+	const char * submitter_name;
+	bool consider_preemption;
+	bool only_for_startdrank;
+};
+
+#endif
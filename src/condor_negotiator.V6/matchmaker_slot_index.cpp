@@ -0,0 +1,451 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_classad.h"
+#include "condor_attributes.h"
+#include "compat_classad_list.h"
+#include "consumption_policy.h"
+#include "matchmaker_slot_index.h"
+
+#include <algorithm>
+
+using classad::ExprTree;
+using classad::Operation;
+using classad::Value;
+
+// integers beyond this can't be compared exactly as doubles
+static const long long MAX_EXACT_INT = 1LL << 53;
+
+// functions whose value depends only on their arguments
+static const char * const pure_functions[] = {
+	"ifThenElse", "isUndefined", "isError", "isString", "isInteger",
+	"isReal", "isBoolean", "int", "real", "string", "floor", "ceiling",
+	"round", "quantize", "pow", "toLower", "toUpper", "strcat", "size",
+};
+
+static bool isPureFunction(const std::string &name)
+{
+	for (auto fn : pure_functions) {
+		if (strcasecmp(name.c_str(), fn) == MATCH) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static const ExprTree * stripParens(const ExprTree *tree)
+{
+	tree = tree->self();
+	while (tree->GetKind() == ExprTree::OP_NODE) {
+		Operation::OpKind op;
+		ExprTree *t1, *t2, *t3;
+		((const Operation*)tree)->GetComponents(op, t1, t2, t3);
+		if (op != Operation::PARENTHESES_OP || ! t1) {
+			break;
+		}
+		tree = t1->self();
+	}
+	return tree;
+}
+
+// If the expression is a reference to an attribute of the bare name
+// (scope == NULL) or of the given scope, return the attribute name.
+static bool isScopedRef(const ExprTree *tree, const char *scope, std::string &attr)
+{
+	if (tree->GetKind() != ExprTree::ATTRREF_NODE) {
+		return false;
+	}
+	ExprTree *expr = NULL;
+	bool absolute = false;
+	((const classad::AttributeReference*)tree)->GetComponents(expr, attr, absolute);
+	if (absolute) {
+		return false;
+	}
+	if ( ! scope) {
+		return expr == NULL;
+	}
+	if ( ! expr || expr->self()->GetKind() != ExprTree::ATTRREF_NODE) {
+		return false;
+	}
+	std::string scope_name;
+	ExprTree *inner = NULL;
+	((const classad::AttributeReference*)expr->self())->GetComponents(inner, scope_name, absolute);
+	return ! inner && ! absolute && strcasecmp(scope_name.c_str(), scope) == MATCH;
+}
+
+// True if the expression evaluates to the same value in the request alone
+// as it does when the request is matched against any slot: it refers only
+// to attributes of the request, which in turn refer only to attributes of
+// the request, and calls no function that might give a different answer
+// the next time.
+static bool isRequestConstant(ClassAd &request, const ExprTree *tree, int depth)
+{
+	if (depth <= 0) {
+		return false;
+	}
+	tree = tree->self();
+	switch (tree->GetKind()) {
+	case ExprTree::LITERAL_NODE:
+		return true;
+
+	case ExprTree::ATTRREF_NODE: {
+		std::string attr;
+		if ( ! isScopedRef(tree, NULL, attr) && ! isScopedRef(tree, "MY", attr)) {
+			return false;
+		}
+		if (strcasecmp(attr.c_str(), "MY") == MATCH || strcasecmp(attr.c_str(), "TARGET") == MATCH) {
+			return false;
+		}
+		ExprTree *expr = request.Lookup(attr);
+		return expr && isRequestConstant(request, expr, depth - 1);
+	}
+
+	case ExprTree::OP_NODE: {
+		Operation::OpKind op;
+		ExprTree *t1, *t2, *t3;
+		((const Operation*)tree)->GetComponents(op, t1, t2, t3);
+		return ( ! t1 || isRequestConstant(request, t1, depth - 1)) &&
+			   ( ! t2 || isRequestConstant(request, t2, depth - 1)) &&
+			   ( ! t3 || isRequestConstant(request, t3, depth - 1));
+	}
+
+	case ExprTree::FN_CALL_NODE: {
+		std::string name;
+		std::vector<ExprTree*> args;
+		((const classad::FunctionCall*)tree)->GetComponents(name, args);
+		if ( ! isPureFunction(name)) {
+			return false;
+		}
+		for (auto arg : args) {
+			if ( ! isRequestConstant(request, arg, depth - 1)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	default:
+		return false;
+	}
+}
+
+// If the expression refers to an attribute of the slot, return its name.
+static bool isSlotRef(ClassAd &request, const ExprTree *tree, std::string &attr)
+{
+	if (isScopedRef(tree, "TARGET", attr)) {
+		return true;
+	}
+	// an unscoped name that the request doesn't have is looked up in the
+	// slot, unless it is one of the names the evaluator treats specially,
+	// such as CurrentTime, which is time() when no ad defines it
+	static const char * const special_names[] = {
+		"MY", "TARGET", "CurrentTime", "self", "parent", "root", "toplevel",
+	};
+	if ( ! isScopedRef(tree, NULL, attr)) {
+		return false;
+	}
+	for (auto name : special_names) {
+		if (strcasecmp(attr.c_str(), name) == MATCH) {
+			return false;
+		}
+	}
+	return ! request.Lookup(attr);
+}
+
+bool
+SlotIndex::getClause(ClassAd &request, const ExprTree *tree, Clause &clause)
+{
+	if (tree->GetKind() != ExprTree::OP_NODE) {
+		return false;
+	}
+	ExprTree *t1, *t2, *t3;
+	((const Operation*)tree)->GetComponents(clause.op, t1, t2, t3);
+	switch (clause.op) {
+	case Operation::EQUAL_OP:
+	case Operation::LESS_THAN_OP:
+	case Operation::LESS_OR_EQUAL_OP:
+	case Operation::GREATER_THAN_OP:
+	case Operation::GREATER_OR_EQUAL_OP:
+		break;
+	default:
+		return false;
+	}
+
+	const ExprTree *left = stripParens(t1);
+	const ExprTree *right = stripParens(t2);
+	const ExprTree *value_expr = right;
+	if ( ! isSlotRef(request, left, clause.attr)) {
+		if ( ! isSlotRef(request, right, clause.attr)) {
+			return false;
+		}
+		// Value OP TARGET.Attr, so turn it around
+		value_expr = left;
+		switch (clause.op) {
+		case Operation::LESS_THAN_OP: clause.op = Operation::GREATER_THAN_OP; break;
+		case Operation::LESS_OR_EQUAL_OP: clause.op = Operation::GREATER_OR_EQUAL_OP; break;
+		case Operation::GREATER_THAN_OP: clause.op = Operation::LESS_THAN_OP; break;
+		case Operation::GREATER_OR_EQUAL_OP: clause.op = Operation::LESS_OR_EQUAL_OP; break;
+		default: break;
+		}
+	}
+
+	if ( ! isRequestConstant(request, value_expr, 10) ||
+		 ! request.EvaluateExpr(value_expr, clause.value))
+	{
+		return false;
+	}
+
+	double dval;
+	long long ival;
+	switch (clause.value.GetType()) {
+	case Value::STRING_VALUE:
+		return clause.op == Operation::EQUAL_OP;
+	case Value::INTEGER_VALUE:
+		clause.value.IsIntegerValue(ival);
+		return ival < MAX_EXACT_INT && ival > -MAX_EXACT_INT;
+	case Value::REAL_VALUE:
+		clause.value.IsRealValue(dval);
+		return ! std::isnan(dval);
+	default:
+		return false;
+	}
+}
+
+void
+SlotIndex::findClauses(ClassAd &request, const ExprTree *tree, std::vector<Clause> &clauses)
+{
+	tree = stripParens(tree);
+	if (tree->GetKind() == ExprTree::OP_NODE) {
+		Operation::OpKind op;
+		ExprTree *t1, *t2, *t3;
+		((const Operation*)tree)->GetComponents(op, t1, t2, t3);
+		if (op == Operation::LOGICAL_AND_OP) {
+			// the && is true only if every clause is true
+			findClauses(request, t1, clauses);
+			findClauses(request, t2, clauses);
+			return;
+		}
+	}
+
+	Clause clause;
+	if (getClause(request, tree, clause)) {
+		clauses.push_back(clause);
+	}
+}
+
+SlotIndex::SlotIndex()
+	: built(false)
+{
+}
+
+void
+SlotIndex::clear()
+{
+	built = false;
+	slots.clear();
+	slot_ids.clear();
+	always.clear();
+	attrs.clear();
+}
+
+void
+SlotIndex::build(ClassAdListDoesNotDeleteAds &startdAds)
+{
+	clear();
+
+	ClassAd *ad;
+	startdAds.Open();
+	while ((ad = startdAds.Next())) {
+		slot_ids[ad] = (int)slots.size();
+		slots.push_back(ad);
+		always.push_back(cp_supports_policy(*ad));
+	}
+	startdAds.Close();
+
+	built = true;
+}
+
+void
+SlotIndex::markChanged(ClassAd *slot)
+{
+	auto it = slot_ids.find(slot);
+	if (it != slot_ids.end()) {
+		always[it->second] = true;
+	}
+}
+
+SlotIndex::AttrIndex &
+SlotIndex::attrIndex(const std::string &attr)
+{
+	auto found = attrs.find(attr);
+	if (found != attrs.end()) {
+		return found->second;
+	}
+
+	AttrIndex &index = attrs[attr];
+	Value val;
+	double dval;
+	long long ival;
+	std::string sval;
+	for (int id = 0; id < (int)slots.size(); ++id) {
+		ExprTree *tree = slots[id]->Lookup(attr);
+		if ( ! tree) {
+			continue;
+		}
+		tree = const_cast<ExprTree*>(tree->self());
+		if (tree->GetKind() != ExprTree::LITERAL_NODE) {
+			index.others.push_back(id);
+			continue;
+		}
+		((classad::Literal*)tree)->GetValue(val);
+		switch (val.GetType()) {
+		case Value::UNDEFINED_VALUE:
+		case Value::ERROR_VALUE:
+			break;
+		case Value::STRING_VALUE:
+			val.IsStringValue(sval);
+			lower_case(sval);
+			index.strings[sval].push_back(id);
+			break;
+		case Value::INTEGER_VALUE:
+			val.IsIntegerValue(ival);
+			if (ival < MAX_EXACT_INT && ival > -MAX_EXACT_INT) {
+				index.numbers.emplace_back((double)ival, id);
+			} else {
+				index.others.push_back(id);
+			}
+			break;
+		case Value::REAL_VALUE:
+			val.IsRealValue(dval);
+			if ( ! std::isnan(dval)) {
+				index.numbers.emplace_back(dval, id);
+			} else {
+				index.others.push_back(id);
+			}
+			break;
+		default:
+			index.others.push_back(id);
+			break;
+		}
+	}
+	std::sort(index.numbers.begin(), index.numbers.end());
+	return index;
+}
+
+// Set matches[id] for every slot for which the clause may be true.
+void
+SlotIndex::lookup(const Clause &clause, std::vector<bool> &matches)
+{
+	AttrIndex &index = attrIndex(clause.attr);
+	matches.assign(slots.size(), false);
+
+	for (int id : index.others) {
+		matches[id] = true;
+	}
+
+	std::string sval;
+	if (clause.value.IsStringValue(sval)) {
+		lower_case(sval);
+		auto it = index.strings.find(sval);
+		if (it != index.strings.end()) {
+			for (int id : it->second) {
+				matches[id] = true;
+			}
+		}
+		// comparing a string to a number is an error, but don't count on it
+		for (auto & num : index.numbers) {
+			matches[num.second] = true;
+		}
+		return;
+	}
+
+	double dval = 0;
+	clause.value.IsNumber(dval);
+	std::pair<double, int> lo(dval, -1), hi(dval, INT_MAX);
+	auto begin = index.numbers.begin();
+	auto end = index.numbers.end();
+	switch (clause.op) {
+	case Operation::EQUAL_OP:
+		begin = std::lower_bound(index.numbers.begin(), index.numbers.end(), lo);
+		end = std::upper_bound(begin, index.numbers.end(), hi);
+		break;
+	case Operation::LESS_THAN_OP:
+		end = std::lower_bound(index.numbers.begin(), index.numbers.end(), lo);
+		break;
+	case Operation::LESS_OR_EQUAL_OP:
+		end = std::upper_bound(index.numbers.begin(), index.numbers.end(), hi);
+		break;
+	case Operation::GREATER_THAN_OP:
+		begin = std::upper_bound(index.numbers.begin(), index.numbers.end(), hi);
+		break;
+	case Operation::GREATER_OR_EQUAL_OP:
+		begin = std::lower_bound(index.numbers.begin(), index.numbers.end(), lo);
+		break;
+	default:
+		break;
+	}
+	for (auto it = begin; it < end; ++it) {
+		matches[it->second] = true;
+	}
+	// as above, for a string compared to a number
+	for (auto & str : index.strings) {
+		for (int id : str.second) {
+			matches[id] = true;
+		}
+	}
+}
+
+bool
+SlotIndex::findCandidates(ClassAd &request, std::vector<bool> &candidates)
+{
+	ExprTree *requirements = built ? request.Lookup(ATTR_REQUIREMENTS) : NULL;
+	if ( ! requirements) {
+		return false;
+	}
+
+	std::vector<Clause> clauses;
+	findClauses(request, requirements, clauses);
+	if (clauses.empty()) {
+		return false;
+	}
+
+	candidates.assign(slots.size(), true);
+	std::vector<bool> matches;
+	for (auto & clause : clauses) {
+		lookup(clause, matches);
+		for (int id = 0; id < (int)slots.size(); ++id) {
+			if ( ! matches[id] && ! always[id]) {
+				candidates[id] = false;
+			}
+		}
+	}
+	return true;
+}
+
+bool
+SlotIndex::isCandidate(const std::vector<bool> &candidates, ClassAd *slot) const
+{
+	auto it = slot_ids.find(slot);
+	if (it == slot_ids.end()) {
+		// not around when the index was built
+		return true;
+	}
+	return candidates[it->second];
+}
@@ -0,0 +1,100 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _MATCHMAKER_SLOT_INDEX_H
+#define _MATCHMAKER_SLOT_INDEX_H
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// An index over the slot ads of one negotiation cycle, used to narrow
+// down the slots a request is matched against.
+//
+// The request's Requirements is split into its && clauses, and clauses
+// of the form TARGET.Attr OP Value, where OP is a comparison and Value
+// does not depend on the slot, are looked up in the index.  A hash of the
+// string values of Attr serves ==, and a sorted array of the numeric
+// values serves the rest.  The index for an attribute is built the first
+// time a request needs it.
+//
+// This only ever rules out slots for which the clause cannot be true, so
+// it never loses a match.  Slots whose value for Attr is an expression or
+// of an unexpected type are always candidates, as are slots that were
+// changed after the index was built (see markChanged()) and slots with a
+// consumption policy, since that rewrites the request's RequestXxx
+// attributes during matching.
+class SlotIndex
+{
+ public:
+	SlotIndex();
+
+		// Forget everything.  Call this before the ads go away.
+	void clear();
+
+		// Index the given slot ads, which must not be deleted until
+		// clear() is called.
+	void build(ClassAdListDoesNotDeleteAds &startdAds);
+
+	bool isBuilt() const { return built; }
+
+		// The slot has been changed by the matchmaker, so the index can't
+		// be trusted for it.
+	void markChanged(ClassAd *slot);
+
+		// Find the slots that may match the request.  Returns false if
+		// nothing in the request's Requirements could be looked up, in
+		// which case every slot may match.
+	bool findCandidates(ClassAd &request, std::vector<bool> &candidates);
+
+		// Whether the slot is among the candidates found above.
+	bool isCandidate(const std::vector<bool> &candidates, ClassAd *slot) const;
+
+ private:
+		// The values of one attribute across all slots.  A slot without
+		// the attribute is in none of these, since any comparison with
+		// undefined is not true.
+	struct AttrIndex {
+		std::unordered_map<std::string, std::vector<int> > strings;  // by lower-cased value
+		std::vector<std::pair<double, int> > numbers;                // sorted
+		std::vector<int> others;    // any other literal type, or an expression
+	};
+
+		// One clause of the Requirements that can be looked up.
+	struct Clause {
+		std::string attr;
+		classad::Operation::OpKind op;   // TARGET.attr op value
+		classad::Value value;
+	};
+
+	AttrIndex & attrIndex(const std::string &attr);
+	void lookup(const Clause &clause, std::vector<bool> &matches);
+
+	static void findClauses(ClassAd &request, const classad::ExprTree *tree, std::vector<Clause> &clauses);
+	static bool getClause(ClassAd &request, const classad::ExprTree *tree, Clause &clause);
+
+	bool built;
+	std::vector<ClassAd *> slots;
+	std::unordered_map<const ClassAd *, int> slot_ids;   // index into slots
+	std::vector<bool> always;   // slots that are candidates for every request
+	std::map<std::string, AttrIndex, classad::CaseIgnLTStr> attrs;
+};
+
+#endif
@@ -0,0 +1,202 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// Checks that matching with the SlotIndex finds the same slots as
+// matching every slot, for randomly made up slots and requests.
+
+#include "condor_common.h"
+#include "condor_classad.h"
+#include "compat_classad_list.h"
+#include "compat_classad_util.h"
+#include "matchmaker_slot_index.h"
+#include "test_random_ads.h"
+
+#include <string>
+#include <vector>
+
+static const char * const arches[] = { "X86_64", "x86_64", "ppc64le", "aarch64" };
+static const char * const opsyses[] = { "LINUX", "WINDOWS", "macos" };
+
+static ClassAd * make_slot(int id)
+{
+	ClassAd *slot = new ClassAd();
+	slot->Assign("Name", std::string("slot") + std::to_string(id));
+	slot->Assign("Requirements", true);
+
+	// Memory and Cpus, which the index sorts slots by, are sometimes missing
+	// or not an int it can sort: an expression, a real, a string, or a Cpus
+	// too big for an int.  Arch is sometimes not a string.
+	switch (rand() % 6) {
+	case 0: break;
+	case 1: slot->AssignExpr("Memory", "1024 * 4"); break;
+	case 2: slot->Assign("Memory", (rand() % 64) * 512.0 + 0.5); break;
+	case 3: slot->Assign("Memory", "lots"); break;
+	default: slot->Assign("Memory", (long long)(rand() % 64) * 512); break;
+	}
+	switch (rand() % 6) {
+	case 0: break;
+	case 1: slot->AssignExpr("Cpus", "TotalCpus / 2"); slot->Assign("TotalCpus", rand() % 16); break;
+	case 2: slot->Assign("Cpus", (long long)1 << 60); break;
+	default: slot->Assign("Cpus", rand() % 16); break;
+	}
+	switch (rand() % 5) {
+	case 0: break;
+	case 1: slot->Assign("Arch", rand() % 4); break;
+	default: slot->Assign("Arch", random_pick(arches)); break;
+	}
+	if (rand() % 4) {
+		slot->Assign("OpSys", random_pick(opsyses));
+	}
+	if (rand() % 2) {
+		slot->Assign("HasDocker", (rand() % 2) != 0);
+	}
+	return slot;
+}
+
+// a clause the index may look up, or one it must leave alone
+static std::string make_clause()
+{
+	static const char * const ops[] = { "==", "<", "<=", ">", ">=" };
+	std::string clause;
+	switch (rand() % 12) {
+	case 0:
+		formatstr(clause, "TARGET.Memory %s MY.RequestMemory", random_pick(ops));
+		break;
+	case 1:
+		formatstr(clause, "%d %s TARGET.Cpus", rand() % 16, random_pick(ops));
+		break;
+	case 2:
+		formatstr(clause, "TARGET.Memory %s %d.5", random_pick(ops), rand() % 32768);
+		break;
+	case 3:
+		formatstr(clause, "TARGET.Arch == \"%s\"", random_pick(arches));
+		break;
+	case 4:
+		formatstr(clause, "OpSys == \"%s\"", random_pick(opsyses));
+		break;
+	case 5:
+		formatstr(clause, "(TARGET.Cpus %s %d || TARGET.HasDocker)", random_pick(ops), rand() % 16);
+		break;
+	case 6:
+		clause = "TARGET.HasDocker";
+		break;
+	case 7:
+		formatstr(clause, "TARGET.Cpus %s %lld", random_pick(ops), ((long long)1 << 60) + (rand() % 3) - 1);
+		break;
+	case 8:
+		formatstr(clause, "TARGET.Memory %s MY.RequestMemory * TARGET.Cpus", random_pick(ops));
+		break;
+	case 9:
+		// CurrentTime is time() and not a slot attribute
+		formatstr(clause, "CurrentTime %s %lld", random_pick(ops), (long long)time(NULL) + (rand() % 7200) - 3600);
+		break;
+	case 10:
+		formatstr(clause, "%d %s currenttime", rand() % 1000, random_pick(ops));
+		break;
+	default:
+		formatstr(clause, "TARGET.Arch =?= \"%s\"", random_pick(arches));
+		break;
+	}
+	return clause;
+}
+
+static ClassAd * make_request()
+{
+	ClassAd *request = new ClassAd();
+	request->Assign("RequestMemory", (rand() % 64) * 512);
+	std::string requirements = make_clause();
+	for (int n = rand() % 4; n > 0; --n) {
+		requirements += " && " + make_clause();
+	}
+	request->AssignExpr("Requirements", requirements.c_str());
+	return request;
+}
+
+int
+main( int argc, char ** argv )
+{
+	random_test_seed(argc, argv);
+
+	// as in the negotiator, where CurrentTime and MY are special
+	classad::SetOldClassAdSemantics(true);
+
+	const int num_slots = 500;
+	const int num_requests = 2000;
+
+	std::vector<ClassAd *> slots;
+	ClassAdListDoesNotDeleteAds startdAds;
+	for (int id = 0; id < num_slots; ++id) {
+		slots.push_back(make_slot(id));
+		startdAds.Insert(slots.back());
+	}
+
+	SlotIndex index;
+	index.build(startdAds);
+
+	// a slot changed after the index was built must still be a candidate
+	ClassAd *changed = slots[0];
+	changed->Assign("Memory", 1 << 30);
+	index.markChanged(changed);
+
+	unsigned failures = 0;
+	int looked_up = 0;
+	int matched = 0;
+	int skipped = 0;
+	for (int ix = 0; ix < num_requests; ++ix) {
+		ClassAd *request = make_request();
+		std::string requirements = ExprTreeToString(request->Lookup("Requirements"));
+
+		std::vector<bool> candidates;
+		bool use_index = index.findCandidates(*request, candidates);
+		if (use_index) { ++looked_up; }
+
+		for (auto slot : slots) {
+			bool is_a_match = IsAMatch(request, slot);
+			bool is_candidate = ! use_index || index.isCandidate(candidates, slot);
+			if (is_a_match) { ++matched; }
+			if ( ! is_candidate) { ++skipped; }
+			if (is_a_match && ! is_candidate) {
+				++failures;
+				std::string name;
+				slot->LookupString("Name", name);
+				std::string slot_text;
+				sPrintAd(slot_text, *slot);
+				fprintf(stderr, "index ruled out %s, which matches %s\n%s\n",
+					name.c_str(), requirements.c_str(), slot_text.c_str());
+			}
+		}
+		delete request;
+	}
+
+	index.clear();
+	for (auto slot : slots) {
+		delete slot;
+	}
+
+	fprintf(stdout, "%d of %d requests used the index, %d matches, %d slots ruled out\n",
+		looked_up, num_requests, matched, skipped);
+	if (looked_up == 0 || skipped == 0) {
+		fprintf(stderr, "the index was never used\n");
+		++failures;
+	}
+	if( failures == 0 ) {
+		fprintf( stdout, "No failures detected.\n" );
+	}
+	return failures;
+}
@@ -3749,6 +3749,15 @@ bool print_jobs_analysis (
 // query SCHEDD daemon for jobs. and then print out the desired job info.
 // this function handles -analyze, -streaming, -dag and all normal condor_q output
 // when the source is a SCHEDD.
+// The job ads are parsed into an arena, so that they are allocated in large blocks
+// and the blocks reused as we print and delete the ads. The arena is never freed,
+// since the ads we keep may be deleted as we exit.
+static classad::ClassAdArena * job_ad_arena()
+{
+	static classad::ClassAdArena * arena = new classad::ClassAdArena();
+	return arena;
+}
+
 static bool
 show_schedd_queue(const char* scheddAddress, const char* scheddName, const char* scheddMachine, int useFastPath,CondorClassAdListWriter &writer )
 {
@@ -3833,6 +3842,7 @@ show_schedd_queue(const char* scheddAddress, const char* scheddName, const char*
 	if (dash_unmatchable) pattrs = &no_attrs; // we need all of the attrs to do matchmaking.
 	int fetchResult;
 	if (dash_dry_run) {
+		classad::ClassAdArenaScope arena_scope(job_ad_arena());
 		fetchResult = dryFetchQueue(dry_run_file, *pattrs, fetch_opts, g_match_limit, pfnProcess, pvProcess);
 	} else {
 		if (dash_long || pattrs->contains_anycase(ATTR_SERVER_TIME)) {
@@ -3841,6 +3851,7 @@ show_schedd_queue(const char* scheddAddress, const char* scheddName, const char*
 			// we do this so that a subsequent "condor_q -jobs <file> -nobatch" will show the correct job times.
 			Q.requestServerTime(true);
 		}
+		classad::ClassAdArenaScope arena_scope(job_ad_arena());
 		fetchResult = Q.fetchQueueFromHostAndProcess(scheddAddress, *pattrs, fetch_opts, g_match_limit, pfnProcess, pvProcess, useFastPath, &errstack, &summary_ad);
 		// In support of HTCONDOR-1125, grab queue time from summary ad if it is there.
 		if (summary_ad) { summary_ad->LookupInteger(ATTR_SERVER_TIME, queue_time); }
@@ -4118,6 +4129,7 @@ show_file_queue(const char* jobads, const char* userlog)
 	if (jobads != NULL) {
 		/* get the "q" from the job ads file */
 		CondorQClassAdFileParseHelper jobads_file_parse_helper(jobads_file_format);
+		classad::ClassAdArenaScope arena_scope(job_ad_arena());
 		if ( ! iter_ads_from_file(jobads, AddJobToClassAdCollection, &jobs, jobads_file_parse_helper, constr.Expr())) {
 			return false;
 		}
@@ -45,12 +45,18 @@ private:
 	std::set<JOB_ID_KEY>::const_iterator it;
 };
 
+// every JobCluster has a different generation after each clear(), so that a
+// JobSignature is never mistaken as belonging to the wrong set of autoclusters.
+static unsigned int last_generation = 0;
+
 JobCluster::JobCluster()
 	: next_id(1)
 	, significant_attrs(NULL)
 #ifdef USE_AUTOCLUSTER_TO_JOBID_MAP
 	, keep_job_ids(false)
 #endif
+	, generation(++last_generation)
+	, hashed_sigs(false)
 {
 }
 
@@ -68,9 +74,40 @@ void JobCluster::clear()
 	cluster_use.clear();
 	cluster_gone.clear();
 #endif
+	key_map.clear();
+	for (auto & entry : sig_entries) { delete entry.second; }
+	sig_entries.clear();
+	generation = ++last_generation;
 	next_id = 1;
 }
 
+bool JobCluster::setHashedSignatures(bool enable)
+{
+	if (enable == hashed_sigs) {
+		return false;
+	}
+	clear();
+	hashed_sigs = enable;
+	return true;
+}
+
+void JobCluster::eraseHashedCluster(int id)
+{
+	std::map<int, SigEntry*>::iterator it = sig_entries.find(id);
+	if (it == sig_entries.end()) {
+		return;
+	}
+	auto range = key_map.equal_range(it->second->key);
+	for (auto kit = range.first; kit != range.second; ++kit) {
+		if (kit->second == id) {
+			key_map.erase(kit);
+			break;
+		}
+	}
+	delete it->second;
+	sig_entries.erase(it);
+}
+
 bool JobCluster::setSigAttrs(const char* new_sig_attrs, bool free_input_attrs, bool replace_attrs)
 {
 	if ( ! new_sig_attrs) {
@@ -195,7 +232,10 @@ void JobCluster::collect_garbage(bool brute_force) // free the deleted clusters
 		}
 		// advance here so that we can erase the previous entry if needed.
 		JobSigidMap::iterator last = it++;
-		if (gone) { cluster_map.erase(last); }
+		if (gone) {
+			if (hashed_sigs) { eraseHashedCluster(last->second); }
+			cluster_map.erase(last);
+		}
 	}
 	cluster_gone.clear();
 }
@@ -204,22 +244,11 @@ void JobCluster::collect_garbage(bool brute_force) // free the deleted clusters
 
 extern int    last_autocluster_classad_cache_hit;
 
-int JobCluster::getClusterid(JobQueueJob & job, bool expand_refs, std::string * final_list)
+// fetch the value of each significant attribute into sigset, and if expand_refs is true
+// also find the attributes those values refer to, and fetch their values as well.
+// sigset gets the significant values first, followed by the values of exattrs in order.
+void JobCluster::collectSigValues(JobQueueJob & job, bool expand_refs, classad::References & exattrs, std::vector<ExprTree*> & sigset)
 {
-	int cur_id = -1;
-
-	// we want to summarize job into a string "signature"
-	// the signature will consist of "key1=val1\nkey2=val2\n"
-	// for each of the keys in the significant_attrs list and (if expand_refs is true)
-	// the keys that the significant_attrs values refer to that are internal references.
-	// the order of the keys in the signature will be the same as the order specified in significant_attrs
-	// followed by the expanded keys in case-insensitive alpha order.
-
-	// first put build a set of class ad values, one for each significant attribute
-	//
-	classad::References exattrs;   // expanded attribs if requested
-	std::vector<ExprTree*> sigset; // significant values, including expanded attribs if requested
-
 	// walk significant attributes list and fetch values for each attrib
 	// also fetch internal references if requested.
 	StringTokenIterator list(significant_attrs);
@@ -262,6 +291,28 @@ int JobCluster::getClusterid(JobQueueJob & job, bool expand_refs, std::string *
 			}
 		}
 	}
+}
+
+int JobCluster::getClusterid(JobQueueJob & job, bool expand_refs, std::string * final_list)
+{
+	int cur_id = -1;
+
+	if (hashed_sigs) {
+		return getClusteridHashed(job, expand_refs, final_list);
+	}
+
+	// we want to summarize job into a string "signature"
+	// the signature will consist of "key1=val1\nkey2=val2\n"
+	// for each of the keys in the significant_attrs list and (if expand_refs is true)
+	// the keys that the significant_attrs values refer to that are internal references.
+	// the order of the keys in the signature will be the same as the order specified in significant_attrs
+	// followed by the expanded keys in case-insensitive alpha order.
+
+	// first put build a set of class ad values, one for each significant attribute
+	//
+	classad::References exattrs;   // expanded attribs if requested
+	std::vector<ExprTree*> sigset; // significant values, including expanded attribs if requested
+	collectSigValues(job, expand_refs, exattrs, sigset);
 
 	// sigset now contains the values of all the attributes we need,
 	// significant attibutes are first, followed by expanded attributes
@@ -275,7 +326,8 @@ int JobCluster::getClusterid(JobQueueJob & job, bool expand_refs, std::string *
 	unp.SetOldClassAd( true, true );
 
 	// first put the pre-defined significant attrs in the sig
-	list.rewind();
+	StringTokenIterator list(significant_attrs);
+	const std::string * attr;
 	int ix = 0;
 	while ((attr = list.next_string())) {
 		ExprTree * tree = sigset[ix];
@@ -338,6 +390,200 @@ int JobCluster::getClusterid(JobQueueJob & job, bool expand_refs, std::string *
 	return cur_id;
 }
 
+// the boost hash_combine mix, and a multiply/rotate mix that is independent of it
+static inline size_t hash_combine(size_t seed, size_t val)
+{
+	return seed ^ (val + (size_t)0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+static inline size_t hash_combine2(size_t seed, size_t val)
+{
+	seed = (seed ^ val) * (size_t)0xff51afd7ed558ccdULL;
+	return (seed << 31) | (seed >> (sizeof(size_t)*8 - 31));
+}
+
+// true if the value can't refer to other attributes, so changing it can't
+// change which attributes are in a JobSignature
+static bool is_literal_value(const classad::ExprTree * tree)
+{
+	if ( ! tree) {
+		return true;
+	}
+	if (tree->GetKind() == classad::ExprTree::EXPR_ENVELOPE) {
+		tree = ((const classad::CachedExprEnvelope*)tree)->get();
+		if ( ! tree) return false;
+	}
+	return tree->GetKind() == classad::ExprTree::LITERAL_NODE;
+}
+
+// SameAs() for the top level values of two jobs, one of which may be
+// cached when the other is not.
+static bool same_value(const classad::ExprTree * tree1, const classad::ExprTree * tree2)
+{
+	if (tree1 == tree2) {
+		return true;
+	}
+	if ( ! tree1 || ! tree2) {
+		return false;
+	}
+	bool env1 = tree1->GetKind() == classad::ExprTree::EXPR_ENVELOPE;
+	bool env2 = tree2->GetKind() == classad::ExprTree::EXPR_ENVELOPE;
+	if (env1 != env2) {
+		if (env1) { tree1 = ((const classad::CachedExprEnvelope*)tree1)->get(); }
+		if (env2) { tree2 = ((const classad::CachedExprEnvelope*)tree2)->get(); }
+		if ( ! tree1 || ! tree2) return false;
+	}
+	return tree1->SameAs(tree2);
+}
+
+bool JobCluster::SigEntry::matches(const JobSignature & sig) const
+{
+	if (sig.parts.size() != attrs.size()) {
+		return false;
+	}
+	for (size_t ix = 0; ix < attrs.size(); ++ix) {
+		const JobSignature::Part & part = sig.parts[ix];
+		if (part.attr != attrs[ix] || ! same_value(values[ix], part.tree)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// (re)build the parts of a job's signature from scratch
+void JobCluster::buildSignature(JobQueueJob & job, bool expand_refs, JobSignature & sig)
+{
+	classad::References exattrs;
+	std::vector<ExprTree*> sigset;
+	collectSigValues(job, expand_refs, exattrs, sigset);
+
+	sig.parts.clear();
+	sig.parts.reserve(sigset.size());
+	sig.generation = generation;
+	sig.expand_refs = expand_refs;
+
+	StringTokenIterator list(significant_attrs);
+	classad::References::const_iterator xit = exattrs.begin();
+	const std::string * attr;
+	for (ExprTree * tree : sigset) {
+		if ( ! (attr = list.next_string())) { attr = &*xit++; }
+		JobSignature::Part part;
+		part.attr = classad::InternAttrName(*attr);
+		part.tree = tree;
+		part.hash = tree ? tree->StructuralHash() : 0;
+		part.literal = is_literal_value(tree);
+		sig.parts.push_back(part);
+	}
+}
+
+int JobCluster::getClusteridHashed(JobQueueJob & job, bool expand_refs, std::string * final_list)
+{
+	int cur_id = -1;
+
+	// bring the job's signature up to date, rehashing only the values that have changed.
+	// if a changed value may have changed the set of expanded attributes, start over.
+	JobSignature * sig = job.autocluster_sig;
+	if ( ! sig) {
+		sig = job.autocluster_sig = new JobSignature();
+	}
+	// values are compared by hash rather than by pointer, since a value inherited
+	// from the cluster ad can be freed and another put at the same address.
+	bool rebuild = (sig->generation != generation || sig->expand_refs != expand_refs);
+	for (size_t ix = 0; ! rebuild && ix < sig->parts.size(); ++ix) {
+		JobSignature::Part & part = sig->parts[ix];
+		ExprTree * tree = job.Lookup(*part.attr);
+		size_t hash = tree ? tree->StructuralHash() : 0;
+		if (hash != part.hash) {
+			bool literal = is_literal_value(tree);
+			if (expand_refs && ! (part.literal && literal)) {
+				rebuild = true;
+				break;
+			}
+			part.hash = hash;
+			part.literal = literal;
+		}
+		part.tree = tree;
+	}
+	if (rebuild) {
+		buildSignature(job, expand_refs, *sig);
+	}
+
+	// combine the hashes into the key, and look for an autocluster with a matching key.
+	SigKey key = { (size_t)0x6a09e667f3bcc908ULL, (size_t)0xbb67ae8584caa73bULL };
+	for (const auto & part : sig->parts) {
+		key.h1 = hash_combine(hash_combine(key.h1, part.attr->hash), part.hash);
+		key.h2 = hash_combine2(hash_combine2(key.h2, part.attr->hash), part.hash);
+	}
+
+	auto range = key_map.equal_range(key);
+	for (auto it = range.first; it != range.second; ++it) {
+		std::map<int, SigEntry*>::iterator eit = sig_entries.find(it->second);
+		if (eit != sig_entries.end() && eit->second->matches(*sig)) {
+			cur_id = it->second;
+			break;
+		}
+	}
+
+	if (cur_id < 0) {
+		cur_id = next_id++;
+
+		SigEntry * entry = new SigEntry();
+		entry->key = key;
+		entry->attrs.reserve(sig->parts.size());
+		entry->values.reserve(sig->parts.size());
+		for (const auto & part : sig->parts) {
+			entry->attrs.push_back(part.attr);
+			entry->values.push_back(part.tree ? part.tree->Copy() : NULL);
+		}
+		sig_entries[cur_id] = entry;
+		key_map.emplace(key, cur_id);
+
+		// the text signature is only needed by aggregation, so it is built once per autocluster
+		std::string signature;
+		classad::ClassAdUnParser unp;
+		unp.SetOldClassAd( true, true );
+		for (const auto & part : sig->parts) {
+			signature += part.attr->name;
+			signature += " = ";
+			if (part.tree) { unp.Unparse(signature, part.tree); }
+			signature += '\n';
+		}
+		cluster_map.insert(JobSigidMap::value_type(signature, cur_id));
+	}
+
+	if (final_list) {
+		// use the spelling from the significant attributes list where we have it.
+		bool need_sep = false;
+		StringTokenIterator list(significant_attrs);
+		const std::string * attr;
+		for (const auto & part : sig->parts) {
+			if (need_sep) { (*final_list) += ','; }
+			need_sep = true;
+			if ((attr = list.next_string())) {
+				final_list->append(*attr);
+			} else {
+				final_list->append(part.attr->name);
+			}
+		}
+	}
+
+#ifdef USE_AUTOCLUSTER_TO_JOBID_MAP
+	if (keep_job_ids) {
+		JobIdSetMap::iterator jit = find_job_id_set(job);
+		if (jit != cluster_use.end()) {
+			int old_id = jit->first;
+			if (old_id != cur_id) {
+				jit->second.erase(job.jid);
+				if (jit->second.empty()) { cluster_gone.insert(old_id); }
+				cluster_use[cur_id].insert(job.jid);
+			}
+		} else {
+			cluster_use[cur_id].insert(job.jid);
+		}
+	}
+#endif
+	return cur_id;
+}
+
 // AutoCluster is an instance of JobCluster with additional semantics because it can pull
 // it's config from params as well as from input.
 //
@@ -521,6 +767,10 @@ bool AutoCluster::config(const classad::References &basic_attrs, const char* sig
 
 	bool replace_attrs = sig_attrs_came_from_config_file;
 	bool changed = this->setSigAttrs(new_sig_attrs, true, replace_attrs);
+	if (this->setHashedSignatures(param_boolean("AUTOCLUSTER_HASHED_SIGNATURES", true))) {
+		// all of the autoclusters were thrown away
+		changed = true;
+	}
 	if (changed) {
 		sig_attrs_changed = true;
 	} else if (sig_attrs_changed) {
@@ -564,6 +814,13 @@ void AutoCluster::sweep()
 			cluster_map.erase( it );
 		}
 	}
+
+	for (auto sit = sig_entries.begin(); sit != sig_entries.end(); ) {
+		int id = (sit++)->first; // advance first, eraseHashedCluster invalidates the iterator
+		if (cluster_in_use.find(id) == cluster_in_use.end()) {
+			eraseHashedCluster(id);
+		}
+	}
 }
 
 extern double last_autocluster_runtime;
@@ -610,6 +867,7 @@ int AutoCluster::getAutoClusterid(JobQueueJob *job)
 		// put the new auto cluster id into the job ad to cache it.
 	job->Assign(ATTR_AUTO_CLUSTER_ID,cur_id);
 	job->autocluster_id = cur_id;
+	UpdateJobQueueIndexes(job->jid);
 
 		// for some nice feedback, place the final list of attrs used to create this
 		// signature into the job ad.
@@ -629,6 +887,7 @@ bool AutoCluster::preSetAttribute(JobQueueJob &job, const char * attr, const cha
 	// the signature needs to be recomputed as it may have changed.
 	// Note we do this whether or not the transaction is committed - that
 	// is ok, and actually is probably more efficient than hitting disk.
+
 	ExprTree * expr = job.Lookup(ATTR_AUTO_CLUSTER_ATTRS);
 	if (expr) {
 		std::string tmp;
@@ -663,6 +922,7 @@ void AutoCluster::removeFromAutocluster(JobQueueJob &job)
 		job.Delete(ATTR_AUTO_CLUSTER_ID);
 		job.Delete(ATTR_AUTO_CLUSTER_ATTRS);
 		job.autocluster_id = -1;
+		UpdateJobQueueIndexes(job.jid);
 	}
 }
 
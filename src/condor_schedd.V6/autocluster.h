@@ -26,17 +26,41 @@
 
 #include "condor_classad.h"
 #include <generic_stats.h>
+#include <unordered_map>
 
 class JobIdSet;
 class JobAggregationResults;
 class JobQueueJob;
 
+/** Per-job state for the hashed signature mode of JobCluster.  Holds the
+	attributes that make up the job's signature, and the StructuralHash()
+	of the value of each, so that a value that hasn't changed doesn't
+	cause the signature to be rebuilt.
+*/
+class JobSignature {
+public:
+	JobSignature() : generation(0), expand_refs(false) {}
+
+	struct Part {
+		const classad::AttrNameAtom * attr;
+		const classad::ExprTree * tree; // the job's value when the signature was last brought up to date
+		size_t hash;      // StructuralHash() of tree, or 0 if the job had no value
+		bool   literal;   // tree could not refer to other attributes
+	};
+
+	unsigned int generation; // JobCluster::generation the parts were built for
+	bool expand_refs;        // parts include the attributes the significant attributes refer to
+	std::vector<Part> parts; // significant attributes in order, followed by expanded references
+};
+
 class JobCluster {
 public:
 	JobCluster();
 	~JobCluster();
 
 	bool setSigAttrs(const char* new_sig_attrs, bool free_input_attrs, bool replace_attrs);
+	// use hashed signatures rather than text signatures, returns true if the mode changed
+	bool setHashedSignatures(bool enable);
 #ifdef USE_AUTOCLUSTER_TO_JOBID_MAP
 	void keepJobIds(bool keep) { keep_job_ids = keep; }
 #endif
@@ -63,6 +87,42 @@ protected:
 #ifdef USE_AUTOCLUSTER_TO_JOBID_MAP
 	bool keep_job_ids;
 #endif
+
+	// In the hashed signature mode autoclusters are found by a 128 bit key made
+	// from the JobSignature of the job rather than by the text of the signature.
+	// A key match is confirmed by comparing the job's values to those of the job
+	// that created the autocluster with SameAs(), which for cached expressions is
+	// a pointer compare.  cluster_map still gets the text signature of each new
+	// autocluster so that it can be aggregated and swept as before.
+	struct SigKey {
+		size_t h1, h2;
+		bool operator==(const SigKey & rhs) const { return h1 == rhs.h1 && h2 == rhs.h2; }
+	};
+	struct SigKeyHash {
+		size_t operator()(const SigKey & key) const { return key.h1; }
+	};
+	class SigEntry {
+	public:
+		SigEntry() : key{0,0} {}
+		~SigEntry() { for (auto * tree : values) { delete tree; } }
+		bool matches(const JobSignature & sig) const;
+		SigKey key;
+		std::vector<const classad::AttrNameAtom*> attrs;
+		std::vector<classad::ExprTree*> values; // copies, NULL where the job had no value
+	private:
+		SigEntry(const SigEntry &);
+		SigEntry & operator=(const SigEntry &);
+	};
+	typedef std::unordered_multimap<SigKey, int, SigKeyHash> JobSigKeyMap;
+	JobSigKeyMap key_map;                 // map of signature key to a cluster id
+	std::map<int, SigEntry*> sig_entries; // map of cluster id to the signature that created it
+	unsigned int generation;              // changes whenever the autoclusters are cleared
+	bool hashed_sigs;
+
+	void collectSigValues(JobQueueJob & job, bool expand_refs, classad::References & exattrs, std::vector<classad::ExprTree*> & sigset);
+	int getClusteridHashed(JobQueueJob & job, bool expand_refs, std::string * final_list);
+	void buildSignature(JobQueueJob & job, bool expand_refs, JobSignature & sig);
+	void eraseHashedCluster(int id);
 };
 
 /** This class manages the computation auto cluster ids for jobs based
@@ -0,0 +1,302 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#include "condor_common.h"
+#include "condor_attributes.h"
+#include "compat_classad_util.h"
+#include "qmgmt.h"
+#include "jobqueue_index.h"
+
+#include <algorithm>
+#include <math.h>
+
+// the indexed attributes, in the order of the idxXXX enum
+static const struct {
+	const char * attr;
+	bool         is_string;
+} IndexedAttrs[] = {
+	{ ATTR_OWNER,           true },
+	{ ATTR_USER,            true },
+	{ ATTR_JOB_STATUS,      false },
+	{ ATTR_JOB_SET_ID,      false },
+	{ ATTR_AUTO_CLUSTER_ID, false },
+};
+
+// convert a value to the text it is indexed by. string attributes are indexed by the
+// string (the index compares them case-insensitively, as the == operator does),
+// and the others by the integer, so that JobStatus == 2.0 finds JobStatus = 2.
+// returns false if the value is not one that the index for the attribute can hold.
+static bool IndexText(const classad::Value & val, bool is_string, std::string & text)
+{
+	if (is_string) {
+		return val.IsStringValue(text);
+	}
+
+	long long ival = 0;
+	double rval = 0;
+	if (val.IsIntegerValue(ival)) {
+	} else if (val.IsRealValue(rval) && floor(rval) == rval && fabs(rval) < 1e15) {
+		ival = (long long)rval;
+	} else {
+		return false;
+	}
+	text = std::to_string(ival);
+	return true;
+}
+
+bool JobQueueIndex::isIndexed(const char * attr)
+{
+	for (const auto & ia : IndexedAttrs) {
+		if (MATCH == strcasecmp(attr, ia.attr)) return true;
+	}
+	return false;
+}
+
+void JobQueueIndex::clear()
+{
+	for (int ix = 0; ix < idxCount; ++ix) {
+		m_index[ix].values.clear();
+		m_index[ix].other.clear();
+	}
+	m_entries.clear();
+	m_built = false;
+}
+
+void JobQueueIndex::update(const JOB_ID_KEY & key, JobQueueBase * ad)
+{
+	if ( ! m_built) return;
+
+	// work out where the ad belongs in each index
+	char where[idxCount];
+	std::string text[idxCount];
+	bool indexed = false;
+	for (int ix = 0; ix < idxCount; ++ix) {
+		where[ix] = inNone;
+		if ( ! ad) continue;
+		classad::ExprTree * expr = ad->LookupIgnoreChain(IndexedAttrs[ix].attr);
+		if ( ! expr) continue;
+		classad::Value val;
+		if (ExprTreeIsLiteral(expr, val) && IndexText(val, IndexedAttrs[ix].is_string, text[ix])) {
+			where[ix] = inValues;
+		} else {
+			where[ix] = inOther;
+		}
+		indexed = true;
+	}
+
+	auto found = m_entries.find(key);
+	if (found == m_entries.end()) {
+		if ( ! indexed) return;
+		Entry blank;
+		memset(blank.where, inNone, sizeof(blank.where));
+		found = m_entries.emplace(key, blank).first;
+	}
+	Entry & entry = found->second;
+
+	for (int ix = 0; ix < idxCount; ++ix) {
+		AttrIndex & index = m_index[ix];
+
+		// nothing to do if the value has not changed
+		if (where[ix] == entry.where[ix]) {
+			if (where[ix] != inValues) continue;
+			if (MATCH == strcasecmp(entry.value[ix]->first.c_str(), text[ix].c_str())) continue;
+		}
+
+		if (entry.where[ix] == inValues) {
+			entry.value[ix]->second.erase(key);
+			if (entry.value[ix]->second.empty()) {
+				index.values.erase(entry.value[ix]);
+			}
+		} else if (entry.where[ix] == inOther) {
+			index.other.erase(key);
+		}
+
+		if (where[ix] == inValues) {
+			entry.value[ix] = index.values.emplace(text[ix], KeySet()).first;
+			entry.value[ix]->second.insert(key);
+		} else if (where[ix] == inOther) {
+			index.other.insert(key);
+		}
+		entry.where[ix] = where[ix];
+	}
+
+	if ( ! indexed) {
+		m_entries.erase(found);
+	}
+}
+
+// returns true if tree is <attr> == <integer> or <attr> =?= <integer>
+static bool ExprIsAttrEqualsInt(classad::ExprTree * tree, const char * attr, long long & ival)
+{
+	classad::Operation::OpKind cmp_op;
+	std::string name;
+	classad::Value val;
+	std::string text;
+	if ( ! ExprTreeIsAttrCmpLiteral(tree, cmp_op, name, val)) return false;
+	if (cmp_op != classad::Operation::EQUAL_OP && cmp_op != classad::Operation::META_EQUAL_OP) return false;
+	if (MATCH != strcasecmp(name.c_str(), attr)) return false;
+	if ( ! IndexText(val, false, text)) return false;
+	ival = std::stoll(text);
+	return true;
+}
+
+// add the sources of candidate ads for tree to sources and their size to cost.
+// returns false if the indexes can't narrow down the ads that match tree.
+bool JobQueueIndex::planExpr(classad::ExprTree * tree, std::vector<Source> & sources, size_t & cost) const
+{
+	tree = SkipExprParens(tree);
+	if ( ! tree) return false;
+
+	// ClusterId == <number> is the cluster ad and its jobs
+	long long cluster = 0;
+	if (ExprIsAttrEqualsInt(tree, ATTR_CLUSTER_ID, cluster)) {
+		if (cluster <= 0 || cluster > INT_MAX) return false;
+		Source src = { NULL, JOB_ID_KEY((int)cluster, CLUSTERID_qkey2), true };
+		JobQueueCluster * cad = GetClusterAd((int)cluster);
+		sources.push_back(src);
+		cost += 1 + (cad ? cad->ClusterSize() : 0);
+		return true;
+	}
+
+	if (tree->GetKind() != classad::ExprTree::OP_NODE) return false;
+
+	classad::Operation::OpKind op;
+	classad::ExprTree *t1, *t2, *t3;
+	((const classad::Operation*)tree)->GetComponents(op, t1, t2, t3);
+
+	if (op == classad::Operation::LOGICAL_AND_OP) {
+		// ClusterId == <number> && ProcId == <number> is a single job
+		long long proc = -1;
+		if ((ExprIsAttrEqualsInt(SkipExprParens(t1), ATTR_CLUSTER_ID, cluster) &&
+				ExprIsAttrEqualsInt(SkipExprParens(t2), ATTR_PROC_ID, proc)) ||
+			(ExprIsAttrEqualsInt(SkipExprParens(t1), ATTR_PROC_ID, proc) &&
+				ExprIsAttrEqualsInt(SkipExprParens(t2), ATTR_CLUSTER_ID, cluster))) {
+			if (cluster <= 0 || cluster > INT_MAX || proc < 0 || proc > INT_MAX) return false;
+			Source src = { NULL, JOB_ID_KEY((int)cluster, (int)proc), false };
+			sources.push_back(src);
+			cost += 1;
+			return true;
+		}
+
+		// otherwise either side will do, so use the one with fewer candidates
+		std::vector<Source> left, right;
+		size_t left_cost = 0, right_cost = 0;
+		bool left_ok = planExpr(t1, left, left_cost);
+		bool right_ok = planExpr(t2, right, right_cost);
+		if (left_ok && ( ! right_ok || left_cost <= right_cost)) {
+			sources.insert(sources.end(), left.begin(), left.end());
+			cost += left_cost;
+			return true;
+		} else if (right_ok) {
+			sources.insert(sources.end(), right.begin(), right.end());
+			cost += right_cost;
+			return true;
+		}
+		return false;
+	}
+
+	if (op == classad::Operation::LOGICAL_OR_OP) {
+		// both sides are needed
+		std::vector<Source> left, right;
+		size_t left_cost = 0, right_cost = 0;
+		if ( ! planExpr(t1, left, left_cost) || ! planExpr(t2, right, right_cost)) {
+			return false;
+		}
+		sources.insert(sources.end(), left.begin(), left.end());
+		sources.insert(sources.end(), right.begin(), right.end());
+		cost += left_cost + right_cost;
+		return true;
+	}
+
+	// <attr> == <literal> or <attr> =?= <literal> for one of the indexed attributes
+	classad::Operation::OpKind cmp_op;
+	std::string attr;
+	classad::Value val;
+	if ( ! ExprTreeIsAttrCmpLiteral(tree, cmp_op, attr, val)) return false;
+	if (cmp_op != classad::Operation::EQUAL_OP && cmp_op != classad::Operation::META_EQUAL_OP) return false;
+
+	for (int ix = 0; ix < idxCount; ++ix) {
+		if (MATCH != strcasecmp(attr.c_str(), IndexedAttrs[ix].attr)) continue;
+
+		std::string text;
+		if ( ! IndexText(val, IndexedAttrs[ix].is_string, text)) return false;
+
+		const AttrIndex & index = m_index[ix];
+		auto it = index.values.find(text);
+		if (it != index.values.end()) {
+			Source src = { &it->second, JOB_ID_KEY(0,0), false };
+			sources.push_back(src);
+			cost += it->second.size();
+		}
+		if ( ! index.other.empty()) {
+			Source src = { &index.other, JOB_ID_KEY(0,0), false };
+			sources.push_back(src);
+			cost += index.other.size();
+		}
+		return true;
+	}
+	return false;
+}
+
+bool JobQueueIndex::plan(classad::ExprTree * requirements, size_t max_keys, std::vector<JOB_ID_KEY> & keys) const
+{
+	keys.clear();
+	if ( ! m_built) return false;
+
+	std::vector<Source> sources;
+	size_t cost = 0;
+	if ( ! planExpr(requirements, sources, cost) || cost > max_keys) {
+		return false;
+	}
+
+	// a cluster ad stands for itself and all of its jobs
+	auto add_cluster = [&keys](const JOB_ID_KEY & jid) {
+		keys.push_back(jid);
+		JobQueueCluster * cad = GetClusterAd(jid.cluster);
+		if ( ! cad) return;
+		for (JobQueueJob * job = cad->FirstJob(); job; job = cad->NextJob(job)) {
+			keys.push_back(job->jid);
+		}
+	};
+
+	for (const auto & src : sources) {
+		if (src.keys) {
+			for (const auto & key : *src.keys) {
+				if (key.proc == CLUSTERID_qkey2) {
+					add_cluster(key);
+				} else {
+					keys.push_back(key);
+				}
+			}
+		} else if (src.whole_cluster) {
+			add_cluster(src.jid);
+		} else {
+			keys.push_back(src.jid);
+		}
+		if (keys.size() > max_keys) {
+			keys.clear();
+			return false;
+		}
+	}
+
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+	return true;
+}
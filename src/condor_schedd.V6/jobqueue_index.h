@@ -0,0 +1,91 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _jobqueue_index_H_
+#define _jobqueue_index_H_
+
+// Secondary indexes on the job queue, so that a query whose requirements select
+// jobs by Owner, User, ClusterId, JobStatus, JobSetId or AutoClusterId can visit
+// just the ads that might match rather than every ad in the queue.
+//
+// Each ad is indexed by the values of its own attributes, not the ones it inherits
+// from its cluster ad, so a cluster ad in the index stands for all of its jobs.
+// Ads whose value is not a literal are kept aside and are candidates for every query.
+// The keys that Plan() returns are thus a superset of the ads that match, and the
+// caller must still evaluate the requirements against each of them.
+// ClusterId needs no index of its own, the cluster ad knows its jobs.
+//
+class JobQueueIndex {
+public:
+
+	JobQueueIndex() {};
+	~JobQueueIndex() = default;
+
+	// the index is built on first use and kept up to date from then on,
+	// until it is cleared.
+	bool built() const { return m_built; }
+	void setBuilt() { m_built = true; }
+	void clear();
+
+	// true if attr is one of the attributes that has an index
+	static bool isIndexed(const char * attr);
+
+	// note the current values of the indexed attributes of the ad with this key,
+	// pass a NULL ad when the key is no longer in the job queue.
+	void update(const JOB_ID_KEY & key, JobQueueBase * ad);
+
+	// fill keys with the ads that might match requirements, in key order. Returns false
+	// when no top level conjunct of the requirements can be looked up in the indexes,
+	// or when there would be more than max_keys candidates, and the whole queue should
+	// be scanned instead.
+	bool plan(classad::ExprTree * requirements, size_t max_keys, std::vector<JOB_ID_KEY> & keys) const;
+
+private:
+	enum { idxOwner=0, idxUser, idxJobStatus, idxJobSetId, idxAutoClusterId, idxCount };
+
+	typedef std::set<JOB_ID_KEY> KeySet;
+	typedef std::map<std::string, KeySet, classad::CaseIgnLTStr> ValueMap;
+
+	struct AttrIndex {
+		ValueMap values;  // keys of ads that have a literal value, by value
+		KeySet other;     // keys of ads that have some other expression
+	};
+
+	// where an ad is in each of the indexes, so that it can be taken out again
+	enum { inNone=0, inValues, inOther };
+	struct Entry {
+		char where[idxCount];
+		ValueMap::iterator value[idxCount];
+	};
+
+	// a set of ads that is part of the plan for a query
+	struct Source {
+		const KeySet * keys;  // when not NULL, these ads, otherwise the ad jid
+		JOB_ID_KEY jid;
+		bool whole_cluster;   // jid is a cluster ad and its jobs are also candidates
+	};
+
+	bool planExpr(classad::ExprTree * tree, std::vector<Source> & sources, size_t & cost) const;
+
+	bool m_built = false;
+	AttrIndex m_index[idxCount];
+	std::map<JOB_ID_KEY, Entry> m_entries;
+};
+
+#endif
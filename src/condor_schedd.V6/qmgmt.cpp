@@ -55,6 +55,7 @@
 #include "classad_helpers.h"
 #include "iso_dates.h"
 #include "jobsets.h"
+#include "jobqueue_index.h"
 #include "exit.h"
 #include <algorithm>
 #include <param_info.h>
@@ -87,7 +88,7 @@ ClassAdLog<K,AD>::filter_iterator::operator++(int)
 	int miss_count = 0;
 	Stopwatch sw;
 	sw.start();
-	while (!(m_cur == end))
+	while (m_keys ? (m_next_key < m_keys->size()) : !(m_cur == end))
 	{
 		miss_count++;
 			// 500 was chosen here based on a queue of 1M jobs and
@@ -101,7 +102,13 @@ ClassAdLog<K,AD>::filter_iterator::operator++(int)
 
 		cur = *this;
 		//const K & tmp_key = (*m_cur).first;
-		AD tmp_ad = (*m_cur++).second;
+		AD tmp_ad = NULL;
+		if (m_keys) {
+			// the ad may have left the queue since the keys were chosen
+			if (m_table->lookup((*m_keys)[m_next_key++], tmp_ad) < 0) continue;
+		} else {
+			tmp_ad = (*m_cur++).second;
+		}
 		if (!tmp_ad) continue;
 
 		//dprintf(D_COMMAND | D_VERBOSE, "ClassAdLog::filter_iterator++ 0x%x key=%d.%d (%d.%d)\n", 
@@ -143,10 +150,12 @@ ClassAdLog<K,AD>::filter_iterator::operator++(int)
 		//	continue;
 		//}
 		cur.m_found_ad = true;
+		cur.m_key_ad = tmp_ad;
 		m_found_ad = true;
 		break;
 	}
-	if ((m_cur == end) && (!m_found_ad)) {
+	bool at_end = m_keys ? (m_next_key >= m_keys->size()) : (m_cur == end);
+	if (at_end && (!m_found_ad)) {
 		m_done = true;
 	}
 	return cur;
@@ -177,6 +186,24 @@ public:
 		}
 		return false;
 	}
+
+	// changes made outside of a transaction go straight into the table, so the
+	// job queue indexes must be updated here rather than when a transaction commits
+	bool SetAttribute(const K& key, const char* name, const char* value, const bool is_dirty=false) {
+		bool rval = GenericClassAdCollection<K, AD>::SetAttribute(key, name, value, is_dirty);
+		if ( ! this->InTransaction() && JobQueueIndex::isIndexed(name)) { UpdateJobQueueIndexes(key); }
+		return rval;
+	}
+	bool DeleteAttribute(const K& key, const char* name) {
+		bool rval = GenericClassAdCollection<K, AD>::DeleteAttribute(key, name);
+		if ( ! this->InTransaction() && JobQueueIndex::isIndexed(name)) { UpdateJobQueueIndexes(key); }
+		return rval;
+	}
+	bool DestroyClassAd(const K& key) {
+		bool rval = GenericClassAdCollection<K, AD>::DestroyClassAd(key);
+		if ( ! this->InTransaction()) { UpdateJobQueueIndexes(key); }
+		return rval;
+	}
 };
 typedef JobQueueCollection<JobQueueKey, JobQueuePayload> JobQueueType;
 #else
@@ -285,6 +312,20 @@ static void HandleFlushJobQueueLogTimer();
 static int dirty_notice_interval = 0;
 static void PeriodicDirtyAttributeNotification();
 static void ScheduleJobQueueLogFlush();
+static bool group_commit = false;
+static int sync_job_queue_log_timer_id = -1;
+static int sync_job_queue_log_delay = 0;
+static long long group_commit_max_bytes = 1024*1024;
+static bool background_job_queue_compaction = false;
+static bool compact_job_queue_child_running = false;
+static bool job_queue_indexes = false;
+static JobQueueIndex JobQueueIndexes;
+static void HandleSyncJobQueueLogTimer();
+static std::function<int(ReliSock *)> deferred_q_reply;
+static std::map<Stream *, QmgmtPeer *> deferred_q_peers; // connections waiting to resume
+static int serve_q_requests();
+static void resume_q_connection(QmgmtPeer *peer, const std::function<int(ReliSock *)> &reply);
+static int handle_q_resume(Stream *sock);
 
 bool qmgmt_all_users_trusted = false;
 static std::vector<std::string> super_users;
@@ -472,11 +513,58 @@ DeletePrivateAttribute(int cluster_id, int proc_id, const char *attr_name)
 }
 
 
+// Build the job queue indexes from the ads in the queue. From then on
+// they are kept up to date as the queue changes, until they are cleared.
+static void
+BuildJobQueueIndexes()
+{
+	Stopwatch sw;
+	sw.start();
+
+	JobQueueIndexes.clear();
+	JobQueueIndexes.setBuilt();
+
+	JobQueueKey key;
+	ClassAd *ad = NULL;
+	JobQueue->StartIterateAllClassAds();
+	while (JobQueue->IterateAllClassAds(ad, key)) {
+		JobQueueIndexes.update(key, dynamic_cast<JobQueueBase*>(ad));
+	}
+	dprintf(D_ALWAYS, "Built the job queue indexes in %d ms\n", (int)sw.get_ms());
+}
+
+void
+UpdateJobQueueIndexes(const JOB_ID_KEY & key)
+{
+	if ( ! JobQueueIndexes.built()) return;
+	JobQueuePayload ad = NULL;
+	if ( ! JobQueue->Lookup(key, ad)) { ad = NULL; }
+	JobQueueIndexes.update(key, ad);
+}
+
 //static int allow_remote_submit = FALSE;
 JobQueueLogType::filter_iterator
 GetJobQueueIterator(const classad::ExprTree &requirements, int timeslice_ms)
 {
-	return JobQueue->GetFilteredIterator(requirements, timeslice_ms);
+	JobQueueLogType::filter_iterator it = JobQueue->GetFilteredIterator(requirements, timeslice_ms);
+	if ( ! job_queue_indexes) {
+		return it;
+	}
+
+	if ( ! JobQueueIndexes.built()) {
+		BuildJobQueueIndexes();
+	}
+
+	// if the requirements pick out ads by an indexed attribute, visit just the ads
+	// the indexes give us. Once that is more than half of the queue, the keys
+	// cost more to look up than scanning the queue does.
+	size_t max_keys = MAX(TotalJobsCount, 1000) / 2;
+	auto keys = std::make_shared<std::vector<JobQueueKey>>();
+	if (JobQueueIndexes.plan(const_cast<classad::ExprTree*>(&requirements), max_keys, *keys)) {
+		dprintf(D_FULLDEBUG, "Job queue query will visit %d ads chosen by the job queue indexes\n", (int)keys->size());
+		it.set_keys(keys);
+	}
+	return it;
 }
 
 JobQueueLogType::filter_iterator
@@ -745,6 +833,7 @@ int GetSchedulerCapabilities(int mask, ClassAd & reply)
 	reply.Assign("LateMaterializeVersion", 2);
 	bool use_jobsets = scheduler.jobSets ? true : false;
 	reply.Assign("UseJobsets", use_jobsets);
+	reply.Assign("SendJobAds", true);
 	const ClassAd * cmds = scheduler.getExtendedSubmitCommands();
 	if (cmds && (cmds->size() > 0)) {
 		reply.Insert("ExtendedSubmitCommands", cmds->Copy());
@@ -1536,6 +1625,20 @@ InitQmgmt()
     cluster_maximum_val = param_integer("SCHEDD_CLUSTER_MAXIMUM_VALUE",0,0);
 
 	flush_job_queue_log_delay = param_integer("SCHEDD_JOB_QUEUE_LOG_FLUSH_DELAY",5,0);
+	group_commit = param_boolean("JOB_QUEUE_GROUP_COMMIT", false);
+	sync_job_queue_log_delay = param_integer("JOB_QUEUE_GROUP_COMMIT_DELAY",0,0);
+	param_longlong("JOB_QUEUE_GROUP_COMMIT_MAX_BYTES", group_commit_max_bytes, true, 1024*1024, true, 0);
+	background_job_queue_compaction = param_boolean("JOB_QUEUE_BACKGROUND_COMPACTION", false);
+	job_queue_indexes = param_boolean("JOB_QUEUE_INDEXES", false);
+	if ( ! job_queue_indexes) {
+		JobQueueIndexes.clear();
+	}
+	if (JobQueue) {
+		JobQueue->SetGroupCommitMaxBytes(group_commit_max_bytes);
+		if ( ! group_commit) {
+			JobQueue->SyncLog();
+		}
+	}
 	dirty_notice_interval = param_integer("SCHEDD_JOB_QUEUE_NOTIFY_UPDATES",30,0);
 }
 
@@ -1766,11 +1869,11 @@ SpoolHierarchyChangePass2(char const *spool,std::list< PROC_ID > &spool_rename_l
 	}
 }
 
-/* handled in header for now.
 JobQueueJob::~JobQueueJob()
 {
+	delete autocluster_sig;
+	autocluster_sig = NULL;
 }
-*/
 
 JobQueueCluster::~JobQueueCluster()
 {
@@ -2147,9 +2250,11 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 #else
 	JobQueue = new JobQueueType(new ConstructClassAdLogTableEntry<JobQueuePayload>());
 #endif
+	JobQueue->SetRecoveryThreads(param_integer("JOB_QUEUE_RECOVERY_THREADS", 0, 0));
 	if( !JobQueue->InitLogFile(job_queue_name,max_historical_logs) ) {
 		EXCEPT("Failed to initialize job queue log!");
 	}
+	JobQueue->SetGroupCommitMaxBytes(group_commit_max_bytes);
 	ClusterSizeHashTable = new ClusterSizeHashTable_t(hashFuncInt);
 	TotalJobsCount = 0;
 	jobs_added_this_transaction = 0;
@@ -2683,12 +2788,50 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 }
 
 
+// Runs in a child forked by CleanJobQueue(), writing out the job queue as
+// it was when forked.
+static int
+CompactJobQueueWorker(int /*n1*/, int /*n2*/, void * /*data*/)
+{
+	return JobQueue->WriteBackgroundTruncLog() ? 0 : 1;
+}
+
+static int
+CompactJobQueueReaper(int /*n1*/, int /*n2*/, void * /*data*/, int exit_status)
+{
+	compact_job_queue_child_running = false;
+	if (JobQueue && JobQueue->FinishBackgroundTruncLog(exit_status == 0)) {
+		dprintf(D_ALWAYS, "Finished cleaning job queue in the background\n");
+	}
+	return 0;
+}
+
+void
+PeriodicCleanJobQueue()
+{
+	CleanJobQueue(background_job_queue_compaction);
+}
+
 void
-CleanJobQueue()
+CleanJobQueue(bool in_background)
 {
 	if (JobQueueDirty) {
 		dprintf(D_ALWAYS, "Cleaning job queue...\n");
-		JobQueue->TruncLog();
+		if ( ! in_background) {
+			JobQueue->TruncLog();
+		} else if (compact_job_queue_child_running) {
+				// even if a TruncLog() has since abandoned its work, the
+				// child may still be writing the file a new one would use
+			dprintf(D_ALWAYS, "Job queue is still being cleaned in the background\n");
+			return;
+		} else if ( ! JobQueue->BeginBackgroundTruncLog()) {
+			JobQueue->TruncLog();
+		} else if ( ! Create_Thread_With_Data(CompactJobQueueWorker, CompactJobQueueReaper)) {
+			JobQueue->FinishBackgroundTruncLog(false);
+			JobQueue->TruncLog();
+		} else {
+			compact_job_queue_child_running = true;
+		}
 
 		auto job_itr = PrivateAttrs.begin();
 		while (job_itr != PrivateAttrs.end()) {
@@ -2714,6 +2857,7 @@ void
 DestroyJobQueue( void )
 {
 	in_DestroyJobQueue = true;
+	JobQueueIndexes.clear();
 
 	// Clean up any children that have exited but haven't been reaped
 	// yet.  This can occur if the schedd receives a query followed
@@ -3528,7 +3672,6 @@ unsetQSock()
 int
 handle_q(int cmd, Stream *sock)
 {
-	int	rval;
 	bool all_good;
 
 	all_good = setQSock((ReliSock*)sock);
@@ -3549,6 +3692,22 @@ handle_q(int cmd, Stream *sock)
 
 	BeginTransaction();
 
+	return serve_q_requests();
+}
+
+void
+DeferQmgmtReply(std::function<int(ReliSock *)> reply)
+{
+	deferred_q_reply = std::move(reply);
+}
+
+// Serve the requests on Q_SOCK until the client hangs up, or the reply
+// to a commit has to wait for the job queue log to be synced, in which
+// case the connection is parked until it is, and KEEP_STREAM returned.
+static int
+serve_q_requests()
+{
+	int	rval;
 	bool may_fork = false;
 	ForkStatus fork_status = FORK_FAILED;
 	do {
@@ -3562,8 +3721,17 @@ handle_q(int cmd, Stream *sock)
 				break;
 			}
 		}
-	} while(rval >= 0);
+	} while(rval >= 0 && rval != QMGMT_REPLY_DEFERRED);
 
+	if( rval == QMGMT_REPLY_DEFERRED ) {
+		ASSERT( fork_status != FORK_CHILD );
+		std::function<int(ReliSock *)> reply = std::move(deferred_q_reply);
+		deferred_q_reply = nullptr;
+		QmgmtPeer *peer = getQmgmtConnectionInfo();
+		dprintf(D_FULLDEBUG, "QMGR commit waiting for the job queue log to be synced\n");
+		JobQueue->WhenLogSynced([peer, reply]() { resume_q_connection(peer, reply); });
+		return KEEP_STREAM;
+	}
 
 	unsetQSock();
 
@@ -3586,6 +3754,42 @@ handle_q(int cmd, Stream *sock)
 	return 0;
 }
 
+// The job queue log has been synced, so send the deferred reply to the
+// commit, and go back to waiting for the client's next request.
+static void
+resume_q_connection(QmgmtPeer *peer, const std::function<int(ReliSock *)> &reply)
+{
+	ReliSock *sock = peer->getReliSock();
+	if( reply(sock) < 0 ||
+		daemonCore->Register_Socket(sock, "QMGMT resumed connection",
+			handle_q_resume, "handle_q_resume") < 0 )
+	{
+		dprintf(D_FULLDEBUG, "QMGR Connection closed\n");
+		delete peer;
+		delete sock;
+		return;
+	}
+	deferred_q_peers[sock] = peer;
+}
+
+static int
+handle_q_resume(Stream *sock)
+{
+	auto it = deferred_q_peers.find(sock);
+	ASSERT( it != deferred_q_peers.end() );
+	QmgmtPeer *peer = it->second;
+	deferred_q_peers.erase(it);
+	daemonCore->Cancel_Socket(sock);
+
+	if( ! setQmgmtConnectionInfo(peer) ) {
+		EXCEPT("handle_q_resume: Unable to restore the QMGMT connection!!");
+	}
+	if( serve_q_requests() != KEEP_STREAM ) {
+		delete sock;
+	}
+	return KEEP_STREAM;
+}
+
 int
 InitializeConnection( const char *  /*owner*/, const char *  /*domain*/ )
 {
@@ -5701,6 +5905,33 @@ HandleFlushJobQueueLogTimer()
 	JobQueue->FlushLog();
 }
 
+static void
+ScheduleJobQueueLogSync()
+{
+		// Sync the log once the commits made in this pass of the event
+		// loop (or the delay, if there is one) have been written, so
+		// that they all share one fsync.
+	if( sync_job_queue_log_timer_id == -1 && ! JobQueue->LogSynced() ) {
+		sync_job_queue_log_timer_id = daemonCore->Register_Timer(
+			sync_job_queue_log_delay,
+			HandleSyncJobQueueLogTimer,
+			"HandleSyncJobQueueLogTimer");
+	}
+}
+
+void
+HandleSyncJobQueueLogTimer()
+{
+	sync_job_queue_log_timer_id = -1;
+	JobQueue->SyncLog();
+}
+
+bool
+JobQueueLogSynced()
+{
+	return JobQueue->LogSynced();
+}
+
 int
 SetTimerAttribute( int cluster, int proc, const char *attr_name, int dur )
 {
@@ -6472,7 +6703,7 @@ AddSessionAttributes(const std::list<std::string> &new_ad_keys, CondorError * er
 	return 0;
 }
 
-int CommitTransactionInternal( bool durable, CondorError * errorStack );
+int CommitTransactionInternal( bool durable, CondorError * errorStack, bool group_sync = false );
 
 void
 CommitTransactionOrDieTrying() {
@@ -6516,7 +6747,23 @@ CommitTransactionAndLive( SetAttributeFlags_t flags,
 	return CommitTransactionInternal( durable, errorStack );
 }
 
-int CommitTransactionInternal( bool durable, CondorError * errorStack ) {
+int
+CommitTransactionGroupSync( SetAttributeFlags_t flags,
+                            CondorError * errorStack )
+{
+	bool durable = !(flags & NONDURABLE);
+	if( (durable && flags != 0) || ((!durable) && flags != NONDURABLE) ) {
+		dprintf( D_ALWAYS | D_BACKTRACE, "ERROR: CommitTransaction(): Flags other than NONDURABLE not supported.\n" );
+	}
+
+	if( errorStack == NULL ) {
+		dprintf( D_ALWAYS | D_BACKTRACE, "ERROR: CommitTransaction() called with NULL error stack.\n" );
+	}
+
+	return CommitTransactionInternal( durable, errorStack, group_commit );
+}
+
+int CommitTransactionInternal( bool durable, CondorError * errorStack, bool group_sync ) {
 
 	std::list<std::string> new_ad_keys;
 	struct ownerinfo_init_state ownerinfo_is = { nullptr, nullptr, false };
@@ -6572,7 +6819,7 @@ int CommitTransactionInternal( bool durable, CondorError * errorStack ) {
 		AddImplicitJobsets(new_ad_keys, new_jobset_ids);
 	}
 
-	if (triggers) {
+	if (triggers || JobQueueIndexes.built()) {
 		JobQueue->GetTransactionKeys(ad_keys);
 
 		// before we commit the transaction, if there were changes to a cluster ad
@@ -6605,6 +6852,10 @@ int CommitTransactionInternal( bool durable, CondorError * errorStack ) {
 		JobQueue->CommitNondurableTransaction(commit_comment);
 		ScheduleJobQueueLogFlush();
 	}
+	else if (group_sync) {
+		JobQueue->CommitGroupedTransaction(commit_comment);
+		ScheduleJobQueueLogSync();
+	}
 	else {
 		JobQueue->CommitTransaction(commit_comment);
 	}
@@ -6871,6 +7122,14 @@ int CommitTransactionInternal( bool durable, CondorError * errorStack ) {
 		DoSetAttributeCallbacks(ad_keys, triggers);
 	}
 
+	// bring the job queue indexes up to date with the ads this transaction touched,
+	// now that the ads have been through all of the processing above.
+	if (JobQueueIndexes.built()) {
+		for (const auto & key : ad_keys) {
+			UpdateJobQueueIndexes(JobQueueKey(key.c_str()));
+		}
+	}
+
 	xact_start_time = 0;
 	return 0;
 }
@@ -7358,6 +7617,65 @@ int QmgmtHandleSendJobsetAd(int cluster_id, ClassAd & ad, int /*flags*/, int & t
 	return rval;
 }
 
+// called by qmgmt_receivers for each ad of a CONDOR_SendJobAds RPC call.
+// a proc_id of -1 is the cluster ad, otherwise the proc is created as NewProc would,
+// and must be the next proc of the cluster. The attributes are then set as the
+// equivalent series of SetAttribute calls would set them.
+int QmgmtHandleSendJobAd(int cluster_id, int proc_id, const std::vector<std::pair<std::string, std::string>> & attrs,
+	SetAttributeFlags_t flags, CondorError * errstack, int & terrno)
+{
+	int rval;
+	terrno = 0;
+	errno = 0;
+
+	bool is_cluster = proc_id < 0;
+	if (is_cluster) {
+		rval = SetAttributeInt(cluster_id, -1, ATTR_CLUSTER_ID, cluster_id, flags);
+	} else {
+		rval = NewProc(cluster_id);
+		if (rval < 0) {
+			terrno = errno;
+			return rval;
+		}
+		if (rval != proc_id) {
+			dprintf(D_ALWAYS, "SendJobAds: expected to create job %d.%d, but NewProc created %d.%d\n",
+				cluster_id, proc_id, cluster_id, rval);
+			terrno = EINVAL;
+			return -1;
+		}
+		rval = SetAttributeInt(cluster_id, proc_id, ATTR_PROC_ID, proc_id, flags);
+	}
+	if (rval < 0) {
+		terrno = errno;
+		return rval;
+	}
+
+	for (auto it = attrs.begin(); it != attrs.end(); ++it) {
+		const char * attr = it->first.c_str();
+
+		// skip the id we just set, and attributes that are forced into the other sort of ad
+		int forced = IsForcedProcAttribute(attr);
+		if (forced) {
+			if (forced != (is_cluster ? -1 : 1)) continue;
+			if (YourStringNoCase(is_cluster ? ATTR_CLUSTER_ID : ATTR_PROC_ID) == attr) continue;
+		}
+
+		if (YourStringNoCase(ATTR_MYPROXY_PASSWORD) == attr) {
+			// see the CONDOR_SetAttribute receiver, we never put this in a job ad
+			terrno = EINVAL;
+			return -1;
+		}
+
+		rval = SetAttribute(cluster_id, proc_id, attr, it->second.c_str(), flags, errstack);
+		if (rval < 0) {
+			terrno = errno;
+			return rval;
+		}
+	}
+
+	return 0;
+}
+
 
 void
 MarkJobClean(PROC_ID proc_id)
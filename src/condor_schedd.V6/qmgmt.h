@@ -126,6 +126,7 @@ inline const char * EffectiveUser(QmgmtPeer * peer) {
 
 class JobFactory;
 class JobQueueCluster;
+class JobSignature;
 
 // structures for a doubly linked list with append-to-tail and remove-from-head semantics (a.k.a a queue)
 // so that any element can act as a queue head, an empty queue will have next == prev == this
@@ -306,6 +307,7 @@ public:
 	int dirty_flags;	// one or more of JQJ_CHACHE_DIRTY_ flags indicating that the job ad differs from the JobQueueJob 
 	int set_id;
 	int autocluster_id;
+	JobSignature * autocluster_sig; // owned by this object, used by the hashed autocluster signature mode
 	// cached pointer into schedulers's SubmitterDataMap and OwnerInfoMap
 	// it is set by count_jobs() or by scheduler::get_submitter_and_owner()
 	// DO NOT FREE FROM HERE!
@@ -325,11 +327,12 @@ public:
 		, dirty_flags(0)
 		, set_id(0)
 		, autocluster_id(0)
+		, autocluster_sig(NULL)
 		, ownerinfo(NULL)
 		, submitterdata(NULL)
 		, parent(NULL)
 	{}
-	virtual ~JobQueueJob() {};
+	virtual ~JobQueueJob();
 
 	virtual void PopulateFromAd(); // populate this structure from contained ClassAd state
 
@@ -519,6 +522,16 @@ void SetMaxHistoricalLogs(int max_historical_logs);
 time_t GetOriginalJobQueueBirthdate();
 void DestroyJobQueue( void );
 int handle_q(int, Stream *sock);
+
+// With JOB_QUEUE_GROUP_COMMIT, the durable commits of qmgmt clients share
+// an fsync of the job queue log, and the reply to each one waits for it.
+// A request handler that has committed that way passes its reply to
+// DeferQmgmtReply() and returns QMGMT_REPLY_DEFERRED, and the connection
+// is set aside until the reply has been sent.
+#define QMGMT_REPLY_DEFERRED 1
+bool JobQueueLogSynced();
+void DeferQmgmtReply(std::function<int(ReliSock *)> reply);
+
 void dirtyJobQueue( void );
 bool SendDirtyJobAdNotification(const PROC_ID& job_id);
 
@@ -574,6 +587,10 @@ JobQueueJob* GetNextDirtyJobByConstraint(const char *constraint, int initScan);
 int NewProcInternal(int cluster_id, int proc_id);
 // call NewProcInternal, and then SetAttribute on all of the attributes in job that are not the same as ClusterAd
 int NewProcFromAd (const classad::ClassAd * job, int ProcId, JobQueueCluster * ClusterAd, SetAttributeFlags_t flags);
+
+// called by qmgmt_receivers to handle each ad of a CONDOR_SendJobAds RPC call
+int QmgmtHandleSendJobAd(int cluster_id, int proc_id, const std::vector<std::pair<std::string, std::string>> & attrs,
+	SetAttributeFlags_t flags, CondorError * errstack, int & terrno);
 #endif
 
 void * BeginJobAggregation(const char * projection, bool create_if_not, const char * constraint);
@@ -748,6 +765,9 @@ private:
 #define JOB_QUEUE_ITERATOR_OPT_INCLUDE_JOBSETS      0x0002
 JobQueueLogType::filter_iterator GetJobQueueIterator(const classad::ExprTree &requirements, int timeslice_ms);
 JobQueueLogType::filter_iterator GetJobQueueIteratorEnd();
+// call after changing an indexed attribute of a job queue ad directly rather than by SetAttribute,
+// as the autocluster code does. See jobqueue_index.h
+void UpdateJobQueueIndexes(const JOB_ID_KEY & key);
 
 
 class schedd_runtime_probe;
@@ -772,7 +792,8 @@ extern int JobsSeenOnQueueWalk;
 void InitQmgmt();
 void InitJobQueue(const char *job_queue_name,int max_historical_logs);
 void PostInitJobQueue();
-void CleanJobQueue();
+void CleanJobQueue(bool in_background = false);
+void PeriodicCleanJobQueue();
 bool setQSock( ReliSock* rsock );
 void unsetQSock();
 void MarkJobClean(PROC_ID job_id);
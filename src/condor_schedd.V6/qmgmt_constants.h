@@ -21,6 +21,11 @@
 #define SENDJOBAD_TYPE_CLUSTER    -1  /* tj*/
 #define SENDJOBAD_TYPE_JOBSET   -100  /* tj*/
 
+// Proc id that ends the ads of a CONDOR_SendJobAds message
+#define SENDJOBADS_END            -2
+// Most attributes one ad of a CONDOR_SendJobAds message may have
+#define SENDJOBADS_MAX_ATTRS      100000
+
 #define	CONDOR_InitializeConnection 10001
 #define	CONDOR_NewCluster 			10002
 #define	CONDOR_NewProc 				10003
@@ -61,5 +66,6 @@
 #define CONDOR_SetMaterializeData   10038 /* tj - abandoned */
 #define CONDOR_SendMaterializeData  10039 /* tj */
 #define CONDOR_SendJobQueueAd       10040 /* tj */
+#define CONDOR_SendJobAds           10041
 
 
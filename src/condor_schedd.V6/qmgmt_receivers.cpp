@@ -49,6 +49,47 @@ static bool QmgmtMayAccessAttribute( char const *attr_name ) {
 	// the client at attempted commit.
 static std::unique_ptr<CondorError> g_transaction_error;
 
+// send the reply to CONDOR_CommitTransaction
+static int
+send_commit_reply(ReliSock *syscall_sock, int rval, int terrno, const CondorError &errstack)
+{
+	syscall_sock->encode();
+	neg_on_error( syscall_sock->code(rval) );
+	const CondorVersionInfo *vers = syscall_sock->get_peer_version();
+	bool send_classad = vers && vers->built_since_version(8, 3, 4);
+	bool always_send_classad = vers && vers->built_since_version(8, 7, 4);
+	if( rval < 0 ) {
+		neg_on_error( syscall_sock->code(terrno) );
+	}
+	if( rval < 0 && send_classad ) {
+		// Send a classad, for less backwards-incompatibility.
+		int code = 1;
+		const char * reason = "QMGMT rejected job submission.";
+		if(! errstack.empty()) {
+			code = 2;
+			reason = errstack.message();
+		}
+
+		ClassAd reply;
+		reply.Assign( "ErrorCode", code );
+		reply.Assign( "ErrorReason", reason );
+		neg_on_error( putClassAd( syscall_sock, reply ) );
+	} else if( always_send_classad ) {
+		ClassAd reply;
+
+		std::string reason;
+		if(! errstack.empty()) {
+			reason = errstack.getFullText();
+			reply.Assign( "WarningReason", reason );
+		}
+
+		neg_on_error( putClassAd( syscall_sock, reply ) );
+	}
+
+	neg_on_error( syscall_sock->end_of_message() );
+	return 0;
+}
+
 int
 do_Q_request(QmgmtPeer &Q_PEER, bool &may_fork)
 {
@@ -508,6 +549,74 @@ do_Q_request(QmgmtPeer &Q_PEER, bool &may_fork)
 		return 0;
 	} break;
 
+	case CONDOR_SendJobAds:
+	{
+		int cluster_id = -1;
+		SetAttributePublicFlags_t wflags = 0;
+		neg_on_error( syscall_sock->code(cluster_id) );
+		dprintf( D_SYSCALLS, "	cluster_id = %d\n", cluster_id );
+		neg_on_error( syscall_sock->code(wflags) );
+		dprintf( D_SYSCALLS, "	flags = 0x%x\n", (unsigned int)wflags );
+		SetAttributeFlags_t flags = (SetAttributeFlags_t)(wflags & SetAttribute_PublicFlagsMask) & ~SetAttribute_NoAck;
+
+		if (!g_transaction_error) g_transaction_error.reset(new CondorError());
+
+			// The ads are applied as they arrive, but there is only one reply,
+			// after the last of them.  After a failure we read and ignore the
+			// rest, and the failure is kept so that the commit will fail too.
+		int terrno = 0;
+		int failed_proc = -1;
+		int num_ads = 0;
+		rval = 0;
+		std::vector<std::pair<std::string, std::string>> attrs;
+		for (;;) {
+			int proc_id = SENDJOBADS_END;
+			int num_attrs = 0;
+			neg_on_error( syscall_sock->code(proc_id) );
+			if (proc_id < -1) break;
+			neg_on_error( syscall_sock->code(num_attrs) );
+			if (num_attrs < 0 || num_attrs > SENDJOBADS_MAX_ATTRS) {
+				dprintf( D_ALWAYS, "SendJobAds: rejecting job %d.%d with %d attributes\n",
+					cluster_id, proc_id, num_attrs );
+				return -1;
+			}
+			attrs.resize(num_attrs);
+			for (auto & attr : attrs) {
+				neg_on_error( syscall_sock->code(attr.first) );
+				neg_on_error( syscall_sock->code(attr.second) );
+			}
+			if (rval < 0) {
+				continue;
+			}
+
+			++num_ads;
+			rval = QmgmtHandleSendJobAd(cluster_id, proc_id, attrs, flags, g_transaction_error.get(), terrno);
+			if (rval < 0) {
+				failed_proc = proc_id;
+				dprintf( D_ALWAYS, "SendJobAds failed for job %d.%d, rval = %d, errno = %d\n",
+					cluster_id, proc_id, rval, terrno );
+				if (g_transaction_error->empty()) {
+					g_transaction_error->pushf("QMGMT", SCHEDD_ERR_SET_ATTRIBUTE_FAILED,
+						"failed to submit job %d.%d (%d, errno %d)", cluster_id, proc_id, rval, terrno);
+				}
+			} else if (proc_id >= 0) {
+				dprintf( D_AUDIT, *syscall_sock,
+						 "Submitting new job %d.%d\n", cluster_id, proc_id );
+			}
+		}
+		neg_on_error( syscall_sock->end_of_message() );
+		dprintf( D_SYSCALLS, "\t%d ads, rval = %d, errno = %d\n", num_ads, rval, terrno );
+
+		syscall_sock->encode();
+		neg_on_error( syscall_sock->code(rval) );
+		if( rval < 0 ) {
+			neg_on_error( syscall_sock->code(terrno) );
+			neg_on_error( syscall_sock->code(failed_proc) );
+		}
+		neg_on_error( syscall_sock->end_of_message() );
+		return 0;
+	} break;
+
 	case CONDOR_SetJobFactory:
 	case CONDOR_SetMaterializeData:
 	{
@@ -718,46 +827,20 @@ do_Q_request(QmgmtPeer &Q_PEER, bool &may_fork)
 		} else {
 			errstack.reset(new CondorError());
 			errno = 0;
-			rval = CommitTransactionAndLive( flags, errstack.get() );
+			rval = CommitTransactionGroupSync( flags, errstack.get() );
 			terrno = errno;
 		}
 		dprintf( D_SYSCALLS, "\tflags = %d, rval = %d, errno = %d\n", flags, rval, terrno );
 
-		syscall_sock->encode();
-		neg_on_error( syscall_sock->code(rval) );
-		const CondorVersionInfo *vers = syscall_sock->get_peer_version();
-		bool send_classad = vers && vers->built_since_version(8, 3, 4);
-		bool always_send_classad = vers && vers->built_since_version(8, 7, 4);
-		if( rval < 0 ) {
-			neg_on_error( syscall_sock->code(terrno) );
+		if (rval >= 0 && ! (flags & NONDURABLE) && ! JobQueueLogSynced()) {
+			// the reply has to wait until the commit is on disk
+			std::shared_ptr<CondorError> errs(std::move(errstack));
+			DeferQmgmtReply([rval, terrno, errs](ReliSock *sock) {
+				return send_commit_reply(sock, rval, terrno, *errs);
+			});
+			return QMGMT_REPLY_DEFERRED;
 		}
-		if( rval < 0 && send_classad ) {
-			// Send a classad, for less backwards-incompatibility.
-			int code = 1;
-			const char * reason = "QMGMT rejected job submission.";
-			if(! errstack->empty()) {
-				code = 2;
-				reason = errstack->message();
-			}
-
-			ClassAd reply;
-			reply.Assign( "ErrorCode", code );
-			reply.Assign( "ErrorReason", reason );
-			neg_on_error( putClassAd( syscall_sock, reply ) );
-		} else if( always_send_classad ) {
-			ClassAd reply;
-
-			std::string reason;
-			if(! errstack->empty()) {
-				reason = errstack->getFullText();
-				reply.Assign( "WarningReason", reason );
-			}
-
-			neg_on_error( putClassAd( syscall_sock, reply ) );
-		}
-
-		neg_on_error( syscall_sock->end_of_message() );;
-		return 0;
+		return send_commit_reply(syscall_sock, rval, terrno, *errstack);
 	}
 
 	case CONDOR_GetAttributeFloat:
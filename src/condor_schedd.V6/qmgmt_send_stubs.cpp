@@ -22,6 +22,7 @@
 #include "condor_common.h"
 #include "condor_io.h"
 #include "condor_classad.h"
+#include "condor_attributes.h"
 #include "condor_fix_assert.h"
 #include "qmgmt_constants.h"
 #include "condor_qmgr.h"
@@ -394,6 +395,160 @@ int SendJobsetAd(int cluster_id, const classad::ClassAd & ad, unsigned int flags
 	return SendJobQueueAd(cluster_id, SENDJOBAD_TYPE_JOBSET, ad, flags);
 }
 
+// state of BeginSendJobAds. The ads go out in CONDOR_SendJobAds messages of up to
+// SEND_JOB_ADS_PER_MESSAGE ads, so that a failure is noticed before we send all
+// of a large cluster, and so that the schedd is not tied up reading one message for too long.
+#define SEND_JOB_ADS_PER_MESSAGE 1000
+static int send_job_ads_cluster = -1;
+static SetAttributeFlags_t send_job_ads_flags = 0;
+static int send_job_ads_count = -1; // ads in the current message, -1 if there is no message
+static int send_job_ads_rval = 0;
+static int send_job_ads_errno = 0;
+static int send_job_ads_failed_proc = -1;
+
+// end the current CONDOR_SendJobAds message, and read the reply to it
+static int FinishSendJobAdsMessage()
+{
+	int rval = -1;
+	int proc_id = SENDJOBADS_END;
+
+	send_job_ads_count = -1;
+	neg_on_error( qmgmt_sock->code(proc_id) );
+	neg_on_error( qmgmt_sock->end_of_message() );
+
+	qmgmt_sock->decode();
+	neg_on_error( qmgmt_sock->code(rval) );
+	if( rval < 0 ) {
+		neg_on_error( qmgmt_sock->code(terrno) );
+		neg_on_error( qmgmt_sock->code(send_job_ads_failed_proc) );
+		neg_on_error( qmgmt_sock->end_of_message() );
+		errno = terrno;
+		return rval;
+	}
+	neg_on_error( qmgmt_sock->end_of_message() );
+	return rval;
+}
+
+int BeginSendJobAds(int cluster_id, SetAttributeFlags_t flags)
+{
+	if (send_job_ads_count >= 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	send_job_ads_cluster = cluster_id;
+	send_job_ads_flags = flags;
+	send_job_ads_rval = 0;
+	send_job_ads_errno = 0;
+	send_job_ads_failed_proc = -1;
+	return 0;
+}
+
+// report the failure returned by the schedd for a CONDOR_SendJobAds message
+static void PushSendJobAdsError(int rval, CondorError *errstack, const char * who)
+{
+	if (errstack) {
+		errstack->pushf(who ? who : "Qmgmt", SCHEDD_ERR_SET_ATTRIBUTE_FAILED,
+			"failed to submit job %d.%d (%d, errno %d)",
+			send_job_ads_cluster, send_job_ads_failed_proc, rval, send_job_ads_errno);
+	}
+}
+
+int SendJobAd(const JOB_ID_KEY & key, const classad::ClassAd & ad, CondorError *errstack /*=NULL*/, const char * who /*=NULL*/)
+{
+	if (key.cluster != send_job_ads_cluster) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (send_job_ads_rval < 0) {
+		// the schedd has already failed an earlier ad
+		errno = send_job_ads_errno;
+		return send_job_ads_rval;
+	}
+
+	bool is_cluster = key.proc < 0;
+	int num_attrs = ad.size();
+	for (auto it = ad.begin(); it != ad.end(); ++it) {
+		if ( ! it->second) {
+			errno = EINVAL;
+			return -1;
+		}
+	}
+
+	// the proc ad must have a JobStatus, even if it is only in the chained cluster ad.
+	// see SendJobAttributes
+	int status = IDLE;
+	bool send_status = ! is_cluster && ad.find(ATTR_JOB_STATUS) == ad.end();
+	if (send_status) {
+		if ( ! ad.EvaluateAttrInt(ATTR_JOB_STATUS, status)) { status = IDLE; }
+		++num_attrs;
+	}
+	if (num_attrs > SENDJOBADS_MAX_ATTRS) {
+		// the schedd would drop the connection
+		errno = E2BIG;
+		return -1;
+	}
+
+	if (send_job_ads_count < 0) {
+		CurrentSysCall = CONDOR_SendJobAds;
+		SetAttributePublicFlags_t wflags = (send_job_ads_flags & SetAttribute_PublicFlagsMask);
+
+		qmgmt_sock->encode();
+		neg_on_error( qmgmt_sock->code(CurrentSysCall) );
+		neg_on_error( qmgmt_sock->code(send_job_ads_cluster) );
+		neg_on_error( qmgmt_sock->code(wflags) );
+		send_job_ads_count = 0;
+	}
+
+	int proc_id = is_cluster ? -1 : key.proc;
+	neg_on_error( qmgmt_sock->code(proc_id) );
+	neg_on_error( qmgmt_sock->code(num_attrs) );
+	if (send_status) {
+		std::string rhs = std::to_string(status);
+		neg_on_error( qmgmt_sock->put(ATTR_JOB_STATUS) );
+		neg_on_error( qmgmt_sock->put(rhs) );
+	}
+
+	// (shallow) iterate the attributes in this ad, the schedd skips those that belong in the other sort of ad
+	classad::ClassAdUnParser unparser;
+	unparser.SetOldClassAd( true, true );
+	std::string rhs; rhs.reserve(120);
+	for (auto it = ad.begin(); it != ad.end(); ++it) {
+		rhs.clear();
+		unparser.Unparse(rhs, it->second);
+		neg_on_error( qmgmt_sock->put(it->first) );
+		neg_on_error( qmgmt_sock->put(rhs) );
+	}
+
+	if (++send_job_ads_count >= SEND_JOB_ADS_PER_MESSAGE) {
+		send_job_ads_rval = FinishSendJobAdsMessage();
+		send_job_ads_errno = errno;
+		if (send_job_ads_rval < 0) {
+			PushSendJobAdsError(send_job_ads_rval, errstack, who);
+			errno = send_job_ads_errno;
+		}
+		return send_job_ads_rval;
+	}
+	return 0;
+}
+
+int EndSendJobAds(CondorError *errstack /*=NULL*/, const char * who /*=NULL*/)
+{
+	// a failure from an earlier message was reported by SendJobAd
+	int rval = send_job_ads_rval;
+	if (rval >= 0 && send_job_ads_count >= 0) {
+		rval = FinishSendJobAdsMessage();
+		send_job_ads_errno = errno;
+		if (rval < 0) {
+			PushSendJobAdsError(rval, errstack, who);
+		}
+	}
+	send_job_ads_cluster = -1;
+	send_job_ads_rval = 0;
+	send_job_ads_count = -1;
+	errno = send_job_ads_errno;
+	return rval;
+}
+
 #if 0
 int
 DestroyClusterByConstraint( char *constraint )
@@ -568,6 +723,9 @@ AbortTransaction_imp()
 {
 	int	rval = -1;
 
+		// finish any ads we are in the middle of sending, so the schedd can read this request
+		if (send_job_ads_count >= 0) { EndSendJobAds(); }
+
 		CurrentSysCall = CONDOR_AbortTransaction;
 
 		qmgmt_sock->encode();
@@ -600,6 +758,11 @@ RemoteCommitTransaction(SetAttributeFlags_t flags_in, CondorError *errstack)
 {
 	int	rval = -1;
 
+	// the ads we are in the middle of sending must all be in the transaction
+	if (send_job_ads_count >= 0 && EndSendJobAds(errstack) < 0) {
+		return -1;
+	}
+
 	// only some of the flags can be sent on the wire, the upper bits are private to the schedd
 	SetAttributePublicFlags_t flags = (flags_in & SetAttribute_PublicFlagsMask);
 	if( flags == 0 ) {
@@ -893,6 +1056,8 @@ SendSpoolFileIfNeeded( ClassAd& ad )
 int
 CloseSocket()
 {
+	if (send_job_ads_count >= 0) { EndSendJobAds(); }
+
 	CurrentSysCall = CONDOR_CloseSocket;
 
 	qmgmt_sock->encode();
@@ -1379,7 +1379,7 @@ Scheduler::sumAllSubmitterData(SubmitterData &all) {
 }
 
 void
-Scheduler::updateSubmitterAd(SubmitterData &SubDat, ClassAd &pAd, DCCollector *col, int flock_level, time_t time_now) {
+Scheduler::updateSubmitterAd(SubmitterData &SubDat, ClassAd &pAd, DCCollector *col, int flock_level, time_t time_now, std::deque<ClassAd> *batch_ads) {
 		const char * owner_name = SubDat.Name();
 		// only flocked collectors get names
 		const char * col_name = col ? col->name() : "";
@@ -1407,7 +1407,13 @@ Scheduler::updateSubmitterAd(SubmitterData &SubDat, ClassAd &pAd, DCCollector *c
 		}
 		// Update non-flock collectors
 		int num_updates = 0;
-		if (col) {
+		if (batch_ads && ! col) {
+			// sent with the others later
+			batch_ads->emplace_back(pAd);
+			SubDat.lastUpdateTime = time_now;
+			SubDat.absentUpdateSent = (SubDat.num.Hits == 0);
+			return;
+		} else if (col) {
 			DCCollectorAdSequences & adSeq = daemonCore->getUpdateAdSeq();
 			num_updates = col->sendUpdate( UPDATE_SUBMITTOR_AD, &pAd, adSeq, NULL, true );
 		} else {
@@ -1821,9 +1827,21 @@ Scheduler::count_jobs()
 	time_t time_now = time(nullptr);
 
 	if (param_boolean("SCHEDDS_ARE_SUBMITTERS", false) == false) {
-		// The usual case -- send one submitter ad per submitter
+		// The usual case -- send one submitter ad per submitter,
+		// perhaps all in one message
+		std::deque<ClassAd> batch_ads;
+		bool send_batch = param_boolean("SCHEDD_SEND_BATCH_UPDATES", false);
 		for (auto it = Submitters.begin(); it != Submitters.end(); ++it) {
-			updateSubmitterAd(it->second, pAd, nullptr, -1, time_now);
+			updateSubmitterAd(it->second, pAd, nullptr, -1, time_now, send_batch ? &batch_ads : nullptr);
+		}
+		if ( ! batch_ads.empty()) {
+			DCCollectorUpdateBatch batch;
+			for (auto & ad : batch_ads) {
+				batch.push_back({UPDATE_SUBMITTOR_AD, &ad, NULL});
+			}
+			int num_updates = daemonCore->sendUpdateBatch(batch, true);
+			dprintf( D_FULLDEBUG, "Sent %d submitter ads to %d collectors\n",
+				(int)batch.size(), num_updates );
 		}
 	} else {
 		// The case where we send one ad for the sum of all demand
@@ -3101,6 +3119,7 @@ clear_autocluster_id(JobQueueJob *job, const JOB_ID_KEY & /*jid*/, void *)
 {
 	job->Delete(ATTR_AUTO_CLUSTER_ID);
 	job->autocluster_id = -1;
+	UpdateJobQueueIndexes(job->jid);
 	return 0;
 }
 
@@ -14112,7 +14131,7 @@ Scheduler::RegisterTimers()
         }
         cleanid =
             daemonCore->Register_Timer(QueueCleanInterval,QueueCleanInterval,
-            CleanJobQueue,"CleanJobQueue");
+            PeriodicCleanJobQueue,"PeriodicCleanJobQueue");
     }
     oldQueueCleanInterval = QueueCleanInterval;
 
@@ -15636,6 +15655,7 @@ fixAttrUser(JobQueueJob *job, const JOB_ID_KEY & /*jid*/, void *oldUidDomain_raw
 	}
 
 	job->Assign( ATTR_USER, user );
+	UpdateJobQueueIndexes(job->jid);
 	return 0;
 }
 
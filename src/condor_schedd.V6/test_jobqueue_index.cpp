@@ -0,0 +1,354 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// Checks that the ads a query visits through the JobQueueIndex include every
+// ad that a scan of the whole queue finds, for a randomly made up job queue
+// that has attributes set and deleted, and jobs and clusters submitted and
+// destroyed, while the queries run.  Jobs inherit from their cluster ads as
+// in the schedd, so an ad's own value of an indexed attribute may hide the
+// value of its cluster ad, or be missing and leave it showing.
+//
+//   test_jobqueue_index [<seed>]
+//
+// The index is tested without the rest of the schedd, so the few parts of
+// the job queue it uses are defined here.
+
+#include "condor_common.h"
+#include "condor_attributes.h"
+#include "compat_classad_util.h"
+#include "qmgmt.h"
+#include "jobqueue_index.h"
+#include "test_random_ads.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------------------------
+// the job queue, and what the index uses of it
+// --------------------------------------------------------------------------
+
+static std::map<JOB_ID_KEY, JobQueueJob *> Queue;
+
+JobQueueCluster* GetClusterAd(int cluster)
+{
+	auto it = Queue.find(JOB_ID_KEY(cluster, CLUSTERID_qkey2));
+	return (it == Queue.end()) ? NULL : static_cast<JobQueueCluster *>(it->second);
+}
+
+void JobQueueBase::PopulateFromAd() {}
+void JobQueueJob::PopulateFromAd() {}
+JobQueueJob::~JobQueueJob() {}
+JobQueueCluster::~JobQueueCluster() {}
+
+void JobQueueCluster::AttachJob(JobQueueJob * job)
+{
+	++num_attached;
+	qe.append_tail(job->qe);
+	job->parent = this;
+}
+
+void JobQueueCluster::DetachJob(JobQueueJob * job)
+{
+	--num_attached;
+	job->qe.detach();
+	job->parent = NULL;
+}
+
+JobQueueJob * JobQueueCluster::FirstJob()
+{
+	if (qe.empty()) return nullptr;
+	return qe.next()->as<JobQueueJob>();
+}
+
+JobQueueJob * JobQueueCluster::NextJob(JobQueueJob * job)
+{
+	if ( ! job || job->qe.empty() || job->Cluster() != this) return nullptr;
+	job = job->qe.next()->as<JobQueueJob>();
+	if (job && job->IsCluster()) job = nullptr;
+	return job;
+}
+
+// --------------------------------------------------------------------------
+// making up the queue
+// --------------------------------------------------------------------------
+
+static const char * const owners[] = { "alice", "Alice", "bob", "carol" };
+static const char * const indexed_attrs[] = {
+	ATTR_OWNER, ATTR_USER, ATTR_JOB_STATUS, ATTR_JOB_SET_ID, ATTR_AUTO_CLUSTER_ID,
+};
+
+static int next_cluster = 1;
+
+// Set an attribute to a value the index looks up, a string for Owner and User
+// and a whole number for the others, including a real like 2.0, or to
+// something it keeps aside: a value of the wrong type, a real that is not
+// whole, undefined or an expression.
+static void set_attr(JobQueueJob * ad, const char * attr)
+{
+	bool is_string = (MATCH == strcasecmp(attr, ATTR_OWNER) || MATCH == strcasecmp(attr, ATTR_USER));
+	std::string user;
+	switch (rand() % 10) {
+	case 0: ad->Assign(attr, rand() % 2 ? "2" : "alice"); break;
+	case 1: ad->Assign(attr, 1 + rand() % 5 + (rand() % 2 ? 0.0 : 0.5)); break;
+	case 2: ad->Assign(attr, (rand() % 2) != 0); break;
+	case 3: ad->AssignExpr(attr, "undefined"); break;
+	case 4: ad->AssignExpr(attr, is_string ? "strcat(\"al\", \"ice\")" : "ProcId + 1"); break;
+	default:
+		if (is_string) {
+			formatstr(user, "%s%s", random_pick(owners), MATCH == strcasecmp(attr, ATTR_USER) ? "@example.org" : "");
+			ad->Assign(attr, user);
+		} else {
+			ad->Assign(attr, 1 + rand() % 5);
+		}
+		break;
+	}
+}
+
+static void submit_cluster(JobQueueIndex & index)
+{
+	JOB_ID_KEY cid(next_cluster++, CLUSTERID_qkey2);
+	JobQueueCluster * cad = new JobQueueCluster(cid);
+	cad->Assign(ATTR_CLUSTER_ID, cid.cluster);
+	cad->Assign(ATTR_OWNER, random_pick(owners));
+	cad->Assign(ATTR_USER, std::string(random_pick(owners)) + "@example.org");
+	if (rand() % 3 == 0) { cad->Assign(ATTR_JOB_SET_ID, 1 + rand() % 5); }
+	if (rand() % 5 == 0) { set_attr(cad, random_pick(indexed_attrs)); }
+	Queue[cid] = cad;
+	index.update(cid, cad);
+
+	int num_procs = rand() % 6;
+	for (int proc = 0; proc < num_procs; ++proc) {
+		JOB_ID_KEY jid(cid.cluster, proc);
+		JobQueueJob * job = new JobQueueJob(jid);
+		job->Assign(ATTR_PROC_ID, proc);
+		job->Assign(ATTR_JOB_STATUS, 1 + rand() % 5);
+		if (rand() % 2) { job->Assign(ATTR_AUTO_CLUSTER_ID, 1 + rand() % 5); }
+		if (rand() % 8 == 0) { set_attr(job, random_pick(indexed_attrs)); }
+		job->ChainToAd(cad);
+		cad->AttachJob(job);
+		Queue[jid] = job;
+		index.update(jid, job);
+	}
+	cad->SetClusterSize(num_procs);
+}
+
+static void destroy_ad(JobQueueIndex & index, JobQueueJob * ad)
+{
+	JOB_ID_KEY key = ad->jid;
+	if (key.proc == CLUSTERID_qkey2) {
+		JobQueueCluster * cad = static_cast<JobQueueCluster *>(ad);
+		while (JobQueueJob * job = cad->FirstJob()) {
+			destroy_ad(index, job);
+		}
+	} else {
+		JobQueueCluster * cad = ad->Cluster();
+		cad->DetachJob(ad);
+		cad->SetClusterSize(cad->ClusterSize() - 1);
+		ad->Unchain();
+	}
+	Queue.erase(key);
+	delete ad;
+	index.update(key, NULL);
+}
+
+static JobQueueJob * random_ad()
+{
+	auto it = Queue.begin();
+	std::advance(it, rand() % Queue.size());
+	return it->second;
+}
+
+// change the queue at random, keeping the index up to date as the schedd does
+static void change_queue(JobQueueIndex & index)
+{
+	if (Queue.size() < 20) {
+		submit_cluster(index);
+		return;
+	}
+	JobQueueJob * ad = random_ad();
+	switch (rand() % 10) {
+	case 0: submit_cluster(index); break;
+	case 1:
+		if (ad->jid.cluster > 0) { destroy_ad(index, ad); }
+		break;
+	case 2: case 3:
+		ad->Delete(random_pick(indexed_attrs));
+		index.update(ad->jid, ad);
+		break;
+	case 4:
+		ad->Assign("Other", rand() % 5);
+		index.update(ad->jid, ad);
+		break;
+	default:
+		set_attr(ad, random_pick(indexed_attrs));
+		index.update(ad->jid, ad);
+		break;
+	}
+}
+
+// a clause the index may look up, or one it must leave alone
+static std::string make_clause()
+{
+	int max_cluster = next_cluster + 1;
+	std::string clause;
+	switch (rand() % 14) {
+	case 0: formatstr(clause, "Owner == \"%s\"", random_pick(owners)); break;
+	case 1: formatstr(clause, "\"%s@example.org\" == User", random_pick(owners)); break;
+	case 2: formatstr(clause, "Owner =?= \"%s\"", random_pick(owners)); break;
+	case 3: formatstr(clause, "JobStatus == %d", rand() % 7); break;
+	case 4: formatstr(clause, "JobStatus =?= %d.0", rand() % 7); break;
+	case 5: formatstr(clause, "(JobSetId == %d)", rand() % 6); break;
+	case 6: formatstr(clause, "AutoClusterId == %d", rand() % 6); break;
+	case 7: formatstr(clause, "ClusterId == %d", 1 + rand() % max_cluster); break;
+	case 8: formatstr(clause, "ClusterId == %d && ProcId == %d", 1 + rand() % max_cluster, rand() % 6); break;
+	case 9: formatstr(clause, "ProcId == %d && %d == ClusterId", rand() % 6, 1 + rand() % max_cluster); break;
+	case 10: formatstr(clause, "JobStatus > %d", rand() % 7); break;
+	case 11: formatstr(clause, "Owner != \"%s\"", random_pick(owners)); break;
+	case 12: formatstr(clause, "Other == %d", rand() % 5); break;
+	default: clause = "JobStatus == \"2\""; break;
+	}
+	return clause;
+}
+
+static std::string make_requirements()
+{
+	std::string requirements = make_clause();
+	for (int n = rand() % 3; n > 0; --n) {
+		if (rand() % 2) {
+			requirements = "(" + requirements + ") || " + make_clause();
+		} else {
+			requirements += " && " + make_clause();
+		}
+	}
+	return requirements;
+}
+
+// Check one query: the ads the index gives must be in the queue, sorted, and
+// include every ad in the queue that matches.
+static unsigned check_query(JobQueueIndex & index, int & looked_up, int & skipped)
+{
+	std::string requirements = make_requirements();
+	classad::ExprTree * tree = NULL;
+	ParseClassAdRvalExpr(requirements.c_str(), tree);
+	ASSERT(tree);
+
+	unsigned failures = 0;
+	std::vector<JOB_ID_KEY> keys;
+	if (index.plan(tree, SIZE_MAX, keys)) {
+		++looked_up;
+		if ( ! std::is_sorted(keys.begin(), keys.end()) ||
+			std::adjacent_find(keys.begin(), keys.end()) != keys.end()) {
+			++failures;
+			fprintf(stderr, "the keys for %s are not sorted and unique\n", requirements.c_str());
+		}
+		for (auto & key : keys) {
+			if ( ! Queue.count(key)) {
+				++failures;
+				fprintf(stderr, "the index has %d.%d for %s, which is not in the queue\n",
+					key.cluster, key.proc, requirements.c_str());
+			}
+		}
+		for (auto & it : Queue) {
+			bool is_a_match = EvalExprBool(it.second, tree);
+			bool is_key = std::binary_search(keys.begin(), keys.end(), it.first);
+			if ( ! is_key) { ++skipped; }
+			if (is_a_match && ! is_key) {
+				++failures;
+				std::string ad_text;
+				sPrintAd(ad_text, *it.second);
+				fprintf(stderr, "index ruled out %d.%d, which matches %s\n%s\n",
+					it.first.cluster, it.first.proc, requirements.c_str(), ad_text.c_str());
+			}
+		}
+
+		// and with too few keys allowed, the query must scan the queue
+		if ( ! keys.empty()) {
+			std::vector<JOB_ID_KEY> fewer;
+			if (index.plan(tree, keys.size() - 1, fewer) || ! fewer.empty()) {
+				++failures;
+				fprintf(stderr, "the index planned %d keys for %s with at most %d allowed\n",
+					(int)fewer.size(), requirements.c_str(), (int)keys.size() - 1);
+			}
+		}
+	}
+	delete tree;
+	return failures;
+}
+
+static void build_index(JobQueueIndex & index)
+{
+	index.clear();
+	index.setBuilt();
+	for (auto & it : Queue) {
+		index.update(it.first, it.second);
+	}
+}
+
+int
+main( int argc, char ** argv )
+{
+	random_test_seed(argc, argv);
+
+	// the header ad is in the queue too
+	JOB_ID_KEY header(0, 0);
+	Queue[header] = new JobQueueJob(header);
+
+	JobQueueIndex index;
+	for (int ix = 0; ix < 200; ++ix) {
+		change_queue(index);
+	}
+	build_index(index);
+
+	const int num_queries = 4000;
+	unsigned failures = 0;
+	int looked_up = 0;
+	int skipped = 0;
+	for (int ix = 0; ix < num_queries; ++ix) {
+		for (int n = rand() % 4; n > 0; --n) {
+			change_queue(index);
+		}
+		// now and then the index is cleared and built again from the queue
+		if (ix % 1000 == 999) {
+			build_index(index);
+		}
+		failures += check_query(index, looked_up, skipped);
+	}
+
+	index.clear();
+	while (Queue.size() > 1) {
+		auto it = Queue.end();
+		--it;
+		destroy_ad(index, it->second);
+	}
+	delete Queue[header];
+	Queue.clear();
+
+	fprintf(stdout, "%d of %d queries used the index, %d ads ruled out\n",
+		looked_up, num_queries, skipped);
+	if (looked_up == 0 || skipped == 0) {
+		fprintf(stderr, "the index was never used\n");
+		++failures;
+	}
+	if( failures == 0 ) {
+		fprintf( stdout, "No failures detected.\n" );
+	}
+	return failures;
+}
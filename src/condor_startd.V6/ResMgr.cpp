@@ -67,6 +67,8 @@ ResMgr::ResMgr() :
 	up_tid = -1;
 	poll_tid = -1;
 	m_cred_sweep_tid = -1;
+	m_send_batch_updates = false;
+	m_batch_update_tid = -1;
 
 	draining = false;
 	draining_is_graceful = false;
@@ -232,6 +234,8 @@ ResMgr::init_config_classad( void )
 	if( config_classad ) delete config_classad;
 	config_classad = new ClassAd();
 
+	m_send_batch_updates = param_boolean("STARTD_SEND_BATCH_UPDATES", false);
+
 		// First, bring in everything we know we need
 	configInsert( config_classad, "START", true );
 	configInsert( config_classad, "SUSPEND", true );
@@ -895,18 +899,90 @@ int
 ResMgr::send_update( int cmd, ClassAd* public_ad, ClassAd* private_ad,
 					 bool nonblock )
 {
-	static bool first_time = true;
-
 		// Increment the resmgr's count of updates.
 	num_updates++;
 
 	int res = daemonCore->sendUpdates(cmd, public_ad, private_ad, nonblock, &m_token_requester,
 		DCTokenRequester::default_identity, "ADVERTISE_STARTD");
 
+	sent_update();
+	return res;
+}
+
+void
+ResMgr::queue_batch_update( Resource* rip )
+{
+	if (std::find(m_batch_update_slots.begin(), m_batch_update_slots.end(), rip) != m_batch_update_slots.end()) {
+		return;
+	}
+	m_batch_update_slots.push_back(rip);
+	if (m_batch_update_tid == -1) {
+		m_batch_update_tid = daemonCore->Register_Timer(0,
+			(TimerHandlercpp)&ResMgr::send_batch_update,
+			"send_batch_update", this);
+	}
+}
+
+void
+ResMgr::cancel_batch_update( Resource* rip )
+{
+	auto it = std::find(m_batch_update_slots.begin(), m_batch_update_slots.end(), rip);
+	if (it != m_batch_update_slots.end()) {
+		m_batch_update_slots.erase(it);
+	}
+}
+
+// Send the updates of all the slots that have asked for one since the
+// last batch, in one message to each collector.
+void
+ResMgr::send_batch_update( void )
+{
+	m_batch_update_tid = -1;
+
+	std::vector<Resource*> rips;
+	rips.swap(m_batch_update_slots);
+	if (rips.empty()) {
+		return;
+	}
+
+	struct SlotAds {
+		ClassAd public_ad;
+		ClassAd private_ad;
+		ClassAd delta_ad;
+	};
+	std::deque<SlotAds> ads;	// so they stay put as it grows
+	DCCollectorUpdateBatch batch;
+	for (Resource *rip : rips) {
+		SlotAds &slot = ads.emplace_back();
+		ClassAd *update_ad = NULL;
+		int cmd = rip->make_update_ads(slot.public_ad, slot.private_ad, slot.delta_ad, update_ad);
+		batch.push_back({cmd, update_ad, &slot.private_ad});
+	}
+
+	num_updates += (int)batch.size();
+	int res = daemonCore->sendUpdateBatch(batch, true, &m_token_requester,
+		DCTokenRequester::default_identity, "ADVERTISE_STARTD");
+	if( res ) {
+		dprintf( D_FULLDEBUG, "Sent update of %d slots to %d collector(s)\n", (int)batch.size(), res );
+	} else {
+		dprintf( D_ALWAYS, "Error sending update to collector(s)\n" );
+	}
+	sent_update();
+
+	for (size_t ix = 0; ix < rips.size(); ix++) {
+		rips[ix]->update_working_cm(ads[ix].public_ad, ads[ix].private_ad);
+	}
+}
+
+void
+ResMgr::sent_update( void )
+{
+	static bool first_time = true;
+
 	if (first_time) {
 		first_time = false;
 		dprintf( D_ALWAYS, "Initial update sent to collector(s)\n");
-		if ( ! param_boolean("STARTD_SEND_READY_AFTER_FIRST_UPDATE", true)) return res;
+		if ( ! param_boolean("STARTD_SEND_READY_AFTER_FIRST_UPDATE", true)) return;
 
 		// send a DC_SET_READY message to the master to indicate the STARTD is ready to go
 		const char* master_sinful(daemonCore->InfoCommandSinfulString(-2));
@@ -921,8 +997,6 @@ ResMgr::send_update( int cmd, ClassAd* public_ad, ClassAd* private_ad,
 			dmn->sendMsg(msg.get());
 		}
 	}
-
-	return res;
 }
 
 
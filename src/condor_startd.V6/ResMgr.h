@@ -171,6 +171,13 @@ public:
 	int		numSlots( void ) const { return (int)slots.size(); }
 
 	int		send_update( int, ClassAd*, ClassAd*, bool nonblocking );
+
+		// With STARTD_SEND_BATCH_UPDATES, the slots that need an update
+		// are queued, and their updates all sent in one message.
+	bool	sending_batch_updates( void ) const { return m_send_batch_updates; }
+	void	queue_batch_update( Resource* );
+	void	cancel_batch_update( Resource* );
+	void	send_batch_update( void );
 	void	final_update( void );
 	
 		// Evaluate the state of all resources.
@@ -438,6 +445,10 @@ private:
 
 	int		num_updates;
 	int		up_tid;		// DaemonCore timer id for update timer
+	bool	m_send_batch_updates;
+	std::vector<Resource*> m_batch_update_slots;	// in the order they asked
+	int		m_batch_update_tid;	// DaemonCore timer id for sending them
+	void	sent_update( void );
 	int		poll_tid;	// DaemonCore timer id for polling timer
 	int		m_cred_sweep_tid;	// DaemonCore timer id for polling timer
 	time_t	startTime;		// Time that we started
@@ -289,6 +289,8 @@ Resource::Resource( CpuAttributes* cap, int rid, Resource* _parent )
 	r_no_collector_updates = SlotType::type_param_boolean(cap, "HIDDEN", false);
 
 	update_tid = -1;
+	r_last_update_ad = NULL;
+	r_update_generation = 0;
 
 #ifdef USE_STARTD_LATCHES  // more generic mechanism for CpuBusy
 #else
@@ -330,6 +332,9 @@ Resource::Resource( CpuAttributes* cap, int rid, Resource* _parent )
 
 Resource::~Resource()
 {
+	if (resmgr) {
+		resmgr->cancel_batch_update(this);
+	}
 	if ( update_tid != -1 ) {
 		if( daemonCore->Cancel_Timer(update_tid) < 0 ) {
 			::dprintf( D_ALWAYS, "failed to cancel update timer (%d): "
@@ -337,6 +342,8 @@ Resource::~Resource()
 		}
 		update_tid = -1;
 	}
+	delete r_last_update_ad;
+	r_last_update_ad = NULL;
 
 #if HAVE_JOB_HOOKS
 	if (m_next_fetch_work_tid != -1) {
@@ -1339,6 +1346,12 @@ Resource::update_needed( WhyFor /*why*/ )
 	//dprintf(D_ZKM, "Resource::update_needed(%d) %s\n",
 	//	why, update_tid < 0 ? "queuing timer" : "timer already queued");
 
+		// The updates of all the slots that need one are sent together
+	if (update_tid == -1 && resmgr->sending_batch_updates()) {
+		resmgr->queue_batch_update(this);
+		return;
+	}
+
 	// If we haven't already queued an update, queue one.
 	int delay = 0;
 	int updateSpreadTime = param_integer( "UPDATE_SPREAD_TIME", 0 );
@@ -1544,7 +1557,29 @@ Resource::do_update( void )
 	int rval;
 	ClassAd private_ad;
 	ClassAd public_ad;
+	ClassAd delta_ad;
+	ClassAd *update_ad = NULL;
+
+	int cmd = make_update_ads(public_ad, private_ad, delta_ad, update_ad);
+	rval = resmgr->send_update( cmd, update_ad,
+								&private_ad, true );
+	if( rval ) {
+		dprintf( D_FULLDEBUG, "Sent update to %d collector(s)\n", rval );
+	} else {
+		dprintf( D_ALWAYS, "Error sending update to collector(s)\n" );
+	}
+
+	update_working_cm(public_ad, private_ad);
+
+	// We _must_ reset update_tid to -1 before we return so
+	// the class knows there is no pending update.
+	update_tid = -1;
+}
 
+int
+Resource::make_update_ads( ClassAd & public_ad, ClassAd & private_ad,
+						   ClassAd & delta_ad, ClassAd *& update_ad )
+{
 	// Get the public and private ads
 	publish_single_slot_ad(public_ad, 0, Resource::Purpose::for_update);
 
@@ -1557,25 +1592,88 @@ Resource::do_update( void )
 	StartdPluginManager::Update(&public_ad, &private_ad);
 #endif
 
-		// Send class ads to owning collector(s)
-	rval = resmgr->send_update( UPDATE_STARTD_AD, &public_ad,
-								&private_ad, true );
-	if( rval ) {
-		dprintf( D_FULLDEBUG, "Sent update to %d collector(s)\n", rval );
-	} else {
-		dprintf( D_ALWAYS, "Error sending update to collector(s)\n" );
+		// Send class ads to owning collector(s), just the changes
+		// since the last update if we can.
+	int cmd = UPDATE_STARTD_AD;
+	update_ad = &public_ad;
+	if (param_boolean("STARTD_SEND_DELTA_UPDATES", false)) {
+		if (make_delta_ad(public_ad, delta_ad)) {
+			cmd = UPDATE_STARTD_AD_DELTA;
+			update_ad = &delta_ad;
+		}
+	} else if (r_last_update_ad) {
+		delete r_last_update_ad;
+		r_last_update_ad = NULL;
 	}
+	return cmd;
+}
 
+void
+Resource::update_working_cm( ClassAd & public_ad, ClassAd & private_ad )
+{
 	// If we have a temporary CM, send update there, too
 	if (!r_cur->c_working_cm.empty()) {
 		CollectorList *workingCollectors = CollectorList::create(r_cur->c_working_cm.c_str());
 		workingCollectors->sendUpdates(UPDATE_STARTD_AD, &public_ad, &private_ad, true);
 		delete workingCollectors;
 	}
+}
 
-	// We _must_ reset update_tid to -1 before we return so
-	// the class knows there is no pending update.
-	update_tid = -1;
+void
+Resource::request_full_update( void )
+{
+	if (r_last_update_ad) {
+		delete r_last_update_ad;
+		r_last_update_ad = NULL;
+	}
+	update_needed(wf_fullUpdate);
+}
+
+// Works out what changed in the public ad since the last update.  Returns
+// true if delta_ad should be sent in place of public_ad, or false if
+// public_ad must be sent whole, because there is nothing to compare it
+// with.  Either way, public_ad gets the new generation number, and
+// becomes the base for the next delta.
+bool
+Resource::make_delta_ad( ClassAd & public_ad, ClassAd & delta_ad )
+{
+	long long base_generation = r_update_generation++;
+	public_ad.Assign(ATTR_STARTD_DELTA_GENERATION, r_update_generation);
+
+	if ( ! r_last_update_ad) {
+		r_last_update_ad = new ClassAd(public_ad);
+		return false;
+	}
+
+	std::string removed;
+	for (auto itr = r_last_update_ad->begin(); itr != r_last_update_ad->end(); ) {
+		if ( ! public_ad.Lookup(itr->first)) {
+			if ( ! removed.empty()) { removed += ","; }
+			removed += itr->first;
+			r_last_update_ad->Delete((itr++)->first);
+		} else {
+			++itr;
+		}
+	}
+	for (auto itr = public_ad.begin(); itr != public_ad.end(); ++itr) {
+		ExprTree *old_expr = r_last_update_ad->Lookup(itr->first);
+		if ( ! old_expr || ! old_expr->SameAs(itr->second)) {
+			delta_ad.Insert(itr->first, itr->second->Copy());
+			r_last_update_ad->Insert(itr->first, itr->second->Copy());
+		}
+	}
+
+		// the collector needs these to find the ad to apply the delta to
+	CopyAttribute(ATTR_NAME, delta_ad, public_ad);
+	CopyAttribute(ATTR_MY_ADDRESS, delta_ad, public_ad);
+	CopyAttribute(ATTR_STARTD_IP_ADDR, delta_ad, public_ad);
+	SetMyTypeName(delta_ad, STARTD_ADTYPE);
+
+	delta_ad.Assign(ATTR_STARTD_DELTA_BASE_GENERATION, base_generation);
+	if ( ! removed.empty()) {
+		delta_ad.Assign(ATTR_STARTD_DELTA_REMOVED_ATTRS, removed);
+	}
+	return true;
 }
 
 // build a slot ad from whole cloth, used for updating the collector, etc
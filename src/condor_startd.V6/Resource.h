@@ -329,11 +329,19 @@ public:
 		wf_dslotCreate,    //7
 		wf_dslotDelete,    //8
 		wf_refreshRes,     //9
+		wf_fullUpdate,     //10
 	} WhyFor;
 	void	update_needed( WhyFor why );// Schedule to update the central manager.
 	void	update_walk_for_timer() { update_needed(wf_timer); } // for use with Walk where arguments are not permitted
 	void	update_walk_for_vm_change() { update_needed(wf_vmChange); } // for use with Walk where arguments are not permitted
 	void	do_update( void );			// Actually update the CM
+		// Build the ads for an update, returning the command to send
+		// them with.  update_ad is set to the public ad to send, which
+		// is delta_ad if only the changes are being sent.
+	int		make_update_ads( ClassAd & public_ad, ClassAd & private_ad,
+							 ClassAd & delta_ad, ClassAd *& update_ad );
+	void	update_working_cm( ClassAd & public_ad, ClassAd & private_ad );
+	void	request_full_update( void );	// Next update sends the whole ad, not a delta
 	void    process_update_ad(ClassAd & ad, int snapshot=0); // change the update ad before we send it 
     int     update_with_ack( void );    // Actually update the CM and wait for an ACK, used when hibernating.
 	void	final_update( void );		// Send a final update to the CM
@@ -487,6 +495,15 @@ private:
 
 	int			update_tid;	// DaemonCore timer id for update delay
 
+		// The public ad as of the last update, which the collector(s)
+		// should also have, and the generation number it was sent with.
+		// Updates only send what changed since then when
+		// STARTD_SEND_DELTA_UPDATES is true.  NULL if the next update
+		// must send the whole ad.
+	ClassAd*	r_last_update_ad;
+	long long	r_update_generation;
+	bool	make_delta_ad( ClassAd & public_ad, ClassAd & delta_ad );
+
 #ifdef USE_STARTD_LATCHES  // more generic mechanism for CpuBusy
 #else
 	int		r_cpu_busy;
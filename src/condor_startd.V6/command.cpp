@@ -2324,6 +2324,30 @@ command_cancel_drain_jobs(int /*dc_cmd*/, Stream* s )
 	return TRUE;
 }
 
+int
+command_request_full_update(int /*dc_cmd*/, Stream* s )
+{
+	ClassAd ad;
+
+	s->decode();
+	if( !getClassAd(s, ad) || !s->end_of_message() ) {
+		dprintf(D_ALWAYS,"command_request_full_update: failed to read request from %s\n",s->peer_description());
+		return FALSE;
+	}
+
+	std::string name;
+	ad.LookupString(ATTR_NAME, name);
+	Resource *rip = resmgr->get_by_name(name.c_str());
+	if( !rip ) {
+		dprintf(D_FULLDEBUG,"command_request_full_update: no slot named %s\n",name.c_str());
+		return TRUE;
+	}
+
+	dprintf(D_FULLDEBUG,"Collector %s asked for a full update of %s\n",s->peer_description(),name.c_str());
+	rip->request_full_update();
+	return TRUE;
+}
+
 int
 command_coalesce_slots(int, Stream * stream ) {
 	Sock * sock = (Sock *)stream;
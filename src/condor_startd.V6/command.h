@@ -120,6 +120,9 @@ int command_drain_jobs(int dc_cmd, Stream* s );
 // Cancel prior request to drain jobs
 int command_cancel_drain_jobs(int dc_cmd, Stream* s );
 
+// Collector wants the whole ad of a slot, not a delta
+int command_request_full_update(int dc_cmd, Stream* s );
+
 // ...
 int command_coalesce_slots(int, Stream * stream );
 
@@ -391,6 +391,10 @@ main_init( int, char* argv[] )
 								  "CANCEL_DRAIN_JOBS",
 								  command_cancel_drain_jobs,
 								  "command_cancel_drain_jobs", ADMINISTRATOR);
+	daemonCore->Register_CommandWithPayload( REQUEST_FULL_STARTD_UPDATE,
+								  "REQUEST_FULL_STARTD_UPDATE",
+								  command_request_full_update,
+								  "command_request_full_update", DAEMON);
 
 		//////////////////////////////////////////////////
 		// Reapers 
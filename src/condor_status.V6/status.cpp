@@ -1183,10 +1183,15 @@ main (int argc, char *argv[])
 	void * rightArg = & mai;
 	FNPROCESS_ADS_CALLBACK rightCallback = merge_ads_callback;
 
+	// Parse the ads into an arena, so that they are allocated in large blocks
+	// and the blocks reused as the ads are rendered and deleted. The arena is
+	// never freed since the ads we keep may be deleted as we exit.
+	static classad::ClassAdArena * ad_arena = new classad::ClassAdArena();
 	if( rightFileName != NULL ) {
 		std::string req;
 		q = query->getRequirements(req);
 		const char * constraint = req.empty() ? NULL : req.c_str();
+		classad::ClassAdArenaScope arena_scope(ad_arena);
 		if( read_classad_file( rightFileName, rightFileFormat, rightCallback, rightArg, constraint, result_limit ) ) {
 			q = Q_OK;
 		}
@@ -1195,11 +1200,11 @@ main (int argc, char *argv[])
 			// subsystem that corresponds to a daemon (above).
 			// Here 'addr' represents either the host:port of requested pool, or
 			// alternatively the host:port of daemon associated with requested subsystem (direct mode)
-		q = query->processAds( rightCallback, rightArg, addr, & errstack );
+		q = query->processAds( rightCallback, rightArg, addr, & errstack, ad_arena );
 	} else {
 			// otherwise obtain list of collectors and submit query that way
 		CollectorList * collectors = CollectorList::create();
-		q = collectors->query( * query, rightCallback, rightArg, & errstack );
+		q = collectors->query( * query, rightCallback, rightArg, & errstack, ad_arena );
 		delete collectors;
 	}
 
@@ -230,6 +230,7 @@ bool IsNoClusterAttr(const char * name);
 int  check_sub_file(void*pv, SubmitHash * sub, _submit_file_role role, const char * name, int flags);
 bool is_crlf_shebang(const char * path);
 int  SendLastExecutable();
+static void print_new_proc_error(int rval);
 static int MySendJobAttributes(const JOB_ID_KEY & key, const classad::ClassAd & ad, SetAttributeFlags_t saflags);
 int  DoUnitTests(int options);
 
@@ -2321,16 +2322,7 @@ int queue_item(int num, StringList & vars, char * item, int item_index, int opti
 
 		if ( ProcId < 0 ) {
 			fprintf(stderr, "\nERROR: Failed to create proc\n");
-			if ( ProcId == NEWJOB_ERR_MAX_JOBS_SUBMITTED ) {
-				fprintf(stderr,
-				"Number of submitted jobs would exceed MAX_JOBS_SUBMITTED\n");
-			} else if( ProcId == NEWJOB_ERR_MAX_JOBS_PER_OWNER ) {
-				fprintf(stderr,
-				"Number of submitted jobs would exceed MAX_JOBS_PER_OWNER\n");
-			} else if( ProcId == NEWJOB_ERR_MAX_JOBS_PER_SUBMISSION ) {
-				fprintf(stderr,
-				"Number of submitted jobs would exceed MAX_JOBS_PER_SUBMISSION\n");
-			}
+			print_new_proc_error(ProcId);
 			DoCleanup(0,0,NULL);
 			exit(1);
 		}
@@ -2955,6 +2947,21 @@ static int IsForcedProcAttribute(const char *attr)
 }
 
 
+// print the reason for a NEWJOB_ERR_* code from NewProc
+static void print_new_proc_error(int rval)
+{
+	if ( rval == NEWJOB_ERR_MAX_JOBS_SUBMITTED ) {
+		fprintf(stderr,
+		"Number of submitted jobs would exceed MAX_JOBS_SUBMITTED\n");
+	} else if( rval == NEWJOB_ERR_MAX_JOBS_PER_OWNER ) {
+		fprintf(stderr,
+		"Number of submitted jobs would exceed MAX_JOBS_PER_OWNER\n");
+	} else if( rval == NEWJOB_ERR_MAX_JOBS_PER_SUBMISSION ) {
+		fprintf(stderr,
+		"Number of submitted jobs would exceed MAX_JOBS_PER_SUBMISSION\n");
+	}
+}
+
 // we have our own private implementation of SendAdAttributes because we use the abstract schedd queue (for -dry and -dump)
 static int MySendJobAttributes(const JOB_ID_KEY & key, const classad::ClassAd & ad, SetAttributeFlags_t saflags)
 {
@@ -2966,6 +2973,17 @@ static int MySendJobAttributes(const JOB_ID_KEY & key, const classad::ClassAd &
 	key.sprint(keybuf);
 	const char * keystr = keybuf.c_str();
 
+	// if the schedd can take the ads of a cluster a message at a time, send the whole ad now.
+	// the schedd replies only now and then, so a failure may be from an earlier proc.
+	if (MyQ->has_send_job_ads()) {
+		int rval = MyQ->send_JobAd(key, ad, saflags);
+		if (rval < 0) {
+			fprintf( stderr, "\nERROR: Failed submission for job %s - aborting entire submit\n", keystr);
+			print_new_proc_error(rval);
+		}
+		return rval;
+	}
+
 	int retval = 0;
 	bool is_cluster = key.proc < 0;
 
@@ -73,6 +73,8 @@ public:
 	virtual int set_Factory(int cluster, int qnum, const char * filename, const char * text);
 	virtual int send_Itemdata(int cluster, SubmitForeachArgs & o);
 	virtual int send_Jobset(int cluster, const ClassAd * jobset_ad);
+	virtual bool has_send_job_ads() { return false; }
+	virtual int send_JobAd(const JOB_ID_KEY & /*key*/, const classad::ClassAd & /*ad*/, SetAttributeFlags_t /*flags*/) { errno = EINVAL; return -1; }
 
 	// set a file that send_Itemdata should "echo" items into. If this file is not set
 	// items are sent but not echoed.
@@ -36,6 +36,8 @@
 #include "match_prefix.h"
 #include "subsystem_info.h"
 #include "historyFileFinder.h"
+#include "historyIndex.h"
+#include "historyArchive.h"
 #include "condor_id.h"
 #include "userlog_to_classads.h"
 #include "setenv.h"
@@ -153,6 +155,7 @@ static  bool use_json_lines = false;
 static  bool wide_format=false;
 static  int  wide_format_width = 0;
 static  bool customFormat=false;
+static  bool format_needs_whole_ad=false; // -format attributes aren't in the projection
 static  bool disable_user_print_files=false;
 static  bool backwards=true;
 static  AttrListPrintMask mask;
@@ -433,6 +436,7 @@ main(int argc, const char* argv[])
 		}
 		mask.registerFormatF(argv[i + 1], argv[i + 2], FormatOptionNoTruncate);
 		customFormat = true;
+		format_needs_whole_ad = true;
 		i += 2;
     }
 	else if (*(argv[i]) == '-' && 
@@ -683,6 +687,11 @@ main(int argc, const char* argv[])
 	}
   }
 
+  // Parse the history ads into an arena, so that they are allocated in large blocks
+  // and the blocks reused as we print and delete the ads. The arena is never freed,
+  // since any ads we keep may be deleted as we exit.
+  classad::ClassAdArenaScope arena_scope(new classad::ClassAdArena());
+
   if(readfromfile == true) {
 		// some output methods use a whitelist rather than a stringlist projection.
 		for (const char * attr = projection.first(); attr != NULL; attr = projection.next()) {
@@ -1067,6 +1076,7 @@ static const char* getAdTypeFromBanner(std::string& banner, std::string& ad_type
 }
 
 static bool parseBanner(BannerInfo& info, std::string banner);
+static bool bannerWanted(const BannerInfo& info);
 
 //History source files that we expect to only contain 1 instance of a Job Ad
 static bool hasOneJobInstInFile() {
@@ -1335,6 +1345,8 @@ static void printJob(ClassAd & ad)
 	printCount++;
 }
 
+static void processHistoryAd(ClassAd & ad, const char* constraint, ExprTree *constraintExpr, BannerInfo& banner);
+
 // convert list of expressions into a classad
 //
 static void printJobIfConstraint(std::vector<std::string> & exprs, const char* constraint, ExprTree *constraintExpr, BannerInfo& banner)
@@ -1358,6 +1370,13 @@ static void printJobIfConstraint(std::vector<std::string> & exprs, const char* c
 		}
 		exprs.pop_back();
 	}
+	processHistoryAd(ad, constraint, constraintExpr, banner);
+}
+
+// check a history ad against -since and the constraint, and print it if it matches
+//
+static void processHistoryAd(ClassAd & ad, const char* constraint, ExprTree *constraintExpr, BannerInfo& banner)
+{
 	++adCount;
 
 	if (sinceExpr && EvalExprBool(&ad, sinceExpr)) {
@@ -1447,7 +1466,11 @@ static bool parseBanner(BannerInfo& info, std::string banner) {
 	//For testing output of banner
 	//fprintf(stdout,"Ad type: %s\n",info.ad_type.c_str());
 	//fprintf(stdout,"Parsed banner info: %s %d.%d | Comp: %ld | Epoch: %d\n",info.owner.c_str(),info.jid.cluster, info.jid.proc, info.completion, info.runId);
+	return bannerWanted(info);
+}
 
+// Whether the ad with the given banner info might be one of the jobs or owners being searched for
+static bool bannerWanted(const BannerInfo& info) {
 	if(jobIdFilterInfo.empty() && ownersList.empty()) { return true; } //If no searches were specified then return true to print job ad
 	else if (info.jid.cluster <= 0 && !jobIdFilterInfo.empty()) { return true; } //If failed to get cluster info and we are searching for job id info return true
 	else if (info.owner.empty() && !ownersList.empty()) { return true; }//If failed to parse owner and we are searching for an owner return true
@@ -1460,6 +1483,133 @@ static bool parseBanner(BannerInfo& info, std::string banner) {
 	return false;
 }
 
+// Read the ads of a history file that the search for particular jobs or owners
+// wants, using the index of the file to find them.  This does what the backwards
+// (or forwards) scan would, without parsing the other ads or their banners.
+// Returns false if the file has no index we can use.
+static bool readHistoryFromIndex(const char *JobHistoryFileName, const char* constraint, ExprTree *constraintExpr, bool read_backwards)
+{
+	// The jobs and owners are on the command line, or for the schedd's
+	// history helper, in the constraint.
+	HistoryIndexSearch search;
+	if ( ! jobIdFilterInfo.empty() || ! ownersList.empty()) {
+		for (auto& item : jobIdFilterInfo) { search.clusters.insert(item.jid.cluster); }
+		for (auto& name : ownersList) { search.owners.insert(HistoryIndexOwnerHash(name.c_str())); }
+	} else if ( ! constraintExpr || ! HistoryIndexSearchTerms(constraintExpr, search.clusters, search.owners)) {
+		return false;
+	} else {
+		// Then the scan would check -since against every ad, not just those
+		// the banners pick out, so the search must too.
+		search.since = sinceExpr;
+	}
+	search.backwards = read_backwards;
+
+	return SearchHistoryIndex(JobHistoryFileName, search, [&](HistoryIndexHit &hit) -> bool {
+		switch (hit.kind) {
+		case HistoryIndexHit::SINCE:
+			++adCount;
+			maxAds = adCount; // this will force us to stop scanning
+			return true;
+		case HistoryIndexHit::PASSED:
+			// not wanted, but when reading backwards we can still check
+			// completion dates vs QDates for done jobs, as the scan does.
+			if (read_backwards && cluster > 0) {
+				BannerInfo info;
+				info.jid.cluster = hit.entry.cluster;
+				info.jid.proc = hit.entry.proc;
+				info.completion = hit.entry.completion;
+				return checkMatchJobIdsFound(info, NULL, true);
+			}
+			return false;
+		case HistoryIndexHit::BAD:
+			printf( "\t*** Warning: Bad history file; skipping malformed ad(s)\n" );
+			return false;
+		case HistoryIndexHit::AD:
+			break;
+		}
+
+		BannerInfo curr_banner;
+		if (parseBanner(curr_banner, hit.banner)) {
+			printJobIfConstraint(hit.lines, constraint, constraintExpr, curr_banner);
+		}
+		return (specifiedMatch > 0 && matchCount >= specifiedMatch) || (maxAds > 0 && adCount >= maxAds) || abort_transfer;
+	});
+}
+
+// Read the ads from a history file that has been turned into an archive.  Blocks
+// where the constraint and -since can't match are passed over, and for the
+// rest only the columns that will be looked at or printed are read.
+static void readHistoryFromArchive(const char *JobHistoryFileName, const char* constraint, ExprTree *constraintExpr, bool read_backwards)
+{
+	HistoryArchiveReader reader;
+	if ( ! reader.open(JobHistoryFileName)) {
+		fprintf(stderr,"Error opening history file %s: %s\n", JobHistoryFileName, strerror(errno));
+		exit(1);
+	}
+
+	// The attributes we need are those printed, unless we can't tell what
+	// they are, and those needed to pick out the ads.
+	classad::References attrs;
+	bool all_attrs;
+	if (writetosocket) {
+		all_attrs = whitelist.empty();
+		attrs = whitelist;
+	} else {
+		all_attrs = projection.isEmpty() || format_needs_whole_ad;
+		projection.rewind();
+		while (const char *attr = projection.next()) { attrs.insert(attr); }
+	}
+	ClassAd empty;
+	if (constraintExpr) { GetExprReferences(constraintExpr, empty, &attrs, &attrs); }
+	if (sinceExpr) { GetExprReferences(sinceExpr, empty, &attrs, &attrs); }
+	static const char* const banner_attrs[] = {
+		ATTR_CLUSTER_ID, ATTR_PROC_ID, ATTR_OWNER, ATTR_COMPLETION_DATE,
+		ATTR_Q_DATE, ATTR_TOTAL_SUBMIT_PROCS, ATTR_NUM_SHADOW_STARTS,
+	};
+	for (auto attr : banner_attrs) { attrs.insert(attr); }
+
+	bool has_constraint = constraint && constraint[0] && constraintExpr;
+	bool done = false;
+	size_t num_blocks = reader.numBlocks();
+	for (size_t bx = 0; bx < num_blocks && !done; ++bx) {
+		HistoryArchiveBlock block;
+		if ( ! reader.readBlock(read_backwards ? num_blocks - 1 - bx : bx, block)) {
+			printf( "\t*** Warning: Bad history file; skipping malformed ad(s)\n" );
+			continue;
+		}
+		if (has_constraint && ! reader.mightMatch(block, constraintExpr) &&
+			( ! sinceExpr || ! reader.mightMatch(block, sinceExpr))) {
+			continue;
+		}
+		if ( ! reader.loadColumns(block, all_attrs ? NULL : &attrs)) {
+			printf( "\t*** Warning: Bad history file; skipping malformed ad(s)\n" );
+			continue;
+		}
+
+		for (uint32_t row = 0; row < block.num_ads && !done; ++row) {
+			ClassAd ad;
+			reader.getAd(block, read_backwards ? block.num_ads - 1 - row : row, ad);
+
+			BannerInfo curr_banner;
+			long long val;
+			if (ad.LookupInteger(ATTR_CLUSTER_ID, val) && val > 0 && val <= INT_MAX) { curr_banner.jid.cluster = (int)val; }
+			if (ad.LookupInteger(ATTR_PROC_ID, val) && val >= 0 && val <= INT_MAX) { curr_banner.jid.proc = (int)val; }
+			if (ad.LookupInteger(ATTR_COMPLETION_DATE, val)) { curr_banner.completion = val; }
+			ad.LookupString(ATTR_OWNER, curr_banner.owner);
+			if (bannerWanted(curr_banner)) {
+				processHistoryAd(ad, constraint, constraintExpr, curr_banner);
+			} else if (read_backwards && cluster > 0 && checkMatchJobIdsFound(curr_banner, NULL, true)) {
+				done = true;
+			}
+
+			if ((specifiedMatch > 0 && matchCount >= specifiedMatch) || (maxAds > 0 && adCount >= maxAds))
+				done = true;
+			if (abort_transfer)
+				done = true;
+		}
+	}
+}
+
 static void readHistoryFromFileEx(const char *JobHistoryFileName, const char* constraint, ExprTree *constraintExpr, bool read_backwards)
 {
 	// In case of rotated history files, check if we have already reached the number of 
@@ -1468,6 +1618,17 @@ static void readHistoryFromFileEx(const char *JobHistoryFileName, const char* co
 		return;
 	}
 
+	if (HistoryArchiveReader::IsArchive(JobHistoryFileName)) {
+		readHistoryFromArchive(JobHistoryFileName, constraint, constraintExpr, read_backwards);
+		return;
+	}
+
+	// when looking for particular jobs or owners, the index of the file (if any)
+	// takes us straight to their ads.
+	if (readHistoryFromIndex(JobHistoryFileName, constraint, constraintExpr, read_backwards)) {
+		return;
+	}
+
 	// the old function doesn't work for backwards, but it does work for forwards so go ahead and call it.
 	//
 	if ( ! read_backwards) {
@@ -0,0 +1,227 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+/*
+	This code tests the TimerManager in condor_daemon_core.V6, without
+	a daemonCore.
+ */
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "function_test_driver.h"
+#include "emit.h"
+#include "unit_test_utils.h"
+#include "condor_daemon_core.h"
+
+#include <vector>
+#include <algorithm>
+#include <random>
+
+static bool test_stress_new_cancel(void);
+static bool test_timeout_order(void);
+static bool test_timeout_cancel_in_handler(void);
+
+// Records the order in which timer handlers are called
+static std::vector<int> fired;
+
+class TimerTarget : public Service
+{
+public:
+	TimerTarget() : num(0), cancel_id(-1) {}
+	void handler() {
+		fired.push_back(num);
+		if (cancel_id >= 0) {
+			TimerManager::GetTimerManager().CancelTimer(cancel_id);
+		}
+	}
+	int num;
+	int cancel_id;   // another timer to cancel when this one fires
+};
+
+bool OTEST_TimerManager(void) {
+	emit_object("TimerManager");
+	emit_comment("This tests the daemon core timer manager");
+
+		// driver to run the tests and all required setup
+	FunctionDriver driver;
+	driver.register_function(test_stress_new_cancel);
+	driver.register_function(test_timeout_order);
+	driver.register_function(test_timeout_cancel_in_handler);
+
+		// run the tests
+	return driver.do_all_functions();
+}
+
+static bool test_stress_new_cancel() {
+	emit_test("Test registering and cancelling 1,000,000 timers in random order");
+
+	const int num_timers = 1000000;
+	emit_input_header();
+	emit_param("Timers", "%d", num_timers);
+	emit_output_expected_header();
+	emit_retval("%d", -1);
+
+	TimerManager &tm = TimerManager::GetTimerManager();
+	TimerTarget target;
+	std::mt19937 rng(4242);
+	std::uniform_int_distribution<unsigned> delta(100, 100000);
+
+	std::vector<std::pair<int, time_t> > timers;
+	timers.reserve(num_timers);
+	time_t start = time(NULL);
+	for (int ix = 0; ix < num_timers; ix++) {
+		unsigned deltawhen = delta(rng);
+		int id = tm.NewTimer(&target, deltawhen, (TimerHandlercpp)&TimerTarget::handler,
+			"stress timer", (ix % 3) ? 0 : deltawhen);
+		if (id < 0) {
+			emit_step_failure(__LINE__, "NewTimer failed");
+			FAIL;
+		}
+		timers.push_back(std::make_pair(id, (time_t)(start + deltawhen)));
+	}
+
+	// nothing is due yet, so nothing should fire
+	int num_fired = -1;
+	tm.Timeout(&num_fired);
+	if (num_fired != 0 || ! fired.empty()) {
+		emit_step_failure(__LINE__, "Timeout() fired timers that weren't due");
+		FAIL;
+	}
+
+	std::shuffle(timers.begin(), timers.end(), rng);
+	for (size_t ix = 0; ix < timers.size(); ix++) {
+		int id = timers[ix].first;
+		time_t when = tm.GetNextRuntime(id);
+		if (when < timers[ix].second || when > timers[ix].second + (time(NULL) - start)) {
+			emit_step_failure(__LINE__, "GetNextRuntime() returned the wrong time");
+			FAIL;
+		}
+		// move every tenth timer before cancelling it
+		if (ix % 10 == 0 && tm.ResetTimer(id, delta(rng)) != 0) {
+			emit_step_failure(__LINE__, "ResetTimer() failed");
+			FAIL;
+		}
+		if (tm.CancelTimer(id) != 0) {
+			emit_step_failure(__LINE__, "CancelTimer() failed");
+			FAIL;
+		}
+		if (tm.GetNextRuntime(id) != 0) {
+			emit_step_failure(__LINE__, "cancelled timer still exists");
+			FAIL;
+		}
+	}
+
+	// every timer is gone, so cancelling one again must fail
+	int retval = tm.CancelTimer(timers[0].first);
+	emit_output_actual_header();
+	emit_retval("%d", retval);
+	if (retval != -1) {
+		FAIL;
+	}
+	PASS;
+}
+
+static bool test_timeout_order() {
+	emit_test("Test that Timeout() calls only the timers that are due, in the "
+		"order they were registered");
+
+	TimerManager &tm = TimerManager::GetTimerManager();
+	const int num_timers = 100;
+	TimerTarget targets[num_timers];
+	std::vector<int> ids;
+	std::vector<int> expected;
+
+	// Half of the timers are due now, and those should run.
+	for (int ix = 0; ix < num_timers; ix++) {
+		targets[ix].num = ix;
+		unsigned deltawhen = (ix < num_timers/2) ? 1000 : 0;
+		ids.push_back(tm.NewTimer(&targets[ix], deltawhen,
+			(TimerHandlercpp)&TimerTarget::handler, "order timer"));
+		if (deltawhen == 0) {
+			expected.push_back(ix);
+		}
+	}
+
+	emit_input_header();
+	emit_param("Timers", "%d", num_timers);
+	emit_output_expected_header();
+	emit_retval("%d", (int)expected.size());
+
+	fired.clear();
+	int num_fired = 0;
+	tm.Timeout(&num_fired);
+
+	emit_output_actual_header();
+	emit_retval("%d", num_fired);
+	if (num_fired != (int)expected.size() || fired != expected) {
+		FAIL;
+	}
+
+	// the ones that fired were one-shot timers, so only the others remain
+	for (int ix = 0; ix < num_timers; ix++) {
+		int rc = tm.CancelTimer(ids[ix]);
+		if ((ix < num_timers/2) != (rc == 0)) {
+			FAIL;
+		}
+	}
+	PASS;
+}
+
+static bool test_timeout_cancel_in_handler() {
+	emit_test("Test that a timer cancelled by another timer's handler in the "
+		"same Timeout() is not called");
+
+	TimerManager &tm = TimerManager::GetTimerManager();
+	TimerTarget first, second, third;
+	first.num = 1;
+	second.num = 2;
+	third.num = 3;
+	int first_id = tm.NewTimer(&first, 0, (TimerHandlercpp)&TimerTarget::handler, "first");
+	int second_id = tm.NewTimer(&second, 0, (TimerHandlercpp)&TimerTarget::handler, "second");
+	int third_id = tm.NewTimer(&third, 0, (TimerHandlercpp)&TimerTarget::handler, "third", 1000);
+	first.cancel_id = second_id;
+
+	emit_input_header();
+	emit_param("Timers", "%d, %d, %d", first_id, second_id, third_id);
+	emit_output_expected_header();
+	emit_retval("%s", "1, 3");
+
+	fired.clear();
+	tm.Timeout();
+
+	emit_output_actual_header();
+	std::string actual;
+	for (size_t ix = 0; ix < fired.size(); ix++) {
+		formatstr_cat(actual, "%s%d", ix ? ", " : "", fired[ix]);
+	}
+	emit_retval("%s", actual.c_str());
+	if (actual != "1, 3") {
+		FAIL;
+	}
+
+	// the third timer is periodic, so it should have been rescheduled
+	if (tm.GetNextRuntime(third_id) < time(NULL) + 999) {
+		FAIL;
+	}
+	if (tm.CancelTimer(third_id) != 0 || tm.CancelTimer(first_id) != -1) {
+		FAIL;
+	}
+	PASS;
+}
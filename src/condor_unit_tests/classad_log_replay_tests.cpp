@@ -0,0 +1,286 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// Benchmark of the loading of a ClassAd log, as the schedd does with its
+// job queue at startup.  Writes a log of a synthetic job queue, then loads
+// it on one thread and on several, and checks they give the same queue.
+//
+//   classad_log_replay_tests [-jobs N] [-threads N] [-dir path] [-keep] [-v]
+
+#include "condor_common.h"
+#include "condor_classad.h"
+#include "classad_log.h"
+#include "classad/classadCache.h"
+
+#include <chrono>
+
+static bool verbose = false;
+
+// Write a log of the given number of jobs in clusters of 10, as the schedd
+// would after cleaning it, then a tail of the transactions of a busy schedd
+// that wasn't shut down cleanly: jobs starting, finishing, and being removed.
+static bool
+generate_log(const char *filename, int num_jobs)
+{
+	FILE *fp = safe_fopen_wrapper_follow(filename, "w");
+	if ( ! fp) {
+		fprintf(stderr, "Can't create %s: %s\n", filename, strerror(errno));
+		return false;
+	}
+
+	const int procs_per_cluster = 10;
+	const int num_clusters = (num_jobs + procs_per_cluster - 1) / procs_per_cluster;
+	const long long qdate = 1700000000;
+
+	// the records are written as ClassAdLog writes them
+	fprintf(fp, "%d 1 CreationTimestamp %lld\n", CondorLogOp_LogHistoricalSequenceNumber, qdate);
+	fprintf(fp, "%d 0.0 Job Machine\n", CondorLogOp_NewClassAd);
+	fprintf(fp, "%d 0.0 NextClusterNum %d\n", CondorLogOp_SetAttribute, num_clusters + 1);
+
+	int jobs = 0;
+	for (int cluster = 1; cluster <= num_clusters; ++cluster) {
+		fprintf(fp, "%d 0%d.-1 Job Machine\n", CondorLogOp_NewClassAd, cluster);
+		fprintf(fp, "%d 0%d.-1 ClusterId %d\n", CondorLogOp_SetAttribute, cluster, cluster);
+		fprintf(fp, "%d 0%d.-1 Owner \"user%d\"\n", CondorLogOp_SetAttribute, cluster, cluster % 97);
+		fprintf(fp, "%d 0%d.-1 QDate %lld\n", CondorLogOp_SetAttribute, cluster, qdate + cluster);
+		fprintf(fp, "%d 0%d.-1 Cmd \"/home/user%d/bin/analyze\"\n", CondorLogOp_SetAttribute, cluster, cluster % 97);
+		fprintf(fp, "%d 0%d.-1 Iwd \"/home/user%d/run%d\"\n", CondorLogOp_SetAttribute, cluster, cluster % 97, cluster);
+		fprintf(fp, "%d 0%d.-1 RequestCpus 1\n", CondorLogOp_SetAttribute, cluster);
+		fprintf(fp, "%d 0%d.-1 RequestMemory ifthenelse(MemoryUsage =!= undefined,MemoryUsage,%d)\n", CondorLogOp_SetAttribute, cluster, 1024 * (1 + cluster % 4));
+		fprintf(fp, "%d 0%d.-1 RequestDisk DiskUsage\n", CondorLogOp_SetAttribute, cluster);
+		fprintf(fp, "%d 0%d.-1 Requirements (TARGET.Arch == \"X86_64\") && (TARGET.OpSys == \"LINUX\") && (TARGET.Disk >= RequestDisk) && (TARGET.Memory >= RequestMemory)\n", CondorLogOp_SetAttribute, cluster);
+		fprintf(fp, "%d 0%d.-1 JobUniverse 5\n", CondorLogOp_SetAttribute, cluster);
+		fprintf(fp, "%d 0%d.-1 Environment \"RUN=%d MODE=fast\"\n", CondorLogOp_SetAttribute, cluster, cluster);
+		fprintf(fp, "%d 0%d.-1 PeriodicRemove (JobStatus == 5) && (time() - EnteredCurrentStatus > 86400)\n", CondorLogOp_SetAttribute, cluster);
+		fprintf(fp, "%d 0%d.-1 TotalSubmitProcs %d\n", CondorLogOp_SetAttribute, cluster, procs_per_cluster);
+		for (int proc = 0; proc < procs_per_cluster && jobs < num_jobs; ++proc, ++jobs) {
+			fprintf(fp, "%d %d.%d Job Machine\n", CondorLogOp_NewClassAd, cluster, proc);
+			fprintf(fp, "%d %d.%d ProcId %d\n", CondorLogOp_SetAttribute, cluster, proc, proc);
+			fprintf(fp, "%d %d.%d ClusterId %d\n", CondorLogOp_SetAttribute, cluster, proc, cluster);
+			fprintf(fp, "%d %d.%d JobStatus 1\n", CondorLogOp_SetAttribute, cluster, proc);
+			fprintf(fp, "%d %d.%d EnteredCurrentStatus %lld\n", CondorLogOp_SetAttribute, cluster, proc, qdate + cluster);
+			fprintf(fp, "%d %d.%d Arguments \"-input data%d.%d -seed %d\"\n", CondorLogOp_SetAttribute, cluster, proc, cluster, proc, jobs);
+			fprintf(fp, "%d %d.%d Out \"out.%d\"\n", CondorLogOp_SetAttribute, cluster, proc, proc);
+			fprintf(fp, "%d %d.%d Err \"err.%d\"\n", CondorLogOp_SetAttribute, cluster, proc, proc);
+		}
+	}
+
+	for (int ix = 0; ix < num_jobs; ix += 101) {
+		int cluster = 1 + ix / procs_per_cluster, proc = ix % procs_per_cluster;
+		fprintf(fp, "%d \n", CondorLogOp_BeginTransaction);
+		fprintf(fp, "%d %d.%d JobStatus 2\n", CondorLogOp_SetAttribute, cluster, proc);
+		fprintf(fp, "%d %d.%d RemoteHost \"slot1@node%d.example.com\"\n", CondorLogOp_SetAttribute, cluster, proc, ix % 1000);
+		fprintf(fp, "%d %d.%d Out\n", CondorLogOp_DeleteAttribute, cluster, proc);
+		fprintf(fp, "%d \n", CondorLogOp_EndTransaction);
+		if (ix % 3 == 0) {
+			fprintf(fp, "%d \n", CondorLogOp_BeginTransaction);
+			fprintf(fp, "%d %d.%d\n", CondorLogOp_DestroyClassAd, cluster, proc);
+			fprintf(fp, "%d #removed by user\n", CondorLogOp_EndTransaction);
+		}
+	}
+
+	if (fclose(fp) != 0) {
+		fprintf(stderr, "Can't write %s: %s\n", filename, strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+typedef HashTable<std::string, ClassAd*> AdTable;
+
+// A summary of the ads in a table that doesn't depend on their order
+struct TableDigest {
+	size_t ads;
+	size_t attrs;
+	uint64_t hash;
+	bool operator==(const TableDigest &that) const { return ads == that.ads && attrs == that.attrs && hash == that.hash; }
+};
+
+static TableDigest
+digest_table(AdTable &table)
+{
+	TableDigest digest = { 0, 0, 0 };
+	std::string key, text;
+	ClassAd *ad = NULL;
+	table.startIterations();
+	while (table.iterate(key, ad) == 1) {
+		text = key;
+		sPrintAd(text, *ad);
+		uint64_t hash = 14695981039346656037ull;
+		for (char ch : text) {
+			hash ^= (unsigned char)ch;
+			hash *= 1099511628211ull;
+		}
+		digest.hash += hash;
+		digest.ads += 1;
+		digest.attrs += ad->size();
+	}
+	return digest;
+}
+
+static void
+clear_table(AdTable &table)
+{
+	std::string key;
+	ClassAd *ad = NULL;
+	table.startIterations();
+	while (table.iterate(key, ad) == 1) {
+		delete ad;
+	}
+	table.clear();
+}
+
+// Load the log as ClassAdLog::InitLogFile() does, returning the seconds taken
+static double
+load_log(const char *filename, int threads, AdTable &table, bool &ok)
+{
+	ClassAdLogTable<std::string, ClassAd*> la(table);
+	unsigned long sequence = 0;
+	time_t birthdate = 0;
+	bool is_clean = true, requires_cleaning = false;
+	std::string errmsg;
+
+	auto start = std::chrono::steady_clock::now();
+	FILE *fp = LoadClassAdLog(filename, la, DefaultMakeClassAdLogTableEntry,
+		sequence, birthdate, is_clean, requires_cleaning, errmsg, threads);
+	auto stop = std::chrono::steady_clock::now();
+
+	ok = fp != NULL && sequence == 1 && ! is_clean && ! requires_cleaning;
+	if ( ! ok) {
+		fprintf(stderr, "Loading %s on %d threads failed: %s\n", filename, threads, errmsg.c_str());
+	}
+	if (fp) {
+		fclose(fp);
+	}
+	return std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc, const char * argv[])
+{
+	int num_jobs = 2000000;
+	int threads = 4;
+	const char *dir = ".";
+	bool keep = false;
+	for (int ixarg = 1; ixarg < argc; ++ixarg) {
+		if (YourString(argv[ixarg]) == "-jobs" && ixarg + 1 < argc) {
+			num_jobs = atoi(argv[++ixarg]);
+		}
+		else
+		if (YourString(argv[ixarg]) == "-threads" && ixarg + 1 < argc) {
+			threads = atoi(argv[++ixarg]);
+		}
+		else
+		if (YourString(argv[ixarg]) == "-dir" && ixarg + 1 < argc) {
+			dir = argv[++ixarg];
+		}
+		else
+		if (YourString(argv[ixarg]) == "-keep") {
+			keep = true;
+		}
+		else
+		if (YourString(argv[ixarg]) == "-v") {
+			verbose = true;
+		}
+		else
+		{
+			fprintf(stderr, "unrecognised argument '%s'\n", argv[ixarg]);
+			return 1;
+		}
+	}
+	if (num_jobs <= 0 || threads <= 0) {
+		fprintf(stderr, "-jobs and -threads must be positive\n");
+		return 1;
+	}
+
+	// as in the schedd
+	classad::ClassAdSetExpressionCaching(true);
+
+	std::string filename;
+	formatstr(filename, "%s/classad_log_replay_test.log", dir);
+	if ( ! generate_log(filename.c_str(), num_jobs)) {
+		return 1;
+	}
+	if (verbose) {
+		struct stat si;
+		if (stat(filename.c_str(), &si) == 0) {
+			fprintf(stdout, "wrote %s, %d jobs, %lld bytes\n", filename.c_str(), num_jobs, (long long)si.st_size);
+		}
+	}
+
+	int failed = 0;
+	bool ok = false;
+	AdTable table(hashFunction);
+
+	double serial = load_log(filename.c_str(), 0, table, ok);
+	if ( ! ok) { ++failed; }
+	TableDigest expected = digest_table(table);
+	clear_table(table);
+	fprintf(stdout, "loaded %zu ads with %zu attributes on 1 thread in %.2f seconds\n",
+		expected.ads, expected.attrs, serial);
+
+	double parallel = load_log(filename.c_str(), threads, table, ok);
+	if ( ! ok) { ++failed; }
+	TableDigest actual = digest_table(table);
+	clear_table(table);
+	fprintf(stdout, "loaded %zu ads with %zu attributes on %d threads in %.2f seconds (%.2fx)\n",
+		actual.ads, actual.attrs, threads, parallel, parallel > 0 ? serial / parallel : 0.0);
+
+	if ( ! (actual == expected)) {
+		fprintf(stderr, "Failed: the log loaded on %d threads differs from the log loaded on 1\n", threads);
+		++failed;
+	}
+
+	// a log that ends in the middle of a record must be cleaned either way
+	FILE *fp = safe_fopen_wrapper_follow(filename.c_str(), "a");
+	if (fp) {
+		fprintf(fp, "%d 1.0 JobStat", CondorLogOp_SetAttribute);
+		fclose(fp);
+	}
+	for (int nthreads = 0; nthreads <= threads; nthreads += threads) {
+		ClassAdLogTable<std::string, ClassAd*> la(table);
+		unsigned long sequence = 0;
+		time_t birthdate = 0;
+		bool is_clean = true, requires_cleaning = false;
+		std::string errmsg;
+		fp = LoadClassAdLog(filename.c_str(), la, DefaultMakeClassAdLogTableEntry,
+			sequence, birthdate, is_clean, requires_cleaning, errmsg, nthreads);
+		if ( ! fp || ! requires_cleaning) {
+			fprintf(stderr, "Failed: a log with an unterminated record loaded on %d threads was not marked for cleaning\n", nthreads);
+			++failed;
+		} else if ( ! (digest_table(table) == expected)) {
+			fprintf(stderr, "Failed: a log with an unterminated record loaded on %d threads differs\n", nthreads);
+			++failed;
+		}
+		if (fp) {
+			fclose(fp);
+		}
+		clear_table(table);
+	}
+
+	if ( ! keep) {
+		unlink(filename.c_str());
+	}
+
+	if ( ! failed) {
+		fprintf(stdout, "all tests pass\n");
+	} else {
+		fprintf(stdout, "%d tests failed\n", failed);
+	}
+	return failed;
+}
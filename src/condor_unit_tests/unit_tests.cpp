@@ -65,6 +65,7 @@ bool OTEST_StatInfo(void);
 bool OTEST_condor_sockaddr();
 bool OTEST_ranger();
 bool OTEST_Timeslice();
+bool OTEST_TimerManager();
 
 	// function map that maps testing function names to testing functions
 const static struct {
@@ -102,6 +103,7 @@ const static struct {
 	map(OTEST_condor_sockaddr),
 	map(OTEST_ranger),
 	map(OTEST_Timeslice),
+	map(OTEST_TimerManager),
 };
 int function_map_num_elems = sizeof(function_map) / sizeof(function_map[0]);
 
@@ -29,6 +29,9 @@
 #include "condor_email.h"
 
 #include "classadHistory.h"
+#include "historyIndex.h"
+#include "historyArchive.h"
+#include "condor_daemon_core.h"
 
 static FILE *HistoryFile_fp = NULL;
 static int HistoryFile_RefCount = 0;
@@ -37,13 +40,18 @@ char* JobHistoryFileName = NULL;
 char* JobHistoryParamName = NULL;
 bool        DoHistoryRotation = true;
 char*       PerJobHistoryDir = NULL;
+static bool DoHistoryIndex = true;
+static bool DoHistoryArchive = false;
 static HistoryFileRotationInfo hri;
+static HistoryIndexWriter HistoryIndex;
 
 static void RemoveExtraHistoryFiles(int max_backups, const char* filename);
 static int MaybeDeleteOneHistoryBackup(int max_backups, const char* original_filename);
 static bool IsHistoryFilename(const char* original_filename, const char *filename, time_t *backup_time);
 static void RotateHistory(bool isHistory, const char* filename, const char* new_path);
+static void ArchiveRotatedHistory(const char* filename);
 static int findHistoryOffset(FILE *LogFile);
+static bool getHistorySize(FILE *LogFile, int64_t &size);
 static FILE* OpenHistoryFile();
 static void CloseJobHistoryFile();
 static void RelinquishHistoryFile(FILE *fp);
@@ -91,6 +99,16 @@ InitJobHistoryFile(const char *history_param, const char *per_job_history_param)
                 "may grow very large.\n");
     }
 
+    // An index is started the next time the history file is new, and
+    // if we stop keeping it, the one we had goes out of date.
+    DoHistoryIndex = param_boolean("ENABLE_HISTORY_INDEX", true);
+    if ( ! DoHistoryIndex && JobHistoryFileName) {
+        HistoryIndex.abandon(JobHistoryFileName);
+    }
+
+    // Rotated history files are turned into archives in the background
+    DoHistoryArchive = param_boolean("ENABLE_HISTORY_ARCHIVE", false);
+
     if (PerJobHistoryDir != NULL) free(PerJobHistoryDir);
     if ((PerJobHistoryDir = param(per_job_history_param)) != NULL) {
         StatInfo si(PerJobHistoryDir);
@@ -150,6 +168,10 @@ AppendHistory(ClassAd* ad)
 	  failed = true;
   } else {
 	  int offset = findHistoryOffset(LogFile);
+	  int64_t start_size = -1;
+	  if (DoHistoryIndex && ! getHistorySize(LogFile, start_size)) {
+		  start_size = -1;
+	  }
 	  if (fputs(ad_string.c_str(), LogFile) == EOF) {
 		  dprintf(D_ALWAYS, 
 				  "ERROR: failed to write job class ad to history file %s\n",
@@ -175,6 +197,23 @@ AppendHistory(ClassAd* ad)
                       "*** Offset = %d ClusterId = %d ProcId = %d Owner = \"%s\" CompletionDate = %d\n",
 				  offset, cluster, proc, owner.c_str(), completion);
 		  fflush( LogFile );
+
+		  // Now that the ad is in the file, add it to the index
+		  int64_t end_size = -1;
+		  if (DoHistoryIndex) {
+			  if (start_size < 0 || ! getHistorySize(LogFile, end_size)) {
+				  HistoryIndex.abandon(JobHistoryFileName);
+			  } else {
+				  HistoryIndexEntry entry;
+				  entry.offset = start_size;
+				  entry.length = (int32_t)(end_size - start_size);
+				  entry.cluster = cluster;
+				  entry.proc = proc;
+				  entry.owner_hash = HistoryIndexOwnerHash(owner == "?" ? NULL : owner.c_str());
+				  entry.completion = completion;
+				  HistoryIndex.append(JobHistoryFileName, entry);
+			  }
+		  }
       }
   }
 
@@ -346,6 +385,19 @@ CloseJobHistoryFile() {
 		fclose( HistoryFile_fp );
 		HistoryFile_fp = NULL;
 	}
+	HistoryIndex.close();
+}
+
+// The size of the open history file, which is where the next ad will go
+static bool
+getHistorySize(FILE *LogFile, int64_t &size)
+{
+	struct stat si;
+	if (fstat(fileno(LogFile), &si) != 0) {
+		return false;
+	}
+	size = si.st_size;
+	return true;
 }
 
 // --------------------------------------------------------------------------
@@ -486,6 +538,10 @@ MaybeDeleteOneHistoryBackup(int max_backups, const char* original_filename)
 			if (!dir.Remove_Current_File()) {
 				dprintf(D_ALWAYS, "Failed to delete %s\n", oldest_history_filename);
 				num_backups = 0; // prevent looping forever
+			} else {
+				std::string oldest_path;
+				dircat(history_dir.c_str(), oldest_history_filename, oldest_path);
+				unlink(HistoryIndexFileName(oldest_path.c_str()).c_str());
 			}
 		} else {
 			dprintf(D_ALWAYS, "Failed to find/delete %s\n", oldest_history_filename);
@@ -571,11 +627,63 @@ RotateHistory(bool isHistory, const char* filename, const char* new_path)
         dprintf(D_ALWAYS, "Failed to rotate history file to %s\n",
                 rotated_history_name.c_str());
         dprintf(D_ALWAYS, "Because rotation failed, the history file may get very large.\n");
+    } else if (isHistory) {
+        // The index goes with the file it indexes
+        std::string index_name = HistoryIndexFileName(filename);
+        StatInfo index_info(index_name.c_str());
+        if (index_info.Error() == SIGood &&
+            rotate_file(index_name.c_str(), HistoryIndexFileName(rotated_history_name.c_str()).c_str())) {
+            unlink(index_name.c_str());
+        }
+        if (DoHistoryArchive) {
+            ArchiveRotatedHistory(rotated_history_name.c_str());
+        }
     }
 
     return;
 }
 
+// --------------------------------------------------------------------------
+// Turn a rotated history file into an archive.  It can take a while for a
+// large file, so in a daemon it is done in a thread.
+// --------------------------------------------------------------------------
+static int
+ArchiveHistoryWorker(int /*n1*/, int /*n2*/, void *data)
+{
+    const char *filename = (const char *)data;
+    std::string errmsg;
+    if ( ! ArchiveHistoryFile(filename, errmsg)) {
+        dprintf(D_ALWAYS, "Failed to archive history file %s: %s\n",
+                filename, errmsg.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+static int
+ArchiveHistoryReaper(int /*n1*/, int /*n2*/, void *data, int exit_status)
+{
+    char *filename = (char *)data;
+    if (exit_status == 0) {
+        dprintf(D_FULLDEBUG, "Archived history file %s\n", filename);
+    } else {
+        dprintf(D_ALWAYS, "Archiving history file %s failed, it is left as it was\n", filename);
+    }
+    free(filename);
+    return 0;
+}
+
+static void
+ArchiveRotatedHistory(const char* filename)
+{
+    if (daemonCore) {
+        Create_Thread_With_Data(ArchiveHistoryWorker, ArchiveHistoryReaper, 0, 0, strdup(filename));
+    } else {
+        char *data = strdup(filename);
+        ArchiveHistoryReaper(0, 0, data, ArchiveHistoryWorker(0, 0, data));
+    }
+}
+
 // --------------------------------------------------------------------------
 // Figure out how far from the end the beginning of the last line in the
 // history file is. We assume that the file is open. We reset the file pointer
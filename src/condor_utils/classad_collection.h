@@ -78,6 +78,10 @@ public:
 	  return ClassAdLog<K,AD>::InitLogFile(filename, max_historical_logs);
   }
 
+  /** Set the number of threads that InitLogFile() reads the log with
+  */
+  void SetRecoveryThreads(int threads) { ClassAdLog<K,AD>::SetRecoveryThreads(threads); }
+
   /** Destructor - frees the memory used by the collections
     @return nothing
   */
@@ -108,6 +112,16 @@ public:
   */
   void CommitNondurableTransaction(const char * comment=NULL) { ClassAdLog<K,AD>::CommitNondurableTransaction(comment); }
 
+  /** Commit a transaction, sharing the sync to disk with those after it
+	  (see ClassAdLog::CommitGroupedTransaction)
+    @return nothing
+  */
+  void CommitGroupedTransaction(const char * comment=NULL) { ClassAdLog<K,AD>::CommitGroupedTransaction(comment); }
+  void SetGroupCommitMaxBytes(long long max_bytes) { ClassAdLog<K,AD>::SetGroupCommitMaxBytes(max_bytes); }
+  bool LogSynced() const { return ClassAdLog<K,AD>::LogSynced(); }
+  void WhenLogSynced(std::function<void()> fn) { ClassAdLog<K,AD>::WhenLogSynced(fn); }
+  void SyncLog() { ClassAdLog<K,AD>::SyncLog(); }
+
   /** Abort a transaction
     @return true if a transaction aborted, false if no transaction active
   */
@@ -169,6 +183,14 @@ public:
   */
   bool TruncLog() { return ClassAdLog<K,AD>::TruncLog(); }
 
+  /** Truncate the log file in a forked child, while the parent goes on
+	  (see ClassAdLog::BeginBackgroundTruncLog)
+  */
+  bool BeginBackgroundTruncLog() { return ClassAdLog<K,AD>::BeginBackgroundTruncLog(); }
+  bool WriteBackgroundTruncLog() { return ClassAdLog<K,AD>::WriteBackgroundTruncLog(); }
+  bool FinishBackgroundTruncLog(bool written) { return ClassAdLog<K,AD>::FinishBackgroundTruncLog(written); }
+  bool BackgroundTruncLogActive() const { return ClassAdLog<K,AD>::BackgroundTruncLogActive(); }
+
   /** Close the log file, discarding any changes that have not yet been written.
       On return from this function, the transaction log will be closed and
       changes to the ad collection will no longer be allowed
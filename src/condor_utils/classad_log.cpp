@@ -30,11 +30,19 @@
 #include "classad_merge.h"
 #include "condor_fsync.h"
 #include "condor_attributes.h"
+#include "classad/classadCache.h" // for CachedExprEnvelope
 
 #if defined(UNIX)
 #include "ClassAdLogPlugin.h"
 #endif
 
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 /***** Prevent calling free multiple times in this code *****/
 /* This fixes bugs where we would segfault when reading in
  * a corrupted log file, because memory would be deallocated
@@ -66,6 +74,265 @@ const ConstructClassAdLogTableEntry<ClassAd*> DefaultMakeClassAdLogTableEntry;
 
 // non-templatized worker function that implements the log loading functionality of ClassAdLog
 //
+// Plays the records read from a log into the table, as LoadClassAdLog()
+// reads them, whether on this thread or others.
+class ClassAdLogLoader
+{
+public:
+	ClassAdLogLoader(const char *filename, LoggableClassAdTable &la,
+		unsigned long &historical_sequence_number, time_t &original_log_birthdate,
+		bool &is_clean, std::string &errmsg)
+		: count(0)
+		, active_transaction(NULL)
+		, m_filename(filename)
+		, m_la(la)
+		, m_historical_sequence_number(historical_sequence_number)
+		, m_original_log_birthdate(original_log_birthdate)
+		, m_is_clean(is_clean)
+		, m_errmsg(errmsg)
+	{}
+	~ClassAdLogLoader() { delete active_transaction; }
+
+		// Takes the record, which was at the given offset in the log.
+		// Returns false if the log is bad.
+	bool play(LogRecord *log_rec, long long pos);
+
+	unsigned long count;
+	Transaction * active_transaction;
+
+private:
+	const char *m_filename;
+	LoggableClassAdTable & m_la;
+	unsigned long & m_historical_sequence_number;
+	time_t & m_original_log_birthdate;
+	bool & m_is_clean;
+	std::string & m_errmsg;
+};
+
+bool
+ClassAdLogLoader::play(LogRecord *log_rec, long long pos)
+{
+	count++;
+	switch (log_rec->get_op_type()) {
+	case CondorLogOp_Error:
+		// this is defensive, ought to be caught in InstantiateLogEntry()
+		formatstr(m_errmsg, "ERROR: in log %s transaction record %lu was bad (byte offset %lld)\n", m_filename, count, pos);
+		delete log_rec;
+		return false;
+	case CondorLogOp_BeginTransaction:
+		// this file contains transactions, so it must not
+		// have been cleanly shut down
+		m_is_clean = false;
+		if (active_transaction) {
+			formatstr_cat(m_errmsg, "Warning: Encountered nested transactions, log may be bogus...\n");
+		} else {
+			active_transaction = new Transaction();
+		}
+		delete log_rec;
+		break;
+	case CondorLogOp_EndTransaction:
+		if (!active_transaction) {
+			formatstr_cat(m_errmsg, "Warning: Encountered unmatched end transaction, log may be bogus...\n");
+		} else {
+			active_transaction->Commit(NULL, NULL, &m_la); // commit in memory only
+			delete active_transaction;
+			active_transaction = NULL;
+		}
+		delete log_rec;
+		break;
+	case CondorLogOp_LogHistoricalSequenceNumber:
+		if(count != 1) {
+			formatstr_cat(m_errmsg, "Warning: Encountered historical sequence number after first log entry (entry number = %ld)\n",count);
+		}
+		m_historical_sequence_number = ((LogHistoricalSequenceNumber *)log_rec)->get_historical_sequence_number();
+		m_original_log_birthdate = ((LogHistoricalSequenceNumber *)log_rec)->get_timestamp();
+		delete log_rec;
+		break;
+	default:
+		if (active_transaction) {
+			active_transaction->AppendLog(log_rec);
+		} else {
+			log_rec->Play((void *)&m_la);
+			delete log_rec;
+		}
+	}
+	return true;
+}
+
+#ifndef WIN32
+
+// The log is read in chunks of about this size, split at the ends of records
+#define CLASSAD_LOG_CHUNK_SIZE (4 * 1024 * 1024)
+
+struct ClassAdLogChunk {
+	size_t offset;		// of the chunk in the log
+	size_t length;
+	size_t parsed;		// bytes of records read from the chunk
+	bool done;
+	std::vector<std::pair<LogRecord *, long long>> records;	// and their offsets
+};
+
+static LogRecord *NewLogEntry(int type, const ConstructLogEntry & ctor);
+
+// Read the records in one chunk of the log, stopping at the first one that
+// is bad, which is left for LoadClassAdLog() to deal with as it does when
+// reading the log itself.  This runs on a worker thread, so the classad
+// cache, the config and dprintf must not be used; LogSetAttribute has a
+// ReadBodyOnThread() that doesn't.
+static void
+ReadClassAdLogChunk(const char *data, ClassAdLogChunk &chunk, const ConstructLogEntry &maker, bool strict_parsing)
+{
+	chunk.parsed = 0;
+	FILE *fp = fmemopen(const_cast<char *>(data + chunk.offset), chunk.length, "r");
+	if ( ! fp) {
+		return;
+	}
+	long long pos = 0;
+	while (pos < (long long)chunk.length) {
+		char *opword = NULL;
+		if (LogRecord::readword(fp, opword) < 0) {
+			break;
+		}
+		int opcode = CondorLogOp_Error;
+		YourStringDeserializer lex(opword);
+		if (!lex.deserialize_int(&opcode) || !valid_record_optype(opcode)) {
+			opcode = CondorLogOp_Error;
+		}
+		free(opword);
+
+		LogRecord *log_rec = NewLogEntry(opcode, maker);
+		if ( ! log_rec || log_rec->get_op_type() == CondorLogOp_Error) {
+			delete log_rec;
+			break;
+		}
+		int rval;
+		if (log_rec->get_op_type() == CondorLogOp_SetAttribute) {
+			rval = static_cast<LogSetAttribute *>(log_rec)->ReadBodyOnThread(fp, strict_parsing);
+		} else {
+			rval = log_rec->ReadBody(fp);
+		}
+		if (rval < 0) {
+			delete log_rec;
+			break;
+		}
+		chunk.records.emplace_back(log_rec, (long long)chunk.offset + pos);
+		pos = ftell(fp);
+	}
+	chunk.parsed = pos;
+	fclose(fp);
+}
+
+// Read the log on several threads, while this one plays the records in
+// order.  Returns the offset in the log of the first record that wasn't
+// played, from which the caller goes on reading the log itself.
+static long long
+LoadClassAdLogOnThreads(FILE *log_fp, int threads, const ConstructLogEntry &maker, ClassAdLogLoader &loader)
+{
+	struct stat si;
+	int fd = fileno(log_fp);
+	if (fstat(fd, &si) != 0 || si.st_size <= 0) {
+		return 0;
+	}
+	size_t size = (size_t)si.st_size;
+	void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		dprintf(D_ALWAYS, "Failed to map the ClassAd log, errno = %d, reading it on one thread\n", errno);
+		return 0;
+	}
+	const char *data = (const char *)map;
+	(void) madvise(map, size, MADV_SEQUENTIAL);
+
+		// a last record without its newline is left for the caller
+	std::vector<ClassAdLogChunk> chunks;
+	size_t offset = 0;
+	while (offset < size) {
+		size_t end = MIN(offset + CLASSAD_LOG_CHUNK_SIZE, size);
+		const char *nl = (const char *)memchr(data + end - 1, '\n', size - end + 1);
+		if ( ! nl) {
+			break;
+		}
+		end = (nl - data) + 1;
+		chunks.emplace_back();
+		chunks.back().offset = offset;
+		chunks.back().length = end - offset;
+		chunks.back().parsed = 0;
+		chunks.back().done = false;
+		offset = end;
+	}
+
+		// the threads don't get too far ahead of the records being played,
+		// so that only a few chunks of records are in memory at once.
+	std::mutex mutex;
+	std::condition_variable cond;
+	const size_t max_ahead = 4 * threads;
+	size_t next_chunk = 0;
+	size_t played = 0;
+	bool stop = false;
+	const bool strict_parsing = param_boolean("CLASSAD_LOG_STRICT_PARSING", true);
+	auto reader = [&]() {
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;) {
+			cond.wait(lock, [&]() { return stop || next_chunk >= chunks.size() || next_chunk < played + max_ahead; });
+			if (stop || next_chunk >= chunks.size()) {
+				return;
+			}
+			ClassAdLogChunk &chunk = chunks[next_chunk++];
+			lock.unlock();
+			ReadClassAdLogChunk(data, chunk, maker, strict_parsing);
+			lock.lock();
+			chunk.done = true;
+			cond.notify_all();
+		}
+	};
+	PrepareClassAdParsingForThreads();
+
+	std::vector<std::thread> readers;
+	for (int ix = 0; ix < threads; ++ix) {
+		readers.emplace_back(reader);
+	}
+
+	long long resume = 0;
+	for (size_t ix = 0; ix < chunks.size(); ++ix) {
+		ClassAdLogChunk &chunk = chunks[ix];
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cond.wait(lock, [&]() { return chunk.done; });
+		}
+		for (auto & rec : chunk.records) {
+			loader.play(rec.first, rec.second);
+		}
+		chunk.records.clear();
+		chunk.records.shrink_to_fit();
+		resume = chunk.offset + chunk.parsed;
+
+		bool bad = chunk.parsed < chunk.length;
+		std::unique_lock<std::mutex> lock(mutex);
+		played = ix + 1;
+		stop = bad;
+		cond.notify_all();
+		if (bad) {
+			break;
+		}
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stop = true;
+		cond.notify_all();
+	}
+	for (auto & thr : readers) {
+		thr.join();
+	}
+	for (auto & chunk : chunks) {
+		for (auto & rec : chunk.records) {
+			delete rec.first;
+		}
+	}
+	munmap(map, size);
+	return resume;
+}
+#endif
+
 FILE* LoadClassAdLog(
 	const char *filename,
 	LoggableClassAdTable & la,
@@ -74,10 +341,10 @@ FILE* LoadClassAdLog(
 	time_t & m_original_log_birthdate,
 	bool & is_clean,
 	bool & requires_successful_cleaning,
-	std::string & errmsg)
+	std::string & errmsg,
+	int recovery_threads)
 {
 	FILE* log_fp = NULL;
-	Transaction * active_transaction = NULL;
 
 	historical_sequence_number = 1;
 	m_original_log_birthdate = time(NULL);
@@ -98,60 +365,28 @@ FILE* LoadClassAdLog(
 	is_clean = true; // was cleanly closed (until we find out otherwise)
 	requires_successful_cleaning = false;
 
+	ClassAdLogLoader loader(filename, la, historical_sequence_number, m_original_log_birthdate, is_clean, errmsg);
+
 	// Read all of the log records
 	LogRecord		*log_rec;
-	unsigned long count = 0;
 	long long next_log_entry_pos = 0;
     long long curr_log_entry_pos = 0;
-	while ((log_rec = ReadLogEntry(log_fp, 1+count, InstantiateLogEntry, maker)) != 0) {
+#ifndef WIN32
+	if (recovery_threads > 0) {
+		next_log_entry_pos = LoadClassAdLogOnThreads(log_fp, recovery_threads, maker, loader);
+		if (fseek(log_fp, next_log_entry_pos, SEEK_SET) != 0) {
+			formatstr(errmsg, "failed to seek in log %s, errno = %d\n", filename, errno);
+			fclose(log_fp);
+			return NULL;
+		}
+	}
+#endif
+	while ((log_rec = ReadLogEntry(log_fp, 1+loader.count, InstantiateLogEntry, maker)) != 0) {
         curr_log_entry_pos = next_log_entry_pos;
 		next_log_entry_pos = ftell(log_fp);
-		count++;
-		switch (log_rec->get_op_type()) {
-		case CondorLogOp_Error:
-			// this is defensive, ought to be caught in InstantiateLogEntry()
-			formatstr(errmsg, "ERROR: in log %s transaction record %lu was bad (byte offset %lld)\n", filename, count, curr_log_entry_pos);
+		if ( ! loader.play(log_rec, curr_log_entry_pos)) {
 			fclose(log_fp); log_fp = NULL;
-
-			delete active_transaction;
 			return NULL;
-			break;
-		case CondorLogOp_BeginTransaction:
-			// this file contains transactions, so it must not
-			// have been cleanly shut down
-			is_clean = false;
-			if (active_transaction) {
-				formatstr_cat(errmsg, "Warning: Encountered nested transactions, log may be bogus...\n");
-			} else {
-				active_transaction = new Transaction();
-			}
-			delete log_rec;
-			break;
-		case CondorLogOp_EndTransaction:
-			if (!active_transaction) {
-				formatstr_cat(errmsg, "Warning: Encountered unmatched end transaction, log may be bogus...\n");
-			} else {
-				active_transaction->Commit(NULL, NULL, &la); // commit in memory only
-				delete active_transaction;
-				active_transaction = NULL;
-			}
-			delete log_rec;
-			break;
-		case CondorLogOp_LogHistoricalSequenceNumber:
-			if(count != 1) {
-				formatstr_cat(errmsg, "Warning: Encountered historical sequence number after first log entry (entry number = %ld)\n",count);
-			}
-			historical_sequence_number = ((LogHistoricalSequenceNumber *)log_rec)->get_historical_sequence_number();
-			m_original_log_birthdate = ((LogHistoricalSequenceNumber *)log_rec)->get_timestamp();
-			delete log_rec;
-			break;
-		default:
-			if (active_transaction) {
-				active_transaction->AppendLog(log_rec);
-			} else {
-				log_rec->Play((void *)&la);
-				delete log_rec;
-			}
 		}
 	}
 	long long final_log_entry_pos = ftell(log_fp);
@@ -166,9 +401,9 @@ FILE* LoadClassAdLog(
 		formatstr_cat(errmsg, "Detected unterminated log entry\n");
 		requires_successful_cleaning = true;
 	}
-	if (active_transaction) {	// abort incomplete transaction
-		delete active_transaction;
-		active_transaction = NULL;
+	if (loader.active_transaction) {	// abort incomplete transaction
+		delete loader.active_transaction;
+		loader.active_transaction = NULL;
 
 		if( !requires_successful_cleaning ) {
 			// For similar reasons as with broken log entries above,
@@ -177,7 +412,7 @@ FILE* LoadClassAdLog(
 			requires_successful_cleaning = true;
 		}
 	}
-	if(!count) {
+	if(!loader.count) {
 		log_rec = new LogHistoricalSequenceNumber( historical_sequence_number, m_original_log_birthdate );
 		if (log_rec->Write(log_fp) < 0) {
 			formatstr(errmsg, "write to %s failed, errno = %d\n", filename, errno);
@@ -251,6 +486,46 @@ bool SaveHistoricalClassAdLogs(
 }
 
 
+// POSIX does not provide any durability guarantees for rename().  Instead, we must
+// open the parent directory and invoke fsync there.
+static void SyncRenamedClassAdLog(const char * filename, std::string & errmsg)
+{
+#ifndef WIN32
+	std::string parent_dir = condor_dirname(filename);
+	int parent_fd = safe_open_wrapper_follow(parent_dir.c_str(), O_RDONLY);
+	if (parent_fd >= 0)
+	{
+		if (condor_fsync(parent_fd) == -1)
+		{
+			formatstr(errmsg, "Failed to fsync directory %s after rename. (errno=%d, msg=%s)", parent_dir.c_str(), errno, strerror(errno));
+		}
+		close(parent_fd);
+	}
+	else
+	{
+		formatstr(errmsg, "Failed to open parent directory %s for fsync after rename. (errno=%d, msg=%s)", parent_dir.c_str(), errno, strerror(errno));
+	}
+#else
+	(void)filename; (void)errmsg;
+#endif
+}
+
+static void ReopenClassAdLog(const char * filename, FILE* &log_fp, std::string & errmsg)
+{
+	int log_fd = safe_open_wrapper_follow(filename, O_RDWR | O_APPEND | O_LARGEFILE | _O_NOINHERIT, 0600);
+	if (log_fd < 0) {
+		formatstr(errmsg, "failed to open log in append mode: "
+			"safe_open_wrapper(%s) returns %d", filename, log_fd);
+	} else {
+		log_fp = fdopen(log_fd, "a+");
+		if (log_fp == NULL) {
+			close(log_fd);
+			formatstr(errmsg, "failed to fdopen log in append mode: "
+				"fdopen(%s) returns %d", filename, log_fd);
+		}
+	}
+}
+
 bool TruncateClassAdLog(
 	const char * filename,	        // in
 	LoggableClassAdTable & la,      // in
@@ -327,38 +602,109 @@ bool TruncateClassAdLog(
 	// we successfully wrote and rotated, so we can update our sequence number
 	historical_sequence_number = future_sequence_number;
 
-#ifndef WIN32
-	// POSIX does not provide any durability guarantees for rename().  Instead, we must
-	// open the parent directory and invoke fsync there.
-	std::string parent_dir = condor_dirname(filename);
-	int parent_fd = safe_open_wrapper_follow(parent_dir.c_str(), O_RDONLY);
-	if (parent_fd >= 0)
-	{
-		if (condor_fsync(parent_fd) == -1)
-		{
-			formatstr(errmsg, "Failed to fsync directory %s after rename. (errno=%d, msg=%s)", parent_dir.c_str(), errno, strerror(errno));
-		}
-		close(parent_fd);
+	SyncRenamedClassAdLog(filename, errmsg);
+	ReopenClassAdLog(filename, log_fp, errmsg);
+
+	return true;
+}
+
+bool WriteClassAdLogSnapshot(
+	const char * tmp_filename,      // in
+	LoggableClassAdTable & la,      // in
+	const ConstructLogEntry& maker, // in
+	unsigned long sequence_number,  // in
+	time_t original_log_birthdate,  // in
+	std::string & errmsg)           // out
+{
+	int fd = safe_create_replace_if_exists(tmp_filename, O_RDWR | O_CREAT | O_LARGEFILE | _O_NOINHERIT, 0600);
+	if (fd < 0) {
+		formatstr(errmsg, "failed to rotate log: safe_create_replace_if_exists(%s) failed with errno %d (%s)\n",
+			tmp_filename, errno, strerror(errno));
+		return false;
 	}
-	else
-	{
-		formatstr(errmsg, "Failed to open parent directory %s for fsync after rename. (errno=%d, msg=%s)", parent_dir.c_str(), errno, strerror(errno));
+
+	FILE *fp = fdopen(fd, "r+");
+	if (fp == NULL) {
+		formatstr(errmsg, "failed to rotate log: fdopen(%s) returns NULL\n", tmp_filename);
+		close(fd);
+		unlink(tmp_filename);
+		return false;
 	}
-#endif
 
-	int log_fd = safe_open_wrapper_follow(filename, O_RDWR | O_APPEND | O_LARGEFILE | _O_NOINHERIT, 0600);
-	if (log_fd < 0) {
-		formatstr(errmsg, "failed to open log in append mode: "
-			"safe_open_wrapper(%s) returns %d", filename, log_fd);
-	} else {
-		log_fp = fdopen(log_fd, "a+");
-		if (log_fp == NULL) {
-			close(log_fd);
-			formatstr(errmsg, "failed to fdopen log in append mode: "
-				"fdopen(%s) returns %d", filename, log_fd);
+	bool success = WriteClassAdLogState(fp, tmp_filename,
+		sequence_number, original_log_birthdate,
+		la, maker, errmsg);
+	if (fclose(fp) != 0) {
+		formatstr(errmsg, "failed to rotate log: fclose(%s) failed with errno %d (%s)\n",
+			tmp_filename, errno, strerror(errno));
+		success = false;
+	}
+	if ( ! success) {
+		unlink(tmp_filename);
+	}
+	return success;
+}
+
+bool FinishTruncateClassAdLog(
+	const char * filename,          // in
+	const char * tmp_filename,      // in
+	long long offset,               // in
+	FILE* &log_fp,                  // in,out
+	unsigned long & historical_sequence_number, // in,out
+	std::string & errmsg)           // out
+{
+	if (FlushClassAdLog(log_fp, false) != 0) {
+		formatstr(errmsg, "failed to rotate log: fflush of %s failed, errno = %d\n", filename, errno);
+		unlink(tmp_filename);
+		return false;
+	}
+
+		// copy what was committed since the snapshot to the end of the new log
+	int log_fd = safe_open_wrapper_follow(filename, O_RDONLY | O_LARGEFILE | _O_NOINHERIT, 0);
+	int tmp_fd = safe_open_wrapper_follow(tmp_filename, O_WRONLY | O_APPEND | O_LARGEFILE | _O_NOINHERIT, 0600);
+	bool copied = log_fd >= 0 && tmp_fd >= 0 && lseek(log_fd, (off_t)offset, SEEK_SET) == (off_t)offset;
+	long long tail = 0;
+	char buf[64 * 1024];
+	while (copied) {
+		ssize_t len = full_read(log_fd, buf, sizeof(buf));
+		if (len <= 0) {
+			copied = (len == 0);
+			break;
 		}
+		if (full_write(tmp_fd, buf, len) != len) {
+			copied = false;
+		}
+		tail += len;
+	}
+	if (copied && condor_fdatasync(tmp_fd) < 0) {
+		copied = false;
+	}
+	int copy_errno = errno;
+	if (log_fd >= 0) { close(log_fd); }
+	if (tmp_fd >= 0) { close(tmp_fd); }
+	if ( ! copied) {
+		formatstr(errmsg, "failed to rotate log: copying the end of %s to %s failed, errno = %d\n",
+			filename, tmp_filename, copy_errno);
+		unlink(tmp_filename);
+		return false;
+	}
+
+	dprintf(D_FULLDEBUG, "Copied %lld bytes committed to %s during its rotation\n", tail, filename);
+
+	if (rotate_file(tmp_filename, filename) < 0) {
+		formatstr(errmsg, "failed to rotate job queue log!\n");
+		unlink(tmp_filename);
+		return false;
 	}
 
+	historical_sequence_number += 1;
+
+	fclose(log_fp);
+	log_fp = NULL;
+
+	SyncRenamedClassAdLog(filename, errmsg);
+	ReopenClassAdLog(filename, log_fp, errmsg);
+
 	return true;
 }
 
@@ -794,6 +1140,7 @@ LogSetAttribute::LogSetAttribute(const char *k, const char *n, const char *val,
 		value = strdup("UNDEFINED");
 	}
 	is_dirty = dirty;
+	value_unparsed = false;
 }
 
 
@@ -812,11 +1159,32 @@ LogSetAttribute::Play(void *data_structure)
 	LoggableClassAdTable *table = (LoggableClassAdTable *)data_structure;
 	int rval;
 	ClassAd *ad = 0;
+	WarnUnparsedValue();
 	if ( ! table->lookup(key, ad))
 		return -1;
 
 	std::string attr(name);
-	if (ad->InsertViaCache(attr, value)) {
+	if (value_expr) {
+			// the value was parsed when this record was made or read,
+			// so put that into the ad rather than parsing it again.
+		ExprTree *tree = value_expr;
+		value_expr = NULL;
+		if (classad::ClassAdGetExpressionCaching() && attr[0] != '\'') {
+			ExprTree *env = classad::CachedExprEnvelope::check_hit(attr, value);
+			if (env) {
+				delete tree;
+			} else {
+				env = classad::CachedExprEnvelope::cache(attr, tree, value);
+			}
+			tree = env;
+		}
+		if (ad->Insert(attr, tree)) {
+			rval = TRUE;
+		} else {
+			delete tree;
+			rval = FALSE;
+		}
+	} else if (ad->InsertViaCache(attr, value)) {
 		rval = TRUE;
 	} else {
 		rval = FALSE;
@@ -876,6 +1244,25 @@ LogSetAttribute::WriteBody(FILE* fp)
 
 int
 LogSetAttribute::ReadBody(FILE* fp)
+{
+	int rval = ReadBodyOnThread(fp, param_boolean("CLASSAD_LOG_STRICT_PARSING", true));
+	if (rval >= 0) {
+		WarnUnparsedValue();
+	}
+	return rval;
+}
+
+void
+LogSetAttribute::WarnUnparsedValue()
+{
+	if (value_unparsed) {
+		dprintf(D_ALWAYS, "WARNING: strict classad parsing failed for expression: %s\n", value);
+		value_unparsed = false;
+	}
+}
+
+int
+LogSetAttribute::ReadBodyOnThread(FILE* fp, bool strict_parsing)
 {
 	int rval, rval1;
 
@@ -900,14 +1287,14 @@ LogSetAttribute::ReadBody(FILE* fp)
 
 	if (value_expr) delete value_expr;
 	value_expr = NULL;
+	value_unparsed = false;
 	if (ParseClassAdRvalExpr(value, value_expr)) {
 		if (value_expr) delete value_expr;
 		value_expr = NULL;
-		if (param_boolean("CLASSAD_LOG_STRICT_PARSING", true)) {
+		if (strict_parsing) {
 			return -1;
-		} else {
-			dprintf(D_ALWAYS, "WARNING: strict classad parsing failed for expression: %s\n", value);
 		}
+		value_unparsed = true;
 	}
 	return rval + rval1;
 }
@@ -1049,8 +1436,9 @@ LogDeleteAttribute::ReadBody(FILE* fp)
 	return rval + rval1;
 }
 
-LogRecord	*
-InstantiateLogEntry(FILE *fp, unsigned long recnum, int type, const ConstructLogEntry & ctor)
+// A new, empty record of the given type, to be read into
+static LogRecord *
+NewLogEntry(int type, const ConstructLogEntry & ctor)
 {
 	LogRecord	*log_rec;
 
@@ -1083,6 +1471,16 @@ InstantiateLogEntry(FILE *fp, unsigned long recnum, int type, const ConstructLog
 		    return NULL;
 			break;
 	}
+	return log_rec;
+}
+
+LogRecord	*
+InstantiateLogEntry(FILE *fp, unsigned long recnum, int type, const ConstructLogEntry & ctor)
+{
+	LogRecord	*log_rec = NewLogEntry(type, ctor);
+	if ( ! log_rec) {
+		return NULL;
+	}
 
 	long long pos = ftell(fp);
 
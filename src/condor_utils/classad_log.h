@@ -42,6 +42,10 @@
    internally by ClassAdLog to delimit transactions in the on-disk log.
 */
 
+#include <functional>
+#include <memory>
+#include <vector>
+
 #include "condor_classad.h"
 #include "log.h"
 #include "log_transaction.h"
@@ -88,6 +92,10 @@ public:
 
 	bool InitLogFile(const char *filename,int max_historical_logs=0);
 
+		// Read the log on this many threads in InitLogFile(), which
+		// speeds up the loading of a large log.  0 reads it on this one.
+	void SetRecoveryThreads(int threads) { m_recovery_threads = threads; }
+
 	// define an stl type iterator, but one that can filter based on a requirements expression
 	class filter_iterator {
 		private:
@@ -98,6 +106,10 @@ public:
 			int m_timeslice_ms;
 			int m_done;
 			int m_options;
+				// when set, only the ads with these keys are visited, rather than the whole table
+			std::shared_ptr<const std::vector<K>> m_keys;
+			size_t m_next_key;
+			AD m_key_ad;
 
 		public:
 			filter_iterator(ClassAdLog<K,AD> &log, const classad::ExprTree *requirements, int timeslice_ms, bool at_end=false)
@@ -107,10 +119,15 @@ public:
 				, m_requirements(requirements)
 				, m_timeslice_ms(timeslice_ms)
 				, m_done(at_end)
-				, m_options(0) {}
+				, m_options(0)
+				, m_next_key(0)
+				, m_key_ad(NULL) {}
 
 			~filter_iterator() {}
 			AD operator *() const {
+				if (m_keys) {
+					return (m_done || !m_found_ad) ? NULL : m_key_ad;
+				}
 				if (m_done || (m_cur == m_table->end()) || !m_found_ad)
 					return NULL;
 				return (*m_cur).second;
@@ -122,12 +139,16 @@ public:
 				if (m_table != rhs.m_table) return false;
 				if (m_done && rhs.m_done) return true;
 				if (m_done != rhs.m_done) return false;
+				if (m_keys != rhs.m_keys || m_next_key != rhs.m_next_key) return false;
 				if (!(m_cur == rhs.m_cur) ) return false;
 				return true;
 			}
 			bool operator!=(const filter_iterator &rhs) const {return !(*this == rhs);}
 			int set_options(int options) { int opts = m_options; m_options = options; return opts; }
 			int get_options() { return m_options; }
+				// visit only the ads with these keys, skipping any that are no longer in the table.
+				// used when an index has narrowed down the ads that can match the requirements.
+			void set_keys(std::shared_ptr<const std::vector<K>> keys) { m_keys = keys; m_next_key = 0; }
 
 			using iterator_category = std::input_iterator_tag;
 			using value_type = AD;
@@ -140,6 +161,19 @@ public:
 	void AppendLog(LogRecord *log);	// perform a log operation
 	bool TruncLog();				// clean log file on disk
 
+		// Clean the log file in the background.  The caller calls
+		// BeginBackgroundTruncLog(), then forks, and the child calls
+		// WriteBackgroundTruncLog() to write the table as it was at the
+		// fork to a new log, while the parent goes on appending to the
+		// old one.  When the child exits, the parent calls
+		// FinishBackgroundTruncLog(), which copies what was appended
+		// meanwhile to the new log and renames it over the old one.
+		// A TruncLog() or StopLog() in between cancels it.
+	bool BeginBackgroundTruncLog();
+	bool WriteBackgroundTruncLog();
+	bool FinishBackgroundTruncLog(bool written);
+	bool BackgroundTruncLogActive() const { return m_background_trunc_offset >= 0; }
+
 	// close the log file and discard any unwritten transactions, disable future changes
 	void StopLog();
 
@@ -148,6 +182,18 @@ public:
 	void CommitTransaction(const char * comment = NULL);
 	void CommitNondurableTransaction(const char * comment = NULL);
 	bool InTransaction() { return active_transaction != NULL; }
+
+		// Group commit: write the transaction like a durable commit, but
+		// leave the fsync to be shared with the transactions committed
+		// after it, until SyncLog() or ForceLog() is called, or more than
+		// the group commit max bytes are waiting.  Whoever acknowledges
+		// the commit must wait until LogSynced() is true; WhenLogSynced()
+		// calls a function at that point.
+	void CommitGroupedTransaction(const char * comment = NULL);
+	void SetGroupCommitMaxBytes(long long max_bytes) { m_group_commit_max_bytes = max_bytes; }
+	bool LogSynced() const { return m_unsynced_bytes == 0; }
+	void WhenLogSynced(std::function<void()> fn);
+	void SyncLog() { if (m_unsynced_bytes) ForceLog(); }
 	int SetTransactionTriggers(int mask);
 	int GetTransactionTriggers();
 
@@ -249,8 +295,16 @@ private:
 	unsigned long historical_sequence_number;
 	time_t m_original_log_birthdate;
 	int m_nondurable_level;
+	long long m_group_commit_max_bytes;
+	long long m_unsynced_bytes;		// written by grouped commits since the last fsync
+	std::vector<std::function<void()>> m_when_synced;
+	long long m_background_trunc_offset;	// of the log at the fork, -1 if none
+	int m_recovery_threads;
 
 	bool SaveHistoricalLogs();
+	void LogWasSynced();
+	std::string BackgroundTruncLogFilename() { return log_filename_buf + ".compact"; }
+	void CancelBackgroundTruncLog();
 };
 
 
@@ -375,14 +429,21 @@ public:
 	char const *get_value() { return value; }
     ExprTree* get_expr() { return value_expr; }
 
+		// Like ReadBody(), but for a reader thread: takes the value of
+		// CLASSAD_LOG_STRICT_PARSING rather than looking it up, and leaves
+		// the warning for a value that doesn't parse to Play().
+	int ReadBodyOnThread(FILE* fp, bool strict_parsing);
+
 private:
 	virtual int WriteBody(FILE* fp);
 	virtual int ReadBody(FILE* fp);
+	void WarnUnparsedValue();
 
 	char *key;
 	char *name;
 	char *value;
 	bool is_dirty;
+	bool value_unparsed;	// the value failed strict parsing, not yet logged
     ExprTree* value_expr;    
 };
 
@@ -452,6 +513,27 @@ bool TruncateClassAdLog(
 	time_t & m_original_log_birthdate, // in,out
 	std::string & errmsg);          // out
 
+// Write the table to a new log file, which is what the first half of
+// TruncateClassAdLog() does.  Used in the child for a background rotation.
+bool WriteClassAdLogSnapshot(
+	const char * tmp_filename,      // in
+	LoggableClassAdTable & la,      // in
+	const ConstructLogEntry& maker, // in
+	unsigned long sequence_number,  // in
+	time_t original_log_birthdate,  // in
+	std::string & errmsg);          // out
+
+// Append what was written to the log after offset to the new log written
+// by WriteClassAdLogSnapshot(), then rename the new log over the old one
+// and reopen it.  If the rename fails, the old log stays open.
+bool FinishTruncateClassAdLog(
+	const char * filename,          // in
+	const char * tmp_filename,      // in
+	long long offset,               // in
+	FILE* &log_fp,                  // in,out
+	unsigned long & historical_sequence_number, // in,out
+	std::string & errmsg);          // out
+
 bool WriteClassAdLogState(
 	FILE *fp,                       // in
 	const char * filename,          // in: used for error messages
@@ -469,7 +551,8 @@ FILE* LoadClassAdLog(
 	time_t & m_original_log_birthdate, // in,out
 	bool & is_clean,  // out: true if log was shutdown cleanly
 	bool & requires_successful_cleaning, // out: true if log must be cleaned (i.e rotated) before it can be written to again.
-	std::string & errmsg);          // out, contains error or warning messages
+	std::string & errmsg,           // out, contains error or warning messages
+	int recovery_threads = 0);      // in: threads to read the log with, 0 to read it on this one
 
 int FlushClassAdLog(FILE* fp, bool force);
 
@@ -525,7 +608,8 @@ ClassAdLog<K,AD>::InitLogFile(const char *filename,int max_historical_logs_arg)
 	log_fp = LoadClassAdLog(filename,
 		la, this->GetTableEntryMaker(),
 		historical_sequence_number, m_original_log_birthdate,
-		is_clean, requires_successful_cleaning, errmsg);
+		is_clean, requires_successful_cleaning, errmsg,
+		m_recovery_threads);
 
 	if ( ! log_fp) {
 		dprintf(D_ALWAYS, "%s", errmsg.c_str());
@@ -558,6 +642,10 @@ ClassAdLog<K,AD>::ClassAdLog(const ConstructLogEntry* maker)
 	, historical_sequence_number(0)
 	, m_original_log_birthdate(0)
 	, m_nondurable_level(0)
+	, m_group_commit_max_bytes(1024*1024)
+	, m_unsynced_bytes(0)
+	, m_background_trunc_offset(-1)
+	, m_recovery_threads(0)
 {
 }
 
@@ -631,6 +719,32 @@ ClassAdLog<K,AD>::ForceLog()
 	if (err) {
 		EXCEPT("fsync of %s failed, errno = %d", logFilename(), err);
 	}
+	LogWasSynced();
+}
+
+// Everything committed so far is on disk, so let those waiting for
+// grouped commits know.
+template <typename K, typename AD>
+void
+ClassAdLog<K,AD>::LogWasSynced()
+{
+	m_unsynced_bytes = 0;
+	std::vector<std::function<void()>> waiting;
+	waiting.swap(m_when_synced);
+	for (auto & fn : waiting) {
+		fn();
+	}
+}
+
+template <typename K, typename AD>
+void
+ClassAdLog<K,AD>::WhenLogSynced(std::function<void()> fn)
+{
+	if (LogSynced()) {
+		fn();
+	} else {
+		m_when_synced.push_back(fn);
+	}
 }
 
 template <typename K, typename AD>
@@ -646,6 +760,11 @@ ClassAdLog<K,AD>::TruncLog()
 {
 	dprintf(D_ALWAYS,"About to rotate ClassAd log %s\n",logFilename());
 
+	CancelBackgroundTruncLog();
+
+		// the grouped commits must be on disk before the old log is saved
+	SyncLog();
+
 	if(!SaveHistoricalLogs()) {
 		dprintf(D_ALWAYS,"Skipping log rotation, because saving of historical log failed for %s.\n",logFilename());
 		return false;
@@ -668,11 +787,100 @@ ClassAdLog<K,AD>::TruncLog()
 	return rotated;
 }
 
+template <typename K, typename AD>
+bool
+ClassAdLog<K,AD>::BeginBackgroundTruncLog()
+{
+	if ( ! log_fp || active_transaction || BackgroundTruncLogActive()) {
+		return false;
+	}
+
+	dprintf(D_ALWAYS,"About to rotate ClassAd log %s in the background\n",logFilename());
+
+		// the grouped commits must be on disk before the old log is saved,
+		// and nothing may be left in the buffer for the child to write.
+	SyncLog();
+	if (FlushClassAdLog(log_fp, false) != 0) {
+		dprintf(D_ALWAYS,"Skipping log rotation, because flushing %s failed.\n",logFilename());
+		return false;
+	}
+
+	if(!SaveHistoricalLogs()) {
+		dprintf(D_ALWAYS,"Skipping log rotation, because saving of historical log failed for %s.\n",logFilename());
+		return false;
+	}
+
+	m_background_trunc_offset = lseek(fileno(log_fp), 0, SEEK_END);
+	return m_background_trunc_offset >= 0;
+}
+
+template <typename K, typename AD>
+bool
+ClassAdLog<K,AD>::WriteBackgroundTruncLog()
+{
+	std::string errmsg;
+	ClassAdLogTable<K,AD> la(table);
+	if ( ! WriteClassAdLogSnapshot(BackgroundTruncLogFilename().c_str(),
+			la, this->GetTableEntryMaker(),
+			historical_sequence_number + 1, m_original_log_birthdate,
+			errmsg)) {
+		dprintf(D_ALWAYS, "%s", errmsg.c_str());
+		return false;
+	}
+	return true;
+}
+
+template <typename K, typename AD>
+bool
+ClassAdLog<K,AD>::FinishBackgroundTruncLog(bool written)
+{
+	std::string tmp_filename = BackgroundTruncLogFilename();
+	if ( ! BackgroundTruncLogActive()) {
+			// cancelled, and maybe already replaced by a TruncLog()
+		unlink(tmp_filename.c_str());
+		return false;
+	}
+	long long offset = m_background_trunc_offset;
+	m_background_trunc_offset = -1;
+
+	if ( ! written) {
+		dprintf(D_ALWAYS,"Skipping log rotation, because writing %s failed.\n",tmp_filename.c_str());
+		unlink(tmp_filename.c_str());
+		return false;
+	}
+
+	std::string errmsg;
+	bool rotated = FinishTruncateClassAdLog(logFilename(), tmp_filename.c_str(),
+		offset, log_fp, historical_sequence_number, errmsg);
+	if ( ! log_fp) {
+		// if after rotation, the log is no longer open, the the failure is fatal, and we must except
+		EXCEPT("%s", errmsg.c_str());
+	}
+	if ( ! errmsg.empty()) {
+		dprintf(D_ALWAYS, "%s", errmsg.c_str());
+	}
+
+	return rotated;
+}
+
+template <typename K, typename AD>
+void
+ClassAdLog<K,AD>::CancelBackgroundTruncLog()
+{
+	if (BackgroundTruncLogActive()) {
+		dprintf(D_FULLDEBUG,"Abandoning the background rotation of %s\n",logFilename());
+		m_background_trunc_offset = -1;
+		unlink(BackgroundTruncLogFilename().c_str());
+	}
+}
+
 template <typename K, typename AD>
 void
 ClassAdLog<K,AD>::StopLog()
 {
 	AbortTransaction();
+	CancelBackgroundTruncLog();
+	SyncLog();
 	if (log_fp) {
 		fclose(log_fp);
 		log_fp = NULL;
@@ -748,11 +956,38 @@ ClassAdLog<K,AD>::CommitTransaction(const char * comment /*=NULL*/)
 		bool nondurable = m_nondurable_level > 0;
 		ClassAdLogTable<K,AD> la(table);
 		active_transaction->Commit(log_fp, logFilename(), &la, nondurable );
+		if ( ! nondurable && log_fp) {
+			// the fsync of the commit covers any grouped commits before it
+			LogWasSynced();
+		}
 	}
 	delete active_transaction;
 	active_transaction = NULL;
 }
 
+template <typename K, typename AD>
+void
+ClassAdLog<K,AD>::CommitGroupedTransaction(const char * comment /*=NULL*/)
+{
+	if ( ! log_fp || m_nondurable_level > 0) {
+		// there is nothing to sync, or no one expects it to be
+		CommitTransaction(comment);
+		return;
+	}
+
+	long long before = ftell(log_fp);
+	int old_level = IncNondurableCommitLevel();
+	CommitTransaction(comment);
+	DecNondurableCommitLevel(old_level);
+	long long after = ftell(log_fp);
+	if (after > before) {
+		m_unsynced_bytes += after - before;
+		if (m_unsynced_bytes >= m_group_commit_max_bytes) {
+			ForceLog();
+		}
+	}
+}
+
 template <typename K, typename AD>
 void
 ClassAdLog<K,AD>::CommitNondurableTransaction(const char * comment /*=NULL*/)
@@ -26,7 +26,9 @@
 #include "string_list.h"
 
 #include "classad/classad_distribution.h"
+#include "classad/classadCache.h"
 #include "classad_oldnew.h"
+#include "classad_wire.h"
 #include "compat_classad.h"
 
 // local helper functions, options are one or more of PUT_CLASSAD_* flags
@@ -39,6 +41,245 @@ int _mergeStringListIntoWhitelist(StringList & list_in, classad::References & wh
 
 static const char *SECRET_MARKER = "ZKM"; // "it's a Zecret Klassad, Mon!"
 
+// string literals this long or longer go through the classad cache
+// rather than being inserted directly, so that copies are shared
+static const size_t always_cache_string_size = 128;
+
+// true if ads sent on this stream may use the binary form.  Released
+// 10.8.0 builds can't read it, so the first version that can is the next
+// one, and until then this build only ever sends text.
+static bool peerSupportsWire(Stream *sock)
+{
+	if ( ! ClassAdWireEnabled()) {
+		return false;
+	}
+	auto *verinfo = sock->get_peer_version();
+	return verinfo && verinfo->built_since_version(10, 9, 0);
+}
+
+static ClassAdWireDictionary * getWireDictionary(Stream *sock)
+{
+	// only ReliSock clears the dictionary at message boundaries,
+	// so the binary form never uses it on other kinds of streams
+	if (sock->type() == Stream::reli_sock) {
+		return static_cast<ReliSock*>(sock)->classad_wire_dict();
+	}
+	return NULL;
+}
+
+// Read the rest of an ad sent in the binary form, see classad_wire.h.
+// The marker has already been read.  Literals are inserted directly,
+// everything else goes through the classad cache when use_cache is true
+// so that receivers holding many similar ads still share expressions.
+static bool getClassAdBinary( Stream *sock, classad::ClassAd& ad, bool use_cache )
+{
+	int num_attrs = 0;
+	int cb = 0;
+	if ( ! sock->code(num_attrs) || ! sock->code(cb)) {
+		dprintf(D_FULLDEBUG, "getClassAd FAILED to get binary ad header\n");
+		return false;
+	}
+	if ( ! ClassAdWireDecoder::headerOk(num_attrs, cb)) {
+		dprintf(D_ALWAYS, "getClassAd: rejecting binary ad of %d attributes in %d bytes\n", num_attrs, cb);
+		return false;
+	}
+
+	std::string data;
+	data.resize(cb);
+	if (cb > 0 && sock->get_bytes(&data[0], cb) != cb) {
+		dprintf(D_FULLDEBUG, "getClassAd FAILED to get %d bytes of binary ad\n", cb);
+		return false;
+	}
+
+	if (ad.size() == 0) {
+		ad.rehash(num_attrs + 5);
+	}
+
+	classad::ClassAdUnParser unp;
+	unp.SetOldClassAd(true, true);
+	ClassAdWireDecoder decoder(data.data(), data.size(), getWireDictionary(sock));
+	std::string attr, rhs;
+	for (int ii = 0; ii < num_attrs; ++ii) {
+		classad::ExprTree *tree = NULL;
+		if ( ! decoder.getAttr(attr, tree)) {
+			dprintf(D_FULLDEBUG, "getClassAd FAILED to decode binary attribute %d of %d\n", ii, num_attrs);
+			delete tree;
+			return false;
+		}
+
+		bool cache = use_cache && classad::ClassAdGetExpressionCaching() && attr[0] != '\'';
+		if (cache) {
+			switch (tree->GetKind()) {
+			case classad::ExprTree::LITERAL_NODE: {
+				int cch = 0;
+				classad::Value::NumberFactor factor;
+				cache = ((classad::Literal*)tree)->getValue(factor).IsStringValue(cch) &&
+					(size_t)cch >= always_cache_string_size;
+				break;
+			}
+			case classad::ExprTree::EXPR_LIST_NODE:
+			case classad::ExprTree::CLASSAD_NODE:
+				cache = false;
+				break;
+			default:
+				break;
+			}
+		}
+
+		bool inserted;
+		if (cache) {
+			// the cache is keyed by the text form, which is cheaper to
+			// produce than to parse
+			rhs.clear();
+			unp.Unparse(rhs, tree);
+			classad::ExprTree *env = classad::CachedExprEnvelope::check_hit(attr, rhs);
+			if (env) {
+				delete tree;
+			} else {
+				env = classad::CachedExprEnvelope::cache(attr, tree, rhs);
+			}
+			inserted = ad.Insert(attr, env);
+			if ( ! inserted) { delete env; }
+		} else {
+			inserted = ad.Insert(attr, tree);
+			if ( ! inserted) { delete tree; }
+		}
+		if ( ! inserted) {
+			dprintf(D_FULLDEBUG, "getClassAd FAILED to insert binary attribute %s\n", attr.c_str());
+			return false;
+		}
+	}
+
+	// private attributes are sent as text, encrypted
+	int num_secrets = 0;
+	if ( ! sock->code(num_secrets)) {
+		dprintf(D_FULLDEBUG, "getClassAd FAILED to get number of private attributes\n");
+		return false;
+	}
+	for (int ii = 0; ii < num_secrets; ++ii) {
+		char *secret_line = NULL;
+		if ( ! sock->get_secret(secret_line)) {
+			dprintf(D_FULLDEBUG, "Failed to read encrypted ClassAd expression.\n");
+			return false;
+		}
+		bool inserted = InsertLongFormAttrValue(ad, secret_line, use_cache);
+		if ( ! inserted) {
+			dprintf(D_FULLDEBUG, "getClassAd FAILED to insert secret attribute\n");
+		}
+		free(secret_line);
+		if ( ! inserted) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Collects the attributes _putClassAd() has decided to send.  Peers that
+// understand it get them in the binary form in one piece at the end,
+// everyone else gets "Attr = expr" strings as they are added.
+class ClassAdSender
+{
+public:
+	ClassAdSender(Stream *sock)
+		: m_sock(sock)
+		, m_binary(peerSupportsWire(sock))
+		, m_encoder(m_binary ? getWireDictionary(sock) : NULL)
+	{
+		m_unp.SetOldClassAd(true, true);
+	}
+
+	bool binary() const { return m_binary; }
+
+	// num_exprs includes the ServerTime attribute if there is one
+	bool begin(int num_exprs) {
+		m_sock->encode();
+		if (m_binary) {
+			int marker = CLASSAD_WIRE_MARKER;
+			return m_sock->code(marker);
+		}
+		return m_sock->code(num_exprs);
+	}
+
+	bool put(const std::string &attr, const classad::ExprTree *expr, bool encrypt_it) {
+		if (m_binary && ! encrypt_it) {
+			m_encoder.putAttr(attr, expr);
+			return true;
+		}
+
+		m_buf = attr;
+		m_buf += " = ";
+		m_unp.Unparse(m_buf, expr);
+		if (m_binary) {
+			m_secrets.push_back(m_buf);
+			return true;
+		}
+		if (encrypt_it) {
+			if ( ! m_sock->put(SECRET_MARKER)) {
+				return false;
+			}
+			return m_sock->put_secret(m_buf.c_str());
+		}
+		return m_sock->put(m_buf);
+	}
+
+	bool putServerTime() {
+		//insert in the current time from the server's (Schedd) point of
+		//view. this is used so condor_q can compute some time values
+		//based upon other attribute values without worrying about
+		//the clocks being different on the condor_schedd machine
+		// -vs- the condor_q machine
+		if (m_binary) {
+			classad::Literal *now = classad::Literal::MakeLong((long long)time(NULL));
+			m_encoder.putAttr(ATTR_SERVER_TIME, now);
+			delete now;
+			return true;
+		}
+
+		static const char fmt[] = ATTR_SERVER_TIME " = %ld";
+		char buf[sizeof(fmt) + 12]; //+12 for time value
+		snprintf(buf, sizeof(buf), fmt, (long)time(NULL));
+		return m_sock->put(buf);
+	}
+
+	bool end() {
+		if ( ! m_binary) {
+			return true;
+		}
+		int num_attrs = m_encoder.numAttrs();
+		if (m_encoder.data().size() > (size_t)ClassAdWireDecoder::MAX_AD_BYTES) {
+			dprintf(D_ALWAYS, "putClassAd: ad of %d attributes is too large to send (%zu bytes)\n",
+				num_attrs, m_encoder.data().size());
+			return false;
+		}
+		int cb = (int)m_encoder.data().size();
+		if ( ! m_sock->code(num_attrs) || ! m_sock->code(cb)) {
+			return false;
+		}
+		if (cb > 0 && m_sock->put_bytes(m_encoder.data().data(), cb) != cb) {
+			return false;
+		}
+		int num_secrets = (int)m_secrets.size();
+		if ( ! m_sock->code(num_secrets)) {
+			return false;
+		}
+		for (auto & line : m_secrets) {
+			if ( ! m_sock->put_secret(line.c_str())) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	Stream *m_sock;
+	bool m_binary;
+	ClassAdWireEncoder m_encoder;
+	classad::ClassAdUnParser m_unp;
+	std::string m_buf;
+	std::vector<std::string> m_secrets;
+};
+
 bool getClassAd( Stream *sock, classad::ClassAd& ad )
 {
 	int 					numExprs;
@@ -52,10 +293,16 @@ bool getClassAd( Stream *sock, classad::ClassAd& ad )
  		return false;
 	}
 
-	// at least numExprs are coming, but we may add
-	// my, target, and a couple extra right away
-
-	ad.rehash(numExprs + 5);
+	if (numExprs == CLASSAD_WIRE_MARKER) {
+		if ( ! getClassAdBinary(sock, ad, true)) {
+			return false;
+		}
+		numExprs = 0;
+	} else {
+		// at least numExprs are coming, but we may add
+		// my, target, and a couple extra right away
+		ad.rehash(numExprs + 5);
+	}
 
 		// pack exprs into classad
 	for( int i = 0 ; i < numExprs ; i++ ) {
@@ -105,6 +352,181 @@ bool getClassAd( Stream *sock, classad::ClassAd& ad )
 }
 
 
+bool getClassAdUnparsed( Stream *sock, UnparsedClassAd &ad )
+{
+	int numExprs;
+	std::string inputLine;
+
+	sock->decode( );
+	if( !sock->code( numExprs ) ) {
+		dprintf(D_FULLDEBUG, "FAILED to get number of expressions.\n");
+		return false;
+	}
+
+	if (numExprs == CLASSAD_WIRE_MARKER) {
+		if (getWireDictionary(sock)) {
+				// the dictionary changes as ads are read, so decode it now
+			ad.m_decoded.reset(new classad::ClassAd());
+			return getClassAdBinary(sock, *ad.m_decoded, true);
+		}
+
+		int cb = 0;
+		if ( ! sock->code(ad.m_binary_attrs) || ! sock->code(cb)) {
+			dprintf(D_FULLDEBUG, "getClassAd FAILED to get binary ad header\n");
+			return false;
+		}
+		if ( ! ClassAdWireDecoder::headerOk(ad.m_binary_attrs, cb)) {
+			dprintf(D_ALWAYS, "getClassAd: rejecting binary ad of %d attributes in %d bytes\n", ad.m_binary_attrs, cb);
+			return false;
+		}
+		ad.m_binary.resize(cb);
+		if (cb > 0 && sock->get_bytes(&ad.m_binary[0], cb) != cb) {
+			dprintf(D_FULLDEBUG, "getClassAd FAILED to get %d bytes of binary ad\n", cb);
+			return false;
+		}
+		ad.m_have_binary = true;
+		if ( ! sock->code(numExprs)) {
+			dprintf(D_FULLDEBUG, "getClassAd FAILED to get number of private attributes\n");
+			return false;
+		}
+		for (int ii = 0; ii < numExprs; ++ii) {
+			char *secret_line = NULL;
+			if ( ! sock->get_secret(secret_line)) {
+				dprintf(D_FULLDEBUG, "Failed to read encrypted ClassAd expression.\n");
+				return false;
+			}
+			ad.m_lines.emplace_back(secret_line);
+			free(secret_line);
+		}
+		return true;
+	}
+
+	ad.m_lines.reserve(numExprs);
+	for( int i = 0 ; i < numExprs ; i++ ) {
+		char const *strptr = NULL;
+		if( !sock->get_string_ptr( strptr ) || !strptr ) {
+			dprintf(D_FULLDEBUG, "FAILED to get expression string.\n");
+			return false;
+		}
+		if(strcmp(strptr,SECRET_MARKER) ==0 ){
+			char *secret_line = NULL;
+			if( !sock->get_secret(secret_line) ) {
+				dprintf(D_FULLDEBUG, "Failed to read encrypted ClassAd expression.\n");
+				return false;
+			}
+			ad.m_lines.emplace_back(secret_line);
+			free( secret_line );
+		} else {
+			ad.m_lines.emplace_back(strptr);
+		}
+	}
+
+	// the MyType and TargetType fields, which we ignore
+	if (!sock->get(inputLine) || !sock->get(inputLine)) {
+		dprintf(D_FULLDEBUG, "FAILED to get(inputLine)\n" );
+		return false;
+	}
+
+	return true;
+}
+
+// Whether the expression of an attribute is worth sharing through the
+// classad cache.  As in getClassAdBinary(), short literals aren't.
+static bool worthCaching( const std::string &attr, classad::ExprTree *tree )
+{
+	if ( ! classad::ClassAdGetExpressionCaching() || attr.empty() || attr[0] == '\'') {
+		return false;
+	}
+	switch (tree->GetKind()) {
+	case classad::ExprTree::LITERAL_NODE: {
+		int cch = 0;
+		classad::Value::NumberFactor factor;
+		return ((classad::Literal*)tree)->getValue(factor).IsStringValue(cch) &&
+			(size_t)cch >= always_cache_string_size;
+	}
+	case classad::ExprTree::EXPR_LIST_NODE:
+	case classad::ExprTree::CLASSAD_NODE:
+		return false;
+	default:
+		return true;
+	}
+}
+
+bool UnparsedClassAd::parse( classad::ClassAd &ad )
+{
+	m_cache_keys.clear();
+	if (m_decoded) {
+		ad.Update(*m_decoded);
+		return true;
+	}
+
+	classad::ClassAdUnParser unp;
+	unp.SetOldClassAd(true, true);
+	std::string attr, rhs;
+	if (m_have_binary) {
+		ClassAdWireDecoder decoder(m_binary.data(), m_binary.size(), NULL);
+		for (int ii = 0; ii < m_binary_attrs; ++ii) {
+			classad::ExprTree *tree = NULL;
+			if ( ! decoder.getAttr(attr, tree)) {
+				dprintf(D_FULLDEBUG, "getClassAd FAILED to decode binary attribute %d of %d\n", ii, m_binary_attrs);
+				delete tree;
+				return false;
+			}
+			if (worthCaching(attr, tree)) {
+				rhs.clear();
+				unp.Unparse(rhs, tree);
+				m_cache_keys.emplace_back(attr, rhs);
+			}
+			if ( ! ad.Insert(attr, tree)) {
+				delete tree;
+				return false;
+			}
+		}
+	}
+
+	classad::ClassAdParser parser;
+	parser.SetOldClassAd(true);
+	for (auto & line : m_lines) {
+		const char *prhs = NULL;
+		if ( ! SplitLongFormAttrValue(line.c_str(), attr, prhs)) {
+			dprintf(D_FULLDEBUG, "FAILED to insert %s\n", line.c_str());
+			return false;
+		}
+		classad::ExprTree *tree = parser.ParseExpression(prhs);
+		if ( ! tree) {
+			dprintf(D_FULLDEBUG, "FAILED to insert %s\n", line.c_str());
+			return false;
+		}
+		if (worthCaching(attr, tree)) {
+			m_cache_keys.emplace_back(attr, prhs);
+		}
+		if ( ! ad.Insert(attr, tree)) {
+			delete tree;
+			return false;
+		}
+	}
+	return true;
+}
+
+void UnparsedClassAd::cache( classad::ClassAd &ad )
+{
+	for (auto & key : m_cache_keys) {
+		classad::ExprTree *env = classad::CachedExprEnvelope::check_hit(key.first, key.second);
+		if ( ! env) {
+			classad::ExprTree *tree = ad.Remove(key.first);
+			if ( ! tree) {
+				continue;
+			}
+			env = classad::CachedExprEnvelope::cache(key.first, tree, key.second);
+		}
+		if ( ! ad.Insert(key.first, env)) {
+			delete env;
+		}
+	}
+	m_cache_keys.clear();
+}
+
+
 //uncomment this to enable runtime profiling of getClassAdEx, be aware that libcondorapi will have link errors with the profiling code.
 //#define PROFILE_GETCLASSAD
 #ifdef PROFILE_GETCLASSAD
@@ -208,7 +630,6 @@ bool getClassAdEx( Stream *sock, classad::ClassAd& ad, int options)
 	bool use_cache = (options & GET_CLASSAD_NO_CACHE) == 0;
 	bool cache_lazy = (options & GET_CLASSAD_LAZY_PARSE) != 0;
 	bool fast_tricks = (options & GET_CLASSAD_FAST) != 0;
-	const size_t always_cache_string_size = 128; // no fast parse for strings > this size.
 
 #ifdef PROFILE_GETCLASSAD
 	_condor_auto_accum_runtime< stats_entry_probe<double> > rt(getClassAdEx_runtime);
@@ -229,11 +650,16 @@ bool getClassAdEx( Stream *sock, classad::ClassAd& ad, int options)
 		return false;
 	}
 
-	// at least numExprs are coming, but we may add
-	// my, target, and a couple extra right away
-	// Auth (id,method) update(total,seq,lost,history)
-
-	if ( ! (options & GET_CLASSAD_NO_CLEAR)) {
+	if (numExprs == CLASSAD_WIRE_MARKER) {
+		// already parsed, so there is nothing lazy or fast to do
+		if ( ! getClassAdBinary(sock, ad, use_cache)) {
+			return false;
+		}
+		numExprs = 0;
+	} else if ( ! (options & GET_CLASSAD_NO_CLEAR)) {
+		// at least numExprs are coming, but we may add
+		// my, target, and a couple extra right away
+		// Auth (id,method) update(total,seq,lost,history)
 		ad.rehash(numExprs + 2 + 7);
 	}
 
@@ -415,6 +841,10 @@ getClassAdNoTypes( Stream *sock, classad::ClassAd& ad )
  		return false;
 	}
 
+	if (numExprs == CLASSAD_WIRE_MARKER) {
+		return getClassAdBinary(sock, ad, true);
+	}
+
 		// pack exprs into classad
 	buffer = "[";
 	for( int i = 0 ; i < numExprs ; i++ ) {
@@ -568,24 +998,8 @@ int putClassAd (Stream *sock, const classad::ClassAd& ad, int options, const cla
 }
 
 // helper function for _putClassAd
-static int _putClassAdTrailingInfo(Stream *sock, const classad::ClassAd& /* ad */, bool send_server_time, bool excludeTypes)
+static int _putClassAdTrailingInfo(Stream *sock, const classad::ClassAd& /* ad */, bool excludeTypes)
 {
-    if (send_server_time)
-    {
-        //insert in the current time from the server's (Schedd) point of
-        //view. this is used so condor_q can compute some time values
-        //based upon other attribute values without worrying about
-        //the clocks being different on the condor_schedd machine
-        // -vs- the condor_q machine
-
-        static const char fmt[] = ATTR_SERVER_TIME " = %ld";
-        char buf[sizeof(fmt) + 12]; //+12 for time value
-        snprintf(buf, sizeof(buf), fmt, (long)time(NULL));
-        if (!sock->put(buf)) {
-            return false;
-        }
-    }
-
     //ok, so the name of the bool doesn't really work here. It works
     //  in the other places though.
     if (!excludeTypes)
@@ -608,13 +1022,8 @@ int _putClassAd( Stream *sock, const classad::ClassAd& ad, int options,
 	auto *verinfo = sock->get_peer_version();
 	bool exclude_private_v2 = exclude_private || !verinfo || !verinfo->built_since_version(9, 9, 0);
 
-	classad::ClassAdUnParser	unp;
-	std::string					buf;
-	buf.reserve(8192);
 	bool send_server_time = false;
 
-	unp.SetOldClassAd( true, true );
-
 	int numExprs=0;
 
 	classad::AttrList::const_iterator itor;
@@ -684,8 +1093,8 @@ int _putClassAd( Stream *sock, const classad::ClassAd& ad, int options,
 		send_server_time = true;
 	}
 
-	sock->encode( );
-	if( !sock->code( numExprs ) ) {
+	ClassAdSender sender(sock);
+	if ( ! sender.begin(numExprs)) {
 		return false;
 	}
 
@@ -738,22 +1147,20 @@ int _putClassAd( Stream *sock, const classad::ClassAd& ad, int options,
 				}
 			}
 
-			buf = attr;
-			buf += " = ";
-			unp.Unparse( buf, expr );
-
-			if (encrypt_it) {
-				sock->put(SECRET_MARKER);
-
-				sock->put_secret(buf.c_str());
-			}
-			else if (!sock->put(buf) ){
+			if ( ! sender.put(attr, expr, encrypt_it)) {
 				return false;
 			}
 		}
 	}
 
-	return _putClassAdTrailingInfo(sock, ad, send_server_time, excludeTypes);
+	if (send_server_time && ! sender.putServerTime()) {
+		return false;
+	}
+	if ( ! sender.end()) {
+		return false;
+	}
+
+	return _putClassAdTrailingInfo(sock, ad, excludeTypes);
 }
 
 int _putClassAd( Stream *sock, const classad::ClassAd& ad, int options, const classad::References &whitelist, const classad::References *encrypted_attrs)
@@ -763,9 +1170,6 @@ int _putClassAd( Stream *sock, const classad::ClassAd& ad, int options, const cl
 	auto *verinfo = sock->get_peer_version();
 	bool exclude_private_v2 = exclude_private || !verinfo || !verinfo->built_since_version(9, 9, 0);
 
-	classad::ClassAdUnParser unp;
-	unp.SetOldClassAd( true, true );
-
 	classad::References blacklist;
 	for (classad::References::const_iterator attr = whitelist.begin(); attr != whitelist.end(); ++attr) {
 		if ( ! ad.Lookup(*attr) ||
@@ -796,12 +1200,11 @@ int _putClassAd( Stream *sock, const classad::ClassAd& ad, int options, const cl
 	}
 
 
-	sock->encode( );
-	if( !sock->code( numExprs ) ) {
+	ClassAdSender sender(sock);
+	if ( ! sender.begin(numExprs)) {
 		return false;
 	}
 
-	std::string buf;
 	bool crypto_is_noop =  sock->prepare_crypto_for_secret_is_noop();
 	for (classad::References::const_iterator attr = whitelist.begin(); attr != whitelist.end(); ++attr) {
 
@@ -809,25 +1212,186 @@ int _putClassAd( Stream *sock, const classad::ClassAd& ad, int options, const cl
 			continue;
 
 		classad::ExprTree const *expr = ad.Lookup(*attr);
-		buf = *attr;
-		buf += " = ";
-		unp.Unparse( buf, expr );
-
-		if ( ! crypto_is_noop &&
+		bool encrypt_it = ! crypto_is_noop &&
 			(ClassAdAttributeIsPrivateAny(*attr) ||
-			(encrypted_attrs && (encrypted_attrs->find(*attr) != encrypted_attrs->end())))
-		) {
-			if (!sock->put(SECRET_MARKER)) {
+			(encrypted_attrs && (encrypted_attrs->find(*attr) != encrypted_attrs->end())));
+		if ( ! sender.put(*attr, expr, encrypt_it)) {
+			return false;
+		}
+	}
+
+	if (send_server_time && ! sender.putServerTime()) {
+		return false;
+	}
+	if ( ! sender.end()) {
+		return false;
+	}
+
+	return _putClassAdTrailingInfo(sock, ad, excludeTypes);
+}
+
+void SerializedClassAd::clear()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_have_text = false;
+	m_have_binary = false;
+	m_lines.clear();
+	m_binary.clear();
+	m_binary_attrs = 0;
+	m_binary_private.clear();
+}
+
+// Called with m_mutex held.  The attributes of the chained parent come
+// first, as in _putClassAd(), so the ad's own attributes override them.
+void SerializedClassAd::makeText()
+{
+	classad::ClassAdUnParser unp;
+	unp.SetOldClassAd(true, true);
+
+	const classad::ClassAd *ads[2] = { m_ad->GetChainedParentAd(), m_ad };
+	for (auto *ad : ads) {
+		if ( ! ad) continue;
+		for (auto itor = ad->begin(); itor != ad->end(); ++itor) {
+			Line line;
+			line.text = itor->first;
+			line.text += " = ";
+			unp.Unparse(line.text, itor->second);
+			line.private_v2 = ClassAdAttributeIsPrivateV2(itor->first);
+			line.private_v1 = ClassAdAttributeIsPrivateV1(itor->first);
+			m_lines.push_back(std::move(line));
+		}
+	}
+	m_have_text = true;
+}
+
+// Called with m_mutex held.  Names are never sent as references to the
+// socket's dictionary, since that changes from one message to the next.
+// The private attributes are always sent as secrets, which works even if
+// the channel is already encrypted.
+void SerializedClassAd::makeBinary()
+{
+	classad::ClassAdUnParser unp;
+	unp.SetOldClassAd(true, true);
+	ClassAdWireEncoder encoder(NULL);
+
+	const classad::ClassAd *ads[2] = { m_ad->GetChainedParentAd(), m_ad };
+	for (auto *ad : ads) {
+		if ( ! ad) continue;
+		for (auto itor = ad->begin(); itor != ad->end(); ++itor) {
+			bool private_v2 = ClassAdAttributeIsPrivateV2(itor->first);
+			bool private_v1 = ClassAdAttributeIsPrivateV1(itor->first);
+			if ( ! private_v1 && ! private_v2) {
+				encoder.putAttr(itor->first, itor->second);
+				continue;
+			}
+			Line line;
+			line.text = itor->first;
+			line.text += " = ";
+			unp.Unparse(line.text, itor->second);
+			line.private_v1 = private_v1;
+			line.private_v2 = private_v2;
+			m_binary_private.push_back(std::move(line));
+		}
+	}
+	m_binary = encoder.data();
+	m_binary_attrs = encoder.numAttrs();
+	m_have_binary = true;
+}
+
+int putClassAd (Stream *sock, SerializedClassAd& ad, int options)
+{
+	bool excludeTypes = (options & PUT_CLASSAD_NO_TYPES) == PUT_CLASSAD_NO_TYPES;
+	bool exclude_private = (options & PUT_CLASSAD_NO_PRIVATE) == PUT_CLASSAD_NO_PRIVATE;
+	auto *verinfo = sock->get_peer_version();
+	bool exclude_private_v2 = exclude_private || !verinfo || !verinfo->built_since_version(9, 9, 0);
+	bool send_server_time = (options & PUT_CLASSAD_SERVER_TIME) != 0;
+
+	sock->encode();
+
+	if (peerSupportsWire(sock)) {
+		{
+			std::lock_guard<std::mutex> guard(ad.m_mutex);
+			if ( ! ad.m_have_binary) { ad.makeBinary(); }
+		}
+
+		ClassAdWireEncoder extra(NULL);
+		if (send_server_time) {
+			classad::Literal *now = classad::Literal::MakeLong((long long)time(NULL));
+			extra.putAttr(ATTR_SERVER_TIME, now);
+			delete now;
+		}
+
+		int marker = CLASSAD_WIRE_MARKER;
+		int num_attrs = ad.m_binary_attrs + extra.numAttrs();
+		int cb_cached = (int)ad.m_binary.size();
+		int cb_extra = (int)extra.data().size();
+		int cb = cb_cached + cb_extra;
+		if ( ! sock->code(marker) || ! sock->code(num_attrs) || ! sock->code(cb)) {
+			return false;
+		}
+		if (cb_cached > 0 && sock->put_bytes(ad.m_binary.data(), cb_cached) != cb_cached) {
+			return false;
+		}
+		if (cb_extra > 0 && sock->put_bytes(extra.data().data(), cb_extra) != cb_extra) {
+			return false;
+		}
+
+		int num_secrets = 0;
+		for (auto & line : ad.m_binary_private) {
+			if (exclude_private || (exclude_private_v2 && line.private_v2)) continue;
+			num_secrets++;
+		}
+		if ( ! sock->code(num_secrets)) {
+			return false;
+		}
+		for (auto & line : ad.m_binary_private) {
+			if (exclude_private || (exclude_private_v2 && line.private_v2)) continue;
+			if ( ! sock->put_secret(line.text.c_str())) {
 				return false;
 			}
-			if (!sock->put_secret(buf.c_str())) {
+		}
+		return _putClassAdTrailingInfo(sock, *ad.m_ad, excludeTypes);
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(ad.m_mutex);
+		if ( ! ad.m_have_text) { ad.makeText(); }
+	}
+
+	// This parallels the logic of _putClassAd()
+	bool crypto_is_noop = sock->prepare_crypto_for_secret_is_noop();
+	bool send_all_plain = crypto_is_noop && !exclude_private && !exclude_private_v2;
+	int numExprs = send_server_time ? 1 : 0;
+	for (auto & line : ad.m_lines) {
+		if ( ! send_all_plain &&
+			((exclude_private && (line.private_v1 || line.private_v2)) || (exclude_private_v2 && line.private_v2))) {
+			continue;
+		}
+		numExprs++;
+	}
+	if ( ! sock->code(numExprs)) {
+		return false;
+	}
+	for (auto & line : ad.m_lines) {
+		if ( ! send_all_plain && (line.private_v1 || line.private_v2)) {
+			if ((exclude_private) || (exclude_private_v2 && line.private_v2)) {
+				continue;
+			}
+			if ( ! sock->put(SECRET_MARKER) || ! sock->put_secret(line.text.c_str())) {
 				return false;
 			}
+		} else if ( ! sock->put(line.text)) {
+			return false;
 		}
-		else if ( ! sock->put(buf)){
+	}
+	if (send_server_time) {
+		static const char fmt[] = ATTR_SERVER_TIME " = %ld";
+		char buf[sizeof(fmt) + 12]; //+12 for time value
+		snprintf(buf, sizeof(buf), fmt, (long)time(NULL));
+		if ( ! sock->put(buf)) {
 			return false;
 		}
 	}
 
-	return _putClassAdTrailingInfo(sock, ad, send_server_time, excludeTypes);
+	return _putClassAdTrailingInfo(sock, *ad.m_ad, excludeTypes);
 }
@@ -25,6 +25,10 @@
 */
 
 #include "classad/classad_distribution.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 // Forward dec'l
 class ReliSock;
@@ -78,6 +82,92 @@ int putClassAd (Stream *sock, const classad::ClassAd& ad, int options,
 #define PUT_CLASSAD_NO_EXPAND_WHITELIST 0x08 // use the whitelist argument as-is, (default is to expand internal references before using it)
 #define PUT_CLASSAD_SERVER_TIME         0x10 // add ServerTime attribute with current time value
 
+/** The parts of what putClassAd() sends for an ad that are the same for
+ *  every socket, so an ad that is sent many times is serialized only once.
+ *  Each form is made the first time it is needed, and it may be sent
+ *  on several threads at once.  The ad must not change while this is in
+ *  use; call clear() after changing it.
+ */
+class SerializedClassAd
+{
+public:
+	explicit SerializedClassAd(const classad::ClassAd *ad) : m_ad(ad), m_have_text(false), m_have_binary(false), m_binary_attrs(0) {}
+
+		// forget the serialized forms
+	void clear();
+
+private:
+	friend int putClassAd (Stream *sock, SerializedClassAd& ad, int options);
+
+	struct Line {
+		std::string text;		// "Attr = expr"
+		bool private_v1;
+		bool private_v2;
+	};
+
+	void makeText();
+	void makeBinary();
+
+	SerializedClassAd(const SerializedClassAd &);
+	SerializedClassAd & operator=(const SerializedClassAd &);
+
+	const classad::ClassAd *m_ad;
+	std::mutex m_mutex;		// held while making a form
+	bool m_have_text;
+	bool m_have_binary;
+	std::vector<Line> m_lines;		// every attribute, for text peers
+	std::string m_binary;			// the public attributes in the binary form
+	int m_binary_attrs;
+	std::vector<Line> m_binary_private;	// the private attributes, for binary peers
+};
+
+/** Send an ad like putClassAd() does, from its serialized form.  Only the
+ *  PUT_CLASSAD_NO_PRIVATE, PUT_CLASSAD_NO_TYPES and PUT_CLASSAD_SERVER_TIME
+ *  options are supported.
+ */
+int putClassAd (Stream *sock, SerializedClassAd& ad, int options = 0);
+
+/** An ad read off a socket by getClassAdUnparsed(), to be parsed later,
+ *  perhaps on another thread.  Reading it has to happen on the thread that
+ *  owns the socket, since the private attributes are decrypted with the
+ *  socket's session key, but that is cheap next to parsing it.
+ */
+class UnparsedClassAd
+{
+public:
+	UnparsedClassAd() : m_binary_attrs(0), m_have_binary(false) {}
+
+		// Parse into ad, without using the classad cache, so it is safe
+		// to call on any thread.
+	bool parse(classad::ClassAd &ad);
+
+		// Share the expressions of ad, as parsed above, through the
+		// classad cache like getClassAd() would have.  The cache isn't
+		// thread safe, so this must be called on the main thread.
+	void cache(classad::ClassAd &ad);
+
+private:
+	friend bool getClassAdUnparsed(Stream *sock, UnparsedClassAd &ad);
+
+	UnparsedClassAd(const UnparsedClassAd &);
+	UnparsedClassAd & operator=(const UnparsedClassAd &);
+
+	std::vector<std::string> m_lines;	// "Attr = expr", decrypted
+	std::string m_binary;				// public attributes in the binary form
+	int m_binary_attrs;
+	bool m_have_binary;
+		// An ad in the binary form that can only be decoded in order
+		// with the others on its socket, since they share a dictionary.
+	std::unique_ptr<classad::ClassAd> m_decoded;
+		// what to cache, filled in by parse()
+	std::vector<std::pair<std::string, std::string> > m_cache_keys;
+};
+
+/** Read an ad like getClassAd() does, but leave the parsing of it for
+ *  later.
+ */
+bool getClassAdUnparsed(Stream *sock, UnparsedClassAd &ad);
+
 // fetch the given attribute from the queryAd and convert it into a set of attributes
 //   the attribute should be a string value containing a comma and/or space separated list of attributes (like StringList)
 //   if allow_list is true, then attribute is permitted to be a classad list of strings each of which is an attribute of the projection.
@@ -0,0 +1,583 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "classad_wire.h"
+
+using namespace classad;
+
+// Each expression node starts with one of these
+enum {
+	WIRE_UNDEFINED = 0,
+	WIRE_ERROR,
+	WIRE_FALSE,
+	WIRE_TRUE,
+	WIRE_INTEGER,	// zig-zag varint
+	WIRE_REAL,		// 8 bytes, IEEE 754 little endian
+	WIRE_STRING,	// varint length, bytes
+	WIRE_ABSTIME,	// zig-zag varint seconds, zig-zag varint offset
+	WIRE_RELTIME,	// 8 bytes like WIRE_REAL
+	WIRE_FACTOR,	// factor byte, followed by a WIRE_INTEGER or WIRE_REAL
+
+	WIRE_ATTRREF = 16,	// name
+	WIRE_ATTRREF_ABS,	// name, for .attr
+	WIRE_ATTRREF_SCOPED,	// expr, name, for expr.attr
+	WIRE_OP,		// op byte, byte with bit n set if operand n is present, operands
+	WIRE_FNCALL,	// name, varint argc, args
+	WIRE_LIST,		// varint count, exprs
+	WIRE_CLASSAD,	// varint count, (name, expr) pairs
+
+	WIRE_TEXT = 31,	// varint length, old ClassAd syntax
+};
+
+// Names are sent as a varint whose low two bits say what follows
+enum {
+	NAME_LITERAL = 0,	// length in the high bits, then the bytes
+	NAME_REF = 1,		// dictionary index in the high bits
+	NAME_DEFINE = 2,	// like NAME_LITERAL, and append to the dictionary
+};
+
+// deeper than the parser will produce, but keeps a corrupt message
+// from running the receiver out of stack
+#define MAX_WIRE_DEPTH 1000
+
+static bool wire_enabled = true;
+
+void ClassAdWireSetEnabled(bool enable)
+{
+	wire_enabled = enable;
+}
+
+bool ClassAdWireEnabled()
+{
+	return wire_enabled;
+}
+
+int ClassAdWireDictionary::find(const std::string & name) const
+{
+	auto it = ids.find(name);
+	return (it == ids.end()) ? -1 : it->second;
+}
+
+int ClassAdWireDictionary::add(const std::string & name)
+{
+	int ix = (int)names.size();
+	names.push_back(name);
+	ids[name] = ix;
+	return ix;
+}
+
+//
+// encoder
+//
+
+ClassAdWireEncoder::ClassAdWireEncoder(ClassAdWireDictionary * d)
+	: dict(d)
+	, num_attrs(0)
+{
+	buf.reserve(8192);
+	unparser.SetOldClassAd(true, true);
+}
+
+void ClassAdWireEncoder::putVarint(unsigned long long val)
+{
+	while (val >= 0x80) {
+		putByte((unsigned char)(val | 0x80));
+		val >>= 7;
+	}
+	putByte((unsigned char)val);
+}
+
+void ClassAdWireEncoder::putSigned(long long val)
+{
+	putVarint(((unsigned long long)val << 1) ^ (unsigned long long)(val >> 63));
+}
+
+void ClassAdWireEncoder::putReal(double val)
+{
+	uint64_t bits;
+	memcpy(&bits, &val, sizeof(bits));
+	for (int ii = 0; ii < 8; ++ii) {
+		putByte((unsigned char)(bits >> (ii * 8)));
+	}
+}
+
+void ClassAdWireEncoder::putBytes(const char * data, size_t len)
+{
+	putVarint(len);
+	buf.append(data, len);
+}
+
+void ClassAdWireEncoder::putName(const std::string & name)
+{
+	if (dict) {
+		int ix = dict->find(name);
+		if (ix >= 0) {
+			putVarint(((unsigned long long)ix << 2) | NAME_REF);
+			return;
+		}
+		if (dict->size() < ClassAdWireDictionary::MAX_ENTRIES) {
+			dict->add(name);
+			putVarint(((unsigned long long)name.size() << 2) | NAME_DEFINE);
+			buf.append(name);
+			return;
+		}
+	}
+	putVarint(((unsigned long long)name.size() << 2) | NAME_LITERAL);
+	buf.append(name);
+}
+
+void ClassAdWireEncoder::putValue(const Value & val, Value::NumberFactor factor)
+{
+	long long ival;
+	double rval;
+	bool bval;
+	const char * str;
+	abstime_t atime;
+
+	if (factor != Value::NO_FACTOR && (val.IsIntegerValue(ival) || val.IsRealValue(rval))) {
+		putByte(WIRE_FACTOR);
+		putByte((unsigned char)factor);
+	}
+
+	switch (val.GetType()) {
+	case Value::UNDEFINED_VALUE:
+		putByte(WIRE_UNDEFINED);
+		break;
+	case Value::ERROR_VALUE:
+		putByte(WIRE_ERROR);
+		break;
+	case Value::BOOLEAN_VALUE:
+		val.IsBooleanValue(bval);
+		putByte(bval ? WIRE_TRUE : WIRE_FALSE);
+		break;
+	case Value::INTEGER_VALUE:
+		val.IsIntegerValue(ival);
+		putByte(WIRE_INTEGER);
+		putSigned(ival);
+		break;
+	case Value::REAL_VALUE:
+		val.IsRealValue(rval);
+		putByte(WIRE_REAL);
+		putReal(rval);
+		break;
+	case Value::STRING_VALUE: {
+		int len = 0;
+		val.IsStringValue(str);
+		val.IsStringValue(len);
+		putByte(WIRE_STRING);
+		putBytes(str, len);
+		break;
+	}
+	case Value::ABSOLUTE_TIME_VALUE:
+		val.IsAbsoluteTimeValue(atime);
+		putByte(WIRE_ABSTIME);
+		putSigned(atime.secs);
+		putSigned(atime.offset);
+		break;
+	case Value::RELATIVE_TIME_VALUE:
+		val.IsRelativeTimeValue(rval);
+		putByte(WIRE_RELTIME);
+		putReal(rval);
+		break;
+	default: {
+		// a literal holding a list or ad, send it as text
+		std::string text;
+		unparser.Unparse(text, val);
+		putByte(WIRE_TEXT);
+		putBytes(text.data(), text.size());
+		break;
+	}
+	}
+}
+
+void ClassAdWireEncoder::putExpr(const ExprTree * expr)
+{
+	expr = expr->self();
+
+	switch (expr->GetKind()) {
+	case ExprTree::LITERAL_NODE: {
+		Value::NumberFactor factor;
+		const Value & val = ((const Literal*)expr)->getValue(factor);
+		putValue(val, factor);
+		break;
+	}
+
+	case ExprTree::ATTRREF_NODE: {
+		ExprTree *scope = NULL;
+		std::string name;
+		bool absolute = false;
+		((const AttributeReference*)expr)->GetComponents(scope, name, absolute);
+		if (scope) {
+			putByte(WIRE_ATTRREF_SCOPED);
+			putExpr(scope);
+		} else {
+			putByte(absolute ? WIRE_ATTRREF_ABS : WIRE_ATTRREF);
+		}
+		putName(name);
+		break;
+	}
+
+	case ExprTree::OP_NODE: {
+		Operation::OpKind op = Operation::__NO_OP__;
+		ExprTree *t1 = NULL, *t2 = NULL, *t3 = NULL;
+		((const Operation*)expr)->GetComponents(op, t1, t2, t3);
+		putByte(WIRE_OP);
+		putByte((unsigned char)op);
+		putByte((t1 ? 1 : 0) | (t2 ? 2 : 0) | (t3 ? 4 : 0));
+		if (t1) putExpr(t1);
+		if (t2) putExpr(t2);
+		if (t3) putExpr(t3);
+		break;
+	}
+
+	case ExprTree::FN_CALL_NODE: {
+		std::string name;
+		std::vector<ExprTree*> args;
+		((const FunctionCall*)expr)->GetComponents(name, args);
+		putByte(WIRE_FNCALL);
+		putName(name);
+		putVarint(args.size());
+		for (auto arg : args) {
+			putExpr(arg);
+		}
+		break;
+	}
+
+	case ExprTree::EXPR_LIST_NODE: {
+		const ExprList *list = (const ExprList*)expr;
+		putByte(WIRE_LIST);
+		putVarint(list->size());
+		for (auto item : *list) {
+			putExpr(item);
+		}
+		break;
+	}
+
+	case ExprTree::CLASSAD_NODE: {
+		const ClassAd *ad = (const ClassAd*)expr;
+		putByte(WIRE_CLASSAD);
+		putVarint(ad->size());
+		for (auto & attr : *ad) {
+			putName(attr.first);
+			putExpr(attr.second);
+		}
+		break;
+	}
+
+	default: {
+		std::string text;
+		unparser.Unparse(text, expr);
+		putByte(WIRE_TEXT);
+		putBytes(text.data(), text.size());
+		break;
+	}
+	}
+}
+
+void ClassAdWireEncoder::putAttr(const std::string & name, const ExprTree * expr)
+{
+	putName(name);
+	putExpr(expr);
+	++num_attrs;
+}
+
+void ClassAdWireEncoder::putAd(const ClassAd & ad)
+{
+	for (auto & attr : ad) {
+		putAttr(attr.first, attr.second);
+	}
+}
+
+//
+// decoder
+//
+
+ClassAdWireDecoder::ClassAdWireDecoder(const char * data, size_t len, ClassAdWireDictionary * d)
+	: ptr(data)
+	, end(data + len)
+	, dict(d)
+{
+	parser.SetOldClassAd(true);
+}
+
+bool ClassAdWireDecoder::getByte(unsigned char & ch)
+{
+	if (ptr >= end) return false;
+	ch = (unsigned char)*ptr++;
+	return true;
+}
+
+bool ClassAdWireDecoder::getVarint(unsigned long long & val)
+{
+	val = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		unsigned char ch;
+		if ( ! getByte(ch)) return false;
+		val |= (unsigned long long)(ch & 0x7F) << shift;
+		if ( ! (ch & 0x80)) return true;
+	}
+	return false;
+}
+
+bool ClassAdWireDecoder::getSigned(long long & val)
+{
+	unsigned long long uval;
+	if ( ! getVarint(uval)) return false;
+	val = (long long)(uval >> 1) ^ -(long long)(uval & 1);
+	return true;
+}
+
+bool ClassAdWireDecoder::getReal(double & val)
+{
+	if (end - ptr < 8) return false;
+	uint64_t bits = 0;
+	for (int ii = 0; ii < 8; ++ii) {
+		bits |= (uint64_t)(unsigned char)ptr[ii] << (ii * 8);
+	}
+	ptr += 8;
+	memcpy(&val, &bits, sizeof(val));
+	return true;
+}
+
+bool ClassAdWireDecoder::getBytes(const char * & data, size_t & len)
+{
+	unsigned long long ulen;
+	if ( ! getVarint(ulen) || ulen > (unsigned long long)(end - ptr)) return false;
+	data = ptr;
+	len = (size_t)ulen;
+	ptr += len;
+	return true;
+}
+
+bool ClassAdWireDecoder::getName(std::string & name)
+{
+	unsigned long long hdr;
+	if ( ! getVarint(hdr)) return false;
+
+	unsigned long long val = hdr >> 2;
+	switch (hdr & 3) {
+	case NAME_REF: {
+		const std::string *str = dict ? dict->at((size_t)val) : NULL;
+		if ( ! str) return false;
+		name = *str;
+		return true;
+	}
+	case NAME_LITERAL:
+	case NAME_DEFINE:
+		if (val > (unsigned long long)(end - ptr)) return false;
+		name.assign(ptr, (size_t)val);
+		if ((hdr & 3) == NAME_DEFINE) {
+			if ( ! dict || ! dict->append(ptr, (size_t)val)) return false;
+		}
+		ptr += val;
+		return true;
+	}
+	return false;
+}
+
+ExprTree * ClassAdWireDecoder::getExpr(int depth)
+{
+	unsigned char tag;
+	if (depth > MAX_WIRE_DEPTH || ! getByte(tag)) {
+		return NULL;
+	}
+
+	switch (tag) {
+	case WIRE_UNDEFINED: return Literal::MakeUndefined();
+	case WIRE_ERROR: return Literal::MakeError();
+	case WIRE_FALSE: return Literal::MakeBool(false);
+	case WIRE_TRUE: return Literal::MakeBool(true);
+
+	case WIRE_INTEGER: {
+		long long ival;
+		if ( ! getSigned(ival)) return NULL;
+		return Literal::MakeLong(ival);
+	}
+
+	case WIRE_REAL: {
+		double rval;
+		if ( ! getReal(rval)) return NULL;
+		return Literal::MakeReal(rval);
+	}
+
+	case WIRE_STRING: {
+		const char *str;
+		size_t len;
+		if ( ! getBytes(str, len)) return NULL;
+		return Literal::MakeString(str, len);
+	}
+
+	case WIRE_ABSTIME: {
+		long long secs, offset;
+		if ( ! getSigned(secs) || ! getSigned(offset)) return NULL;
+		Value val;
+		abstime_t atime;
+		atime.secs = (time_t)secs;
+		atime.offset = (int)offset;
+		val.SetAbsoluteTimeValue(atime);
+		return Literal::MakeLiteral(val);
+	}
+
+	case WIRE_RELTIME: {
+		double secs;
+		if ( ! getReal(secs)) return NULL;
+		Value val;
+		val.SetRelativeTimeValue(secs);
+		return Literal::MakeLiteral(val);
+	}
+
+	case WIRE_FACTOR: {
+		unsigned char factor, num_tag;
+		if ( ! getByte(factor) || ! getByte(num_tag) || factor > Value::T_FACTOR) return NULL;
+		Value val;
+		if (num_tag == WIRE_INTEGER) {
+			long long ival;
+			if ( ! getSigned(ival)) return NULL;
+			val.SetIntegerValue(ival);
+		} else if (num_tag == WIRE_REAL) {
+			double rval;
+			if ( ! getReal(rval)) return NULL;
+			val.SetRealValue(rval);
+		} else {
+			return NULL;
+		}
+		return Literal::MakeLiteral(val, (Value::NumberFactor)factor);
+	}
+
+	case WIRE_ATTRREF:
+	case WIRE_ATTRREF_ABS:
+	case WIRE_ATTRREF_SCOPED: {
+		ExprTree *scope = NULL;
+		if (tag == WIRE_ATTRREF_SCOPED && ! (scope = getExpr(depth + 1))) {
+			return NULL;
+		}
+		std::string name;
+		if ( ! getName(name)) {
+			delete scope;
+			return NULL;
+		}
+		return AttributeReference::MakeAttributeReference(scope, name, tag == WIRE_ATTRREF_ABS);
+	}
+
+	case WIRE_OP: {
+		unsigned char op, mask;
+		if ( ! getByte(op) || ! getByte(mask)) return NULL;
+		if (op < Operation::__FIRST_OP__ || op > Operation::__LAST_OP__) return NULL;
+		// only accept the shapes the parser produces
+		if (op == Operation::TERNARY_OP) {
+			if ((mask & 5) != 5) return NULL;
+		} else if (op == Operation::PARENTHESES_OP || op == Operation::UNARY_PLUS_OP || op == Operation::UNARY_MINUS_OP ||
+				op == Operation::LOGICAL_NOT_OP || op == Operation::BITWISE_NOT_OP) {
+			if (mask != 1) return NULL;
+		} else if (mask != 3) {
+			return NULL;
+		}
+		ExprTree *t[3] = { NULL, NULL, NULL };
+		for (int ii = 0; ii < 3; ++ii) {
+			if ((mask & (1 << ii)) && ! (t[ii] = getExpr(depth + 1))) {
+				delete t[0]; delete t[1];
+				return NULL;
+			}
+		}
+		return Operation::MakeOperation((Operation::OpKind)op, t[0], t[1], t[2]);
+	}
+
+	case WIRE_FNCALL: {
+		std::string name;
+		unsigned long long argc;
+		if ( ! getName(name) || ! getVarint(argc) || argc > (unsigned long long)(end - ptr)) return NULL;
+		std::vector<ExprTree*> args;
+		args.reserve((size_t)argc);
+		for (unsigned long long ii = 0; ii < argc; ++ii) {
+			ExprTree *arg = getExpr(depth + 1);
+			if ( ! arg) {
+				for (auto a : args) delete a;
+				return NULL;
+			}
+			args.push_back(arg);
+		}
+		return FunctionCall::MakeFunctionCall(name, args);
+	}
+
+	case WIRE_LIST: {
+		unsigned long long count;
+		if ( ! getVarint(count) || count > (unsigned long long)(end - ptr)) return NULL;
+		std::vector<ExprTree*> items;
+		items.reserve((size_t)count);
+		for (unsigned long long ii = 0; ii < count; ++ii) {
+			ExprTree *item = getExpr(depth + 1);
+			if ( ! item) {
+				for (auto i : items) delete i;
+				return NULL;
+			}
+			items.push_back(item);
+		}
+		return ExprList::MakeExprList(items);
+	}
+
+	case WIRE_CLASSAD: {
+		unsigned long long count;
+		if ( ! getVarint(count) || count > (unsigned long long)(end - ptr)) return NULL;
+		ClassAd *ad = new ClassAd();
+		for (unsigned long long ii = 0; ii < count; ++ii) {
+			std::string name;
+			ExprTree *item = NULL;
+			if ( ! getName(name) || ! (item = getExpr(depth + 1)) || ! ad->Insert(name, item)) {
+				delete item;
+				delete ad;
+				return NULL;
+			}
+		}
+		return ad;
+	}
+
+	case WIRE_TEXT: {
+		const char *str;
+		size_t len;
+		if ( ! getBytes(str, len)) return NULL;
+		return parser.ParseExpression(std::string(str, len), true);
+	}
+	}
+
+	return NULL;
+}
+
+bool ClassAdWireDecoder::getAttr(std::string & name, ExprTree * & expr)
+{
+	expr = NULL;
+	if ( ! getName(name)) {
+		return false;
+	}
+	expr = getExpr(0);
+	return expr != NULL;
+}
+
+bool ClassAdWireDecoder::getAd(ClassAd & ad, int num_attrs)
+{
+	std::string name;
+	for (int ii = 0; ii < num_attrs; ++ii) {
+		ExprTree *expr = NULL;
+		if ( ! getAttr(name, expr) || ! ad.Insert(name, expr)) {
+			delete expr;
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,170 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _CLASSAD_WIRE_H
+#define _CLASSAD_WIRE_H
+
+/*
+  A compact binary encoding of ClassAds, used by putClassAd() and
+  getClassAd() in place of "Attr = expr" text when the peer supports it.
+
+  Expressions are sent as a pre-order walk of the expression tree, so the
+  receiver rebuilds the tree directly instead of lexing and parsing text.
+  Literals are typed, integers are zig-zag varints, and attribute names can
+  be replaced by a reference to an earlier occurrence of the same name in
+  the same CEDAR message (see ClassAdWireDictionary).
+
+  On the socket, an ad in this form is
+      int     CLASSAD_WIRE_MARKER      (in place of the attribute count)
+      int     number of encoded attributes
+      int     number of bytes of encoded attributes
+      bytes   the encoded attributes
+      int     number of private attributes
+      secret  "Attr = expr" text of each private attribute
+  followed by the usual (empty) MyType and TargetType strings.
+*/
+
+#include "classad/classad_distribution.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Sent in place of the number of attributes.  A text ad never has a
+// negative count, so receivers can tell the two forms apart.
+#define CLASSAD_WIRE_MARKER (-0x434144)
+
+/** Attribute names seen so far in the current message.  The first time a
+	name is sent it is sent in full and both sides append it to their
+	dictionary, after that it is sent as its index.  Both sides must clear
+	the dictionary at the same point in the stream, so ReliSock clears it
+	at every message boundary.
+*/
+class ClassAdWireDictionary
+{
+public:
+	ClassAdWireDictionary() {}
+
+	void clear() { ids.clear(); names.clear(); }
+	size_t size() const { return names.size(); }
+
+	// sender side, returns the index of the name or -1 if it is not
+	// in the dictionary
+	int find(const std::string & name) const;
+	// sender side, returns the index given to the name
+	int add(const std::string & name);
+
+	// receiver side, fails if the sender has gone past MAX_ENTRIES
+	bool append(const char * name, size_t len) {
+		if (names.size() >= MAX_ENTRIES) return false;
+		names.emplace_back(name, len);
+		return true;
+	}
+	const std::string * at(size_t ix) const { return ix < names.size() ? &names[ix] : NULL; }
+
+	// don't grow the dictionary beyond this, names past it are sent in full
+	static const size_t MAX_ENTRIES = 4096;
+
+private:
+	std::unordered_map<std::string, int> ids;
+	std::vector<std::string> names;
+};
+
+/** Builds the encoded form of a set of attributes.
+*/
+class ClassAdWireEncoder
+{
+public:
+	// dict may be NULL, in which case every name is sent in full
+	explicit ClassAdWireEncoder(ClassAdWireDictionary * dict = NULL);
+
+	void clear() { buf.clear(); num_attrs = 0; }
+
+	// append one attribute
+	void putAttr(const std::string & name, const classad::ExprTree * expr);
+	// append every attribute of an ad (but not of its chained parent)
+	void putAd(const classad::ClassAd & ad);
+
+	int numAttrs() const { return num_attrs; }
+	const std::string & data() const { return buf; }
+
+private:
+	void putByte(unsigned char ch) { buf += (char)ch; }
+	void putVarint(unsigned long long val);
+	void putSigned(long long val);
+	void putReal(double val);
+	void putBytes(const char * data, size_t len);
+	void putName(const std::string & name);
+	void putExpr(const classad::ExprTree * expr);
+	void putValue(const classad::Value & val, classad::Value::NumberFactor factor);
+
+	ClassAdWireDictionary * dict;
+	std::string buf;
+	int num_attrs;
+	classad::ClassAdUnParser unparser;
+};
+
+/** Reads attributes from the encoded form.  Trees it hands out belong to
+	the caller.
+*/
+class ClassAdWireDecoder
+{
+public:
+	// dict may be NULL, in which case name references are an error
+	ClassAdWireDecoder(const char * data, size_t len, ClassAdWireDictionary * dict = NULL);
+
+	bool atEnd() const { return ptr >= end; }
+
+	// the largest encoded ad either side will handle, so that a bad header
+	// can't make the receiver allocate an arbitrary amount of memory
+	static const int MAX_AD_BYTES = 128 * 1024 * 1024;
+
+	// true if a header of num_attrs attributes in cb bytes is one that
+	// a well behaved sender could have sent
+	static bool headerOk(int num_attrs, int cb) {
+		// every attribute takes at least a byte for its name and one for its value
+		return num_attrs >= 0 && cb >= 0 && cb <= MAX_AD_BYTES && num_attrs <= cb / 2;
+	}
+
+	// read the next attribute
+	bool getAttr(std::string & name, classad::ExprTree * & expr);
+	// read num_attrs attributes into ad
+	bool getAd(classad::ClassAd & ad, int num_attrs);
+
+private:
+	bool getByte(unsigned char & ch);
+	bool getVarint(unsigned long long & val);
+	bool getSigned(long long & val);
+	bool getReal(double & val);
+	bool getBytes(const char * & data, size_t & len);
+	bool getName(std::string & name);
+	classad::ExprTree * getExpr(int depth);
+
+	const char * ptr;
+	const char * end;
+	ClassAdWireDictionary * dict;
+	classad::ClassAdParser parser;
+};
+
+/** Allow putClassAd() to send ads in the binary form to peers that
+	support it.  Set from ENABLE_CLASSAD_BINARY_ENCODING on reconfig.
+*/
+void ClassAdWireSetEnabled(bool enable);
+bool ClassAdWireEnabled();
+
+#endif
@@ -22,11 +22,13 @@
 
 #include "condor_classad.h"
 #include "classad_oldnew.h"
+#include "classad_wire.h"
 #include "condor_attributes.h"
 #include "classad/xmlSink.h"
 #include "condor_config.h"
 #include "condor_regex.h"
 #include "classad/classadCache.h"
+#include "classad/regexCache.h"
 #include "env.h"
 #include "condor_arglist.h"
 #define CLASSAD_USER_MAP_RETURNS_STRINGLIST 1
@@ -69,6 +71,10 @@ void ClassAdReconfig()
 	classad::SetOldClassAdSemantics( !ClassAd_strictEvaluation );
 
 	classad::ClassAdSetExpressionCaching( param_boolean( "ENABLE_CLASSAD_CACHING", false ) );
+	classad::ClassAdSetExpressionCompiling( param_boolean( "ENABLE_CLASSAD_COMPILING", false ) );
+	classad::ClassAdSetRegexCacheSize( param_integer( "CLASSAD_REGEX_CACHE_SIZE", 128, 0 ) );
+	classad::ClassAdSetRegexJIT( param_boolean( "CLASSAD_REGEX_JIT", false ) );
+	ClassAdWireSetEnabled( param_boolean( "ENABLE_CLASSAD_BINARY_ENCODING", true ) );
 
 	char *new_libs = param( "CLASSAD_USER_LIBS" );
 	if ( new_libs ) {
@@ -496,28 +502,29 @@ bool stringListRegexpMember_func( const char * /*name*/,
 		return true;
 	}
 
-	Regex r;
-	int errcode;
-	int errpos = 0;
-	bool valid;
 	uint32_t options = regexp_str_to_options(options_str.c_str());
 
 	/* can the pattern be compiled */
-	valid = r.compile(pattern_str.c_str(), &errcode, &errpos, options);
-	if (!valid) {
+	classad::RegexPtr re = classad::RegexCache::Acquire(pattern_str.c_str(), options);
+	if ( ! re) {
 		result.SetErrorValue();
 		return true;
 	}
 
 	result.SetBooleanValue( false );
 
+	const pcre2_code * re_code = static_cast<const pcre2_code *>(classad::RegexCache::Code(re));
+	pcre2_match_data * match_data = pcre2_match_data_create_from_pattern(re_code, NULL);
 	sl.rewind();
 	char *entry;
 	while( (entry = sl.next())) {
-		if (r.match(entry)) {
+		PCRE2_SPTR entry_pcre2str = reinterpret_cast<const unsigned char *>(entry);
+		if (pcre2_match(re_code, entry_pcre2str, strlen(entry), 0, 0, match_data, NULL) > 0) {
 			result.SetBooleanValue( true );
+			break;
 		}
 	}
+	pcre2_match_data_free(match_data);
 
 	return true;
 }
@@ -44,6 +44,13 @@ int ParseClassAdRvalExpr(const char*s, classad::ExprTree*&tree)
 	}
 }
 
+void PrepareClassAdParsingForThreads()
+{
+	classad::ExprTree *tree = NULL;
+	ParseClassAdRvalExpr("isUndefined(x)", tree);
+	delete tree;
+}
+
 bool ParseLongFormAttrValue(const char * str, std::string & attr, classad::ExprTree*&tree)
 {
 	const char * rhs = NULL;
@@ -256,6 +263,33 @@ bool ExprTreeIsAttrRef(classad::ExprTree * expr, std::string & attr, bool * is_a
 	return false;
 }
 
+bool ExprTreeIsPlainLiteral(classad::ExprTree * expr, classad::Value & value)
+{
+	expr = SkipExprParens(expr);
+	if ( ! expr || expr->GetKind() != classad::ExprTree::LITERAL_NODE) return false;
+
+	classad::Value::NumberFactor factor;
+	((classad::Literal*)expr)->GetComponents(value, factor);
+	return factor == classad::Value::NO_FACTOR;
+}
+
+bool ExprTreeIsMyAttrRef(classad::ExprTree * expr, std::string & attr)
+{
+	expr = SkipExprParens(expr);
+	if ( ! expr || expr->GetKind() != classad::ExprTree::ATTRREF_NODE) return false;
+
+	classad::ExprTree *scope = NULL;
+	bool absolute = false;
+	((classad::AttributeReference*)expr)->GetComponents(scope, attr, absolute);
+	if (absolute) return false;
+	if ( ! scope) return true;
+
+	std::string scope_name;
+	bool scope_absolute = false;
+	return ExprTreeIsAttrRef(scope, scope_name, &scope_absolute) &&
+		! scope_absolute && strcasecmp(scope_name.c_str(), "MY") == MATCH;
+}
+
 // returns true and appends the unparsed value of the given attribute
 // IFF the value might have $$() expansions in it
 // returns false if $$() is impossible (because int, etc).
@@ -27,6 +27,11 @@ bool ParseLongFormAttrValue(const char*str, std::string &attr, classad::ExprTree
 
 int ParseClassAdRvalExpr(const char*s, classad::ExprTree*&tree);
 
+// The function table of the classad library is filled in the first time a
+// function call is parsed.  Call this before starting threads that parse,
+// so they don't all try to fill it at once.
+void PrepareClassAdParsingForThreads();
+
 const char * ExprTreeToString( const classad::ExprTree *expr, std::string & buffer );
 const char * ExprTreeToString( const classad::ExprTree *expr );
 const char * ClassAdValueToString ( const classad::Value & value, std::string & buffer );
@@ -39,6 +44,11 @@ bool ExprTreeIsLiteralString(classad::ExprTree * expr, std::string & sval);
 bool ExprTreeIsLiteralString(classad::ExprTree * expr, const char* & cstr);
 bool ExprTreeIsLiteralBool(classad::ExprTree * expr, bool & bval);
 bool ExprTreeIsAttrRef(classad::ExprTree * expr, std::string & attr, bool * is_absolute=NULL);
+// like ExprTreeIsLiteral, but a number with a factor (like 4K) doesn't count,
+// since its value isn't the one an ad holding it would be compared with
+bool ExprTreeIsPlainLiteral(classad::ExprTree * expr, classad::Value & value);
+// true for a reference to an attribute of the ad itself, with no scope or MY.
+bool ExprTreeIsMyAttrRef(classad::ExprTree * expr, std::string & attr);
 bool ExprTreeMayDollarDollarExpand(classad::ExprTree *tree, std::string & unparsed);
 
 // returns true when the expression is a comparision between an attribute ref and a literal
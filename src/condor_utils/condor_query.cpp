@@ -396,7 +396,7 @@ CondorQuery::setLocationLookup(const std::string &location, bool want_one_result
 // process ads from the collector, handing each to the callback
 // callback will return 'false' if it took ownership of the ad.
 QueryResult CondorQuery::
-processAds (bool (*callback)(void*, ClassAd *), void* pv, const char * poolName, CondorError* errstack /*= NULL*/)
+processAds (bool (*callback)(void*, ClassAd *), void* pv, const char * poolName, CondorError* errstack /*= NULL*/, classad::ClassAdArena * arena /*= NULL*/)
 {
 	Sock*    sock; 
 	QueryResult result;
@@ -447,8 +447,14 @@ processAds (bool (*callback)(void*, ClassAd *), void* pv, const char * poolName,
 			return Q_COMMUNICATION_ERROR;
 		}
 		if (more) {
-			ClassAd * ad = new ClassAd;
-			if( !getClassAd(sock, *ad) ) {
+			ClassAd * ad;
+			bool got_ad;
+			{
+				classad::ClassAdArenaScope arena_scope(arena);
+				ad = new ClassAd;
+				got_ad = getClassAd(sock, *ad);
+			}
+			if( !got_ad ) {
 				sock->end_of_message();
 				delete ad;
 				delete sock;
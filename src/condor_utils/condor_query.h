@@ -159,7 +159,9 @@ class CondorQuery
 	QueryResult fetchAds (ClassAdList &adList, const char * pool, CondorError* errstack = NULL);
 	// fetch ads from the collector, handing each to 'callback'
 	// callback will return 'false' if it took ownership of the ad.
-	QueryResult processAds (bool (*callback)(void*, ClassAd *), void* pv, const char * pool, CondorError* errstack = NULL);
+	// if an arena is given, the ads are allocated from it and must be
+	// destroyed before it is.
+	QueryResult processAds (bool (*callback)(void*, ClassAd *), void* pv, const char * pool, CondorError* errstack = NULL, classad::ClassAdArena * arena = NULL);
 
 
 	// filter list of ads; arg1 is 'in', arg2 is 'out'
@@ -0,0 +1,401 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "epoll_selector.h"
+#include "condor_threads.h"
+#include "stl_string_utils.h"
+
+EpollSelector::EpollSelector()
+	: epfd(-1)
+	, epfd_pid(0)
+	, num_watching(0)
+	, timeout_wanted(false)
+	, state(Selector::VIRGIN)
+	, _select_retval(-2)
+	, _select_errno(0)
+{
+	timeout.tv_sec = timeout.tv_usec = 0;
+}
+
+EpollSelector::~EpollSelector()
+{
+	if ( epfd >= 0 ) {
+		close( epfd );
+	}
+}
+
+bool
+EpollSelector::init()
+{
+#ifdef CONDOR_HAVE_EPOLL
+	if ( epfd >= 0 ) {
+		return true;
+	}
+	epfd = epoll_create1( EPOLL_CLOEXEC );
+	if ( epfd < 0 ) {
+		dprintf( D_ALWAYS, "EpollSelector: epoll_create1() failed: %s (errno=%d)\n",
+				 strerror(errno), errno );
+		return false;
+	}
+	epfd_pid = getpid();
+	return true;
+#else
+	return false;
+#endif
+}
+
+void
+EpollSelector::disable( const char *why, int err )
+{
+	dprintf( D_ALWAYS, "EpollSelector: %s: %s (errno=%d)\n", why, strerror(err), err );
+	if ( epfd >= 0 ) {
+		close( epfd );
+		epfd = -1;
+	}
+}
+
+bool
+EpollSelector::usable()
+{
+	if ( epfd >= 0 && epfd_pid != getpid() ) {
+			// We're a forked child.  Closing our copy doesn't affect
+			// the parent's interest set.
+		close( epfd );
+		epfd = -1;
+	}
+	return epfd >= 0;
+}
+
+void
+EpollSelector::set_interest( int fd, int interests, int tag )
+{
+#ifdef CONDOR_HAVE_EPOLL
+	if ( fd < 0 || ! usable() ) {
+		return;
+	}
+	if ( fd >= (int)fds.size() ) {
+		FdState empty = { 0, -1, 0 };
+		fds.resize( fd + 1, empty );
+	}
+
+		// If the owner of this tag has a new fd, its old one may have been
+		// closed behind our back, in which case the kernel has forgotten
+		// it, and so must we.
+	if ( tag >= 0 ) {
+		if ( tag >= (int)tag_fds.size() ) {
+			tag_fds.resize( tag + 1, -1 );
+		}
+		int old_fd = tag_fds[tag];
+		if ( old_fd != fd && old_fd >= 0 && fds[old_fd].tag == tag ) {
+			forget_fd( old_fd );
+		}
+		tag_fds[tag] = fd;
+	}
+
+		// Likewise, an fd with a new owner may be a new file with the
+		// number of an old one, so tell the kernel about it again.
+	FdState &st = fds[fd];
+	bool new_owner = st.tag != tag;
+	st.tag = tag;
+	if ( st.interests == interests && ! new_owner ) {
+		return;
+	}
+	if ( st.interests == 0 && interests == 0 ) {
+		return;
+	}
+
+	struct epoll_event ev;
+	memset( &ev, 0, sizeof(ev) );
+	ev.data.fd = fd;
+	if ( interests & WANT_READ ) { ev.events |= EPOLLIN; }
+	if ( interests & WANT_WRITE ) { ev.events |= EPOLLOUT; }
+	if ( interests & WANT_EXCEPT ) { ev.events |= EPOLLPRI; }
+
+	if (IsDebugLevel(D_DAEMONCORE)) {
+		dprintf( D_DAEMONCORE | D_VERBOSE, "epoll selector watching fd %d for 0x%x (was 0x%x)\n",
+				 fd, interests, st.interests );
+	}
+
+	int rc;
+	if ( interests == 0 ) {
+		rc = epoll_ctl( epfd, EPOLL_CTL_DEL, fd, &ev );
+		if ( rc < 0 && (errno == ENOENT || errno == EBADF) ) {
+			rc = 0;
+		}
+	} else if ( st.interests == 0 ) {
+		rc = epoll_ctl( epfd, EPOLL_CTL_ADD, fd, &ev );
+		if ( rc < 0 && errno == EEXIST ) {
+			rc = epoll_ctl( epfd, EPOLL_CTL_MOD, fd, &ev );
+		}
+	} else {
+		rc = epoll_ctl( epfd, EPOLL_CTL_MOD, fd, &ev );
+		if ( rc < 0 && errno == ENOENT ) {
+			rc = epoll_ctl( epfd, EPOLL_CTL_ADD, fd, &ev );
+		}
+	}
+	if ( rc < 0 ) {
+		std::string msg;
+		formatstr( msg, "epoll_ctl() failed for fd %d", fd );
+		disable( msg.c_str(), errno );
+		return;
+	}
+
+	if ( st.interests == 0 ) {
+		num_watching++;
+	} else if ( interests == 0 ) {
+		num_watching--;
+	}
+	st.interests = interests;
+#else
+	if ( fd || interests || tag ) {}
+#endif
+}
+
+void
+EpollSelector::forget_fd( int fd )
+{
+#ifdef CONDOR_HAVE_EPOLL
+	if ( fd < 0 || fd >= (int)fds.size() ) {
+		return;
+	}
+	FdState &st = fds[fd];
+	if ( st.interests && usable() ) {
+		struct epoll_event ev;
+		memset( &ev, 0, sizeof(ev) );
+			// This fails if the fd has been closed already, which is fine.
+		IGNORE_RETURN epoll_ctl( epfd, EPOLL_CTL_DEL, fd, &ev );
+	}
+	if ( st.interests ) {
+		num_watching--;
+	}
+	st.interests = 0;
+	st.tag = -1;
+	st.revents = 0;
+#else
+	if ( fd ) {}
+#endif
+}
+
+void
+EpollSelector::set_timeout( time_t sec, long usec )
+{
+	timeout_wanted = true;
+
+	timeout.tv_sec = sec;
+	timeout.tv_usec = usec;
+}
+
+void
+EpollSelector::unset_timeout()
+{
+	timeout_wanted = false;
+}
+
+void
+EpollSelector::execute()
+{
+#ifdef CONDOR_HAVE_EPOLL
+	for ( int fd : ready ) {
+		fds[fd].revents = 0;
+	}
+	ready.clear();
+
+	if ( ! usable() ) {
+		_select_retval = -1;
+		_select_errno = EBADF;
+		state = Selector::FAILED;
+		return;
+	}
+
+	int timeout_ms = -1;
+	if ( timeout_wanted && timeout.tv_sec < INT_MAX / 1000 ) {
+		timeout_ms = (int)(timeout.tv_sec * 1000 + (timeout.tv_usec + 999) / 1000);
+	}
+
+		// room for every fd we watch, so one call reports them all
+	size_t max_events = num_watching > 0 ? num_watching : 1;
+	if ( events.size() < max_events ) {
+		events.resize( max_events );
+	}
+
+	start_thread_safe("select");
+	int nfds = epoll_wait( epfd, &events[0], (int)events.size(), timeout_ms );
+	_select_errno = errno;
+	stop_thread_safe("select");
+	_select_retval = nfds;
+
+	if ( nfds < 0 ) {
+		if ( _select_errno == EINTR ) {
+			state = Selector::SIGNALLED;
+			return;
+		}
+		state = Selector::FAILED;
+		return;
+	}
+	_select_errno = 0;
+
+	for ( int ix = 0; ix < nfds; ix++ ) {
+		int fd = events[ix].data.fd;
+		if ( fd < 0 || fd >= (int)fds.size() || fds[fd].interests == 0 ) {
+			continue;
+		}
+		if ( fds[fd].revents == 0 ) {
+			ready.push_back( fd );
+		}
+		fds[fd].revents |= events[ix].events;
+	}
+
+	state = ready.empty() ? Selector::TIMED_OUT : Selector::FDS_READY;
+#else
+	_select_retval = -1;
+	_select_errno = ENOSYS;
+	state = Selector::FAILED;
+#endif
+}
+
+int
+EpollSelector::select_retval() const
+{
+	return _select_retval;
+}
+
+int
+EpollSelector::select_errno() const
+{
+	return _select_errno;
+}
+
+bool
+EpollSelector::fd_ready( int fd, Selector::IO_FUNC interest )
+{
+	if( state != Selector::FDS_READY && state != Selector::TIMED_OUT ) {
+		EXCEPT(
+			"EpollSelector::fd_ready() called, but selector not in FDS_READY state"
+		);
+	}
+
+#ifdef CONDOR_HAVE_EPOLL
+	if ( fd < 0 || fd >= (int)fds.size() ) {
+		return false;
+	}
+	const FdState &st = fds[fd];
+
+		// errors and hangups are reported whatever we asked for, and
+		// select() would count them as readable and writable
+	switch( interest ) {
+
+	  case Selector::IO_READ:
+		return (st.interests & WANT_READ) && (st.revents & (EPOLLIN|EPOLLHUP|EPOLLERR));
+
+	  case Selector::IO_WRITE:
+		return (st.interests & WANT_WRITE) && (st.revents & (EPOLLOUT|EPOLLHUP|EPOLLERR));
+
+	  case Selector::IO_EXCEPT:
+		return (st.interests & WANT_EXCEPT) && (st.revents & (EPOLLPRI|EPOLLERR));
+
+	}
+#endif
+
+	return false;
+}
+
+bool
+EpollSelector::timed_out()
+{
+	return state == Selector::TIMED_OUT;
+}
+
+bool
+EpollSelector::signalled()
+{
+	return state == Selector::SIGNALLED;
+}
+
+bool
+EpollSelector::failed()
+{
+	return state == Selector::FAILED;
+}
+
+bool
+EpollSelector::has_ready()
+{
+	return state == Selector::FDS_READY;
+}
+
+void
+EpollSelector::display()
+{
+	switch( state ) {
+
+	  case Selector::VIRGIN:
+		dprintf( D_ALWAYS, "State = VIRGIN\n" );
+		break;
+
+	  case Selector::FDS_READY:
+		dprintf( D_ALWAYS, "State = FDS_READY\n" );
+		break;
+
+	  case Selector::TIMED_OUT:
+		dprintf( D_ALWAYS, "State = TIMED_OUT\n" );
+		break;
+
+	  case Selector::SIGNALLED:
+		dprintf( D_ALWAYS, "State = SIGNALLED\n" );
+		break;
+
+	  case Selector::FAILED:
+		dprintf( D_ALWAYS, "State = FAILED\n" );
+		break;
+	}
+
+	dprintf( D_ALWAYS, "epoll fd = %d, watching %d fds\n", epfd, num_watching );
+
+	const char *names[] = { "\tRead", "\tWrite", "\tExcept" };
+	for ( int want = 0; want < 3; want++ ) {
+		int count = 0;
+		dprintf( D_ALWAYS, "%s {", names[want] );
+		for ( int fd = 0; fd < (int)fds.size(); fd++ ) {
+			if ( fds[fd].interests & (1 << want) ) {
+				dprintf( D_ALWAYS | D_NOHEADER, "%d ", fd );
+				count++;
+			}
+		}
+		dprintf( D_ALWAYS | D_NOHEADER, "} = %d\n", count );
+	}
+
+	if( state == Selector::FDS_READY ) {
+		dprintf( D_ALWAYS, "Ready FD's {" );
+		for ( int fd : ready ) {
+			dprintf( D_ALWAYS | D_NOHEADER, "%d:0x%x ", fd, fds[fd].revents );
+		}
+		dprintf( D_ALWAYS | D_NOHEADER, "} = %d\n", (int)ready.size() );
+	}
+	if( timeout_wanted ) {
+		dprintf( D_ALWAYS,
+			"Timeout = %ld.%06ld seconds\n", (long) timeout.tv_sec,
+			(long) timeout.tv_usec
+		);
+	} else {
+		dprintf( D_ALWAYS, "Timeout not wanted\n" );
+	}
+}
@@ -0,0 +1,124 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#ifndef EPOLL_SELECTOR_H
+#define EPOLL_SELECTOR_H
+
+#include "condor_common.h"
+#include "selector.h"
+
+#include <vector>
+
+#ifdef CONDOR_HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+// Waits for activity on a set of file descriptors, like Selector, but
+// the set persists from one wait to the next.  Only changes to the
+// interest in an fd are passed to the kernel, and only the fds that are
+// ready are reported, so the cost of a wait does not grow with the number
+// of fds being watched.
+//
+// This uses level-triggered epoll, since the handlers we call need not
+// drain their fds.  Where epoll is not available, init() fails and the
+// caller should use a Selector instead.
+//
+// The epoll instance is shared with any child forked from this process.
+// So as not to change the parent's interest set, the child may not use it,
+// and usable() returns false there.
+class EpollSelector {
+public:
+	EpollSelector();
+	~EpollSelector();
+
+	enum INTEREST {
+		WANT_READ = 1, WANT_WRITE = 2, WANT_EXCEPT = 4
+	};
+
+		// Returns false if epoll can't be used.
+	bool init();
+
+		// Returns false if init() failed, if we are in a forked child, or
+		// if the kernel refused to watch one of our fds.  Once this
+		// returns false, it always will.
+	bool usable();
+
+		// Watch fd for the WANT_ bits in interests, or stop watching it
+		// if interests is 0.  The tag is handed back by ready_tag(); if
+		// it isn't -1, it should be a small index identifying the owner
+		// of the fd.  This only makes a system call if the interests or
+		// the owner changed.
+	void set_interest( int fd, int interests, int tag );
+
+		// Stop watching fd.  This must be called before an fd that is
+		// being watched is closed, since the kernel forgets about it then,
+		// and we would not know to watch a new fd with the same number.
+	void forget_fd( int fd );
+
+	void set_timeout( time_t sec, long usec = 0 );
+	void unset_timeout();
+	void execute();
+	int select_retval() const;
+	int select_errno() const;
+	bool has_ready();
+	bool timed_out();
+	bool signalled();
+	bool failed();
+
+		// Same as Selector::fd_ready()
+	bool fd_ready( int fd, Selector::IO_FUNC interest );
+
+		// The fds that are ready after execute(), in no particular order
+	int num_ready() const { return (int)ready.size(); }
+	int ready_fd( int ix ) const { return ready[ix]; }
+	int ready_tag( int ix ) const { return fds[ready[ix]].tag; }
+
+	int num_watched() const { return num_watching; }
+	void display();
+
+private:
+	EpollSelector(const EpollSelector &);
+	EpollSelector & operator=(const EpollSelector &);
+
+	void disable( const char *why, int err );
+
+	struct FdState {
+		int interests;       // what the kernel is watching for
+		int tag;
+		unsigned int revents;    // epoll events from the last execute()
+	};
+
+	int		epfd;
+	pid_t	epfd_pid;           // the process that created epfd
+	std::vector<FdState> fds;   // by fd
+	std::vector<int> ready;     // fds with revents set
+	std::vector<int> tag_fds;   // the last fd set for each tag
+#ifdef CONDOR_HAVE_EPOLL
+	std::vector<struct epoll_event> events;
+#endif
+	int		num_watching;
+	bool	timeout_wanted;
+	struct timeval	timeout;
+	Selector::SELECTOR_STATE	state;
+	int		_select_retval;
+	int		_select_errno;
+};
+
+#endif
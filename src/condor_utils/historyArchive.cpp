@@ -0,0 +1,759 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_classad.h"
+#include "compat_classad_util.h"
+#include "basename.h"
+#include "condor_fsync.h"
+#include "directory_util.h"
+#include "safe_open.h"
+#include "stl_string_utils.h"
+#include "util_lib_proto.h"	// for rotate_file
+
+#include "historyArchive.h"
+#include "historyIndex.h"
+
+#include <map>
+#include <unordered_map>
+
+// An archive is
+//
+//   magic
+//   blocks
+//   footer: number of blocks, then the offset and header length of each
+//   trailer: offset of the footer, magic
+//
+// and a block is a header, which has the number of ads, and for each
+// column its name, range and where its data is, followed by the data of
+// each column: the dictionary (a count and then the values), and the rows
+// as varints.  Numbers are in the byte order of the host.
+
+#define HISTORY_ARCHIVE_MAGIC "HISTARC1"
+#define HISTORY_ARCHIVE_MAGIC_LEN 8
+#define HISTORY_ARCHIVE_TRAILER_LEN (8 + HISTORY_ARCHIVE_MAGIC_LEN)
+
+static void putU32(std::string &buf, uint32_t val) { buf.append((const char *)&val, sizeof(val)); }
+static void putI64(std::string &buf, int64_t val) { buf.append((const char *)&val, sizeof(val)); }
+static void putString(std::string &buf, const std::string &str) { putU32(buf, (uint32_t)str.size()); buf += str; }
+static void putVarint(std::string &buf, uint32_t val)
+{
+	while (val >= 0x80) {
+		buf += (char)(val | 0x80);
+		val >>= 7;
+	}
+	buf += (char)val;
+}
+
+// Takes values off the front of a buffer read from an archive.  Once it
+// runs off the end, it returns zeros and ok() is false.
+class ArchiveCursor
+{
+public:
+	ArchiveCursor(const std::string &buf) : m_p(buf.data()), m_end(buf.data() + buf.size()), m_ok(true) {}
+	bool ok() const { return m_ok; }
+
+	uint8_t u8() { uint8_t val = 0; take(&val, sizeof(val)); return val; }
+	uint32_t u32() { uint32_t val = 0; take(&val, sizeof(val)); return val; }
+	int64_t i64() { int64_t val = 0; take(&val, sizeof(val)); return val; }
+	std::string str()
+	{
+		uint32_t len = u32();
+		if ( ! m_ok || len > (size_t)(m_end - m_p)) {
+			m_ok = false;
+			return "";
+		}
+		std::string val(m_p, len);
+		m_p += len;
+		return val;
+	}
+	uint32_t varint()
+	{
+		uint32_t val = 0;
+		for (int shift = 0; m_ok; shift += 7) {
+			if (m_p >= m_end || shift > 28) {
+				m_ok = false;
+				return 0;
+			}
+			uint8_t byte = (uint8_t)*m_p++;
+			val |= (uint32_t)(byte & 0x7f) << shift;
+			if ( ! (byte & 0x80)) {
+				break;
+			}
+		}
+		return val;
+	}
+
+private:
+	void take(void *dst, size_t len)
+	{
+		if ( ! m_ok || (size_t)(m_end - m_p) < len) {
+			m_ok = false;
+			return;
+		}
+		memcpy(dst, m_p, len);
+		m_p += len;
+	}
+
+	const char *m_p;
+	const char *m_end;
+	bool m_ok;
+};
+
+static bool
+readAt(int fd, int64_t offset, size_t len, std::string &buf)
+{
+	buf.resize(len);
+	if (lseek(fd, (off_t)offset, SEEK_SET) != (off_t)offset) {
+		return false;
+	}
+	return full_read(fd, &buf[0], len) == (ssize_t)len;
+}
+
+// Whether the text of a value is an integer, as the parser would read it
+static bool
+isIntegerText(const char *str, int64_t &val)
+{
+	const char *p = str;
+	if (*p == '-') { ++p; }
+	if ( ! isdigit(*p) || (*p == '0' && p[1])) {
+		return false;
+	}
+	size_t digits = 0;
+	for ( ; isdigit(*p); ++p) { ++digits; }
+	if (*p || digits > 18) {
+		return false;
+	}
+	val = strtoll(str, NULL, 10);
+	return true;
+}
+
+// --------------------------------------------------------------------------
+// Writing an archive
+// --------------------------------------------------------------------------
+
+namespace {
+
+struct ColumnBuilder {
+	explicit ColumnBuilder(const std::string &attr)
+		: name(attr), has_range(true), min(INT64_MAX), max(INT64_MIN) {}
+
+	std::string name;
+	std::unordered_map<std::string, uint32_t> ids;	// index of each value in dict
+	std::vector<const std::string *> dict;			// the keys of ids, in order
+	std::vector<uint32_t> rows;
+	bool has_range;
+	int64_t min;
+	int64_t max;
+};
+
+class ArchiveWriter
+{
+public:
+	explicit ArchiveWriter(int fd) : m_fd(fd), m_offset(0), m_num_ads(0) {}
+
+	bool start() { return write(HISTORY_ARCHIVE_MAGIC); }
+	void addAttr(const std::string &attr, const char *value);
+	bool endAd();
+	bool finish();
+
+private:
+	bool write(const std::string &buf);
+	bool writeBlock();
+
+	int m_fd;
+	int64_t m_offset;
+	uint32_t m_num_ads;		// in the current block
+	std::vector<std::unique_ptr<ColumnBuilder>> m_columns;
+	std::map<std::string, size_t, classad::CaseIgnLTStr> m_column_ids;
+	std::vector<std::pair<int64_t, uint32_t>> m_blocks;
+};
+
+}
+
+bool
+ArchiveWriter::write(const std::string &buf)
+{
+	if (full_write(m_fd, buf.data(), buf.size()) != (ssize_t)buf.size()) {
+		return false;
+	}
+	m_offset += buf.size();
+	return true;
+}
+
+void
+ArchiveWriter::addAttr(const std::string &attr, const char *value)
+{
+	size_t ix;
+	auto it = m_column_ids.find(attr);
+	if (it == m_column_ids.end()) {
+		ix = m_columns.size();
+		m_columns.emplace_back(new ColumnBuilder(attr));
+		m_column_ids[attr] = ix;
+	} else {
+		ix = it->second;
+	}
+	ColumnBuilder &column = *m_columns[ix];
+
+		// the ads before this one that didn't have it
+	column.rows.resize(m_num_ads, 0);
+
+	auto found = column.ids.emplace(value, (uint32_t)column.dict.size());
+	if (found.second) {
+		column.dict.push_back(&found.first->first);
+		int64_t val;
+		if (column.has_range && isIntegerText(value, val)) {
+			column.min = MIN(column.min, val);
+			column.max = MAX(column.max, val);
+		} else {
+			column.has_range = false;
+		}
+	}
+
+	uint32_t row = found.first->second + 1;
+	if (column.rows.size() > m_num_ads) {
+		column.rows[m_num_ads] = row;	// the ad has it twice, the last one wins
+	} else {
+		column.rows.push_back(row);
+	}
+}
+
+bool
+ArchiveWriter::endAd()
+{
+	if (++m_num_ads >= HISTORY_ARCHIVE_BLOCK_ADS) {
+		return writeBlock();
+	}
+	return true;
+}
+
+bool
+ArchiveWriter::writeBlock()
+{
+	if (m_num_ads == 0) {
+		return true;
+	}
+
+		// the column data starts after the header, so size it first
+	uint32_t header_length = 2 * sizeof(uint32_t);
+	for (auto & column : m_columns) {
+		header_length += sizeof(uint32_t) + column->name.size() + 1 + 2 * sizeof(int64_t) + 3 * sizeof(uint32_t);
+	}
+
+	std::string header, data;
+	putU32(header, m_num_ads);
+	putU32(header, (uint32_t)m_columns.size());
+	for (auto & column : m_columns) {
+		column->rows.resize(m_num_ads, 0);
+
+		size_t start = data.size();
+		putU32(data, (uint32_t)column->dict.size());
+		for (auto value : column->dict) {
+			putString(data, *value);
+		}
+		size_t dict_length = data.size() - start;
+		for (auto row : column->rows) {
+			putVarint(data, row);
+		}
+		size_t rows_length = data.size() - start - dict_length;
+
+		putString(header, column->name);
+		header += (char)(column->has_range ? 1 : 0);
+		putI64(header, column->has_range ? column->min : 0);
+		putI64(header, column->has_range ? column->max : 0);
+		putU32(header, (uint32_t)(header_length + start));
+		putU32(header, (uint32_t)dict_length);
+		putU32(header, (uint32_t)rows_length);
+	}
+	ASSERT(header.size() == header_length);
+
+	m_blocks.emplace_back(m_offset, header_length);
+	if ( ! write(header) || ! write(data)) {
+		return false;
+	}
+
+	m_columns.clear();
+	m_column_ids.clear();
+	m_num_ads = 0;
+	return true;
+}
+
+bool
+ArchiveWriter::finish()
+{
+	if ( ! writeBlock()) {
+		return false;
+	}
+
+	int64_t footer_offset = m_offset;
+	std::string footer;
+	putU32(footer, (uint32_t)m_blocks.size());
+	for (auto & block : m_blocks) {
+		putI64(footer, block.first);
+		putU32(footer, block.second);
+	}
+	putI64(footer, footer_offset);
+	footer += HISTORY_ARCHIVE_MAGIC;
+	return write(footer);
+}
+
+bool
+ArchiveHistoryFile(const char *history_file, std::string &errmsg)
+{
+	if (HistoryArchiveReader::IsArchive(history_file)) {
+		return true;
+	}
+
+	FILE *in = safe_fopen_wrapper_follow(history_file, "r");
+	if ( ! in) {
+		formatstr(errmsg, "cannot open %s: %s", history_file, strerror(errno));
+		return false;
+	}
+	struct stat read_st;
+	if (fstat(fileno(in), &read_st) != 0) {
+		formatstr(errmsg, "cannot stat %s: %s", history_file, strerror(errno));
+		fclose(in);
+		return false;
+	}
+
+	std::string tmp_name;
+	dircat(condor_dirname(history_file).c_str(), ".", tmp_name);
+	tmp_name += condor_basename(history_file);
+	tmp_name += ".arc.tmp";
+	int fd = safe_open_wrapper_follow(tmp_name.c_str(),
+		O_WRONLY|O_CREAT|O_TRUNC|O_LARGEFILE|_O_BINARY|_O_NOINHERIT, 0644);
+	if (fd < 0) {
+		formatstr(errmsg, "cannot create %s: %s", tmp_name.c_str(), strerror(errno));
+		fclose(in);
+		return false;
+	}
+
+	// Each ad is its lines of attr = value, then a banner.  The values are
+	// kept as they are, so an ad read back from the archive is the ad that
+	// would have been read from the file.
+	ArchiveWriter writer(fd);
+	bool ok = writer.start();
+	bool in_ad = false;
+	std::string line, attr;
+	while (ok && readLine(line, in)) {
+		chomp(line);
+		if (starts_with(line, "***")) {
+			if (in_ad) {
+				ok = writer.endAd();
+				in_ad = false;
+			}
+			continue;
+		}
+		const char *p = line.c_str();
+		while (*p == ' ' || *p == '\t') ++p;
+		const char *rhs = NULL;
+		if ( ! *p || *p == '#' || ! SplitLongFormAttrValue(p, attr, rhs)) {
+			continue;
+		}
+		writer.addAttr(attr, rhs);
+		in_ad = true;
+	}
+	if (ok && in_ad) {
+		ok = writer.endAd();
+	}
+	if (ok) {
+		ok = writer.finish();
+	}
+	if ( ! ok) {
+		formatstr(errmsg, "cannot write %s: %s", tmp_name.c_str(), strerror(errno));
+	}
+		// the archive replaces the only copy of the history, so it must be
+		// on disk before the rename is
+	if (ok && condor_fdatasync(fd) < 0) {
+		formatstr(errmsg, "fsync of %s failed: %s", tmp_name.c_str(), strerror(errno));
+		ok = false;
+	}
+	if (close(fd) != 0 && ok) {
+		formatstr(errmsg, "cannot write %s: %s", tmp_name.c_str(), strerror(errno));
+		ok = false;
+	}
+
+		// the history file may have been rotated away or written to while
+		// we worked; it must still be the file we read, all of it
+	if (ok) {
+		struct stat now_st;
+		if ( ! feof(in) || stat(history_file, &now_st) != 0 ||
+			read_st.st_dev != now_st.st_dev || read_st.st_ino != now_st.st_ino ||
+			read_st.st_size != now_st.st_size) {
+			formatstr(errmsg, "%s was changed or removed", history_file);
+			ok = false;
+		}
+	}
+	if (ok && rotate_file(tmp_name.c_str(), history_file) != 0) {
+		formatstr(errmsg, "cannot rename %s to %s", tmp_name.c_str(), history_file);
+		ok = false;
+	}
+	fclose(in);
+	if ( ! ok) {
+		unlink(tmp_name.c_str());
+		return false;
+	}
+
+		// POSIX makes no promise that a rename is durable until the
+		// directory is synced
+#ifndef WIN32
+	std::string parent_dir = condor_dirname(history_file);
+	int parent_fd = safe_open_wrapper_follow(parent_dir.c_str(), O_RDONLY);
+	if (parent_fd < 0 || condor_fsync(parent_fd) < 0) {
+		dprintf(D_ALWAYS, "WARNING: cannot fsync directory %s after archiving %s: %s\n",
+			parent_dir.c_str(), history_file, strerror(errno));
+	}
+	if (parent_fd >= 0) {
+		close(parent_fd);
+	}
+#endif
+
+		// the offsets in the index are no longer any use
+	unlink(HistoryIndexFileName(history_file).c_str());
+	return true;
+}
+
+// --------------------------------------------------------------------------
+// Reading an archive
+// --------------------------------------------------------------------------
+
+bool
+HistoryArchiveReader::IsArchive(const char *filename)
+{
+	int fd = safe_open_wrapper_follow(filename, O_RDONLY|O_LARGEFILE|_O_BINARY, 0);
+	if (fd < 0) {
+		return false;
+	}
+	char magic[HISTORY_ARCHIVE_MAGIC_LEN];
+	bool is_archive = full_read(fd, magic, sizeof(magic)) == (ssize_t)sizeof(magic) &&
+		memcmp(magic, HISTORY_ARCHIVE_MAGIC, sizeof(magic)) == 0;
+	::close(fd);
+	return is_archive;
+}
+
+void
+HistoryArchiveReader::close()
+{
+	if (m_fd >= 0) {
+		::close(m_fd);
+		m_fd = -1;
+	}
+	m_blocks.clear();
+}
+
+bool
+HistoryArchiveReader::open(const char *filename)
+{
+	close();
+	m_fd = safe_open_wrapper_follow(filename, O_RDONLY|O_LARGEFILE|_O_BINARY, 0);
+	if (m_fd < 0) {
+		return false;
+	}
+
+	struct stat si;
+	std::string buf;
+	bool ok = fstat(m_fd, &si) == 0 &&
+		si.st_size >= HISTORY_ARCHIVE_MAGIC_LEN + HISTORY_ARCHIVE_TRAILER_LEN &&
+		readAt(m_fd, 0, HISTORY_ARCHIVE_MAGIC_LEN, buf) &&
+		buf == HISTORY_ARCHIVE_MAGIC &&
+		readAt(m_fd, si.st_size - HISTORY_ARCHIVE_TRAILER_LEN, HISTORY_ARCHIVE_TRAILER_LEN, buf);
+	int64_t footer_offset = 0;
+	if (ok) {
+		ArchiveCursor trailer(buf);
+		footer_offset = trailer.i64();
+		ok = buf.compare(8, HISTORY_ARCHIVE_MAGIC_LEN, HISTORY_ARCHIVE_MAGIC) == 0 &&
+			footer_offset >= HISTORY_ARCHIVE_MAGIC_LEN &&
+			footer_offset <= si.st_size - HISTORY_ARCHIVE_TRAILER_LEN;
+	}
+	if (ok) {
+		ok = readAt(m_fd, footer_offset, si.st_size - HISTORY_ARCHIVE_TRAILER_LEN - footer_offset, buf);
+	}
+	if (ok) {
+		ArchiveCursor footer(buf);
+		uint32_t num_blocks = footer.u32();
+		for (uint32_t ix = 0; ix < num_blocks && footer.ok(); ++ix) {
+			int64_t offset = footer.i64();
+			uint32_t header_length = footer.u32();
+			m_blocks.emplace_back(offset, header_length);
+		}
+		ok = footer.ok();
+	}
+	if ( ! ok) {
+		close();
+		errno = EINVAL;
+		return false;
+	}
+	return true;
+}
+
+bool
+HistoryArchiveReader::readBlock(size_t ix, HistoryArchiveBlock &block)
+{
+	block.columns.clear();
+	block.num_ads = 0;
+	if (ix >= m_blocks.size()) {
+		return false;
+	}
+	block.offset = m_blocks[ix].first;
+
+	std::string buf;
+	if ( ! readAt(m_fd, block.offset, m_blocks[ix].second, buf)) {
+		return false;
+	}
+	ArchiveCursor header(buf);
+	block.num_ads = header.u32();
+	uint32_t num_columns = header.u32();
+	for (uint32_t cx = 0; cx < num_columns && header.ok(); ++cx) {
+		block.columns.emplace_back();
+		HistoryArchiveColumn &column = block.columns.back();
+		column.name = header.str();
+		column.has_range = header.u8() != 0;
+		column.min = header.i64();
+		column.max = header.i64();
+		column.data_offset = header.u32();
+		column.dict_length = header.u32();
+		column.rows_length = header.u32();
+		column.loaded = false;
+	}
+	return header.ok();
+}
+
+bool
+HistoryArchiveReader::loadColumn(HistoryArchiveBlock &block, HistoryArchiveColumn &column)
+{
+	if (column.loaded) {
+		return true;
+	}
+
+	std::string buf;
+	if ( ! readAt(m_fd, block.offset + column.data_offset, column.dict_length + column.rows_length, buf)) {
+		return false;
+	}
+	ArchiveCursor data(buf);
+	uint32_t num_values = data.u32();
+	for (uint32_t ix = 0; ix < num_values && data.ok(); ++ix) {
+		column.dict.push_back(data.str());
+	}
+	column.rows.reserve(block.num_ads);
+	for (uint32_t ix = 0; ix < block.num_ads && data.ok(); ++ix) {
+		uint32_t row = data.varint();
+		if (row > column.dict.size()) {
+			return false;
+		}
+		column.rows.push_back(row);
+	}
+	if ( ! data.ok()) {
+		return false;
+	}
+	column.exprs.resize(column.dict.size());
+	column.loaded = true;
+	return true;
+}
+
+// The value of a loaded column, parsed the first time it is wanted
+static classad::ExprTree *
+columnExpr(HistoryArchiveColumn &column, uint32_t ix)
+{
+	if ( ! column.exprs[ix]) {
+		classad::ClassAdParser parser;
+		parser.SetOldClassAd(true);
+		column.exprs[ix].reset(parser.ParseExpression(column.dict[ix]));
+	}
+	return column.exprs[ix].get();
+}
+
+HistoryArchiveColumn *
+HistoryArchiveReader::findColumn(HistoryArchiveBlock &block, const std::string &attr)
+{
+	for (auto & column : block.columns) {
+		if (strcasecmp(column.name.c_str(), attr.c_str()) == MATCH) {
+			return &column;
+		}
+	}
+	return NULL;
+}
+
+bool
+HistoryArchiveReader::loadColumns(HistoryArchiveBlock &block, const classad::References *attrs)
+{
+	if ( ! attrs) {
+		for (auto & column : block.columns) {
+			if ( ! loadColumn(block, column)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::vector<HistoryArchiveColumn *> pending;
+	for (auto & attr : *attrs) {
+		HistoryArchiveColumn *column = findColumn(block, attr);
+		if (column) {
+			pending.push_back(column);
+		}
+	}
+
+	// A value may refer to other attributes of the ad, and evaluating or
+	// printing it needs those too.
+	std::set<HistoryArchiveColumn *> seen;
+	ClassAd empty;
+	while ( ! pending.empty()) {
+		HistoryArchiveColumn *column = pending.back();
+		pending.pop_back();
+		if ( ! seen.insert(column).second) {
+			continue;
+		}
+		if ( ! loadColumn(block, *column)) {
+			return false;
+		}
+		for (uint32_t ix = 0; ix < column->dict.size(); ++ix) {
+			classad::ExprTree *tree = columnExpr(*column, ix);
+			if ( ! tree || tree->GetKind() == classad::ExprTree::LITERAL_NODE) {
+				continue;
+			}
+			classad::References refs;
+			GetExprReferences(tree, empty, &refs, &refs);
+			for (auto & ref : refs) {
+				HistoryArchiveColumn *other = findColumn(block, ref);
+				if (other && ! seen.count(other)) {
+					pending.push_back(other);
+				}
+			}
+		}
+	}
+	return true;
+}
+
+void
+HistoryArchiveReader::getAd(HistoryArchiveBlock &block, uint32_t row, ClassAd &ad)
+{
+	for (auto & column : block.columns) {
+		if ( ! column.loaded || row >= column.rows.size() || column.rows[row] == 0) {
+			continue;
+		}
+		classad::ExprTree *tree = columnExpr(column, column.rows[row] - 1);
+		if (tree) {
+			ad.Insert(column.name, tree->Copy());
+		}
+	}
+}
+
+bool
+HistoryArchiveReader::mightMatch(HistoryArchiveBlock &block, classad::ExprTree *tree)
+{
+	tree = SkipExprParens(tree);
+	if ( ! tree || tree->GetKind() != classad::ExprTree::OP_NODE) {
+		return true;
+	}
+	classad::Operation::OpKind op;
+	classad::ExprTree *t1, *t2, *t3;
+	((classad::Operation *)tree)->GetComponents(op, t1, t2, t3);
+	if (op == classad::Operation::LOGICAL_AND_OP) {
+		return mightMatch(block, t1) && mightMatch(block, t2);
+	}
+	if (op == classad::Operation::LOGICAL_OR_OP) {
+		return mightMatch(block, t1) || mightMatch(block, t2);
+	}
+	return comparisonMightMatch(block, tree);
+}
+
+// Whether an attribute of the ad compared with a number or a string literal
+// might be true for an ad of the block.
+bool
+HistoryArchiveReader::comparisonMightMatch(HistoryArchiveBlock &block, classad::ExprTree *tree)
+{
+	classad::Operation::OpKind op;
+	classad::ExprTree *t1, *t2, *t3;
+	((classad::Operation *)tree)->GetComponents(op, t1, t2, t3);
+
+	std::string attr;
+	classad::Value val;
+	if (ExprTreeIsMyAttrRef(t1, attr) && ExprTreeIsPlainLiteral(t2, val)) {
+		// attr op literal
+	} else if (ExprTreeIsMyAttrRef(t2, attr) && ExprTreeIsPlainLiteral(t1, val)) {
+			// literal op attr, so turn it around
+		switch (op) {
+		case classad::Operation::LESS_THAN_OP: op = classad::Operation::GREATER_THAN_OP; break;
+		case classad::Operation::LESS_OR_EQUAL_OP: op = classad::Operation::GREATER_OR_EQUAL_OP; break;
+		case classad::Operation::GREATER_THAN_OP: op = classad::Operation::LESS_THAN_OP; break;
+		case classad::Operation::GREATER_OR_EQUAL_OP: op = classad::Operation::LESS_OR_EQUAL_OP; break;
+		default: break;
+		}
+	} else {
+		return true;
+	}
+
+	bool is_equal = (op == classad::Operation::EQUAL_OP || op == classad::Operation::META_EQUAL_OP);
+	if ( ! is_equal &&
+		op != classad::Operation::LESS_THAN_OP && op != classad::Operation::LESS_OR_EQUAL_OP &&
+		op != classad::Operation::GREATER_THAN_OP && op != classad::Operation::GREATER_OR_EQUAL_OP) {
+		return true;
+	}
+
+	long long ival = 0;
+	double num = 0;
+	std::string str;
+	bool is_number = val.IsIntegerValue(ival) || val.IsRealValue(num);
+	if (val.IsIntegerValue(ival)) {
+		num = (double)ival;
+	}
+	if ( ! is_number && ! val.IsStringValue(str)) {
+		return true;
+	}
+
+		// an attribute no ad in the block has compares as undefined
+	HistoryArchiveColumn *column = findColumn(block, attr);
+	if ( ! column) {
+		return false;
+	}
+
+	if (is_number) {
+		if ( ! column->has_range) {
+			return true;
+		}
+		double lo = (double)column->min;
+		double hi = (double)column->max;
+		switch (op) {
+		case classad::Operation::LESS_THAN_OP: return lo < num;
+		case classad::Operation::LESS_OR_EQUAL_OP: return lo <= num;
+		case classad::Operation::GREATER_THAN_OP: return hi > num;
+		case classad::Operation::GREATER_OR_EQUAL_OP: return hi >= num;
+		default: return num >= lo && num <= hi;
+		}
+	}
+
+		// a string, which we look for in the dictionary
+	if ( ! is_equal || ! loadColumn(block, *column)) {
+		return true;
+	}
+	for (uint32_t ix = 0; ix < column->dict.size(); ++ix) {
+		classad::Value value;
+		std::string value_str;
+		classad::ExprTree *value_tree = columnExpr(*column, ix);
+		if ( ! value_tree || ! ExprTreeIsPlainLiteral(value_tree, value) || ! value.IsStringValue(value_str)) {
+			return true;
+		}
+		if (op == classad::Operation::META_EQUAL_OP ? value_str == str
+				: strcasecmp(value_str.c_str(), str.c_str()) == MATCH) {
+			return true;
+		}
+	}
+	return false;
+}
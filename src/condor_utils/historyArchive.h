@@ -0,0 +1,115 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _HISTORY_ARCHIVE_H_
+#define _HISTORY_ARCHIVE_H_
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "condor_classad.h"
+
+// A rotated history file can be turned into an archive, which holds the
+// same ads in much less space, and can be searched without parsing all
+// of them.
+//
+// The ads are kept in blocks of up to HISTORY_ARCHIVE_BLOCK_ADS, in the
+// order they were in the history file.  Within a block each attribute is
+// a column: a dictionary of the distinct values it has in the block, as
+// the text of the expressions, and for each ad which of them it has, if
+// any.  The columns of a block are read separately, so a search only reads
+// and parses the attributes it looks at.  For a column whose values are
+// all integers, the block also has their range, so that a search can pass
+// over the blocks where the ranges rule out a match.
+//
+// The archive of a history file replaces it under the same name, so it is
+// found, rotated and deleted just as the history file was.
+
+#define HISTORY_ARCHIVE_BLOCK_ADS 1024
+
+struct HistoryArchiveColumn {
+	std::string name;
+	bool has_range;			// all values are integers, from min to max
+	int64_t min;
+	int64_t max;
+	uint32_t data_offset;	// of the column in the block
+	uint32_t dict_length;	// the dictionary, then the rows
+	uint32_t rows_length;
+
+		// filled in when the column is loaded
+	bool loaded;
+	std::vector<std::string> dict;
+	std::vector<uint32_t> rows;		// 1 + index into dict, or 0 if the ad hasn't got it
+	std::vector<std::unique_ptr<classad::ExprTree>> exprs;	// dict, parsed
+};
+
+struct HistoryArchiveBlock {
+	int64_t offset;			// of the block in the archive
+	uint32_t num_ads;
+	std::vector<HistoryArchiveColumn> columns;
+};
+
+// Turn a history file into an archive, in place.  Returns false, and
+// leaves the file as it was, on failure.
+bool ArchiveHistoryFile(const char *history_file, std::string &errmsg);
+
+class HistoryArchiveReader
+{
+public:
+	HistoryArchiveReader() : m_fd(-1) {}
+	~HistoryArchiveReader() { close(); }
+
+		// Whether the file is an archive rather than a history file of text
+	static bool IsArchive(const char *filename);
+
+	bool open(const char *filename);	// sets errno on failure
+	void close();
+
+	size_t numBlocks() const { return m_blocks.size(); }
+	bool readBlock(size_t ix, HistoryArchiveBlock &block);
+
+		// Whether any ad in the block might make the expression true,
+		// going by the ranges and dictionaries of the columns that it
+		// compares with literals.
+	bool mightMatch(HistoryArchiveBlock &block, classad::ExprTree *expr);
+
+		// Load the given columns of the block, and those their values
+		// refer to, or all of them if attrs is NULL.
+	bool loadColumns(HistoryArchiveBlock &block, const classad::References *attrs);
+
+		// Put the values of the loaded columns for one ad of the block
+		// into the given ad.
+	void getAd(HistoryArchiveBlock &block, uint32_t row, ClassAd &ad);
+
+private:
+	HistoryArchiveReader(const HistoryArchiveReader &);
+	HistoryArchiveReader & operator=(const HistoryArchiveReader &);
+
+	bool loadColumn(HistoryArchiveBlock &block, HistoryArchiveColumn &column);
+	HistoryArchiveColumn *findColumn(HistoryArchiveBlock &block, const std::string &attr);
+	bool comparisonMightMatch(HistoryArchiveBlock &block, classad::ExprTree *tree);
+
+	int m_fd;
+	std::vector<std::pair<int64_t, uint32_t>> m_blocks;	// offset and length of the header
+};
+
+#endif
@@ -0,0 +1,576 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_attributes.h"
+#include "condor_classad.h"
+#include "basename.h"
+#include "directory_util.h"
+#include "safe_open.h"
+#include "stl_string_utils.h"
+
+#include "historyIndex.h"
+
+#include <algorithm>
+
+#define HISTORY_INDEX_MAGIC "HISTIDX"
+#define HISTORY_INDEX_VERSION 1
+#define HISTORY_INDEX_SUMMARY_MARKER -1
+
+struct HistoryIndexHeader {
+	char magic[8];
+	int32_t version;
+	int32_t block_size;
+};
+
+static_assert(sizeof(HistoryIndexEntry) == sizeof(HistoryIndexSummary),
+	"history index entries and summaries must be the same size");
+static const int RECORD_SIZE = sizeof(HistoryIndexEntry);
+
+std::string
+HistoryIndexFileName(const char *history_file)
+{
+	std::string name;
+	dircat(condor_dirname(history_file).c_str(), ".", name);
+	name += condor_basename(history_file);
+	name += ".idx";
+	return name;
+}
+
+uint32_t
+HistoryIndexOwnerHash(const char *owner)
+{
+	if ( ! owner || ! *owner) {
+		return 0;
+	}
+		// FNV-1a, so that it is the same for every reader
+	uint32_t hash = 2166136261u;
+	for (const char *p = owner; *p; ++p) {
+		hash ^= (unsigned char)tolower((unsigned char)*p);
+		hash *= 16777619u;
+	}
+	return hash ? hash : 1;
+}
+
+static bool
+readRecords(int fd, int64_t first, int64_t count, void *buf)
+{
+	off_t pos = (off_t)(sizeof(HistoryIndexHeader) + first * RECORD_SIZE);
+	size_t len = (size_t)(count * RECORD_SIZE);
+	if (lseek(fd, pos, SEEK_SET) != pos) {
+		return false;
+	}
+	return full_read(fd, buf, len) == (ssize_t)len;
+}
+
+static bool
+readHeader(int fd, HistoryIndexHeader &header, int64_t &records)
+{
+	struct stat si;
+	if (fstat(fd, &si) != 0 || si.st_size < (off_t)sizeof(header)) {
+		return false;
+	}
+	if (lseek(fd, 0, SEEK_SET) != 0 ||
+		full_read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+		return false;
+	}
+	if (memcmp(header.magic, HISTORY_INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+		header.version != HISTORY_INDEX_VERSION || header.block_size <= 0) {
+		return false;
+	}
+		// a record being written by the schedd doesn't count yet
+	records = (si.st_size - (int64_t)sizeof(header)) / RECORD_SIZE;
+	return true;
+}
+
+// --------------------------------------------------------------------------
+// Writing the index
+// --------------------------------------------------------------------------
+
+HistoryIndexWriter::HistoryIndexWriter()
+	: m_fd(-1)
+	, m_block_size(HISTORY_INDEX_BLOCK_SIZE)
+	, m_in_block(0)
+	, m_next_offset(0)
+{
+	startSummary();
+}
+
+void
+HistoryIndexWriter::close()
+{
+	if (m_fd >= 0) {
+		::close(m_fd);
+		m_fd = -1;
+	}
+}
+
+void
+HistoryIndexWriter::abandon(const char *history_file)
+{
+	close();
+	std::string filename = HistoryIndexFileName(history_file);
+	if (unlink(filename.c_str()) != 0 && errno != ENOENT) {
+		dprintf(D_ALWAYS, "Failed to remove history index %s: %s\n",
+			filename.c_str(), strerror(errno));
+	}
+}
+
+void
+HistoryIndexWriter::startSummary()
+{
+	m_summary.marker = HISTORY_INDEX_SUMMARY_MARKER;
+	m_summary.min_cluster = INT32_MAX;
+	m_summary.max_cluster = INT32_MIN;
+	m_summary.min_completion = INT64_MAX;
+	m_summary.max_completion = INT64_MIN;
+}
+
+// Pick up where the index we just opened left off.  Returns false if
+// it isn't a history index.
+bool
+HistoryIndexWriter::load()
+{
+	HistoryIndexHeader header;
+	int64_t records = 0;
+	if ( ! readHeader(m_fd, header, records)) {
+		return false;
+	}
+	m_block_size = header.block_size;
+	m_in_block = (int)(records % (m_block_size + 1));
+	m_next_offset = 0;
+	startSummary();
+
+	std::vector<HistoryIndexEntry> entries;
+	if (m_in_block > 0) {
+		entries.resize(m_in_block);
+		if ( ! readRecords(m_fd, records - m_in_block, m_in_block, entries.data())) {
+			return false;
+		}
+	} else if (records > 0) {
+			// the last record is a summary, so the entry before it is the last
+		entries.resize(1);
+		if ( ! readRecords(m_fd, records - 2, 1, entries.data())) {
+			return false;
+		}
+	}
+	for (auto & entry : entries) {
+		if (entry.offset == HISTORY_INDEX_SUMMARY_MARKER) {
+			return false;
+		}
+		if (m_in_block > 0) {
+			m_summary.min_cluster = MIN(m_summary.min_cluster, entry.cluster);
+			m_summary.max_cluster = MAX(m_summary.max_cluster, entry.cluster);
+			m_summary.min_completion = MIN(m_summary.min_completion, entry.completion);
+			m_summary.max_completion = MAX(m_summary.max_completion, entry.completion);
+		}
+		m_next_offset = entry.offset + entry.length;
+	}
+
+	// O_APPEND puts the new records at the end
+	return true;
+}
+
+bool
+HistoryIndexWriter::open(const char *history_file, int64_t history_size)
+{
+	std::string filename = HistoryIndexFileName(history_file);
+
+	m_fd = safe_open_wrapper_follow(filename.c_str(),
+		O_RDWR|O_APPEND|O_LARGEFILE|_O_BINARY|_O_NOINHERIT, 0644);
+	if (m_fd >= 0) {
+		if (load() && m_next_offset == history_size) {
+			return true;
+		}
+		dprintf(D_ALWAYS, "History index %s does not match %s, removing it\n",
+			filename.c_str(), history_file);
+		abandon(history_file);
+	}
+
+		// an index has to cover the whole of its history file, so we
+		// can only start one for a new file.
+	if (history_size != 0) {
+		return false;
+	}
+
+	m_fd = safe_open_wrapper_follow(filename.c_str(),
+		O_RDWR|O_CREAT|O_TRUNC|O_APPEND|O_LARGEFILE|_O_BINARY|_O_NOINHERIT, 0644);
+	if (m_fd < 0) {
+		dprintf(D_ALWAYS, "Failed to create history index %s: %s\n",
+			filename.c_str(), strerror(errno));
+		return false;
+	}
+
+	HistoryIndexHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, HISTORY_INDEX_MAGIC, sizeof(header.magic));
+	header.version = HISTORY_INDEX_VERSION;
+	header.block_size = HISTORY_INDEX_BLOCK_SIZE;
+	if (full_write(m_fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+		dprintf(D_ALWAYS, "Failed to write history index %s: %s\n",
+			filename.c_str(), strerror(errno));
+		abandon(history_file);
+		return false;
+	}
+	m_block_size = header.block_size;
+	m_in_block = 0;
+	m_next_offset = 0;
+	startSummary();
+	return true;
+}
+
+bool
+HistoryIndexWriter::append(const char *history_file, HistoryIndexEntry &entry)
+{
+	if (m_fd < 0 && ! open(history_file, entry.offset)) {
+		return false;
+	}
+	if (entry.offset != m_next_offset) {
+		dprintf(D_ALWAYS, "History index of %s is out of step with it, removing it\n",
+			history_file);
+		abandon(history_file);
+		return false;
+	}
+
+	m_summary.min_cluster = MIN(m_summary.min_cluster, entry.cluster);
+	m_summary.max_cluster = MAX(m_summary.max_cluster, entry.cluster);
+	m_summary.min_completion = MIN(m_summary.min_completion, entry.completion);
+	m_summary.max_completion = MAX(m_summary.max_completion, entry.completion);
+
+	char buf[2 * RECORD_SIZE];
+	size_t len = RECORD_SIZE;
+	memcpy(buf, &entry, RECORD_SIZE);
+	if (++m_in_block == m_block_size) {
+		memcpy(buf + RECORD_SIZE, &m_summary, RECORD_SIZE);
+		len += RECORD_SIZE;
+	}
+	if (full_write(m_fd, buf, len) != (ssize_t)len) {
+		dprintf(D_ALWAYS, "Failed to write history index of %s: %s\n",
+			history_file, strerror(errno));
+		abandon(history_file);
+		return false;
+	}
+
+	m_next_offset = entry.offset + entry.length;
+	if (m_in_block == m_block_size) {
+		m_in_block = 0;
+		startSummary();
+	}
+	return true;
+}
+
+// --------------------------------------------------------------------------
+// Reading the index
+// --------------------------------------------------------------------------
+
+static bool
+readIndex(int fd, int64_t history_size,
+	const std::function<bool(const HistoryIndexSummary &)> &skip_block,
+	std::vector<HistoryIndexBlock> &blocks)
+{
+	HistoryIndexHeader header;
+	int64_t records = 0;
+	if ( ! readHeader(fd, header, records)) {
+		return false;
+	}
+
+	// The history file may have grown since the caller looked at its size,
+	// so the entries for any ads after that are left out.
+	const int64_t per_block = header.block_size + 1;
+	int64_t next_offset = 0;
+	bool done = false;
+	for (int64_t first = 0; first < records && ! done; first += per_block) {
+		blocks.emplace_back();
+		HistoryIndexBlock &block = blocks.back();
+		block.skipped = false;
+		block.has_summary = (records - first) >= per_block;
+		int64_t count = block.has_summary ? header.block_size : (records - first);
+
+		if (block.has_summary) {
+			if ( ! readRecords(fd, first + header.block_size, 1, &block.summary) ||
+				block.summary.marker != HISTORY_INDEX_SUMMARY_MARKER) {
+				return false;
+			}
+			if (skip_block && skip_block(block.summary)) {
+					// we still need to know where the block ends
+				HistoryIndexEntry last;
+				if ( ! readRecords(fd, first + count - 1, 1, &last)) {
+					return false;
+				}
+				if (last.offset + last.length <= history_size) {
+					block.skipped = true;
+					next_offset = last.offset + last.length;
+					continue;
+				}
+			}
+		}
+
+		block.entries.resize(count);
+		if ( ! readRecords(fd, first, count, block.entries.data())) {
+			return false;
+		}
+		for (size_t ix = 0; ix < block.entries.size(); ++ix) {
+			const HistoryIndexEntry &entry = block.entries[ix];
+			if (entry.offset + entry.length > history_size) {
+				block.entries.resize(ix);
+				done = true;
+				break;
+			}
+			if (entry.offset != next_offset || entry.length <= 0) {
+				return false;
+			}
+			next_offset = entry.offset + entry.length;
+		}
+	}
+
+	return next_offset == history_size;
+}
+
+bool
+ReadHistoryIndex(const char *history_file, int history_fd,
+	const std::function<bool(const HistoryIndexSummary &)> &skip_block,
+	std::vector<HistoryIndexBlock> &blocks)
+{
+	blocks.clear();
+
+	struct stat si;
+	if (fstat(history_fd, &si) != 0) {
+		return false;
+	}
+
+	std::string filename = HistoryIndexFileName(history_file);
+	int fd = safe_open_wrapper_follow(filename.c_str(), O_RDONLY|O_LARGEFILE|_O_BINARY, 0);
+	if (fd < 0) {
+		return false;
+	}
+	bool ok = readIndex(fd, si.st_size, skip_block, blocks);
+	close(fd);
+	if ( ! ok) {
+		dprintf(D_FULLDEBUG, "History index %s does not cover %s, not using it\n",
+			filename.c_str(), history_file);
+		blocks.clear();
+	}
+	return ok;
+}
+
+// Whether tree is attr == literal, either way around
+static bool
+isAttrEqualsLiteral(classad::ExprTree *tree, const char *attr, classad::Value &val)
+{
+	tree = SkipExprParens(tree);
+	if ( ! tree || tree->GetKind() != classad::ExprTree::OP_NODE) { return false; }
+	classad::Operation::OpKind op;
+	classad::ExprTree *t1, *t2, *t3;
+	((classad::Operation *)tree)->GetComponents(op, t1, t2, t3);
+	if (op != classad::Operation::EQUAL_OP && op != classad::Operation::META_EQUAL_OP) { return false; }
+	std::string name;
+	if ( ! (ExprTreeIsAttrRef(t1, name) && ExprTreeIsLiteral(t2, val)) &&
+		! (ExprTreeIsAttrRef(t2, name) && ExprTreeIsLiteral(t1, val))) {
+		return false;
+	}
+	return strcasecmp(name.c_str(), attr) == MATCH;
+}
+
+bool
+HistoryIndexSearchTerms(classad::ExprTree *tree, std::set<int> &clusters, std::set<uint32_t> &owners)
+{
+	tree = SkipExprParens(tree);
+	if ( ! tree) { return false; }
+	if (tree->GetKind() == classad::ExprTree::OP_NODE) {
+		classad::Operation::OpKind op;
+		classad::ExprTree *t1, *t2, *t3;
+		((classad::Operation *)tree)->GetComponents(op, t1, t2, t3);
+		if (op == classad::Operation::LOGICAL_OR_OP) {
+			return HistoryIndexSearchTerms(t1, clusters, owners) && HistoryIndexSearchTerms(t2, clusters, owners);
+		}
+		if (op == classad::Operation::LOGICAL_AND_OP) {
+			// either side will do, such as the cluster of a cluster.proc
+			std::set<int> c;
+			std::set<uint32_t> o;
+			if ( ! HistoryIndexSearchTerms(t1, c, o)) {
+				c.clear(); o.clear();
+				if ( ! HistoryIndexSearchTerms(t2, c, o)) { return false; }
+			}
+			clusters.insert(c.begin(), c.end());
+			owners.insert(o.begin(), o.end());
+			return true;
+		}
+	}
+	classad::Value val;
+	long long num = 0;
+	std::string str;
+	if (isAttrEqualsLiteral(tree, ATTR_CLUSTER_ID, val) && val.IsIntegerValue(num) && num > 0 && num <= INT_MAX) {
+		clusters.insert((int)num);
+		return true;
+	}
+	if (isAttrEqualsLiteral(tree, ATTR_OWNER, val) && val.IsStringValue(str)) {
+		owners.insert(HistoryIndexOwnerHash(str.c_str()));
+		return true;
+	}
+	return false;
+}
+
+// Whether the ad of an index entry might be one the search wants.  Like the
+// banner of the ad, an entry with no cluster or owner might be.
+static bool
+entryWanted(const HistoryIndexEntry &entry, const HistoryIndexSearch &search)
+{
+	if ( ! search.clusters.empty() && (entry.cluster <= 0 || search.clusters.count(entry.cluster))) { return true; }
+	if ( ! search.owners.empty() && (entry.owner_hash == 0 || search.owners.count(entry.owner_hash))) { return true; }
+	return false;
+}
+
+// Whether -since only looks at what the index knows of an ad
+static bool
+sinceUsesIndexedAttrs(classad::ExprTree *since)
+{
+	ClassAd ad;
+	classad::References refs;
+	GetExprReferences(since, ad, &refs, &refs);
+	for (auto& attr : refs) {
+		if (strcasecmp(attr.c_str(), ATTR_CLUSTER_ID) != MATCH &&
+			strcasecmp(attr.c_str(), ATTR_PROC_ID) != MATCH &&
+			strcasecmp(attr.c_str(), ATTR_COMPLETION_DATE) != MATCH) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Whether -since is true of the ad of an index entry: 1 if so, 0 if not,
+// and -1 if the ad must be read to know.
+static int
+sinceMatchesEntry(const HistoryIndexEntry &entry, classad::ExprTree *since)
+{
+	if (entry.cluster < 0 || entry.proc < 0 || entry.completion < 0) { return -1; }
+	ClassAd ad;
+	ad.InsertAttr(ATTR_CLUSTER_ID, entry.cluster);
+	ad.InsertAttr(ATTR_PROC_ID, entry.proc);
+	ad.InsertAttr(ATTR_COMPLETION_DATE, entry.completion);
+	return EvalExprBool(&ad, since) ? 1 : 0;
+}
+
+// Read the ad of an index entry into its banner line and its lines, last
+// line first, as the backwards reader leaves them.
+static bool
+readEntryAd(int fd, const HistoryIndexEntry &entry, std::string &banner, std::vector<std::string> &lines)
+{
+	std::string text(entry.length, '\0');
+	if (lseek(fd, (off_t)entry.offset, SEEK_SET) != (off_t)entry.offset ||
+		full_read(fd, &text[0], text.size()) != (ssize_t)text.size()) {
+		return false;
+	}
+
+	banner.clear();
+	lines.clear();
+	size_t pos = 0;
+	while (pos < text.size()) {
+		size_t eol = text.find('\n', pos);
+		if (eol == std::string::npos) { eol = text.size(); }
+		std::string line = text.substr(pos, eol - pos);
+		pos = eol + 1;
+		if ( ! line.empty() && line.back() == '\r') { line.pop_back(); }
+
+		if (starts_with(line.c_str(), "*** ")) {
+			banner = line;
+			break;
+		}
+		const char * psz = line.c_str();
+		while (*psz == ' ' || *psz == '\t') ++psz;
+		if (*psz && *psz != '#') {
+			lines.push_back(line);
+		}
+	}
+	std::reverse(lines.begin(), lines.end());
+
+	// the banner ends the record
+	return ! banner.empty() && pos >= text.size();
+}
+
+bool
+SearchHistoryIndex(const char *history_file, const HistoryIndexSearch &search,
+	const std::function<bool(HistoryIndexHit &)> &found)
+{
+	if (search.clusters.empty() && search.owners.empty()) {
+		return false;
+	}
+	if (search.since && ! sinceUsesIndexedAttrs(search.since)) {
+		return false;
+	}
+
+	int fd = safe_open_wrapper_follow(history_file, O_RDONLY | O_LARGEFILE | _O_BINARY, 0);
+	if (fd < 0) {
+		return false;
+	}
+
+	// Without an owner to look for, blocks with none of the clusters can be skipped
+	std::function<bool(const HistoryIndexSummary &)> skip_block;
+	if (search.owners.empty() && ! search.since) {
+		skip_block = [&search](const HistoryIndexSummary &summary) {
+			if (summary.min_cluster <= 0) { return false; }
+			auto it = search.clusters.lower_bound(summary.min_cluster);
+			return it == search.clusters.end() || *it > summary.max_cluster;
+		};
+	}
+
+	std::vector<HistoryIndexBlock> blocks;
+	if ( ! ReadHistoryIndex(history_file, fd, skip_block, blocks)) {
+		close(fd);
+		return false;
+	}
+
+	HistoryIndexHit hit;
+	bool done = false;
+	size_t num_blocks = blocks.size();
+	for (size_t bx = 0; bx < num_blocks && !done; ++bx) {
+		HistoryIndexBlock &block = blocks[search.backwards ? num_blocks - 1 - bx : bx];
+		if (block.skipped) {
+			hit.kind = HistoryIndexHit::PASSED;
+			memset(&hit.entry, 0, sizeof(hit.entry));
+			hit.entry.cluster = hit.entry.proc = -1;
+			hit.entry.completion = block.summary.min_completion;
+			done = found(hit);
+			continue;
+		}
+
+		size_t num_entries = block.entries.size();
+		for (size_t ex = 0; ex < num_entries && !done; ++ex) {
+			hit.entry = block.entries[search.backwards ? num_entries - 1 - ex : ex];
+			int since = search.since ? sinceMatchesEntry(hit.entry, search.since) : 0;
+			if (since > 0) {
+				hit.kind = HistoryIndexHit::SINCE;
+				found(hit);
+				done = true;
+			} else if (since == 0 && ! entryWanted(hit.entry, search)) {
+				hit.kind = HistoryIndexHit::PASSED;
+				done = found(hit);
+			} else if ( ! readEntryAd(fd, hit.entry, hit.banner, hit.lines)) {
+				hit.kind = HistoryIndexHit::BAD;
+				done = found(hit);
+			} else {
+				hit.kind = HistoryIndexHit::AD;
+				done = found(hit);
+			}
+		}
+	}
+
+	close(fd);
+	return true;
+}
@@ -0,0 +1,164 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _HISTORY_INDEX_H_
+#define _HISTORY_INDEX_H_
+
+#include <stdint.h>
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace classad { class ExprTree; }
+
+// A history file may have a sidecar index, written by AppendHistory() as
+// each ad is appended, so that a reader looking for particular jobs can
+// go straight to their ads instead of parsing the whole file.
+//
+// The index is a header followed by fixed size records, one entry per ad
+// in the order of the ads in the file.  After each block of entries comes
+// a summary of the range of ClusterIds and CompletionDates in it, so that
+// a reader can step over the blocks that can't hold what it wants.
+//
+// The index of /path/history is /path/.history.idx, so that it doesn't look
+// like a rotated history file, and it is rotated and deleted along with
+// its history file.  An index is only started for an empty history file,
+// and is removed if it ever falls out of step with it, so an index that
+// exists covers the whole of its history file.
+
+#define HISTORY_INDEX_BLOCK_SIZE 64
+
+struct HistoryIndexEntry {
+	int64_t offset;			// of the ad in the history file
+	int32_t length;			// of the ad and its banner
+	int32_t cluster;		// -1 if the ad has none, as for the others
+	int32_t proc;
+	uint32_t owner_hash;	// 0 if the ad has no Owner
+	int64_t completion;
+};
+
+struct HistoryIndexSummary {
+	int64_t marker;			// where an entry has its offset
+	int32_t min_cluster;
+	int32_t max_cluster;
+	int64_t min_completion;
+	int64_t max_completion;
+};
+
+// The entries of one block of the index, or just its summary if the
+// reader skipped it.  The last block may not be complete, in which
+// case it has no summary yet, and all of its entries are read.
+struct HistoryIndexBlock {
+	bool skipped;
+	bool has_summary;
+	HistoryIndexSummary summary;
+	std::vector<HistoryIndexEntry> entries;
+};
+
+// Name of the index of the given history file
+std::string HistoryIndexFileName(const char *history_file);
+
+// Hash of an Owner for the index, which ignores case as == does
+uint32_t HistoryIndexOwnerHash(const char *owner);
+
+// Adds the entries for a history file as its ads are appended
+class HistoryIndexWriter
+{
+public:
+	HistoryIndexWriter();
+	~HistoryIndexWriter() { close(); }
+
+		// Add the entry of an ad just appended to the history file, whose
+		// offset is the size of the file before.  Opens or starts the
+		// index as needed.  Returns false if the history file can't be
+		// indexed, in which case any index it had is removed.
+	bool append(const char *history_file, HistoryIndexEntry &entry);
+
+		// Stop indexing the history file, and remove its index
+	void abandon(const char *history_file);
+
+	void close();
+
+private:
+	HistoryIndexWriter(const HistoryIndexWriter &);
+	HistoryIndexWriter & operator=(const HistoryIndexWriter &);
+
+	bool open(const char *history_file, int64_t history_size);
+	bool load();
+	void startSummary();
+
+	int m_fd;
+	int m_block_size;
+	int m_in_block;			// entries in the current block
+	int64_t m_next_offset;	// of the next ad in the history file
+	HistoryIndexSummary m_summary;	// of the current block
+};
+
+// Reads the index of a history file, which must be open as history_fd.
+// Returns false if there is no index, or it doesn't cover the file as it
+// is now, in which case the file must be read the slow way.
+//
+// A complete block is skipped if skip_block returns true for its summary.
+bool ReadHistoryIndex(const char *history_file, int history_fd,
+	const std::function<bool(const HistoryIndexSummary &)> &skip_block,
+	std::vector<HistoryIndexBlock> &blocks);
+
+// What a search of a history file through its index is looking for: the
+// ads of some clusters or owners, and with -since, the first ad to stop at.
+struct HistoryIndexSearch {
+	std::set<int> clusters;
+	std::set<uint32_t> owners;			// by HistoryIndexOwnerHash()
+	classad::ExprTree *since = nullptr;	// checked against every ad
+	bool backwards = true;
+};
+
+// Find the clusters and owners that a constraint limits the ads to, as the
+// one sent to the schedd for "condor_history 123 alice" does.  Returns false
+// if it doesn't, in which case any ad might match.
+bool HistoryIndexSearchTerms(classad::ExprTree *constraint,
+	std::set<int> &clusters, std::set<uint32_t> &owners);
+
+// An ad of the history file, as the search comes to it
+struct HistoryIndexHit {
+	enum Kind {
+		AD,			// an ad that may be wanted, which has been read
+		PASSED,		// an ad that isn't wanted, or a block of them
+		SINCE,		// the ad that -since is true of
+		BAD,		// an ad that couldn't be read
+	} kind;
+		// For a block passed over, the cluster and proc are -1, and the
+		// completion date is the earliest in the block.
+	HistoryIndexEntry entry;
+	std::string banner;
+	std::vector<std::string> lines;		// last line first
+};
+
+// Search a history file through its index, calling found for each ad in
+// turn until it returns true, or -since is true of an ad.  The ads that
+// may be wanted are read, the others are only passed on, so found must
+// still check them against its constraint and -since.  This finds what
+// reading the whole file (backwards, unless told otherwise) would.
+//
+// Returns false without calling found if the file has no index that can
+// be used, or -since looks at attributes that the index doesn't have.
+bool SearchHistoryIndex(const char *history_file, const HistoryIndexSearch &search,
+	const std::function<bool(HistoryIndexHit &)> &found);
+
+#endif
@@ -104,20 +104,49 @@ bool ActualScheddQ::Connect(DCSchedd & MySchedd, CondorError & errstack) {
 bool ActualScheddQ::disconnect(bool commit_transaction, CondorError & errstack) {
 	bool rval = false;
 	if (qmgr) {
-		rval = DisconnectQ(qmgr, commit_transaction, &errstack);
+		if (end_JobAds(&errstack) < 0) {
+			commit_transaction = false;
+		}
+		rval = DisconnectQ(qmgr, commit_transaction, &errstack) && commit_transaction;
 	}
 	qmgr = NULL;
+	job_ads_cluster = -1;
 	return rval;
 }
 
-int ActualScheddQ::get_NewCluster(CondorError & errstack) { return NewCluster(&errstack); }
-int ActualScheddQ::get_NewProc(int cluster_id) { return NewProc(cluster_id); }
-int ActualScheddQ::destroy_Cluster(int cluster_id, const char *reason) { return DestroyCluster(cluster_id, reason); }
+// finish sending job ads (if we are), so that we can make some other qmgmt call
+int ActualScheddQ::end_JobAds(CondorError * errstack) {
+	if ( ! sending_job_ads) return 0;
+	sending_job_ads = false;
+	return EndSendJobAds(errstack, "Submit");
+}
+
+int ActualScheddQ::get_NewCluster(CondorError & errstack) {
+	if (end_JobAds(&errstack) < 0) return -1;
+	int cluster_id = NewCluster(&errstack);
+	job_ads_cluster = -1;
+	if (cluster_id > 0 && has_send_job_ads()) {
+		job_ads_cluster = cluster_id;
+		job_ads_next_proc = 0;
+	}
+	return cluster_id;
+}
+int ActualScheddQ::get_NewProc(int cluster_id) {
+	// when sending job ads, the schedd creates the proc when it gets the proc ad
+	if (cluster_id == job_ads_cluster) {
+		return job_ads_next_proc++;
+	}
+	return NewProc(cluster_id);
+}
+int ActualScheddQ::destroy_Cluster(int cluster_id, const char *reason) {
+	if (end_JobAds() < 0) return -1;
+	return DestroyCluster(cluster_id, reason);
+}
 
 int ActualScheddQ::init_capabilities() {
 	int rval = 0;
 	if (! tried_to_get_capabilities) {
-		if (!GetScheddCapabilites(0, capabilities)) {
+		if (end_JobAds() < 0 || !GetScheddCapabilites(0, capabilities)) {
 			rval = -1;
 		}
 		tried_to_get_capabilities = true;
@@ -140,9 +169,17 @@ int ActualScheddQ::init_capabilities() {
 			use_jobsets = false;
 		}
 		//has_jobsets = use_jobsets;
+		has_job_ads = false;
+		if ( ! capabilities.LookupBool("SendJobAds", has_job_ads)) {
+			has_job_ads = false;
+		}
 	}
 	return rval;
 }
+bool ActualScheddQ::has_send_job_ads() {
+	init_capabilities();
+	return has_job_ads;
+}
 bool ActualScheddQ::has_send_jobset(int &ver) {
 	init_capabilities();
 	ver = jobsets_ver;
@@ -190,6 +227,7 @@ int ActualScheddQ::get_ExtendedHelp(std::string &content) {
 	if (has_extended_help(content)) {
 		content.clear();
 		ClassAd ad;
+		if (end_JobAds() < 0) return 0;
 		GetScheddCapabilites(GetsScheddCapabilities_F_HELPTEXT, ad);
 		ad.LookupString("ExtendedSubmitHelp", content);
 	}
@@ -198,17 +236,32 @@ int ActualScheddQ::get_ExtendedHelp(std::string &content) {
 
 
 int ActualScheddQ::set_Attribute(int cluster, int proc, const char *attr, const char *value, SetAttributeFlags_t flags) {
+	if (end_JobAds() < 0) return -1;
 	return SetAttribute(cluster, proc, attr, value, flags);
 }
 
 int ActualScheddQ::set_AttributeInt(int cluster, int proc, const char *attr, int value, SetAttributeFlags_t flags) {
+	if (end_JobAds() < 0) return -1;
 	return SetAttributeInt(cluster, proc, attr, value, flags);
 }
 
 int ActualScheddQ::set_Factory(int cluster, int qnum, const char * filename, const char * text) {
+	if (end_JobAds() < 0) return -1;
 	return SetJobFactory(cluster, qnum, filename, text);
 }
 
+int ActualScheddQ::send_JobAd(const JOB_ID_KEY & key, const classad::ClassAd & ad, SetAttributeFlags_t flags) {
+	if (key.cluster != job_ads_cluster) {
+		errno = EINVAL;
+		return -1;
+	}
+	if ( ! sending_job_ads) {
+		if (BeginSendJobAds(key.cluster, flags) < 0) return -1;
+		sending_job_ads = true;
+	}
+	return SendJobAd(key, ad);
+}
+
 // helper function used as 3rd argument to SendMaterializeData.
 // it treats pv as a pointer to SubmitForeachArgs, calls next() on it and then formats the
 // resulting rowdata for SendMaterializeData to use.  This could be a free function
@@ -248,6 +301,7 @@ int ActualScheddQ::set_Factory(int cluster, int qnum, const char * filename, con
 
 int ActualScheddQ::send_Itemdata(int cluster_id, SubmitForeachArgs & o)
 {
+	if (end_JobAds() < 0) return -1;
 	if (o.items.number() > 0) {
 		int row_count = 0;
 		o.items.rewind();
@@ -266,6 +320,7 @@ int ActualScheddQ::send_Jobset(int cluster_id, const ClassAd * jobset_ad)
 {
 	// JOBSET_TODO: error handling ?
 	if (jobset_ad) {
+		if (end_JobAds() < 0) return -1;
 		return SendJobsetAd(cluster_id, *jobset_ad, 0);
 	}
 	return 0;
@@ -277,6 +332,9 @@ int ActualScheddQ::set_Foreach(int cluster, int itemnum, const char * filename,
 }
 */
 
-int ActualScheddQ::send_SpoolFile(char const *filename) { return SendSpoolFile(filename); }
+int ActualScheddQ::send_SpoolFile(char const *filename) {
+	if (end_JobAds() < 0) return -1;
+	return SendSpoolFile(filename);
+}
 int ActualScheddQ::send_SpoolFileBytes(char const *filename) { return SendSpoolFileBytes(filename); }
 
@@ -25,6 +25,10 @@ public:
 	virtual int set_Factory(int cluster, int qnum, const char * filename, const char * text) = 0;
 	virtual int send_Itemdata(int cluster, SubmitForeachArgs & o) = 0;
 	virtual int send_Jobset(int cluster, const ClassAd * jobset_ad) = 0;
+	// send the cluster ad or a proc ad as part of a stream of ads, rather than as a series of set_Attribute calls.
+	// only valid when has_send_job_ads(), in which case get_NewProc does not create the proc, sending its ad does.
+	virtual bool has_send_job_ads() = 0;
+	virtual int send_JobAd(const JOB_ID_KEY & key, const classad::ClassAd & ad, SetAttributeFlags_t flags) = 0;
 
 	// helper function used as 3rd argument to SendMaterializeData.
 	// it treats pv as a pointer to SubmitForeachArgs, calls next() on it and then formats the
@@ -47,6 +51,7 @@ public:
 	ActualScheddQ() : qmgr(NULL)
 		, tried_to_get_capabilities(false), has_late(false), allows_late(false), late_ver(0)
 		, has_jobsets(false), use_jobsets(false), jobsets_ver(0)
+		, has_job_ads(false), job_ads_cluster(-1), job_ads_next_proc(0), sending_job_ads(false)
 	{}
 	virtual ~ActualScheddQ();
 	virtual int get_NewCluster(CondorError & errstack);
@@ -68,6 +73,8 @@ public:
 	virtual int set_Factory(int cluster, int qnum, const char * filename, const char * text);
 	virtual int send_Itemdata(int cluster, SubmitForeachArgs & o);
 	virtual int send_Jobset(int cluster, const ClassAd * jobset_ad);
+	virtual bool has_send_job_ads();
+	virtual int send_JobAd(const JOB_ID_KEY & key, const classad::ClassAd & ad, SetAttributeFlags_t flags);
 
 	bool Connect(DCSchedd & MySchedd, CondorError & errstack);
 private:
@@ -80,5 +87,10 @@ private:
 	bool has_jobsets;
 	bool use_jobsets;
 	char jobsets_ver;
+	bool has_job_ads;      // schedd has the SendJobAds capability
+	int job_ads_cluster;   // cluster whose procs are created by send_JobAd, or -1
+	int job_ads_next_proc;
+	bool sending_job_ads;  // between BeginSendJobAds and EndSendJobAds
 	int init_capabilities();
+	int end_JobAds(CondorError * errstack = NULL);
 };
\ No newline at end of file
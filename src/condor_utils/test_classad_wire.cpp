@@ -0,0 +1,573 @@
+/***************************************************************
+ *
+ * Copyright (C) 2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ * 
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// Compares the cost of sending ClassAds as "Attr = expr" text with the
+// binary encoding in classad_wire.h.  Every ad is also checked to survive
+// the binary round trip unchanged, and the limits a receiver puts on binary
+// ads are checked, so a failure exits non-zero.
+//
+//   test_classad_wire [-verbose] [-iterations <n>] [-batch <n>] [<file> ...]
+//
+// Each file holds one or more long form ads separated by blank lines.
+// With no files, a startd ad and a job ad captured from real pools are used.
+
+#include "condor_common.h"
+#include "condor_attributes.h"
+
+#include "classad/classad_distribution.h"
+#include "compat_classad.h"
+#include "classad_wire.h"
+#include "match_prefix.h"
+#include "stl_string_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+static int dash_verbose = 0;
+
+static const char startd_ad[] =
+	"Activity = \"Busy\"\n"
+	"Arch = \"X86_64\"\n"
+	"AuthenticatedIdentity = \"unauthenticated@unmapped\"\n"
+	"CanHibernate = true\n"
+	"CheckpointPlatform = \"LINUX X86_64 2.6.x normal 0x2aaaaaaab000 ssse3 sse4_1 sse4_2\"\n"
+	"ClientMachine = \"ingwe.cs.wisc.edu\"\n"
+	"ClockDay = 5\n"
+	"ClockMin = 819\n"
+	"COLLECTOR_HOST_STRING = \"ingwe.cs.wisc.edu:0\"\n"
+	"CondorLoadAvg = 0.0\n"
+	"CondorPlatform = \"$CondorPlatform: X86_64-RedHat_6.5 $\"\n"
+	"CondorVersion = \"$CondorVersion: 8.2.6 Dec 02 2014 BuildID: UW_development PRE-RELEASE-UWCS $\"\n"
+	"ConsoleIdle = 14681389\n"
+	"CpuBusy = ((LoadAvg - CondorLoadAvg) >= 0.5)\n"
+	"CpuBusyTime = 0\n"
+	"CpuIsBusy = false\n"
+	"Cpus = 1\n"
+	"CurrentRank = 0.0\n"
+	"CurrentTime = time()\n"
+	"DaemonCoreDutyCycle = 0.003355423233666999\n"
+	"DaemonStartTime = 1417808328\n"
+	"DetectedCpus = 8\n"
+	"DetectedMemory = 15940\n"
+	"Disk = 65736940\n"
+	"EnteredCurrentActivity = 1417808369\n"
+	"EnteredCurrentState = 1417808369\n"
+	"ExecutableSize = 1\n"
+	"ExpectedMachineGracefulDrainingBadput = 605\n"
+	"ExpectedMachineGracefulDrainingCompletion = 1417808974\n"
+	"ExpectedMachineQuickDrainingBadput = 605\n"
+	"ExpectedMachineQuickDrainingCompletion = 1417808974\n"
+	"FileSystemDomain = \"cs.wisc.edu\"\n"
+	"GlobalJobId = \"ingwe.cs.wisc.edu#2.0#1417808351\"\n"
+	"HardwareAddress = \"78:2b:cb:41:52:a6\"\n"
+	"has_sse4_1 = true\n"
+	"has_sse4_2 = true\n"
+	"has_ssse3 = true\n"
+	"HasCheckpointing = true\n"
+	"HasFileTransfer = true\n"
+	"HasFileTransferPluginMethods = \"file,ftp,http,data\"\n"
+	"HasIOProxy = true\n"
+	"HasJava = true\n"
+	"HasJICLocalConfig = true\n"
+	"HasJICLocalStdin = true\n"
+	"HasJobDeferral = true\n"
+	"HasMPI = true\n"
+	"HasPerFileEncryption = true\n"
+	"HasReconnect = true\n"
+	"HasRemoteSyscalls = true\n"
+	"HasTDP = true\n"
+	"HasVM = false\n"
+	"HibernationLevel = 0\n"
+	"HibernationState = \"NONE\"\n"
+	"HibernationSupportedStates = \"S4\"\n"
+	"ImageSize = 192012\n"
+	"IsLocalStartd = false\n"
+	"IsValidCheckpointPlatform = (TARGET.JobUniverse =!= 1 || ((MY.CheckpointPlatform =!= undefined) && ((TARGET.LastCheckpointPlatform =?= MY.CheckpointPlatform) || (TARGET.NumCkpts == 0))))\n"
+	"IsWakeAble = false\n"
+	"IsWakeOnLanEnabled = false\n"
+	"IsWakeOnLanSupported = false\n"
+	"JavaSpecificationVersion = \"1.7\"\n"
+	"JavaVendor = \"Oracle Corporation\"\n"
+	"JavaVersion = \"1.7.0_65\"\n"
+	"JobId = \"2.0\"\n"
+	"JobPreemptions = 0\n"
+	"JobRankPreemptions = 0\n"
+	"JobStart = 1417808369\n"
+	"JobStarts = 2\n"
+	"JobUniverse = 5\n"
+	"JobUserPrioPreemptions = 0\n"
+	"KeyboardIdle = 80\n"
+	"LastBenchmark = 0\n"
+	"LastFetchWorkCompleted = 0\n"
+	"LastFetchWorkSpawned = 0\n"
+	"LastHeardFrom = 1417808378\n"
+	"LoadAvg = 0.08\n"
+	"Machine = \"ingwe.cs.wisc.edu\"\n"
+	"MachineMaxVacateTime = 10 * 60\n"
+	"MachineResources = \"Cpus Memory Disk Swap\"\n"
+	"MaxJobRetirementTime = 0\n"
+	"Memory = 15940\n"
+	"MonitorSelfAge = 7\n"
+	"MonitorSelfCPUUsage = 0.1428571492433548\n"
+	"MonitorSelfImageSize = 95284.0\n"
+	"MonitorSelfRegisteredSocketCount = 1\n"
+	"MonitorSelfResidentSetSize = 7976\n"
+	"MonitorSelfSecuritySessions = 1\n"
+	"MonitorSelfTime = 1417808334\n"
+	"MyAddress = \"<128.105.121.64:51962>\"\n"
+	"MyCurrentTime = 1417808378\n"
+	"MyType = \"Machine\"\n"
+	"Name = \"ingwe.cs.wisc.edu\"\n"
+	"NextFetchWorkDelay = -1\n"
+	"NiceUser = false\n"
+	"NumPids = 1\n"
+	"OpSys = \"LINUX\"\n"
+	"OpSysAndVer = \"RedHat6\"\n"
+	"OpSysLegacy = \"LINUX\"\n"
+	"OpSysLongName = \"Red Hat Enterprise Linux Server release 6.5 (Santiago)\"\n"
+	"OpSysMajorVer = 6\n"
+	"OpSysName = \"RedHat\"\n"
+	"OpSysShortName = \"RedHat\"\n"
+	"OpSysVer = 605\n"
+	"PublicClaimId = \"<128.105.121.64:51962>#1417808328#3#...\"\n"
+	"Rank = 0.0\n"
+	"RecentDaemonCoreDutyCycle = 0.003355423233666999\n"
+	"RecentJobPreemptions = 0\n"
+	"RecentJobRankPreemptions = 0\n"
+	"RecentJobStarts = 2\n"
+	"RecentJobUserPrioPreemptions = 0\n"
+	"RemoteAutoregroup = false\n"
+	"RemoteNegotiatingGroup = \"<none>\"\n"
+	"RemoteOwner = \"bt@cs.wisc.edu\"\n"
+	"RemoteUser = \"bt@cs.wisc.edu\"\n"
+	"Requirements = (START) && (IsValidCheckpointPlatform)\n"
+	"RetirementTimeRemaining = -9\n"
+	"SlotID = 1\n"
+	"SlotType = \"Static\"\n"
+	"SlotTypeID = 0\n"
+	"SlotWeight = Cpus\n"
+	"Start = true\n"
+	"StartdIpAddr = \"<128.105.121.64:51962>\"\n"
+	"StarterAbilityList = \"HasTDP,HasFileTransferPluginMethods,HasJobDeferral,HasJICLocalConfig,HasJICLocalStdin,HasPerFileEncryption,HasFileTransfer,HasVM,HasReconnect,HasMPI,HasJava,HasRemoteSyscalls,HasCheckpointing\"\n"
+	"State = \"Claimed\"\n"
+	"SubnetMask = \"255.255.255.0\"\n"
+	"TargetType = \"Job\"\n"
+	"TimeToLive = 2147483647\n"
+	"TotalClaimRunTime = 9\n"
+	"TotalCondorLoadAvg = 0.0\n"
+	"TotalCpus = 1.0\n"
+	"TotalDisk = 65736940\n"
+	"TotalJobRunTime = 9\n"
+	"TotalLoadAvg = 0.08\n"
+	"TotalMemory = 15940\n"
+	"TotalSlotCpus = 1\n"
+	"TotalSlotDisk = 65737172.0\n"
+	"TotalSlotMemory = 15940\n"
+	"TotalSlots = 1\n"
+	"TotalTimeClaimedBusy = 10\n"
+	"TotalTimeClaimedIdle = 1\n"
+	"TotalTimeUnclaimedIdle = 33\n"
+	"TotalVirtualMemory = 24661692\n"
+	"UidDomain = \"cs.wisc.edu\"\n"
+	"Unhibernate = MY.MachineLastMatchTime =!= undefined\n"
+	"UpdateSequenceNumber = 8\n"
+	"UpdatesHistory = \"0x00000000000000000000000000000000\"\n"
+	"UpdatesLost = 0\n"
+	"UpdatesSequenced = 8\n"
+	"UpdatesTotal = 9\n"
+	"UtsnameMachine = \"x86_64\"\n"
+	"UtsnameNodename = \"ingwe.cs.wisc.edu\"\n"
+	"UtsnameRelease = \"2.6.32-431.3.1.el6.x86_64\"\n"
+	"UtsnameSysname = \"Linux\"\n"
+	"UtsnameVersion = \"#1 SMP Fri Dec 13 06:58:20 EST 2013\"\n"
+	"VirtualMemory = 24661692\n"
+	"WakeOnLanEnabledFlags = \"NONE\"\n"
+	"WakeOnLanSupportedFlags = \"NONE\"\n"
+;
+
+static const char job_ad[] =
+	"MaxHosts = 1\n"
+	"Managed = \"Schedd\"\n"
+	"User = \"bbockelm@users.opensciencegrid.org\"\n"
+	"SUBMIT_x509userproxy = \"/tmp/x509up_u1221\"\n"
+	"OnExitHold = false\n"
+	"CoreSize = 0\n"
+	"LastHoldReason = \"Spooling input data files\"\n"
+	"MyType = \"Job\"\n"
+	"Rank = 0.0\n"
+	"CumulativeSuspensionTime = 0\n"
+	"MinHosts = 1\n"
+	"ReleaseReason = \"Data files spooled\"\n"
+	"PeriodicHold = false\n"
+	"PeriodicRemove = false\n"
+	"Err = \"_condor_stderr\"\n"
+	"ProcId = 0\n"
+	"EnteredCurrentStatus = 1357311628\n"
+	"UserLog = \".log_1521_fmz75O\"\n"
+	"NumJobStarts = 0\n"
+	"JobUniverse = 5\n"
+	"In = \"/dev/null\"\n"
+	"Requirements = (TARGET.Arch == \"X86_64\") && (TARGET.OpSys == \"LINUX\") && (TARGET.Disk >= RequestDisk) && (TARGET.Memory >= RequestMemory) && (TARGET.HasFileTransfer)\n"
+	"ClusterId = 15\n"
+	"WhenToTransferOutput = \"ON_EXIT\"\n"
+	"CompletionDate = 0\n"
+	"BufferSize = 524288\n"
+	"Environment = \"\"\n"
+	"TargetType = \"Machine\"\n"
+	"LeaveJobInQueue = (StageOutFinish > 0) isnt true\n"
+	"x509UserProxyExpiration = 1357354655\n"
+	"JobNotification = 0\n"
+	"Owner = \"bbockelm\"\n"
+	"CondorPlatform = \"$CondorPlatform: X86_64-ScientificLinux_6.3 $\"\n"
+	"CommittedTime = 0\n"
+	"x509userproxy = \"x509up_u1221\"\n"
+	"QDate = 1357311627\n"
+	"JobLeaseDuration = 1200\n"
+	"TransferIn = false\n"
+	"ExitStatus = 0\n"
+	"NumCkpts_RAW = 0\n"
+	"HoldReason = undefined\n"
+	"RootDir = \"/\"\n"
+	"CurrentHosts = 0\n"
+	"GlobalJobId = \"hcc-briantest.unl.edu#15.0#1357311627\"\n"
+	"RemoteSysCpu = 0.0\n"
+	"TotalSuspensions = 0\n"
+	"ManagedManager = \"\"\n"
+	"x509userproxysubject = \"/DC=com/DC=DigiCert-Grid/O=Open Science Grid/OU=People/CN=Brian Bockelman\"\n"
+	"PeriodicRelease = false\n"
+	"CondorVersion = \"$CondorVersion: 7.9.4 Jan 03 2013 PRE-RELEASE-UWCS $\"\n"
+	"Out = \"_condor_stdout\"\n"
+	"ShouldTransferFiles = \"YES\"\n"
+	"DiskUsage = 100\n"
+	"CumulativeSlotTime = 0\n"
+	"CommittedSlotTime = 0\n"
+	"LocalUserCpu = 0.0\n"
+	"DiskUsage_RAW = 86\n"
+	"ExitBySignal = false\n"
+	"StreamErr = false\n"
+	"HoldReasonCode = undefined\n"
+	"NumSystemHolds = 0\n"
+	"NumRestarts = 0\n"
+	"RequestDisk = DiskUsage\n"
+	"JobPrio = 0\n"
+	"NumCkpts = 0\n"
+	"BufferBlockSize = 32768\n"
+	"StageInStart = 1357311627\n"
+	"ImageSize = 100\n"
+	"CommittedSuspensionTime = 0\n"
+	"x509UserProxyEmail = \"bbockelm@cse.unl.edu\"\n"
+	"ExecutableSize_RAW = 86\n"
+	"Cmd = \"ps\"\n"
+	"LocalSysCpu = 0.0\n"
+	"LastHoldReasonCode = 16\n"
+	"Iwd = \"/var/lib/condor-ce/spool/15/0/cluster15.proc0.subproc0\"\n"
+	"TransferInputSizeMB = 0\n"
+	"ImageSize_RAW = 86\n"
+	"LastSuspensionTime = 0\n"
+	"TransferOutputRemaps = undefined\n"
+	"JobStatus = 1\n"
+	"SUBMIT_TransferOutputRemaps = \"_condor_stdout=/home/cse496/bbockelm/.stdout_1521_CN744L;_condor_stderr=/home/cse496/bbockelm/.stderr_1521_TKyDjv\"\n"
+	"ExecutableSize = 100\n"
+	"SUBMIT_Cmd = \"/bin/ps\"\n"
+	"SUBMIT_Iwd = \"/home/cse496/bbockelm\"\n"
+	"RemoteWallClockTime = 0.0\n"
+	"OnExitRemove = true\n"
+	"Arguments = \"faux\"\n"
+	"StreamOut = false\n"
+	"CurrentTime = time()\n"
+	"RequestMemory = ifthenelse(MemoryUsage isnt undefined,MemoryUsage,(ImageSize + 1023) / 1024)\n"
+	"RemoteUserCpu = 0.0\n"
+	"NiceUser = false\n"
+	"SUBMIT_UserLog = \"/home/cse496/bbockelm/.log_1521_fmz75O\"\n"
+	"RequestCpus = 1\n"
+	"StageInFinish = 1357311627\n"
+	"LastJobStatus = 5\n"
+;
+
+// parse long form ads separated by blank lines
+static int load_ads(const char * text, std::vector<classad::ClassAd*> & ads)
+{
+	int count = 0;
+	classad::ClassAd *ad = NULL;
+	std::string buf = text;
+	size_t start = 0;
+	while (start <= buf.size()) {
+		size_t end = buf.find('\n', start);
+		if (end == std::string::npos) end = buf.size();
+		std::string line = buf.substr(start, end - start);
+		start = end + 1;
+		trim(line);
+		if (line.empty() || line[0] == '#') {
+			if (line.empty() && ad) { ads.push_back(ad); ad = NULL; ++count; }
+			continue;
+		}
+		if ( ! ad) ad = new classad::ClassAd();
+		if ( ! InsertLongFormAttrValue(*ad, line.c_str(), false)) {
+			fprintf(stderr, "could not parse: %s\n", line.c_str());
+		}
+	}
+	if (ad) { ads.push_back(ad); ++count; }
+	return count;
+}
+
+static bool load_ad_file(const char * filename, std::vector<classad::ClassAd*> & ads)
+{
+	FILE *fp = safe_fopen_wrapper_follow(filename, "r");
+	if ( ! fp) {
+		fprintf(stderr, "could not open %s\n", filename);
+		return false;
+	}
+	std::string text, line;
+	while (readLine(line, fp, false)) {
+		text += line;
+	}
+	fclose(fp);
+	return load_ads(text.c_str(), ads) > 0;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsed_us(Clock::time_point begin)
+{
+	return std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+}
+
+// what _putClassAd does for each attribute of a text ad
+static size_t text_encode(const classad::ClassAd & ad, std::vector<std::string> & lines)
+{
+	classad::ClassAdUnParser unp;
+	unp.SetOldClassAd(true, true);
+	size_t cb = 0;
+	lines.clear();
+	for (auto & attr : ad) {
+		lines.emplace_back(attr.first);
+		std::string & buf = lines.back();
+		buf += " = ";
+		unp.Unparse(buf, attr.second);
+		cb += buf.size() + 1;
+	}
+	return cb;
+}
+
+// what getClassAdEx does for each attribute of a text ad, without the cache
+static void text_decode(const std::vector<std::string> & lines, classad::ClassAd & ad)
+{
+	ad.Clear();
+	for (auto & line : lines) {
+		InsertLongFormAttrValue(ad, line.c_str(), false);
+	}
+}
+
+static bool check_round_trip(const classad::ClassAd & ad)
+{
+	ClassAdWireEncoder encoder;
+	encoder.putAd(ad);
+	ClassAdWireDecoder decoder(encoder.data().data(), encoder.data().size());
+	classad::ClassAd copy;
+	if ( ! decoder.getAd(copy, encoder.numAttrs()) || ! decoder.atEnd()) {
+		fprintf(stderr, "FAILED to decode binary ad\n");
+		return false;
+	}
+	if ( ! ad.SameAs(&copy)) {
+		std::string before, after;
+		classad::ClassAdUnParser unp;
+		unp.SetOldClassAd(true, true);
+		unp.Unparse(before, &ad);
+		unp.Unparse(after, &copy);
+		fprintf(stderr, "FAILED binary round trip\nsent: %s\ngot:  %s\n", before.c_str(), after.c_str());
+		return false;
+	}
+	return true;
+}
+
+// check that the receiver refuses headers and dictionaries that a well
+// behaved sender would never produce
+static bool check_limits()
+{
+	bool ok = true;
+	if ( ! ClassAdWireDecoder::headerOk(0, 0) || ! ClassAdWireDecoder::headerOk(10, 100) ||
+		ClassAdWireDecoder::headerOk(-1, 100) || ClassAdWireDecoder::headerOk(10, -1) ||
+		ClassAdWireDecoder::headerOk(100, 10) || ClassAdWireDecoder::headerOk(INT_MAX, INT_MAX) ||
+		ClassAdWireDecoder::headerOk(0, ClassAdWireDecoder::MAX_AD_BYTES + 1)) {
+		fprintf(stderr, "FAILED binary header limits\n");
+		ok = false;
+	}
+
+	// fill the receiver's dictionary, a name that would go past the end must fail to decode
+	ClassAdWireDictionary full;
+	for (size_t ix = 0; ix < ClassAdWireDictionary::MAX_ENTRIES; ++ix) {
+		std::string name = "Attr" + std::to_string(ix);
+		if ( ! full.append(name.data(), name.size())) {
+			fprintf(stderr, "FAILED to fill the binary dictionary at %d\n", (int)ix);
+			return false;
+		}
+	}
+	ClassAdWireDictionary sender;
+	ClassAdWireEncoder encoder(&sender);
+	classad::ClassAd ad;
+	ad.InsertAttr("OneMore", 1);
+	encoder.putAd(ad);
+	ClassAdWireDecoder decoder(encoder.data().data(), encoder.data().size(), &full);
+	classad::ClassAd copy;
+	if (decoder.getAd(copy, encoder.numAttrs()) || full.size() != ClassAdWireDictionary::MAX_ENTRIES) {
+		fprintf(stderr, "FAILED to refuse a binary dictionary entry past the limit\n");
+		ok = false;
+	}
+	return ok;
+}
+
+// time encoding and decoding batch copies of ad, as a query reply would
+static void bench_ad(const char * label, const classad::ClassAd & ad, int iterations, int batch)
+{
+	std::vector<std::string> lines;
+	size_t text_bytes = 0;
+	Clock::time_point begin = Clock::now();
+	for (int ii = 0; ii < iterations; ++ii) {
+		text_bytes = text_encode(ad, lines);
+	}
+	double text_put = elapsed_us(begin) / iterations;
+
+	classad::ClassAd copy;
+	begin = Clock::now();
+	for (int ii = 0; ii < iterations; ++ii) {
+		text_decode(lines, copy);
+	}
+	double text_get = elapsed_us(begin) / iterations;
+
+	// without a dictionary, like a single ad in a message
+	ClassAdWireEncoder encoder;
+	begin = Clock::now();
+	for (int ii = 0; ii < iterations; ++ii) {
+		encoder.clear();
+		encoder.putAd(ad);
+	}
+	double bin_put = elapsed_us(begin) / iterations;
+	size_t bin_bytes = encoder.data().size();
+
+	begin = Clock::now();
+	for (int ii = 0; ii < iterations; ++ii) {
+		ClassAdWireDecoder decoder(encoder.data().data(), encoder.data().size());
+		copy.Clear();
+		decoder.getAd(copy, encoder.numAttrs());
+	}
+	double bin_get = elapsed_us(begin) / iterations;
+
+	// batch ads in one message, sharing the attribute name dictionary
+	size_t dict_bytes = 0;
+	int rounds = (iterations + batch - 1) / batch;
+	begin = Clock::now();
+	for (int ii = 0; ii < rounds; ++ii) {
+		ClassAdWireDictionary dict;
+		ClassAdWireEncoder batch_encoder(&dict);
+		for (int jj = 0; jj < batch; ++jj) {
+			batch_encoder.putAd(ad);
+		}
+		dict_bytes = batch_encoder.data().size();
+	}
+	double dict_put = elapsed_us(begin) / (rounds * batch);
+
+	printf("%s: %d attributes\n", label, (int)ad.size());
+	printf("  %-22s %10s %10s %12s\n", "", "put (us)", "get (us)", "bytes/ad");
+	printf("  %-22s %10.2f %10.2f %12d\n", "text", text_put, text_get, (int)text_bytes);
+	printf("  %-22s %10.2f %10.2f %12d\n", "binary", bin_put, bin_get, (int)bin_bytes);
+	printf("  %-22s %10.2f %10s %12d\n", "binary + dictionary", dict_put, "", (int)(dict_bytes / batch));
+	printf("  speedup: put %.1fx, get %.1fx, size %.0f%%\n",
+		bin_put > 0 ? text_put / bin_put : 0.0,
+		bin_get > 0 ? text_get / bin_get : 0.0,
+		text_bytes ? 100.0 * bin_bytes / text_bytes : 0.0);
+}
+
+int main(int /*argc*/, const char *argv[])
+{
+	int iterations = 20000;
+	int batch = 100;
+	std::vector<const char *> files;
+
+	for (int ii = 1; argv[ii]; ++ii) {
+		const char *arg = argv[ii];
+		if (is_dash_arg_prefix(arg, "verbose", 1)) {
+			dash_verbose = 1;
+		} else if (is_dash_arg_prefix(arg, "iterations", 1)) {
+			if ( ! argv[ii+1]) {
+				fprintf(stderr, "-iterations requires a number\n");
+				return 1;
+			}
+			iterations = atoi(argv[++ii]);
+		} else if (is_dash_arg_prefix(arg, "batch", 1)) {
+			if ( ! argv[ii+1]) {
+				fprintf(stderr, "-batch requires a number\n");
+				return 1;
+			}
+			batch = atoi(argv[++ii]);
+		} else if (*arg == '-') {
+			fprintf(stderr, "unknown argument %s\n", arg);
+			fprintf(stderr, "usage: %s [-verbose] [-iterations <n>] [-batch <n>] [<file> ...]\n", argv[0]);
+			return 1;
+		} else {
+			files.push_back(arg);
+		}
+	}
+	if (iterations < 1) iterations = 1;
+	if (batch < 1) batch = 1;
+
+	std::vector<classad::ClassAd*> ads;
+	std::vector<std::string> labels;
+	if (files.empty()) {
+		load_ads(startd_ad, ads); labels.push_back("startd ad");
+		load_ads(job_ad, ads); labels.push_back("job ad");
+	} else {
+		for (auto file : files) {
+			size_t first = ads.size();
+			if ( ! load_ad_file(file, ads)) {
+				return 1;
+			}
+			for (size_t ix = first; ix < ads.size(); ++ix) {
+				labels.push_back(file);
+			}
+		}
+	}
+
+	int fail_count = 0;
+	if ( ! check_limits()) {
+		++fail_count;
+	}
+	for (size_t ix = 0; ix < ads.size(); ++ix) {
+		if ( ! check_round_trip(*ads[ix])) {
+			++fail_count;
+			continue;
+		}
+		if (dash_verbose) {
+			printf("%s round trips\n", labels[ix].c_str());
+		}
+		bench_ad(labels[ix].c_str(), *ads[ix], iterations, batch);
+	}
+
+	for (auto ad : ads) {
+		delete ad;
+	}
+
+	if (fail_count) {
+		fprintf(stderr, "%d ads FAILED the binary round trip\n", fail_count);
+		return 1;
+	}
+	return 0;
+}
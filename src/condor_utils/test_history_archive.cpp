@@ -0,0 +1,460 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// Checks that searching an archive of a history file, passing over the
+// blocks that can't match and reading only the columns needed, the way
+// condor_history does, gives exactly the ads that reading the history file
+// does.  The history file is written by AppendHistory() from randomly made
+// up job ads, and searched with random constraints on clusters, owners and
+// other attributes, forwards and backwards, with and without -since, for
+// some or all of the attributes.  Then the archive is truncated or
+// corrupted, and the reader must refuse it rather than give wrong ads.
+//
+//   test_history_archive [<seed>]
+
+#include "condor_common.h"
+#include "condor_config.h"
+#include "condor_attributes.h"
+#include "condor_classad.h"
+#include "compat_classad_util.h"
+#include "subsystem_info.h"
+#include "directory_util.h"
+#include "classadHistory.h"
+#include "historyArchive.h"
+#include "safe_open.h"
+#include "stl_string_utils.h"
+#include "test_random_ads.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+static const char * const cmds[] = { "/bin/sleep", "/bin/true", "/usr/bin/python3" };
+static const char * const attrs[] = {
+	ATTR_CLUSTER_ID, ATTR_PROC_ID, ATTR_OWNER, ATTR_COMPLETION_DATE, ATTR_JOB_STATUS,
+	ATTR_REQUEST_MEMORY, ATTR_REQUEST_CPUS, ATTR_JOB_CMD, "Score", "DiskUsage",
+};
+
+// The columns of the archive besides the ones write_random_history()
+// fills in.  JobStatus is sometimes a string, RequestMemory sometimes a
+// real or an expression, and DiskUsage sometimes an expression with a
+// unit, so that some blocks have columns without a range to rule them out.
+static void add_job_columns(ClassAd &job)
+{
+	switch (rand() % 8) {
+	case 0: break;
+	case 1: job.Assign(ATTR_JOB_STATUS, "done"); break;
+	default: job.Assign(ATTR_JOB_STATUS, 1 + rand() % 6); break;
+	}
+	switch (rand() % 6) {
+	case 0: break;
+	case 1: job.AssignExpr(ATTR_REQUEST_MEMORY, "1024 * RequestCpus"); break;
+	case 2: job.Assign(ATTR_REQUEST_MEMORY, (rand() % 64) * 128.0 + 0.5); break;
+	default: job.Assign(ATTR_REQUEST_MEMORY, (rand() % 64) * 128); break;
+	}
+	if (rand() % 4) { job.Assign(ATTR_REQUEST_CPUS, 1 + rand() % 8); }
+	job.Assign(ATTR_JOB_CMD, random_pick(cmds));
+	if (rand() % 3) { job.Assign("Score", (rand() % 200) - 100); }
+	if (rand() % 5 == 0) { job.AssignExpr("DiskUsage", "4K"); }
+	job.Assign("Padding", std::string(rand() % 200, 'x'));
+}
+
+static void parse_record(const std::string &text, ClassAd &ad)
+{
+	size_t pos = 0;
+	while (pos < text.size()) {
+		size_t eol = text.find('\n', pos);
+		if (eol == std::string::npos) { eol = text.size(); }
+		std::string line = text.substr(pos, eol - pos);
+		pos = eol + 1;
+		if (starts_with(line, "*** ")) { break; }
+		InsertLongFormAttrValue(ad, line.c_str(), true);
+	}
+}
+
+// Read every ad of the history file, as the scan does
+static void read_all(const std::string &filename, std::vector<ClassAd> &ads)
+{
+	ads.clear();
+	std::string contents;
+	FILE *fp = safe_fopen_wrapper_follow(filename.c_str(), "r");
+	ASSERT(fp);
+	char buf[8192];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), fp)) > 0) {
+		contents.append(buf, len);
+	}
+	fclose(fp);
+
+	size_t start = 0;
+	size_t pos = 0;
+	while (pos < contents.size()) {
+		size_t eol = contents.find('\n', pos);
+		if (eol == std::string::npos) { break; }
+		bool banner = contents.compare(pos, 4, "*** ") == 0;
+		pos = eol + 1;
+		if (banner) {
+			ads.emplace_back();
+			parse_record(contents.substr(start, pos - start), ads.back());
+			start = pos;
+		}
+	}
+}
+
+struct HistorySearch {
+	ExprTree *constraint;
+	ExprTree *since;
+	bool backwards;
+	bool all_attrs;
+	classad::References projection;
+};
+
+// The attributes of a found ad that would be printed, as text
+static std::string show(ClassAd &ad, const HistorySearch &search)
+{
+	std::map<std::string, std::string, classad::CaseIgnLTStr> shown;
+	for (auto & it : ad) {
+		if (search.all_attrs || search.projection.count(it.first)) {
+			ExprTreeToString(it.second, shown[it.first]);
+		}
+	}
+	std::string text;
+	for (auto & it : shown) {
+		formatstr_cat(text, "%s = %s\n", it.first.c_str(), it.second.c_str());
+	}
+	return text;
+}
+
+// The ads the search finds by reading every ad
+static void scan(std::vector<ClassAd> &ads, const HistorySearch &search, std::vector<std::string> &found)
+{
+	found.clear();
+	for (size_t ix = 0; ix < ads.size(); ++ix) {
+		ClassAd &ad = ads[search.backwards ? ads.size() - 1 - ix : ix];
+		if (search.since && EvalExprBool(&ad, search.since)) { break; }
+		if (EvalExprBool(&ad, search.constraint)) { found.push_back(show(ad, search)); }
+	}
+}
+
+// The ads the search finds in the archive, as readHistoryFromArchive() in
+// condor_history does.  Returns false if the archive can't be read.
+static bool archived(const std::string &filename, const HistorySearch &search, std::vector<std::string> &found,
+	int &passed_over)
+{
+	found.clear();
+	HistoryArchiveReader reader;
+	if ( ! reader.open(filename.c_str())) {
+		return false;
+	}
+
+	classad::References attrs = search.projection;
+	ClassAd empty;
+	GetExprReferences(search.constraint, empty, &attrs, &attrs);
+	if (search.since) { GetExprReferences(search.since, empty, &attrs, &attrs); }
+
+	bool done = false;
+	size_t num_blocks = reader.numBlocks();
+	for (size_t bx = 0; bx < num_blocks && ! done; ++bx) {
+		HistoryArchiveBlock block;
+		if ( ! reader.readBlock(search.backwards ? num_blocks - 1 - bx : bx, block)) {
+			return false;
+		}
+		if ( ! reader.mightMatch(block, search.constraint) &&
+			( ! search.since || ! reader.mightMatch(block, search.since))) {
+			++passed_over;
+			continue;
+		}
+		if ( ! reader.loadColumns(block, search.all_attrs ? NULL : &attrs)) {
+			return false;
+		}
+		for (uint32_t row = 0; row < block.num_ads && ! done; ++row) {
+			ClassAd ad;
+			reader.getAd(block, search.backwards ? block.num_ads - 1 - row : row, ad);
+			if (search.since && EvalExprBool(&ad, search.since)) {
+				done = true;
+			} else if (EvalExprBool(&ad, search.constraint)) {
+				found.push_back(show(ad, search));
+			}
+		}
+	}
+	return true;
+}
+
+// a clause the archive may use to pass over blocks, or one it must leave alone
+static std::string make_clause(int max_cluster, long long max_completion)
+{
+	static const char * const ops[] = { "==", "=?=", "<", "<=", ">", ">=", "!=" };
+	std::string clause;
+	switch (rand() % 14) {
+	case 0:
+	case 1:
+		formatstr(clause, "ClusterId == %d", 1 + rand() % (max_cluster + 2));
+		break;
+	case 2:
+		formatstr(clause, "ClusterId %s %d", random_pick(ops), 1 + rand() % (max_cluster + 2));
+		break;
+	case 3:
+		formatstr(clause, "%d %s ClusterId", 1 + rand() % (max_cluster + 2), random_pick(ops));
+		break;
+	case 4:
+	case 5:
+		formatstr(clause, "Owner == \"%s\"", random_pick(random_history_owners));
+		break;
+	case 6:
+		formatstr(clause, "MY.Owner =?= \"%s\"", random_pick(random_history_owners));
+		break;
+	case 7:
+		formatstr(clause, "CompletionDate %s %lld", random_pick(ops), (long long)(rand() % max_completion));
+		break;
+	case 8:
+		formatstr(clause, "JobStatus %s %d", random_pick(ops), rand() % 7);
+		break;
+	case 9:
+		formatstr(clause, "RequestMemory %s %d.5", random_pick(ops), rand() % 8192);
+		break;
+	case 10:
+		formatstr(clause, "Score %s -%d", random_pick(ops), rand() % 100);
+		break;
+	case 11:
+		formatstr(clause, "DiskUsage %s %d", random_pick(ops), rand() % 8192);
+		break;
+	case 12:
+		formatstr(clause, "!(Cmd == \"%s\")", random_pick(cmds));
+		break;
+	default:
+		formatstr(clause, "NoSuchAttr %s %d", random_pick(ops), rand() % 10);
+		break;
+	}
+	return clause;
+}
+
+static void make_search(HistorySearch &search, int max_cluster, long long max_completion)
+{
+	search.since = NULL;
+	search.backwards = (rand() % 3) != 0;
+
+	std::string constraint = make_clause(max_cluster, max_completion);
+	for (int n = rand() % 3; n > 0; --n) {
+		constraint = (rand() % 2) ? "(" + constraint + ") || " : constraint + " && ";
+		constraint += make_clause(max_cluster, max_completion);
+	}
+	ParseClassAdRvalExpr(constraint.c_str(), search.constraint);
+	ASSERT(search.constraint);
+
+	std::string since;
+	switch (rand() % 4) {
+	case 0:
+		formatstr(since, "ClusterId == %d && ProcId == %d", 1 + rand() % max_cluster, rand() % 3);
+		break;
+	case 1:
+		formatstr(since, "CompletionDate <= %lld", (long long)(rand() % max_completion));
+		break;
+	default:
+		break;
+	}
+	if ( ! since.empty()) {
+		ParseClassAdRvalExpr(since.c_str(), search.since);
+		ASSERT(search.since);
+	}
+
+	search.all_attrs = (rand() % 3) == 0;
+	search.projection.clear();
+	for (int n = 1 + rand() % 3; n > 0; --n) {
+		search.projection.insert(random_pick(attrs));
+	}
+}
+
+static void free_search(HistorySearch &search)
+{
+	delete search.constraint;
+	delete search.since;
+	search.constraint = search.since = NULL;
+}
+
+// Check that the archive can't be read after it has been damaged
+static unsigned check_refused(const std::string &filename, const char *what)
+{
+	HistoryArchiveReader reader;
+	bool refused = ! reader.open(filename.c_str());
+	for (size_t bx = 0; ! refused && bx < reader.numBlocks(); ++bx) {
+		HistoryArchiveBlock block;
+		refused = ! reader.readBlock(bx, block) || ! reader.loadColumns(block, NULL);
+	}
+	if ( ! refused) {
+		fprintf(stderr, "%s: the archive was read\n", what);
+		return 1;
+	}
+	fprintf(stdout, "%s: the archive was refused\n", what);
+	return 0;
+}
+
+static void copy_file(const std::string &from, const std::string &to)
+{
+	std::string contents;
+	FILE *in = safe_fopen_wrapper_follow(from.c_str(), "rb");
+	ASSERT(in);
+	char buf[8192];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), in)) > 0) { contents.append(buf, len); }
+	fclose(in);
+	FILE *out = safe_fopen_wrapper_follow(to.c_str(), "wb");
+	ASSERT(out);
+	ASSERT(fwrite(contents.data(), 1, contents.size(), out) == contents.size());
+	fclose(out);
+}
+
+static void overwrite(const std::string &filename, off_t offset, const void *data, size_t len)
+{
+	int fd = safe_open_wrapper_follow(filename.c_str(), O_WRONLY | O_LARGEFILE | _O_BINARY, 0);
+	ASSERT(fd >= 0);
+	ASSERT(lseek(fd, offset, SEEK_SET) == offset);
+	ASSERT(full_write(fd, data, len) == (ssize_t)len);
+	close(fd);
+}
+
+static off_t file_size(const std::string &filename)
+{
+	struct stat si;
+	ASSERT(stat(filename.c_str(), &si) == 0);
+	return si.st_size;
+}
+
+int
+main( int argc, char ** argv )
+{
+	random_test_seed(argc, argv);
+
+	char dir_template[] = "test_history_archive.XXXXXX";
+	char *dir = mkdtemp(dir_template);
+	ASSERT(dir);
+	std::string history;
+	dircat(dir, "history", history);
+	std::string saved = history + ".saved";
+
+	setenv("CONDOR_CONFIG", "ONLY_ENV", 1);
+	set_mySubSystem("TOOL", false, SUBSYSTEM_TYPE_TOOL);
+	config();
+	config_insert("HISTORY", history.c_str());
+	config_insert("ENABLE_HISTORY_ROTATION", "false");
+	config_insert("ENABLE_HISTORY_INDEX", "false");
+	InitJobHistoryFile("HISTORY", "PER_JOB_HISTORY_DIR");
+
+	// The clusters and completion dates mostly go up, so that the blocks
+	// have ranges that rule some of them out.
+	const int num_ads = 5 * HISTORY_ARCHIVE_BLOCK_ADS / 2;
+	RandomHistory written = write_random_history(num_ads, -1, add_job_columns);
+
+	std::vector<ClassAd> ads;
+	read_all(history, ads);
+
+	unsigned failures = 0;
+	std::string errmsg;
+	if ( ! ArchiveHistoryFile(history.c_str(), errmsg) || ! HistoryArchiveReader::IsArchive(history.c_str())) {
+		fprintf(stderr, "failed to archive %s: %s\n", history.c_str(), errmsg.c_str());
+		return 1;
+	}
+
+	const int num_searches = 1000;
+	int passed_over = 0;
+	int matched = 0;
+	for (int ix = 0; ix < num_searches; ++ix) {
+		HistorySearch search;
+		make_search(search, written.max_cluster, written.max_completion);
+		std::vector<std::string> expected, found;
+		scan(ads, search, expected);
+		matched += (int)expected.size();
+		if ( ! archived(history, search, found, passed_over) || found != expected) {
+			++failures;
+			std::string constraint, since;
+			ExprTreeToString(search.constraint, constraint);
+			if (search.since) { ExprTreeToString(search.since, since); }
+			fprintf(stderr, "the archive found %d ads, reading the file found %d, for %s%s%s%s\n",
+				(int)found.size(), (int)expected.size(), constraint.c_str(),
+				search.since ? " since " : "", since.c_str(),
+				search.backwards ? "" : " forwards");
+			for (size_t fx = 0; fx < found.size() && fx < expected.size(); ++fx) {
+				if (found[fx] != expected[fx]) {
+					fprintf(stderr, "first difference:\n%s\nvs\n%s\n", found[fx].c_str(), expected[fx].c_str());
+					break;
+				}
+			}
+		}
+		free_search(search);
+	}
+	fprintf(stdout, "%d searches, %d ads found, %d blocks passed over\n", num_searches, matched, passed_over);
+	if (passed_over == 0) {
+		fprintf(stderr, "no block was ever passed over\n");
+		++failures;
+	}
+
+	copy_file(history, saved);
+	off_t size = file_size(history);
+
+	// Cut short, at the end of the last block and inside it
+	std::string trailer(16, '\0');
+	int fd = safe_open_wrapper_follow(history.c_str(), O_RDONLY | O_LARGEFILE | _O_BINARY, 0);
+	ASSERT(fd >= 0);
+	ASSERT(lseek(fd, size - 16, SEEK_SET) == size - 16);
+	ASSERT(full_read(fd, &trailer[0], trailer.size()) == (ssize_t)trailer.size());
+	close(fd);
+	int64_t footer_offset = 0;
+	memcpy(&footer_offset, trailer.data(), sizeof(footer_offset));
+	ASSERT(footer_offset > 0 && footer_offset < size);
+
+	ASSERT(truncate(history.c_str(), footer_offset) == 0);
+	failures += check_refused(history, "no footer");
+	copy_file(saved, history);
+	ASSERT(truncate(history.c_str(), footer_offset / 2) == 0);
+	failures += check_refused(history, "cut inside a block");
+	copy_file(saved, history);
+	ASSERT(truncate(history.c_str(), size - 1) == 0);
+	failures += check_refused(history, "cut inside the trailer");
+	copy_file(saved, history);
+
+	// A footer that isn't where the trailer says
+	int64_t bad_offset = size;
+	overwrite(history, size - 16, &bad_offset, sizeof(bad_offset));
+	failures += check_refused(history, "bad footer offset");
+	copy_file(saved, history);
+
+	// A block that isn't where the footer says
+	bad_offset = size + 4096;
+	overwrite(history, footer_offset + sizeof(uint32_t), &bad_offset, sizeof(bad_offset));
+	failures += check_refused(history, "bad block offset");
+	copy_file(saved, history);
+
+	// A block header of garbage
+	std::string garbage(64, '\xff');
+	overwrite(history, 8, garbage.data(), garbage.size());
+	failures += check_refused(history, "bad block header");
+	copy_file(saved, history);
+
+	// An empty file
+	ASSERT(truncate(history.c_str(), 0) == 0);
+	failures += check_refused(history, "empty file");
+
+	unlink(history.c_str());
+	unlink(saved.c_str());
+	rmdir(dir);
+
+	if( failures == 0 ) {
+		fprintf( stdout, "No failures detected.\n" );
+	}
+	return failures;
+}
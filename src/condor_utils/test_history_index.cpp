@@ -0,0 +1,429 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// Checks that SearchHistoryIndex(), which condor_history uses when looking
+// for particular clusters or owners, finds exactly the ads that reading the
+// whole file does.  The history
+// file is written by AppendHistory() from randomly made up job ads, and
+// searched forwards and backwards, with and without -since.  Then the
+// index is truncated or corrupted, or the file is changed under it, and
+// the index must either still give the right ads or not be used at all.
+//
+//   test_history_index [<seed>]
+
+#include "condor_common.h"
+#include "condor_config.h"
+#include "condor_attributes.h"
+#include "condor_classad.h"
+#include "compat_classad_util.h"
+#include "subsystem_info.h"
+#include "directory_util.h"
+#include "classadHistory.h"
+#include "historyIndex.h"
+#include "safe_open.h"
+#include "stl_string_utils.h"
+#include "test_random_ads.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+// One ad of a history file: its lines and banner, the ad, and how many
+// bytes of the file it takes up
+struct HistoryRecord {
+	std::string text;
+	ClassAd ad;
+	size_t length = 0;
+};
+
+// Add a line of an ad to the text the searches are compared by, leaving
+// out blank lines and comments as the reader of the index does
+static void add_line(std::string &text, const std::string &line)
+{
+	const char *p = line.c_str();
+	while (*p == ' ' || *p == '\t') ++p;
+	if (*p && *p != '#') {
+		text += line;
+		text += '\n';
+	}
+}
+
+static void parse_record(const std::string &text, HistoryRecord &rec)
+{
+	std::string banner;
+	size_t pos = 0;
+	while (pos < text.size()) {
+		size_t eol = text.find('\n', pos);
+		if (eol == std::string::npos) { eol = text.size(); }
+		std::string line = text.substr(pos, eol - pos);
+		pos = eol + 1;
+		if (starts_with(line, "*** ")) {
+			banner = line;
+			break;
+		}
+		add_line(rec.text, line);
+		InsertLongFormAttrValue(rec.ad, line.c_str(), true);
+	}
+	rec.text += banner;
+}
+
+// Read the whole history file, as the scan does
+static void read_all(const std::string &filename, std::vector<HistoryRecord> &records)
+{
+	records.clear();
+	std::string contents;
+	FILE *fp = safe_fopen_wrapper_follow(filename.c_str(), "r");
+	ASSERT(fp);
+	char buf[8192];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), fp)) > 0) {
+		contents.append(buf, len);
+	}
+	fclose(fp);
+
+	size_t start = 0;
+	size_t pos = 0;
+	while (pos < contents.size()) {
+		size_t eol = contents.find('\n', pos);
+		if (eol == std::string::npos) { break; }
+		bool banner = contents.compare(pos, 4, "*** ") == 0;
+		pos = eol + 1;
+		if (banner) {
+			records.emplace_back();
+			parse_record(contents.substr(start, pos - start), records.back());
+			records.back().length = pos - start;
+			start = pos;
+		}
+	}
+}
+
+// What condor_history is asked for: a constraint that picks out some
+// clusters or owners, and -since
+struct HistorySearch {
+	ExprTree *constraint;
+	ExprTree *since;
+	bool backwards;
+};
+
+// Whether the search stops at an ad, and if not, whether it wants it
+static bool since_matches(const HistorySearch &search, ClassAd &ad)
+{
+	return search.since && EvalExprBool(&ad, search.since);
+}
+
+static bool constraint_matches(const HistorySearch &search, ClassAd &ad)
+{
+	return EvalExprBool(&ad, search.constraint);
+}
+
+// The ads the search finds by reading every ad of the file
+static void scan(const std::vector<HistoryRecord> &records, const HistorySearch &search, std::vector<std::string> &found)
+{
+	found.clear();
+	for (size_t ix = 0; ix < records.size(); ++ix) {
+		const HistoryRecord &rec = records[search.backwards ? records.size() - 1 - ix : ix];
+		ClassAd ad(rec.ad);
+		if (since_matches(search, ad)) { break; }
+		if (constraint_matches(search, ad)) { found.push_back(rec.text); }
+	}
+}
+
+// The ads the search finds through the index, checked against the
+// constraint and -since as condor_history does.  Returns false if the
+// index can't be used.
+static bool indexed(const std::string &filename, const HistorySearch &search, std::vector<std::string> &found, int &bad)
+{
+	found.clear();
+	HistoryIndexSearch terms;
+	if ( ! HistoryIndexSearchTerms(search.constraint, terms.clusters, terms.owners)) {
+		return false;
+	}
+	terms.since = search.since;
+	terms.backwards = search.backwards;
+
+	return SearchHistoryIndex(filename.c_str(), terms, [&](HistoryIndexHit &hit) -> bool {
+		if (hit.kind == HistoryIndexHit::SINCE) { return true; }
+		if (hit.kind == HistoryIndexHit::BAD) { ++bad; }
+		if (hit.kind != HistoryIndexHit::AD) { return false; }
+
+		HistoryRecord rec;
+		for (auto it = hit.lines.rbegin(); it != hit.lines.rend(); ++it) {
+			add_line(rec.text, *it);
+			InsertLongFormAttrValue(rec.ad, it->c_str(), true);
+		}
+		rec.text += hit.banner;
+		if (since_matches(search, rec.ad)) { return true; }
+		if (constraint_matches(search, rec.ad)) { found.push_back(rec.text); }
+		return false;
+	});
+}
+
+// A constraint of a few clusters, jobs and owners, as condor_history
+// sends to the schedd for "condor_history 12 13.1 alice", and sometimes
+// -since a job or a completion date
+static void make_search(HistorySearch &search, int max_cluster, long long max_completion)
+{
+	search.since = NULL;
+	search.backwards = (rand() % 3) != 0;
+
+	std::string constraint;
+	for (int n = 1 + rand() % 3; n > 0; --n) {
+		if ( ! constraint.empty()) { constraint += " || "; }
+		int cluster = 1 + rand() % (max_cluster + 2);
+		switch (rand() % 3) {
+		case 0:
+			formatstr_cat(constraint, "ClusterId == %d", cluster);
+			break;
+		case 1:
+			formatstr_cat(constraint, "(ClusterId == %d && ProcId == %d)", cluster, rand() % 3);
+			break;
+		default:
+			formatstr_cat(constraint, "Owner == \"%s\"", random_pick(random_history_owners));
+			break;
+		}
+	}
+	ParseClassAdRvalExpr(constraint.c_str(), search.constraint);
+	ASSERT(search.constraint);
+
+	std::string since;
+	switch (rand() % 4) {
+	case 0:
+		formatstr(since, "ClusterId == %d && ProcId == %d", 1 + rand() % max_cluster, rand() % 3);
+		break;
+	case 1:
+		formatstr(since, "CompletionDate <= %lld", (long long)(rand() % max_completion));
+		break;
+	default:
+		break;
+	}
+	if ( ! since.empty()) {
+		ParseClassAdRvalExpr(since.c_str(), search.since);
+		ASSERT(search.since);
+	}
+}
+
+static void free_search(HistorySearch &search)
+{
+	delete search.constraint;
+	delete search.since;
+	search.constraint = search.since = NULL;
+}
+
+// Search the file both ways, and count the searches that find different ads.
+// If require_index, the index must be used.
+static unsigned check_searches(const std::string &filename, int max_cluster, long long max_completion,
+	bool require_index, const char *what)
+{
+	std::vector<HistoryRecord> records;
+	read_all(filename, records);
+
+	unsigned failures = 0;
+	int used = 0;
+	for (int ix = 0; ix < 300; ++ix) {
+		HistorySearch search;
+		make_search(search, max_cluster, max_completion);
+		std::vector<std::string> expected, found;
+		scan(records, search, expected);
+		int bad = 0;
+		if (indexed(filename, search, found, bad)) {
+			++used;
+			if (bad) {
+				++failures;
+				fprintf(stderr, "%s: %d ads could not be read through the index\n", what, bad);
+			}
+			if (found != expected) {
+				++failures;
+				std::string constraint, since;
+				ExprTreeToString(search.constraint, constraint);
+				if (search.since) { ExprTreeToString(search.since, since); }
+				fprintf(stderr, "%s: the index found %d ads, reading the file found %d, for %s%s%s%s\n",
+					what, (int)found.size(), (int)expected.size(), constraint.c_str(),
+					search.since ? " since " : "", since.c_str(),
+					search.backwards ? "" : " forwards");
+			}
+		}
+		free_search(search);
+	}
+	if (require_index && used == 0) {
+		fprintf(stderr, "%s: the index was never used\n", what);
+		++failures;
+	}
+	fprintf(stdout, "%s: %d of 300 searches used the index\n", what, used);
+	return failures;
+}
+
+// Check that the index is not used at all after it has been damaged
+static unsigned check_unused(const std::string &filename, const char *what)
+{
+	HistoryIndexSearch search;
+	search.clusters.insert(1);
+	search.owners.insert(HistoryIndexOwnerHash("alice"));
+	int calls = 0;
+	bool used = SearchHistoryIndex(filename.c_str(), search, [&calls](HistoryIndexHit &) -> bool {
+		++calls;
+		return false;
+	});
+	if (used || calls) {
+		fprintf(stderr, "%s: the index was used\n", what);
+		return 1;
+	}
+	fprintf(stdout, "%s: the index was not used\n", what);
+	return 0;
+}
+
+static void copy_file(const std::string &from, const std::string &to)
+{
+	std::string contents;
+	FILE *in = safe_fopen_wrapper_follow(from.c_str(), "rb");
+	ASSERT(in);
+	char buf[8192];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), in)) > 0) { contents.append(buf, len); }
+	fclose(in);
+	FILE *out = safe_fopen_wrapper_follow(to.c_str(), "wb");
+	ASSERT(out);
+	ASSERT(fwrite(contents.data(), 1, contents.size(), out) == contents.size());
+	fclose(out);
+}
+
+static void overwrite(const std::string &filename, off_t offset, const void *data, size_t len)
+{
+	int fd = safe_open_wrapper_follow(filename.c_str(), O_WRONLY | O_LARGEFILE | _O_BINARY, 0);
+	ASSERT(fd >= 0);
+	ASSERT(lseek(fd, offset, SEEK_SET) == offset);
+	ASSERT(full_write(fd, data, len) == (ssize_t)len);
+	close(fd);
+}
+
+static off_t file_size(const std::string &filename)
+{
+	struct stat si;
+	ASSERT(stat(filename.c_str(), &si) == 0);
+	return si.st_size;
+}
+
+int
+main( int argc, char ** argv )
+{
+	random_test_seed(argc, argv);
+
+	char dir_template[] = "test_history_index.XXXXXX";
+	char *dir = mkdtemp(dir_template);
+	ASSERT(dir);
+	std::string history;
+	dircat(dir, "history", history);
+	std::string index = HistoryIndexFileName(history.c_str());
+	std::string saved_history = history + ".saved";
+	std::string saved_index = index + ".saved";
+
+	setenv("CONDOR_CONFIG", "ONLY_ENV", 1);
+	set_mySubSystem("TOOL", false, SUBSYSTEM_TYPE_TOOL);
+	config();
+	config_insert("HISTORY", history.c_str());
+	config_insert("ENABLE_HISTORY_ROTATION", "false");
+	config_insert("ENABLE_HISTORY_INDEX", "true");
+	InitJobHistoryFile("HISTORY", "PER_JOB_HISTORY_DIR");
+
+	// Halfway through the history file is closed and opened again, so that
+	// the index is picked up mid-block.  The padding spreads the ads over
+	// enough of the file that the index blocks are far apart.
+	const int num_ads = 20 * HISTORY_INDEX_BLOCK_SIZE + HISTORY_INDEX_BLOCK_SIZE / 2;
+	RandomHistory written = write_random_history(num_ads, num_ads / 2 + 7, [](ClassAd &job) {
+		job.Assign(ATTR_JOB_CMD, "/bin/sleep");
+		job.Assign("Padding", std::string(rand() % 400, 'x'));
+	});
+
+	unsigned failures = 0;
+	failures += check_searches(history, written.max_cluster, written.max_completion, true, "whole index");
+
+	copy_file(history, saved_history);
+	copy_file(index, saved_index);
+
+	// The schedd may append an ad after condor_history looks at the size
+	// of the file, and before it reads the index, so the index may cover
+	// more than the file it was given.  Here that's a file cut short.
+	std::vector<HistoryRecord> records;
+	read_all(history, records);
+	off_t cut = 0;
+	for (size_t ix = 0; ix < records.size() - HISTORY_INDEX_BLOCK_SIZE - 3; ++ix) {
+		cut += records[ix].length;
+	}
+	ASSERT(truncate(history.c_str(), cut) == 0);
+	failures += check_searches(history, written.max_cluster, written.max_completion, true, "index ahead of the file");
+
+	// A file cut short in the middle of an ad isn't covered by the index
+	ASSERT(truncate(history.c_str(), cut - 10) == 0);
+	failures += check_unused(history, "file ends inside an ad");
+	copy_file(saved_history, history);
+
+	// An ad appended without adding it to the index
+	FILE *fp = safe_fopen_wrapper_follow(history.c_str(), "a");
+	ASSERT(fp);
+	fprintf(fp, "ClusterId = 1\nProcId = 0\nOwner = \"alice\"\n*** Offset = 0 ClusterId = 1 ProcId = 0 Owner = \"alice\" CompletionDate = 0\n");
+	fclose(fp);
+	failures += check_unused(history, "file longer than the index");
+	copy_file(saved_history, history);
+
+	// The index cut short, at the end of an entry and inside one
+	off_t index_size = file_size(index);
+	const off_t record_size = sizeof(HistoryIndexEntry);
+	ASSERT(truncate(index.c_str(), index_size - 3 * record_size) == 0);
+	failures += check_unused(history, "index cut short");
+	copy_file(saved_index, index);
+	ASSERT(truncate(index.c_str(), index_size - record_size / 2) == 0);
+	failures += check_unused(history, "index cut inside an entry");
+	copy_file(saved_index, index);
+
+	// An entry in the middle with the wrong offset
+	off_t header_size = index_size - (num_ads + num_ads / HISTORY_INDEX_BLOCK_SIZE) * record_size;
+	ASSERT(header_size > 0);
+	HistoryIndexEntry entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.offset = 12345;
+	entry.length = 100;
+	overwrite(index, header_size + 5 * record_size, &entry, sizeof(entry));
+	failures += check_unused(history, "bad entry");
+	copy_file(saved_index, index);
+
+	// A summary without its marker
+	memset(&entry, 0, sizeof(entry));
+	overwrite(index, header_size + HISTORY_INDEX_BLOCK_SIZE * record_size, &entry, sizeof(entry));
+	failures += check_unused(history, "bad summary");
+	copy_file(saved_index, index);
+
+	// Not an index at all
+	overwrite(index, 0, "NOTANIDX", 8);
+	failures += check_unused(history, "bad header");
+	copy_file(saved_index, index);
+
+	// An empty index
+	ASSERT(truncate(index.c_str(), 0) == 0);
+	failures += check_unused(history, "empty index");
+
+	unlink(history.c_str());
+	unlink(index.c_str());
+	unlink(saved_history.c_str());
+	unlink(saved_index.c_str());
+	rmdir(dir);
+
+	if( failures == 0 ) {
+		fprintf( stdout, "No failures detected.\n" );
+	}
+	return failures;
+}
@@ -0,0 +1,92 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _TEST_RANDOM_ADS_H_
+#define _TEST_RANDOM_ADS_H_
+
+// Helpers for the tests that check an index against a scan of made up ads.
+// Each test takes a seed on its command line, or picks one and prints it,
+// so that a failure can be repeated.
+
+#include "condor_attributes.h"
+#include "condor_classad.h"
+#include "classadHistory.h"
+
+#include <functional>
+
+inline unsigned random_test_seed(int argc, char **argv)
+{
+	unsigned seed = (argc > 1) ? (unsigned)atoi(argv[1]) : (unsigned)time(NULL);
+	srand(seed);
+	fprintf(stdout, "seed %u\n", seed);
+	return seed;
+}
+
+template <size_t N>
+const char * random_pick(const char * const (&names)[N])
+{
+	return names[rand() % N];
+}
+
+// Owners of the jobs in a random history file; Owner == ignores case, so
+// two differ only in case.
+static const char * const random_history_owners[] = { "alice", "Alice", "bob", "carol", "dave" };
+
+// The range of the ClusterIds and CompletionDates in a random history file
+struct RandomHistory {
+	int max_cluster = 1;
+	long long max_completion = 1000;
+};
+
+// Append num_ads job ads to the history file with AppendHistory(), as a
+// schedd does: clusters of a few procs, mostly in order, with completion
+// dates that mostly go up.  Now and then ClusterId, ProcId, Owner or
+// CompletionDate is left out, and add_attrs adds whatever else the test
+// wants in the ad.  After reopen_at ads, the history file is closed and
+// opened again, as when the schedd is reconfigured.
+inline RandomHistory write_random_history(int num_ads, int reopen_at,
+	const std::function<void(ClassAd &)> &add_attrs)
+{
+	RandomHistory history;
+	int proc = 0;
+	for (int ix = 0; ix < num_ads; ++ix) {
+		if (ix == reopen_at) {
+			InitJobHistoryFile("HISTORY", "PER_JOB_HISTORY_DIR");
+		}
+		if (rand() % 3 == 0) {
+			++history.max_cluster;
+			proc = 0;
+		}
+		int cluster = (rand() % 40) ? history.max_cluster : 1 + rand() % history.max_cluster;
+		history.max_completion += rand() % 5;
+
+		ClassAd job;
+		if (rand() % 50) { job.Assign(ATTR_CLUSTER_ID, cluster); }
+		if (rand() % 50) { job.Assign(ATTR_PROC_ID, proc); }
+		if (rand() % 30) { job.Assign(ATTR_OWNER, random_pick(random_history_owners)); }
+		if (rand() % 20) { job.Assign(ATTR_COMPLETION_DATE, history.max_completion - (rand() % 10)); }
+		++proc;
+		add_attrs(job);
+		AppendHistory(&job);
+	}
+	InitJobHistoryFile("HISTORY", "PER_JOB_HISTORY_DIR");
+	return history;
+}
+
+#endif
@@ -0,0 +1,154 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "work_stealing_pool.h"
+
+WorkStealingPool::WorkStealingPool(int num_workers)
+	: queues(num_workers < 1 ? 1 : num_workers)
+	, job_fn(NULL)
+	, job_count(0)
+	, job_chunk_size(1)
+	, job_generation(0)
+	, busy(0)
+	, shutting_down(false)
+	, num_steals(0)
+{
+		// the jobs may dprintf, which only locks if told to expect threads
+	if (queues.size() > 1) {
+		dprintf_make_thread_safe();
+	}
+	for (int worker = 1; worker < (int)queues.size(); ++worker) {
+		threads.emplace_back(&WorkStealingPool::threadMain, this, worker);
+	}
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		shutting_down = true;
+	}
+	wake.notify_all();
+	for (auto & thr : threads) {
+		thr.join();
+	}
+}
+
+// take the next chunk from our own share, or steal the last one from someone else's
+bool WorkStealingPool::takeChunk(int worker, size_t & chunk)
+{
+	{
+		Queue & q = queues[worker];
+		std::lock_guard<std::mutex> guard(q.mtx);
+		if (q.head < q.tail) {
+			chunk = q.head++;
+			return true;
+		}
+	}
+
+	int num_workers = (int)queues.size();
+	for (int ix = 1; ix < num_workers; ++ix) {
+		Queue & q = queues[(worker + ix) % num_workers];
+		std::lock_guard<std::mutex> guard(q.mtx);
+		if (q.head < q.tail) {
+			chunk = --q.tail;
+			num_steals++;
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkStealingPool::work(int worker)
+{
+	size_t chunk;
+	while (takeChunk(worker, chunk)) {
+		size_t begin = chunk * job_chunk_size;
+		size_t end = begin + job_chunk_size;
+		if (end > job_count) { end = job_count; }
+		(*job_fn)(begin, end, worker);
+	}
+}
+
+void WorkStealingPool::threadMain(int worker)
+{
+	unsigned int seen_generation = 0;
+	std::unique_lock<std::mutex> lock(mtx);
+	for (;;) {
+		wake.wait(lock, [&]{ return shutting_down || (job_fn && job_generation != seen_generation); });
+		if (shutting_down) {
+			return;
+		}
+		seen_generation = job_generation;
+		++busy;
+		lock.unlock();
+
+		work(worker);
+
+		lock.lock();
+		if (--busy == 0) {
+			idle.notify_all();
+		}
+	}
+}
+
+void WorkStealingPool::run(size_t count, size_t chunk_size, const ChunkFunc & fn)
+{
+	if ( ! count) {
+		return;
+	}
+	if (chunk_size < 1) { chunk_size = 1; }
+
+	size_t num_chunks = (count + chunk_size - 1) / chunk_size;
+	size_t num_workers = queues.size();
+
+	// with nothing to share, don't bother waking anyone
+	if (num_workers == 1 || num_chunks == 1) {
+		fn(0, count, 0);
+		return;
+	}
+
+	// give each worker an equal contiguous share of the chunks
+	for (size_t worker = 0; worker < num_workers; ++worker) {
+		Queue & q = queues[worker];
+		std::lock_guard<std::mutex> guard(q.mtx);
+		q.head = (num_chunks * worker) / num_workers;
+		q.tail = (num_chunks * (worker + 1)) / num_workers;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(mtx);
+		job_fn = &fn;
+		job_count = count;
+		job_chunk_size = chunk_size;
+		++job_generation;
+	}
+	wake.notify_all();
+
+	work(0);
+
+	// every chunk has been taken once we get here, but pool threads may
+	// still be running theirs.  a thread that wakes up after we clear
+	// job_fn will find nothing to do.
+	std::unique_lock<std::mutex> lock(mtx);
+	idle.wait(lock, [&]{ return busy == 0; });
+	job_fn = NULL;
+}
@@ -0,0 +1,95 @@
+/***************************************************************
+ *
+ * Copyright (C) 1990-2023, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _WORK_STEALING_POOL_H
+#define _WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** A fixed set of threads for running a loop over an index range in
+	parallel.  run() splits the range into chunks and gives each worker
+	an equal, contiguous share of them.  A worker takes chunks from the
+	front of its own share, and when that is empty it steals chunks from
+	the back of another worker's share, so a worker that draws expensive
+	items does not hold up the others.
+
+	The thread that calls run() is worker 0 and works alongside the pool
+	threads, so a pool of size 1 has no threads and simply runs the loop.
+	The function passed to run() must not call back into daemon core or
+	anything else that is not thread safe.  Only one thread may call run()
+	at a time.
+*/
+class WorkStealingPool
+{
+public:
+	// fn(begin, end, worker) processes items [begin, end) on behalf of worker
+	typedef std::function<void(size_t begin, size_t end, int worker)> ChunkFunc;
+
+	// num_workers includes the calling thread
+	explicit WorkStealingPool(int num_workers);
+	~WorkStealingPool();
+
+	int size() const { return (int)queues.size(); }
+
+	// call fn for every chunk of [0, count) and return when all are done
+	void run(size_t count, size_t chunk_size, const ChunkFunc & fn);
+
+	// the number of chunks that were run by a worker other than the one
+	// they were given to, since the pool was created
+	size_t steals() const { return num_steals; }
+
+private:
+	WorkStealingPool(const WorkStealingPool &);
+	WorkStealingPool & operator=(const WorkStealingPool &);
+
+	// the chunks [head, tail) not yet taken from one worker's share
+	struct Queue {
+		std::mutex mtx;
+		size_t head;
+		size_t tail;
+		Queue() : head(0), tail(0) {}
+	};
+
+	bool takeChunk(int worker, size_t & chunk);
+	void work(int worker);
+	void threadMain(int worker);
+
+	std::vector<Queue> queues;
+	std::vector<std::thread> threads;
+
+	// the current job, protected by mtx
+	std::mutex mtx;
+	std::condition_variable wake;   // signalled when a job starts or the pool shuts down
+	std::condition_variable idle;   // signalled when a worker finishes with a job
+	const ChunkFunc * job_fn;
+	size_t job_count;
+	size_t job_chunk_size;
+	unsigned int job_generation;
+	int busy;                       // pool threads working on the current job
+	bool shutting_down;
+
+	std::atomic<size_t> num_steals;
+};
+
+#endif
@@ -1091,6 +1091,7 @@ public:
     int  procId() const {return m_proc_id;}
     int  newCluster();
     int  newProc();
+    int  reserveProc() { return ++m_proc_id; } // the schedd creates this proc when SendJobAd sends its ad
     void reschedule();
     std::string owner() const;
     std::string schedd_version();
@@ -3313,6 +3314,21 @@ public:
 		return false;
 	}
 
+	// helper function for determining if the schedd can take the ads of a cluster a message at a time
+	bool begin_send_job_ads_if_supported(boost::shared_ptr<ConnectionSentry> txn, int cluster)
+	{
+		bool send_ads = false;
+		const ClassAd *capabilities = txn->capabilites();
+		if (capabilities) {
+			capabilities->LookupBool("SendJobAds", send_ads);
+		}
+		if (send_ads) {
+			condor::ModuleLock ml;
+			send_ads = BeginSendJobAds(cluster, SetAttribute_NoAck) >= 0;
+		}
+		return send_ads;
+	}
+
 	// helper function for determining if this is a factory submit for a job submit
 	bool is_factory(long long & max_materialize, boost::shared_ptr<ConnectionSentry> txn)
 	{
@@ -3511,9 +3527,10 @@ public:
 		} else {
 			// loop through the itemdata, sending jobs for each item
 			//
+			bool send_ads = begin_send_job_ads_if_supported(txn, cluster);
 			while ((rval = ssi.next(jid, item_index, step)) > 0) {
 
-				int procid = txn->newProc();
+				int procid = send_ads ? txn->reserveProc() : txn->newProc();
 				if (procid < 0) {
 				    THROW_EX(HTCondorIOError, "Failed to create new proc ID.");
 				}
@@ -3530,13 +3547,21 @@ public:
 					classad::ClassAd * clusterad = proc_ad->GetChainedParentAd();
 					if (clusterad) {
 						condor::ModuleLock ml;
-						rval = SendJobAttributes(JOB_ID_KEY(cluster, -1), *clusterad, SetAttribute_NoAck, m_hash.error_stack(), "Submit");
+						if (send_ads) {
+							rval = SendJobAd(JOB_ID_KEY(cluster, -1), *clusterad, m_hash.error_stack(), "Submit");
+						} else {
+							rval = SendJobAttributes(JOB_ID_KEY(cluster, -1), *clusterad, SetAttribute_NoAck, m_hash.error_stack(), "Submit");
+						}
 					}
 				}
 				// send the proc ad unless there was a failure.
 				if (rval >= 0) {
 					condor::ModuleLock ml;
-					rval = SendJobAttributes(jid, *proc_ad, SetAttribute_NoAck, m_hash.error_stack(), "Submit");
+					if (send_ads) {
+						rval = SendJobAd(jid, *proc_ad, m_hash.error_stack(), "Submit");
+					} else {
+						rval = SendJobAttributes(jid, *proc_ad, SetAttribute_NoAck, m_hash.error_stack(), "Submit");
+					}
 				}
 				process_submit_errstack(m_hash.error_stack());
 				if (rval < 0) {
@@ -3551,6 +3576,17 @@ public:
 
 				++num_jobs;
 			}
+			if (send_ads) {
+				int rv;
+				{
+				condor::ModuleLock ml;
+				rv = EndSendJobAds(m_hash.error_stack(), "Submit");
+				}
+				process_submit_errstack(m_hash.error_stack());
+				if (rv < 0) {
+					THROW_EX(HTCondorIOError, "Failed to send job attributes");
+				}
+			}
 		}
 
         if (param_boolean("SUBMIT_SEND_RESCHEDULE",true))
@@ -3673,9 +3709,10 @@ public:
 
 		} else {
 
+			bool send_ads = begin_send_job_ads_if_supported(txn, cluster);
 			while ((rval = ssi.next(jid, item_index, step)) > 0) {
 
-				int procid = txn->newProc();
+				int procid = send_ads ? txn->reserveProc() : txn->newProc();
 				if (procid < 0) {
 				    THROW_EX(HTCondorIOError, "Failed to create new proc ID.");
 				}
@@ -3695,12 +3732,20 @@ public:
 					if (clusterad) {
 						// before the cluster ad, send the jobset ad if we have one, and can send it
 						push_jobset_if_supported(txn, cluster);
-						rval = SendJobAttributes(JOB_ID_KEY(cluster, -1), *clusterad, SetAttribute_NoAck, m_hash.error_stack(), "Submit");
+						if (send_ads) {
+							rval = SendJobAd(JOB_ID_KEY(cluster, -1), *clusterad, m_hash.error_stack(), "Submit");
+						} else {
+							rval = SendJobAttributes(JOB_ID_KEY(cluster, -1), *clusterad, SetAttribute_NoAck, m_hash.error_stack(), "Submit");
+						}
 					}
 				}
 				// send the proc ad unless there was a failure.
 				if (rval >= 0) {
-					rval = SendJobAttributes(jid, *proc_ad, SetAttribute_NoAck, m_hash.error_stack(), "Submit");
+					if (send_ads) {
+						rval = SendJobAd(jid, *proc_ad, m_hash.error_stack(), "Submit");
+					} else {
+						rval = SendJobAttributes(jid, *proc_ad, SetAttribute_NoAck, m_hash.error_stack(), "Submit");
+					}
 				}
 				process_submit_errstack(m_hash.error_stack());
 				if (rval < 0) {
@@ -3709,6 +3754,13 @@ public:
 
 				++num_jobs;
 			}
+			if (send_ads) {
+				int rv = EndSendJobAds(m_hash.error_stack(), "Submit");
+				process_submit_errstack(m_hash.error_stack());
+				if (rv < 0) {
+					THROW_EX(HTCondorIOError, "Failed to send job attributes");
+				}
+			}
 
 		}
 